@@ -79,12 +79,117 @@
 #endif
 
 /**
- * Set the maximum number of client connections
+ * Default maximum number of client connections of a CS104 server. The limit can be changed
+ * at runtime (see CS104_Slave_setMaxOpenConnections).
  */
 #ifndef CONFIG_CS104_MAX_CLIENT_CONNECTIONS
 #define CONFIG_CS104_MAX_CLIENT_CONNECTIONS 100
 #endif
 
+/**
+ * Default number of worker threads for the CS104 server threading model
+ * CS104_THREADING_MODEL_EVENT_LOOP (only CS104 server)
+ */
+#ifndef CONFIG_CS104_EVENT_LOOP_DEFAULT_WORKERS
+#define CONFIG_CS104_EVENT_LOOP_DEFAULT_WORKERS 4
+#endif
+
+/**
+ * Number of threads that perform the TLS handshakes of new client connections for the CS104
+ * server threading model CS104_THREADING_MODEL_EVENT_LOOP. This is the maximum number of
+ * concurrent handshakes. Further connections wait until a handshake thread is free.
+ * A client that doesn't complete the handshake blocks a handshake thread for at most t0.
+ */
+#ifndef CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS
+#define CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS 2
+#endif
+
+/**
+ * Default size of the output buffer (in bytes) that is used by the CS104 server to send
+ * multiple APDUs with a single socket write. 0 -> each APDU is written separately.
+ */
+#ifndef CONFIG_CS104_DEFAULT_TX_BATCH_SIZE
+#define CONFIG_CS104_DEFAULT_TX_BATCH_SIZE 4096
+#endif
+
+/**
+ * Default number of entries of the lock-free ingress queue that is used by CS104_Slave_enqueueASDU
+ * (CS104 server). 0 -> the ASDUs are directly added to the event queue (protected by a lock).
+ */
+#ifndef CONFIG_CS104_DEFAULT_INGRESS_QUEUE_SIZE
+#define CONFIG_CS104_DEFAULT_INGRESS_QUEUE_SIZE 0
+#endif
+
+/**
+ * Support for an event queue that is stored in a memory mapped file (CS104 server). Unconfirmed
+ * events in the file are sent again after the server is restarted (see CS104_Slave_setEventQueueFile).
+ */
+#ifndef CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE
+#define CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE 1
+#endif
+
+/**
+ * Support for the replication of the event queue to a warm-standby server (CS104 server). The active
+ * server sends new events and confirmations to the standby server (see CS104_Slave_setReplicationPort
+ * and CS104_Slave_startStandby). Requires CONFIG_USE_THREADS = 1.
+ */
+#ifndef CONFIG_CS104_SUPPORT_EVENT_QUEUE_REPLICATION
+#define CONFIG_CS104_SUPPORT_EVENT_QUEUE_REPLICATION 1
+#endif
+
+/**
+ * Time (in ms) the changes of the event queue are collected before they are sent to the standby
+ * server with a single socket write (CS104 server).
+ */
+#ifndef CONFIG_CS104_EVENT_QUEUE_REPLICATION_INTERVAL
+#define CONFIG_CS104_EVENT_QUEUE_REPLICATION_INTERVAL 10
+#endif
+
+/**
+ * Maximum number of open commands of the asynchronous command handler (CS104 server).
+ * Additional commands are rejected with a negative ACT_CON (see CS104_Slave_setAsyncCommandHandler).
+ */
+#ifndef CONFIG_CS104_MAX_PENDING_COMMANDS
+#define CONFIG_CS104_MAX_PENDING_COMMANDS 32
+#endif
+
+/**
+ * Record latency histograms of the events sent by a CS104 server connection (time in the event queue,
+ * time until confirmation by the client), see CS104_Slave_getConnectionLatency.
+ * 0 -> no time stamps are taken and the histograms are not available.
+ */
+#ifndef CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS
+#define CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS 1
+#endif
+
+/**
+ * Size of the receive buffer (in bytes) of a CS104 connection. All available data (up to
+ * this size) is read from the socket at once and can contain multiple APDUs.
+ * Minimum size is 256 bytes (one APDU).
+ */
+#ifndef CONFIG_CS104_RX_BUFFER_SIZE
+#define CONFIG_CS104_RX_BUFFER_SIZE 16384
+#endif
+
+/**
+ * Maximum time (in ms) a CS104 server connection waits for new events when nothing has to be sent.
+ * The connection handling is woken up earlier by received data, enqueued ASDUs, and the protocol
+ * timers (T1, T2, T3). When wakeups are not supported by the platform or plugins are used
+ * the maximum wait time is 100 ms.
+ */
+#ifndef CONFIG_CS104_SLAVE_MAX_WAIT_TIME
+#define CONFIG_CS104_SLAVE_MAX_WAIT_TIME 1000
+#endif
+
+/**
+ * Maximum number of pending connection requests of a listening socket of the CS104 server. Connection
+ * requests that arrive at the same time (e.g. after a failover of the control center) are rejected by
+ * the operating system when the queue is full.
+ */
+#ifndef CONFIG_CS104_SLAVE_LISTEN_BACKLOG
+#define CONFIG_CS104_SLAVE_LISTEN_BACKLOG 1024
+#endif
+
 /* activate TCP keep alive mechanism. 1 -> activate */
 #ifndef CONFIG_ACTIVATE_TCP_KEEPALIVE
 #define CONFIG_ACTIVATE_TCP_KEEPALIVE 0
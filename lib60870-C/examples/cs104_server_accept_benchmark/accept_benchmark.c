@@ -0,0 +1,219 @@
+/*
+ * Measures how fast the CS104 server accepts many connections that arrive at the
+ * same time (e.g. all clients of a control center reconnect after a failover).
+ * The server uses the event loop threading model with a single listening socket
+ * and with one listening socket per worker (accept sharding). The connection
+ * request handler simulates the time that is required to check a new client.
+ *
+ * usage: cs104_server_accept_benchmark [<number of connections> [<number of workers> [<check time in ms>]]]
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cs104_slave.h"
+
+#include "hal_socket.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+
+#define MAX_CONNECTIONS 1000
+#define NUMBER_OF_CLIENT_THREADS 8
+
+struct sServerState
+{
+    Semaphore lock;
+    int openedConnections;
+    int checkTime;
+};
+
+struct sClientThread
+{
+    Socket* sockets;
+    int numberOfSockets;
+};
+
+static bool
+connectionRequestHandler(void* parameter, const char* ipAddress)
+{
+    struct sServerState* state = (struct sServerState*)parameter;
+
+    (void)ipAddress;
+
+    /* e.g. look up the client in a list of allowed clients */
+    if (state->checkTime > 0)
+        Thread_sleep(state->checkTime);
+
+    return true;
+}
+
+static void
+connectionEventHandler(void* parameter, IMasterConnection con, CS104_PeerConnectionEvent event)
+{
+    struct sServerState* state = (struct sServerState*)parameter;
+
+    (void)con;
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+    {
+        Semaphore_wait(state->lock);
+        state->openedConnections++;
+        Semaphore_post(state->lock);
+    }
+}
+
+static int
+getOpenedConnections(struct sServerState* state)
+{
+    int openedConnections;
+
+    Semaphore_wait(state->lock);
+    openedConnections = state->openedConnections;
+    Semaphore_post(state->lock);
+
+    return openedConnections;
+}
+
+static void*
+clientThread(void* parameter)
+{
+    struct sClientThread* client = (struct sClientThread*)parameter;
+
+    int i;
+
+    for (i = 0; i < client->numberOfSockets; i++)
+    {
+        Socket socket = TcpSocket_create();
+
+        if (socket)
+        {
+            if (Socket_connect(socket, "127.0.0.1", 2404) == false)
+            {
+                Socket_destroy(socket);
+                socket = NULL;
+            }
+        }
+
+        client->sockets[i] = socket;
+    }
+
+    return NULL;
+}
+
+static void
+runBenchmark(int numberOfConnections, int numberOfWorkers, int checkTime, bool acceptSharding)
+{
+    struct sServerState state;
+    state.lock = Semaphore_create(1);
+    state.openedConnections = 0;
+    state.checkTime = checkTime;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 2404);
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setThreadingModel(slave, CS104_THREADING_MODEL_EVENT_LOOP, numberOfWorkers);
+    CS104_Slave_setAcceptSharding(slave, acceptSharding);
+    CS104_Slave_setMaxOpenConnections(slave, numberOfConnections);
+
+    CS104_Slave_setConnectionRequestHandler(slave, connectionRequestHandler, &state);
+    CS104_Slave_setConnectionEventHandler(slave, connectionEventHandler, &state);
+
+    CS104_Slave_start(slave);
+
+    if (CS104_Slave_isRunning(slave) == false)
+    {
+        printf("Starting server failed!\n");
+        CS104_Slave_destroy(slave);
+        Semaphore_destroy(state.lock);
+        return;
+    }
+
+    Socket sockets[MAX_CONNECTIONS];
+    struct sClientThread clients[NUMBER_OF_CLIENT_THREADS];
+    Thread threads[NUMBER_OF_CLIENT_THREADS];
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    int i;
+    int offset = 0;
+
+    for (i = 0; i < NUMBER_OF_CLIENT_THREADS; i++)
+    {
+        clients[i].sockets = sockets + offset;
+        clients[i].numberOfSockets = numberOfConnections / NUMBER_OF_CLIENT_THREADS;
+
+        if (i < (numberOfConnections % NUMBER_OF_CLIENT_THREADS))
+            clients[i].numberOfSockets++;
+
+        offset += clients[i].numberOfSockets;
+
+        threads[i] = Thread_create(clientThread, &(clients[i]), false);
+        Thread_start(threads[i]);
+    }
+
+    for (i = 0; i < NUMBER_OF_CLIENT_THREADS; i++)
+        Thread_destroy(threads[i]);
+
+    /* wait until the server has accepted all connections (max. 60 s) */
+    while ((getOpenedConnections(&state) < numberOfConnections) &&
+           ((Hal_getMonotonicTimeInMs() - startTime) < 60000))
+    {
+        Thread_sleep(1);
+    }
+
+    uint64_t duration = Hal_getMonotonicTimeInMs() - startTime;
+
+    int openedConnections = getOpenedConnections(&state);
+
+    if (duration == 0)
+        duration = 1;
+
+    printf("%-16s %2i workers: %i of %i connections accepted in %i ms (%i connections/s)\n",
+           acceptSharding ? "accept sharding" : "single listener", numberOfWorkers, openedConnections,
+           numberOfConnections, (int)duration, (int)(openedConnections * 1000ULL / duration));
+
+    for (i = 0; i < numberOfConnections; i++)
+    {
+        if (sockets[i])
+            Socket_destroy(sockets[i]);
+    }
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    Semaphore_destroy(state.lock);
+}
+
+int
+main(int argc, char** argv)
+{
+    int numberOfConnections = 400;
+    int numberOfWorkers = 4;
+    int checkTime = 1;
+
+    if (argc > 1)
+        numberOfConnections = atoi(argv[1]);
+
+    if (argc > 2)
+        numberOfWorkers = atoi(argv[2]);
+
+    if (argc > 3)
+        checkTime = atoi(argv[3]);
+
+    if ((numberOfConnections < 1) || (numberOfConnections > MAX_CONNECTIONS))
+    {
+        printf("number of connections has to be between 1 and %i\n", MAX_CONNECTIONS);
+        return 1;
+    }
+
+    /* all connections are accepted and checked by the server thread */
+    runBenchmark(numberOfConnections, numberOfWorkers, checkTime, false);
+
+    /* each worker accepts and checks connections with its own listening socket */
+    runBenchmark(numberOfConnections, numberOfWorkers, checkTime, true);
+
+    return 0;
+}
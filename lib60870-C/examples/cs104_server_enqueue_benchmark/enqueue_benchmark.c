@@ -0,0 +1,186 @@
+/*
+ * Measures the throughput of CS104_Slave_enqueueASDU when multiple application
+ * threads enqueue events at the same time (with and without the lock-free
+ * ingress queue). When a file name is given the throughput of the persistent
+ * event queue (memory mapped file) is measured as well.
+ *
+ * usage: cs104_server_enqueue_benchmark [<number of producers> [<events per producer> [<event queue file>]]]
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cs104_slave.h"
+#include "cs104_connection.h"
+
+#include "hal_thread.h"
+#include "hal_time.h"
+
+#define MAX_PRODUCERS 64
+
+struct sProducer
+{
+    CS104_Slave slave;
+    int producerId;
+    int numberOfEvents;
+};
+
+static void*
+producerThread(void* parameter)
+{
+    struct sProducer* producer = (struct sProducer*)parameter;
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(producer->slave);
+
+    int i;
+
+    for (i = 0; i < producer->numberOfEvents; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 1000 + producer->producerId,
+                                                                             (int16_t)i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(producer->slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+
+    return NULL;
+}
+
+static bool
+asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* receivedEvents = (int*)parameter;
+
+    (*receivedEvents)++;
+
+    return true;
+}
+
+static void
+runBenchmark(int numberOfProducers, int eventsPerProducer, int ingressQueueSize, const char* eventQueueFile,
+             bool syncOnWrite)
+{
+    CS104_Slave slave = CS104_Slave_create(10000, 100);
+
+    CS104_Slave_setLocalPort(slave, 2404);
+    CS104_Slave_setIngressQueueSize(slave, ingressQueueSize);
+
+    if (eventQueueFile)
+    {
+        /* start with an empty event queue */
+        remove(eventQueueFile);
+
+        CS104_Slave_setEventQueueFile(slave, eventQueueFile, syncOnWrite);
+    }
+
+    CS104_Slave_start(slave);
+
+    if (CS104_Slave_isRunning(slave) == false)
+    {
+        printf("Starting server failed!\n");
+        CS104_Slave_destroy(slave);
+        return;
+    }
+
+    /* local client that receives the events */
+    int receivedEvents = 0;
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 2404);
+
+    CS104_Connection_setASDUReceivedHandler(con, asduReceivedHandler, &receivedEvents);
+
+    if (CS104_Connection_connect(con))
+        CS104_Connection_sendStartDT(con);
+    else
+        printf("Connecting client failed!\n");
+
+    Thread_sleep(100);
+
+    struct sProducer producers[MAX_PRODUCERS];
+    Thread threads[MAX_PRODUCERS];
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    int i;
+
+    for (i = 0; i < numberOfProducers; i++)
+    {
+        producers[i].slave = slave;
+        producers[i].producerId = i;
+        producers[i].numberOfEvents = eventsPerProducer;
+
+        threads[i] = Thread_create(producerThread, &(producers[i]), false);
+        Thread_start(threads[i]);
+    }
+
+    for (i = 0; i < numberOfProducers; i++)
+        Thread_destroy(threads[i]);
+
+    uint64_t duration = Hal_getMonotonicTimeInMs() - startTime;
+
+    int totalEvents = numberOfProducers * eventsPerProducer;
+
+    if (duration == 0)
+        duration = 1;
+
+    printf("%-13s ingress queue size %5i: %i producers enqueued %i events in %i ms (%i events/s, %i received by client)\n",
+           eventQueueFile ? (syncOnWrite ? "file (sync)" : "file") : "memory", ingressQueueSize, numberOfProducers,
+           totalEvents, (int)duration, (int)(totalEvents * 1000ULL / duration), receivedEvents);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+int
+main(int argc, char** argv)
+{
+    int numberOfProducers = 8;
+    int eventsPerProducer = 100000;
+    const char* eventQueueFile = NULL;
+
+    if (argc > 1)
+        numberOfProducers = atoi(argv[1]);
+
+    if (argc > 2)
+        eventsPerProducer = atoi(argv[2]);
+
+    if (argc > 3)
+        eventQueueFile = argv[3];
+
+    if ((numberOfProducers < 1) || (numberOfProducers > MAX_PRODUCERS))
+    {
+        printf("number of producers has to be between 1 and %i\n", MAX_PRODUCERS);
+        return 1;
+    }
+
+    /* all ASDUs are added to the event queue while holding the queue lock */
+    runBenchmark(numberOfProducers, eventsPerProducer, 0, NULL, false);
+
+    /* ASDUs are added to the lock-free ingress queue */
+    runBenchmark(numberOfProducers, eventsPerProducer, 4096, NULL, false);
+
+    if (eventQueueFile)
+    {
+        /* event queue in memory mapped file */
+        runBenchmark(numberOfProducers, eventsPerProducer, 0, eventQueueFile, false);
+        runBenchmark(numberOfProducers, eventsPerProducer, 4096, eventQueueFile, false);
+
+        /* each event is written to the storage device (much slower -> fewer events) */
+        runBenchmark(numberOfProducers, eventsPerProducer / 100 + 1, 0, eventQueueFile, true);
+
+        remove(eventQueueFile);
+    }
+
+    return 0;
+}
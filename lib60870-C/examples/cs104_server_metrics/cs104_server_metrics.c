@@ -0,0 +1,292 @@
+/*
+ * CS104 server that provides the connection metrics in the Prometheus text format.
+ *
+ * The metrics are served by a minimal HTTP listener (built on the HAL sockets) at
+ * http://<host>:<metrics port>/metrics
+ *
+ * usage: cs104_server_metrics [<metrics port>]
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+#include "cs104_slave.h"
+
+#include "hal_socket.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+
+#define MAX_CONNECTIONS 16
+
+static bool running = true;
+
+/* open client connections (to label the metrics with the peer address) */
+static IMasterConnection connections[MAX_CONNECTIONS];
+static char peerAddresses[MAX_CONNECTIONS][60];
+static Semaphore connectionsLock = NULL;
+
+void
+sigint_handler(int signalId)
+{
+    running = false;
+}
+
+static void
+connectionEventHandler(void* parameter, IMasterConnection con, CS104_PeerConnectionEvent event)
+{
+    int i;
+
+    Semaphore_wait(connectionsLock);
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+    {
+        for (i = 0; i < MAX_CONNECTIONS; i++)
+        {
+            if (connections[i] == NULL)
+            {
+                connections[i] = con;
+                IMasterConnection_getPeerAddress(con, peerAddresses[i], sizeof(peerAddresses[i]));
+                break;
+            }
+        }
+    }
+    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED)
+    {
+        for (i = 0; i < MAX_CONNECTIONS; i++)
+        {
+            if (connections[i] == con)
+                connections[i] = NULL;
+        }
+    }
+
+    Semaphore_post(connectionsLock);
+}
+
+static int
+appendMetric(char* buffer, int bufSize, int pos, const char* name, const char* labels, uint64_t value)
+{
+    if (pos >= bufSize)
+        return pos;
+
+    int written = snprintf(buffer + pos, bufSize - pos, "%s%s %llu\n", name, labels, (unsigned long long)value);
+
+    if (written > 0)
+        pos += written;
+
+    return pos;
+}
+
+static int
+appendMetrics(char* buffer, int bufSize, int pos, const char* labels, CS104_ConnectionMetrics metrics)
+{
+    pos = appendMetric(buffer, bufSize, pos, "iec104_i_frames_received_total", labels, metrics->iFramesReceived);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_i_frames_sent_total", labels, metrics->iFramesSent);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_s_frames_received_total", labels, metrics->sFramesReceived);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_s_frames_sent_total", labels, metrics->sFramesSent);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_u_frames_received_total", labels, metrics->uFramesReceived);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_u_frames_sent_total", labels, metrics->uFramesSent);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_bytes_received_total", labels, metrics->bytesReceived);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_bytes_sent_total", labels, metrics->bytesSent);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_k_window_stalls_total", labels, metrics->kWindowStalls);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_t1_timeouts_total", labels, metrics->t1Timeouts);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_t2_timeouts_total", labels, metrics->t2Timeouts);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_t3_timeouts_total", labels, metrics->t3Timeouts);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_high_prio_queue_full_total", labels, metrics->highPrioQueueFull);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_high_prio_queue_depth", labels, metrics->highPrioQueueDepth);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_unconfirmed_i_frames", labels, metrics->unconfirmedIFrames);
+    pos = appendMetric(buffer, bufSize, pos, "iec104_oldest_unconfirmed_age_ms", labels, metrics->oldestUnconfirmedAge);
+
+    return pos;
+}
+
+/* create the metrics page in the Prometheus text format */
+static int
+createMetricsPage(CS104_Slave slave, char* buffer, int bufSize)
+{
+    struct sCS104_ConnectionMetrics metrics;
+    struct sCS104_QueueStatistics queueStats;
+
+    int pos = 0;
+    int i;
+
+    /* sum of all (also closed) connections */
+    if (CS104_Slave_getRedundancyGroupMetrics(slave, NULL, &metrics))
+        pos = appendMetrics(buffer, bufSize, pos, "{connection=\"all\"}", &metrics);
+
+    Semaphore_wait(connectionsLock);
+
+    for (i = 0; i < MAX_CONNECTIONS; i++)
+    {
+        if (connections[i] && CS104_Slave_getConnectionMetrics(slave, connections[i], &metrics))
+        {
+            char labels[80];
+
+            snprintf(labels, sizeof(labels), "{connection=\"%s\"}", peerAddresses[i]);
+
+            pos = appendMetrics(buffer, bufSize, pos, labels, &metrics);
+        }
+    }
+
+    Semaphore_post(connectionsLock);
+
+    if (CS104_Slave_getQueueStatistics(slave, NULL, &queueStats))
+    {
+        pos = appendMetric(buffer, bufSize, pos, "iec104_queue_enqueued_total", "", queueStats.enqueuedASDUs);
+        pos = appendMetric(buffer, bufSize, pos, "iec104_queue_dropped_total", "", queueStats.droppedASDUs);
+        pos = appendMetric(buffer, bufSize, pos, "iec104_queue_pending", "", queueStats.pendingASDUs);
+        pos = appendMetric(buffer, bufSize, pos, "iec104_queue_oldest_pending_age_ms", "", queueStats.oldestPendingAge);
+    }
+
+    pos = appendMetric(buffer, bufSize, pos, "iec104_open_connections", "", CS104_Slave_getOpenConnections(slave));
+
+    if (pos > bufSize)
+        pos = bufSize;
+
+    return pos;
+}
+
+static void
+writeAll(Socket socket, uint8_t* buffer, int size)
+{
+    uint64_t timeout = Hal_getMonotonicTimeInMs() + 1000;
+
+    while ((size > 0) && (Hal_getMonotonicTimeInMs() < timeout))
+    {
+        int written = Socket_write(socket, buffer, size);
+
+        if (written < 0)
+            break;
+
+        buffer += written;
+        size -= written;
+
+        if (written == 0)
+            Thread_sleep(1);
+    }
+}
+
+/* answer a single HTTP request with the metrics page */
+static void
+handleHttpRequest(CS104_Slave slave, Socket socket)
+{
+    char request[1024];
+    int requestSize = 0;
+
+    uint64_t timeout = Hal_getMonotonicTimeInMs() + 1000;
+
+    /* read the request header (the content of the request is ignored) */
+    while ((requestSize < (int)sizeof(request) - 1) && (Hal_getMonotonicTimeInMs() < timeout))
+    {
+        int readBytes = Socket_read(socket, (uint8_t*)request + requestSize, sizeof(request) - 1 - requestSize);
+
+        if (readBytes < 0)
+            return;
+
+        requestSize += readBytes;
+        request[requestSize] = 0;
+
+        if (strstr(request, "\r\n\r\n"))
+            break;
+
+        if (readBytes == 0)
+            Thread_sleep(1);
+    }
+
+    static char page[32768];
+    char header[128];
+
+    int pageSize = createMetricsPage(slave, page, sizeof(page));
+
+    int headerSize = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %i\r\n\r\n",
+                              pageSize);
+
+    writeAll(socket, (uint8_t*)header, headerSize);
+    writeAll(socket, (uint8_t*)page, pageSize);
+}
+
+int
+main(int argc, char** argv)
+{
+    int metricsPort = 9100;
+
+    if (argc > 1)
+        metricsPort = atoi(argv[1]);
+
+    signal(SIGINT, sigint_handler);
+
+    connectionsLock = Semaphore_create(1);
+
+    CS104_Slave slave = CS104_Slave_create(1000, 1000);
+
+    CS104_Slave_setLocalAddress(slave, "0.0.0.0");
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setConnectionEventHandler(slave, connectionEventHandler, NULL);
+
+    CS104_Slave_start(slave);
+
+    ServerSocket metricsSocket = NULL;
+
+    if (CS104_Slave_isRunning(slave) == false)
+        printf("Starting server failed!\n");
+    else
+        metricsSocket = TcpServerSocket_create("0.0.0.0", metricsPort);
+
+    if (metricsSocket)
+    {
+        ServerSocket_listen(metricsSocket);
+
+        printf("Metrics available at http://localhost:%i/metrics\n", metricsPort);
+
+        CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+        int16_t scaledValue = 0;
+        uint64_t nextEventTime = Hal_getMonotonicTimeInMs();
+
+        while (running)
+        {
+            Socket httpConnection = ServerSocket_accept(metricsSocket);
+
+            if (httpConnection)
+            {
+                handleHttpRequest(slave, httpConnection);
+                Socket_destroy(httpConnection);
+            }
+
+            /* create some traffic */
+            if (Hal_getMonotonicTimeInMs() >= nextEventTime)
+            {
+                CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_PERIODIC, 0, 1, false, false);
+
+                InformationObject io =
+                    (InformationObject)MeasuredValueScaled_create(NULL, 110, scaledValue++, IEC60870_QUALITY_GOOD);
+
+                CS101_ASDU_addInformationObject(newAsdu, io);
+
+                InformationObject_destroy(io);
+
+                CS104_Slave_enqueueASDU(slave, newAsdu);
+
+                CS101_ASDU_destroy(newAsdu);
+
+                nextEventTime += 1000;
+            }
+
+            Thread_sleep(10);
+        }
+
+        ServerSocket_destroy(metricsSocket);
+    }
+    else if (CS104_Slave_isRunning(slave))
+    {
+        printf("Cannot create metrics listener on port %i\n", metricsPort);
+    }
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    Semaphore_destroy(connectionsLock);
+}
@@ -0,0 +1,155 @@
+/*
+ * Measures how long the CS104 server needs to transmit a large event queue to a
+ * client with different values of the k parameter (maximum number of sent but
+ * unconfirmed APDUs). The time per event should not depend on k because the next
+ * waiting event is found without walking over the unconfirmed events.
+ *
+ * usage: cs104_server_transmit_benchmark [<number of events>]
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cs104_slave.h"
+#include "cs104_connection.h"
+
+#include "hal_thread.h"
+#include "hal_time.h"
+
+struct sClientState
+{
+    Semaphore lock;
+    int receivedEvents;
+};
+
+static bool
+asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct sClientState* state = (struct sClientState*)parameter;
+
+    (void)address;
+
+    if (CS101_ASDU_getCOT(asdu) == CS101_COT_SPONTANEOUS)
+    {
+        Semaphore_wait(state->lock);
+        state->receivedEvents++;
+        Semaphore_post(state->lock);
+    }
+
+    return true;
+}
+
+static int
+getReceivedEvents(struct sClientState* state)
+{
+    int receivedEvents;
+
+    Semaphore_wait(state->lock);
+    receivedEvents = state->receivedEvents;
+    Semaphore_post(state->lock);
+
+    return receivedEvents;
+}
+
+static void
+runBenchmark(int numberOfEvents, int k)
+{
+    CS104_Slave slave = CS104_Slave_create(numberOfEvents, 10);
+
+    CS104_Slave_setLocalPort(slave, 2404);
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+
+    CS104_APCIParameters slaveParams = CS104_Slave_getConnectionParameters(slave);
+    slaveParams->k = k;
+    slaveParams->w = (k * 2) / 3;
+
+    CS104_Slave_start(slave);
+
+    if (CS104_Slave_isRunning(slave) == false)
+    {
+        printf("Starting server failed!\n");
+        CS104_Slave_destroy(slave);
+        return;
+    }
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    int i;
+
+    for (i = 0; i < numberOfEvents; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+
+    struct sClientState state;
+    state.lock = Semaphore_create(1);
+    state.receivedEvents = 0;
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 2404);
+
+    CS104_APCIParameters clientParams = CS104_Connection_getAPCIParameters(con);
+    clientParams->k = slaveParams->k;
+    clientParams->w = slaveParams->w;
+
+    CS104_Connection_setASDUReceivedHandler(con, asduReceivedHandler, &state);
+
+    if (CS104_Connection_connect(con))
+    {
+        uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+        CS104_Connection_sendStartDT(con);
+
+        /* wait until all events are received (max. 60 s) */
+        while ((getReceivedEvents(&state) < numberOfEvents) && ((Hal_getMonotonicTimeInMs() - startTime) < 60000))
+            Thread_sleep(1);
+
+        uint64_t duration = Hal_getMonotonicTimeInMs() - startTime;
+
+        int receivedEvents = getReceivedEvents(&state);
+
+        printf("k = %4i: %i of %i events received in %i ms (%.2f us/event)\n", k, receivedEvents, numberOfEvents,
+               (int)duration, receivedEvents > 0 ? (duration * 1000.0) / receivedEvents : 0.0);
+    }
+    else
+        printf("Connecting to server failed!\n");
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    Semaphore_destroy(state.lock);
+}
+
+int
+main(int argc, char** argv)
+{
+    int numberOfEvents = 50000;
+
+    if (argc > 1)
+        numberOfEvents = atoi(argv[1]);
+
+    if (numberOfEvents < 1)
+    {
+        printf("number of events has to be greater than 0\n");
+        return 1;
+    }
+
+    runBenchmark(numberOfEvents, 12);
+    runBenchmark(numberOfEvents, 256);
+    runBenchmark(numberOfEvents, 1024);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ *  mapped_file_linux.c
+ *
+ *  Copyright 2026 Michael Zillgith
+ *
+ *  This file is part of Platform Abstraction Layer (libpal)
+ *  for libiec61850, libmms, and lib60870.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hal_mapped_file.h"
+#include "lib_memory.h"
+
+struct sMappedFile
+{
+    int fd;
+    int size;
+    uint8_t* buffer;
+};
+
+MappedFile
+MappedFile_open(const char* filename, int size, bool* isNew)
+{
+    MappedFile self = NULL;
+    void* buffer = NULL;
+    bool resized = false;
+    struct stat fileStat;
+
+    if (size < 1)
+        return NULL;
+
+    int fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if (fd == -1)
+        return NULL;
+
+    if (fstat(fd, &fileStat) == -1)
+        goto exit_error;
+
+    if (fileStat.st_size != (off_t)size)
+    {
+        /* drop old content -> new content is filled with zeros */
+        if (ftruncate(fd, 0) == -1)
+            goto exit_error;
+
+        if (ftruncate(fd, (off_t)size) == -1)
+            goto exit_error;
+
+        resized = true;
+    }
+
+    buffer = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (buffer == MAP_FAILED)
+        goto exit_error;
+
+    self = (MappedFile)GLOBAL_MALLOC(sizeof(struct sMappedFile));
+
+    if (self == NULL)
+    {
+        munmap(buffer, (size_t)size);
+        goto exit_error;
+    }
+
+    self->fd = fd;
+    self->size = size;
+    self->buffer = (uint8_t*)buffer;
+
+    if (isNew)
+        *isNew = resized;
+
+    return self;
+
+exit_error:
+    close(fd);
+    return NULL;
+}
+
+uint8_t*
+MappedFile_getBuffer(MappedFile self)
+{
+    return self->buffer;
+}
+
+int
+MappedFile_getSize(MappedFile self)
+{
+    return self->size;
+}
+
+bool
+MappedFile_sync(MappedFile self, bool wait)
+{
+    return (msync(self->buffer, (size_t)self->size, wait ? MS_SYNC : MS_ASYNC) == 0);
+}
+
+void
+MappedFile_close(MappedFile self)
+{
+    if (self)
+    {
+        msync(self->buffer, (size_t)self->size, MS_SYNC);
+        munmap(self->buffer, (size_t)self->size);
+        close(self->fd);
+
+        GLOBAL_FREEMEM(self);
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ *  mapped_file_win32.c
+ *
+ *  Copyright 2026 Michael Zillgith
+ *
+ *  This file is part of Platform Abstraction Layer (libpal)
+ *  for libiec61850, libmms, and lib60870.
+ */
+
+#include <windows.h>
+
+#include "hal_mapped_file.h"
+#include "lib_memory.h"
+
+struct sMappedFile
+{
+    HANDLE file;
+    HANDLE mapping;
+    int size;
+    uint8_t* buffer;
+};
+
+MappedFile
+MappedFile_open(const char* filename, int size, bool* isNew)
+{
+    MappedFile self = NULL;
+    HANDLE mapping = NULL;
+    void* buffer = NULL;
+    bool resized = false;
+    LARGE_INTEGER fileSize;
+
+    if (size < 1)
+        return NULL;
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (GetFileSizeEx(file, &fileSize) == FALSE)
+        goto exit_error;
+
+    if (fileSize.QuadPart != (LONGLONG)size)
+    {
+        LARGE_INTEGER position;
+
+        /* drop old content -> new content is filled with zeros */
+        position.QuadPart = 0;
+
+        if ((SetFilePointerEx(file, position, NULL, FILE_BEGIN) == FALSE) || (SetEndOfFile(file) == FALSE))
+            goto exit_error;
+
+        position.QuadPart = size;
+
+        if ((SetFilePointerEx(file, position, NULL, FILE_BEGIN) == FALSE) || (SetEndOfFile(file) == FALSE))
+            goto exit_error;
+
+        resized = true;
+    }
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+
+    if (mapping == NULL)
+        goto exit_error;
+
+    buffer = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+
+    if (buffer == NULL)
+    {
+        CloseHandle(mapping);
+        goto exit_error;
+    }
+
+    self = (MappedFile)GLOBAL_MALLOC(sizeof(struct sMappedFile));
+
+    if (self == NULL)
+    {
+        UnmapViewOfFile(buffer);
+        CloseHandle(mapping);
+        goto exit_error;
+    }
+
+    self->file = file;
+    self->mapping = mapping;
+    self->size = size;
+    self->buffer = (uint8_t*)buffer;
+
+    if (isNew)
+        *isNew = resized;
+
+    return self;
+
+exit_error:
+    CloseHandle(file);
+    return NULL;
+}
+
+uint8_t*
+MappedFile_getBuffer(MappedFile self)
+{
+    return self->buffer;
+}
+
+int
+MappedFile_getSize(MappedFile self)
+{
+    return self->size;
+}
+
+bool
+MappedFile_sync(MappedFile self, bool wait)
+{
+    if (FlushViewOfFile(self->buffer, (SIZE_T)self->size) == FALSE)
+        return false;
+
+    if (wait)
+        return (FlushFileBuffers(self->file) != FALSE);
+
+    return true;
+}
+
+void
+MappedFile_close(MappedFile self)
+{
+    if (self)
+    {
+        FlushViewOfFile(self->buffer, (SIZE_T)self->size);
+        FlushFileBuffers(self->file);
+
+        UnmapViewOfFile(self->buffer);
+        CloseHandle(self->mapping);
+        CloseHandle(self->file);
+
+        GLOBAL_FREEMEM(self);
+    }
+}
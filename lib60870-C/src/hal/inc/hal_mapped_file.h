@@ -0,0 +1,97 @@
+/*
+ *  hal_mapped_file.h
+ *
+ *  Copyright 2026 Michael Zillgith
+ *
+ *  This file is part of Platform Abstraction Layer (libpal)
+ *  for libiec61850, libmms, and lib60870.
+ */
+
+#ifndef HAL_MAPPED_FILE_H_
+#define HAL_MAPPED_FILE_H_
+
+#include "hal_base.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file hal_mapped_file.h
+ * \brief Abstraction layer for memory mapped files
+ */
+
+/*! \addtogroup hal
+   *
+   *  @{
+   */
+
+/**
+ * @defgroup HAL_MAPPED_FILE Memory mapped files
+ *
+ * A memory mapped file gives direct access to the content of a file of fixed size. Changes
+ * of the mapped memory are written back to the file by the operating system. They survive
+ * a crash of the process. \ref MappedFile_sync has to be used to make them survive a crash
+ * of the operating system or a power failure.
+ *
+ * @{
+ */
+
+/** Opaque reference for a memory mapped file */
+typedef struct sMappedFile* MappedFile;
+
+/**
+ * \brief Open a file and map it into memory. The file is created when it does not exist.
+ *
+ * When the file does not exist or has a different size it is resized to the requested
+ * size and the content is set to zero.
+ *
+ * \param filename name of the file
+ * \param size size of the file in bytes
+ * \param isNew returns true when the file has been created or resized (can be NULL)
+ *
+ * \return the mapped file instance or NULL in case of an error
+ */
+PAL_API MappedFile
+MappedFile_open(const char* filename, int size, bool* isNew);
+
+/**
+ * \brief Get the mapped memory of the file
+ *
+ * \return pointer to the first byte of the file content
+ */
+PAL_API uint8_t*
+MappedFile_getBuffer(MappedFile self);
+
+/**
+ * \brief Get the size of the mapped memory
+ */
+PAL_API int
+MappedFile_getSize(MappedFile self);
+
+/**
+ * \brief Write modified parts of the mapped memory to the storage device
+ *
+ * \param wait when true the function returns after the data has been written. Otherwise it only
+ *        schedules the write operation.
+ *
+ * \return true on success, false otherwise
+ */
+PAL_API bool
+MappedFile_sync(MappedFile self, bool wait);
+
+/**
+ * \brief Write all changes to the file, remove the mapping and close the file
+ */
+PAL_API void
+MappedFile_close(MappedFile self);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_MAPPED_FILE_H_ */
@@ -107,6 +107,80 @@ Handleset_removeSocket(HandleSet self, const Socket sock);
 PAL_API int
 Handleset_waitReady(HandleSet self, unsigned int timeoutMs);
 
+/**
+ * \brief check if a socket of the handle set is ready for reading
+ *
+ * Has to be called after \ref Handleset_waitReady to find out which of the monitored
+ * sockets have pending data (or an error condition). Querying the sockets in the
+ * order they were added to the handle set is the most efficient way.
+ *
+ * \param self the HandleSet instance
+ * \param sock the socket to check
+ *
+ * \return true when the socket is ready, false otherwise
+ */
+PAL_API bool
+Handleset_isReady(HandleSet self, const Socket sock);
+
+/**
+ * \brief monitor a socket of the handle set also for writability
+ *
+ * When enabled \ref Handleset_waitReady also returns when the socket can accept more data
+ * (e.g. after the socket send buffer was full). The socket has to be added with
+ * \ref Handleset_addSocket. The write interest is removed by \ref Handleset_reset.
+ *
+ * Implementation of this function is OPTIONAL (return false when not supported).
+ *
+ * \param self the HandleSet instance
+ * \param sock the socket to monitor
+ * \param enable true to monitor the socket for writability, false to stop monitoring
+ *
+ * \return true when the write interest was changed, false otherwise (not supported)
+ */
+PAL_API bool
+Handleset_setWriteInterest(HandleSet self, const Socket sock, bool enable);
+
+/**
+ * \brief check if a socket of the handle set is ready for writing
+ *
+ * Has to be called after \ref Handleset_waitReady. Only sockets with write interest
+ * (see \ref Handleset_setWriteInterest) are reported as writable.
+ *
+ * Implementation of this function is OPTIONAL (return false when not supported).
+ *
+ * \param self the HandleSet instance
+ * \param sock the socket to check
+ *
+ * \return true when the socket can accept more data (or has an error condition), false otherwise
+ */
+PAL_API bool
+Handleset_isWritable(HandleSet self, const Socket sock);
+
+/**
+ * \brief enable the wakeup handle of the handle set
+ *
+ * When enabled the handle set contains an additional internal handle (e.g. an eventfd on Linux)
+ * that is signaled by \ref Handleset_wakeup. This allows other threads to interrupt a
+ * \ref Handleset_waitReady call. The wakeup handle is not affected by \ref Handleset_reset.
+ *
+ * \param self the HandleSet instance
+ *
+ * \return true when the wakeup handle is available, false otherwise (not supported or out of resources)
+ */
+PAL_API bool
+Handleset_enableWakeup(HandleSet self);
+
+/**
+ * \brief interrupt a waiting (or the next) \ref Handleset_waitReady call
+ *
+ * This function can be called by any thread. It has no effect when the wakeup handle
+ * is not enabled (see \ref Handleset_enableWakeup).
+ *
+ * \param self the HandleSet instance
+ */
+PAL_API void
+Handleset_wakeup(HandleSet self);
+
 /**
  * \brief destroy the HandleSet instance
  *
@@ -128,6 +202,23 @@ Handleset_destroy(HandleSet self);
 PAL_API ServerSocket
 TcpServerSocket_create(const char* address, int port);
 
+/**
+ * \brief Create a new TcpServerSocket instance that shares the port with other server sockets
+ *
+ * Multiple server sockets can be bound to the same address and port (e.g. with the SO_REUSEPORT
+ * socket option on Linux). Incoming connections are distributed over the sockets by the operating
+ * system.
+ *
+ * Implementation of this function is OPTIONAL.
+ *
+ * \param address ip address or hostname to listen on
+ * \param port the TCP port to listen on
+ *
+ * \return the newly create TcpServerSocket instance or NULL when not supported
+ */
+PAL_API ServerSocket
+TcpServerSocket_createReusePort(const char* address, int port);
+
 /**
  * \brief Create an IPv4 UDP socket instance
  *
@@ -369,6 +460,38 @@ Socket_getPeerAddress(Socket self);
 PAL_API char*
 Socket_getPeerAddressStatic(Socket self, char* peerAddressString);
 
+/**
+ * \brief Get the operating system handle of the socket (file descriptor)
+ *
+ * The handle can be used to integrate the socket into an external event loop (e.g. epoll).
+ * The handle must not be closed or used to read or write data.
+ *
+ * Implementation of this function is OPTIONAL (only required by the threadless CS104 server
+ * functions that expose the socket handles)
+ *
+ * \param self the client, connection or server socket instance
+ *
+ * \return the socket handle or -1 when the socket is not valid
+ */
+PAL_API int
+Socket_getFd(Socket self);
+
+/**
+ * \brief Get the IP address of the peer application in binary form
+ *
+ * IPv4 addresses that are mapped to IPv6 addresses (::ffff:a.b.c.d) are returned as IPv4 addresses.
+ *
+ * Implementation of this function is OPTIONAL (return 0 when not supported). The CS104 server then
+ * parses the address string of \ref Socket_getPeerAddressStatic.
+ *
+ * \param self the client or connection socket instance
+ * \param ipAddress buffer to store the address in network byte order (at least 16 bytes)
+ *
+ * \return the size of the address (4 for IPv4, 16 for IPv6) or 0 when the address cannot be determined
+ */
+PAL_API int
+Socket_getPeerIpAddress(Socket self, uint8_t* ipAddress);
+
 /**
  * \brief destroy a socket (close the socket if a connection is established)
  *
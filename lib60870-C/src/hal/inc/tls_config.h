@@ -104,6 +104,7 @@ typedef enum {
 #define TLS_EVENT_CODE_ALM_RENEGOTIATION_TIMEOUT 26
 #define TLS_EVENT_CODE_INF_SESSION_RESUMED 27
 #define TLS_EVENT_CODE_INF_SESSION_EXPIRED 28
+#define TLS_EVENT_CODE_ALM_HANDSHAKE_TIMEOUT 29
 
 typedef struct sTLSConnection* TLSConnection;
 
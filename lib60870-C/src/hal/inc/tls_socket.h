@@ -62,6 +62,23 @@ typedef struct sTLSSocket* TLSSocket;
 PAL_API TLSSocket
 TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClientCert);
 
+/**
+ * \brief Create a new TLSSocket instance with a limit for the duration of the TLS handshake
+ *
+ * Same as \ref TLSSocket_create but the handshake fails when it is not completed within the
+ * given time (e.g. a peer that connects but doesn't send data).
+ *
+ * \param socket the socket instance to use for the TLS connection
+ * \param configuration the TLS configuration object to use
+ * \param storeClientCert if true, the client certificate will be stored
+ *                        for later access by \ref TLSSocket_getPeerCertificate
+ * \param handshakeTimeoutInMs maximum duration of the handshake in ms (0 = no limit)
+ *
+ * \return new TLS connection instance or NULL when the handshake failed
+ */
+PAL_API TLSSocket
+TLSSocket_createEx(Socket socket, TLSConfiguration configuration, bool storeClientCert, int handshakeTimeoutInMs);
+
 /**
  * \brief Perform a new TLS handshake/session renegotiation
  *
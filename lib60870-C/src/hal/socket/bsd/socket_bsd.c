@@ -62,9 +62,12 @@ struct sUdpSocket
 struct sHandleSet
 {
     LinkedList sockets;
+    LinkedList writeSockets; /* sockets that are also monitored for writability */
     bool pollfdIsUpdated;
     struct pollfd* fds;
     int nfds;
+    int nextIndex; /* index hint for Handleset_isReady */
+    int wakeupFds[2]; /* pipe to interrupt poll (-1 when not enabled) */
 };
 
 HandleSet
@@ -75,9 +78,13 @@ Handleset_new(void)
     if (self)
     {
         self->sockets = LinkedList_create();
+        self->writeSockets = LinkedList_create();
         self->pollfdIsUpdated = false;
         self->fds = NULL;
         self->nfds = 0;
+        self->nextIndex = 0;
+        self->wakeupFds[0] = -1;
+        self->wakeupFds[1] = -1;
     }
 
     return self;
@@ -94,6 +101,12 @@ Handleset_reset(HandleSet self)
             self->sockets = LinkedList_create();
             self->pollfdIsUpdated = false;
         }
+
+        if (self->writeSockets)
+        {
+            LinkedList_destroyStatic(self->writeSockets);
+            self->writeSockets = LinkedList_create();
+        }
     }
 }
 
@@ -113,10 +126,30 @@ Handleset_removeSocket(HandleSet self, const Socket sock)
     if (self && self->sockets && sock)
     {
         LinkedList_remove(self->sockets, sock);
+
+        if (self->writeSockets)
+            LinkedList_remove(self->writeSockets, sock);
+
         self->pollfdIsUpdated = false;
     }
 }
 
+static short
+getPollEvents(HandleSet self, Socket sock)
+{
+    LinkedList element = LinkedList_getNext(self->writeSockets);
+
+    while (element)
+    {
+        if (LinkedList_getData(element) == sock)
+            return POLLIN | POLLOUT;
+
+        element = LinkedList_getNext(element);
+    }
+
+    return POLLIN;
+}
+
 int
 Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 {
@@ -131,7 +164,8 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 
         self->nfds = LinkedList_size(self->sockets);
 
-        self->fds = GLOBAL_CALLOC(self->nfds, sizeof(struct pollfd));
+        /* additional element for the wakeup handle */
+        self->fds = GLOBAL_CALLOC(self->nfds + 1, sizeof(struct pollfd));
 
         int i;
 
@@ -146,23 +180,44 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
                 if (sock)
                 {
                     self->fds[i].fd = sock->fd;
-                    self->fds[i].events = POLL_IN;
+                    self->fds[i].events = getPollEvents(self, sock);
                 }
             }
         }
 
         self->pollfdIsUpdated = true;
+        self->nextIndex = 0;
+    }
+
+    int nfds = self->nfds;
+
+    if (self->fds && (self->wakeupFds[0] != -1))
+    {
+        self->fds[nfds].fd = self->wakeupFds[0];
+        self->fds[nfds].events = POLL_IN;
+        self->fds[nfds].revents = 0;
+        nfds++;
     }
 
-    if (self->fds && self->nfds > 0)
+    if (self->fds && nfds > 0)
     {
-        int result = poll(self->fds, self->nfds, timeoutMs);
+        int result = poll(self->fds, nfds, timeoutMs);
 
         if (result == -1)
         {
             if (DEBUG_SOCKET)
                 printf("SOCKET: poll error (errno: %i)\n", errno);
         }
+        else if ((nfds > self->nfds) && (self->fds[self->nfds].revents & POLLIN))
+        {
+            /* consume all pending wakeup events - only the sockets are counted */
+            uint8_t buf[64];
+
+            while (read(self->wakeupFds[0], buf, sizeof(buf)) > 0)
+                ;
+
+            result--;
+        }
 
         return result;
     }
@@ -173,14 +228,146 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
     }
 }
 
+bool
+Handleset_isReady(HandleSet self, const Socket sock)
+{
+    if (self && self->fds && sock && self->pollfdIsUpdated)
+    {
+        int i;
+
+        for (i = 0; i < self->nfds; i++)
+        {
+            int index = (self->nextIndex + i) % self->nfds;
+
+            if (self->fds[index].fd == sock->fd)
+            {
+                self->nextIndex = (index + 1) % self->nfds;
+
+                if (self->fds[index].revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
+                    return true;
+                else
+                    return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+Handleset_setWriteInterest(HandleSet self, const Socket sock, bool enable)
+{
+    if (self && self->writeSockets && sock && (sock->fd != -1))
+    {
+        LinkedList_remove(self->writeSockets, sock);
+
+        if (enable)
+            LinkedList_add(self->writeSockets, sock);
+
+        /* update the pollfd array in place to avoid a rebuild */
+        if (self->pollfdIsUpdated && self->fds)
+        {
+            int i;
+
+            for (i = 0; i < self->nfds; i++)
+            {
+                if (self->fds[i].fd == sock->fd)
+                {
+                    self->fds[i].events = enable ? (POLLIN | POLLOUT) : POLLIN;
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool
+Handleset_isWritable(HandleSet self, const Socket sock)
+{
+    if (self && self->fds && sock && self->pollfdIsUpdated)
+    {
+        int i;
+
+        for (i = 0; i < self->nfds; i++)
+        {
+            if (self->fds[i].fd == sock->fd)
+            {
+                if ((self->fds[i].events & POLLOUT) && (self->fds[i].revents & (POLLOUT | POLLERR | POLLHUP | POLLNVAL)))
+                    return true;
+                else
+                    return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+Handleset_enableWakeup(HandleSet self)
+{
+    if (self == NULL)
+        return false;
+
+    if (self->wakeupFds[0] == -1)
+    {
+        if (pipe(self->wakeupFds) == -1)
+        {
+            if (DEBUG_SOCKET)
+                printf("SOCKET: failed to create wakeup pipe (errno: %i)\n", errno);
+
+            self->wakeupFds[0] = -1;
+            self->wakeupFds[1] = -1;
+
+            return false;
+        }
+
+        fcntl(self->wakeupFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(self->wakeupFds[1], F_SETFL, O_NONBLOCK);
+        fcntl(self->wakeupFds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(self->wakeupFds[1], F_SETFD, FD_CLOEXEC);
+    }
+
+    return true;
+}
+
+void
+Handleset_wakeup(HandleSet self)
+{
+    if (self && (self->wakeupFds[1] != -1))
+    {
+        uint8_t value = 1;
+
+        /* EAGAIN: pipe is full -> the wakeup is already pending */
+        if (write(self->wakeupFds[1], &value, 1) == -1)
+        {
+            if (DEBUG_SOCKET && (errno != EAGAIN))
+                printf("SOCKET: failed to signal wakeup event (errno: %i)\n", errno);
+        }
+    }
+}
+
 void
 Handleset_destroy(HandleSet self)
 {
     if (self)
     {
+        if (self->wakeupFds[0] != -1)
+        {
+            close(self->wakeupFds[0]);
+            close(self->wakeupFds[1]);
+        }
+
         if (self->sockets)
             LinkedList_destroyStatic(self->sockets);
 
+        if (self->writeSockets)
+            LinkedList_destroyStatic(self->writeSockets);
+
         if (self->fds)
             GLOBAL_FREEMEM(self->fds);
 
@@ -251,8 +438,8 @@ activateTcpNoDelay(Socket self)
     setsockopt(self->fd, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, sizeof(int));
 }
 
-ServerSocket
-TcpServerSocket_create(const char* address, int port)
+static ServerSocket
+createServerSocket(const char* address, int port, bool reusePort)
 {
     ServerSocket serverSocket = NULL;
 
@@ -271,6 +458,23 @@ TcpServerSocket_create(const char* address, int port)
         int optionReuseAddr = 1;
         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char*)&optionReuseAddr, sizeof(int));
 
+        if (reusePort)
+        {
+            /* SO_REUSEPORT doesn't distribute the connections on all BSD systems -> only SO_REUSEPORT_LB is used */
+#if defined SO_REUSEPORT_LB
+            int optionReusePort = 1;
+
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT_LB, (char*)&optionReusePort, sizeof(int)) < 0)
+            {
+                close(fd);
+                return NULL;
+            }
+#else
+            close(fd);
+            return NULL;
+#endif
+        }
+
         if (bind(fd, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) >= 0)
         {
             serverSocket = (ServerSocket)GLOBAL_MALLOC(sizeof(struct sServerSocket));
@@ -289,6 +493,18 @@ TcpServerSocket_create(const char* address, int port)
     return serverSocket;
 }
 
+ServerSocket
+TcpServerSocket_create(const char* address, int port)
+{
+    return createServerSocket(address, port, false);
+}
+
+ServerSocket
+TcpServerSocket_createReusePort(const char* address, int port)
+{
+    return createServerSocket(address, port, true);
+}
+
 void
 ServerSocket_listen(ServerSocket self)
 {
@@ -644,6 +860,47 @@ Socket_getPeerAddressStatic(Socket self, char* peerAddressString)
     return peerAddressString;
 }
 
+int
+Socket_getPeerIpAddress(Socket self, uint8_t* ipAddress)
+{
+    struct sockaddr_storage addr;
+    socklen_t addrLen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+
+    if (getpeername(self->fd, (struct sockaddr*)&addr, &addrLen) != 0)
+        return 0;
+
+    if (addr.ss_family == AF_INET)
+    {
+        struct sockaddr_in* ipv4Addr = (struct sockaddr_in*)&addr;
+
+        memcpy(ipAddress, &(ipv4Addr->sin_addr), 4);
+
+        return 4;
+    }
+    else if (addr.ss_family == AF_INET6)
+    {
+        struct sockaddr_in6* ipv6Addr = (struct sockaddr_in6*)&addr;
+
+        uint8_t* addrBytes = (uint8_t*)&(ipv6Addr->sin6_addr);
+
+        static const uint8_t ipv4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+        if (memcmp(addrBytes, ipv4MappedPrefix, 12) == 0)
+        {
+            memcpy(ipAddress, addrBytes + 12, 4);
+
+            return 4;
+        }
+
+        memcpy(ipAddress, addrBytes, 16);
+
+        return 16;
+    }
+
+    return 0;
+}
+
 int
 Socket_read(Socket self, uint8_t* buf, int size)
 {
@@ -690,6 +947,15 @@ Socket_write(Socket self, uint8_t* buf, int size)
         return retVal;
 }
 
+int
+Socket_getFd(Socket self)
+{
+    if (self == NULL)
+        return -1;
+
+    return self->fd;
+}
+
 void
 Socket_destroy(Socket self)
 {
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -55,9 +56,12 @@ struct sUdpSocket
 struct sHandleSet
 {
     LinkedList sockets;
+    LinkedList writeSockets; /* sockets that are also monitored for writability */
     bool pollfdIsUpdated;
     struct pollfd* fds;
     int nfds;
+    int nextIndex; /* index hint for Handleset_isReady */
+    int wakeupFd; /* eventfd to interrupt poll (-1 when not enabled) */
 };
 
 HandleSet
@@ -68,9 +72,12 @@ Handleset_new(void)
     if (self)
     {
         self->sockets = LinkedList_create();
+        self->writeSockets = LinkedList_create();
         self->pollfdIsUpdated = false;
         self->fds = NULL;
         self->nfds = 0;
+        self->nextIndex = 0;
+        self->wakeupFd = -1;
     }
 
     return self;
@@ -87,6 +94,12 @@ Handleset_reset(HandleSet self)
             self->sockets = LinkedList_create();
             self->pollfdIsUpdated = false;
         }
+
+        if (self->writeSockets)
+        {
+            LinkedList_destroyStatic(self->writeSockets);
+            self->writeSockets = LinkedList_create();
+        }
     }
 }
 
@@ -107,10 +120,30 @@ Handleset_removeSocket(HandleSet self, const Socket sock)
     if (self && self->sockets && sock)
     {
         LinkedList_remove(self->sockets, sock);
+
+        if (self->writeSockets)
+            LinkedList_remove(self->writeSockets, sock);
+
         self->pollfdIsUpdated = false;
     }
 }
 
+static short
+getPollEvents(HandleSet self, Socket sock)
+{
+    LinkedList element = LinkedList_getNext(self->writeSockets);
+
+    while (element)
+    {
+        if (LinkedList_getData(element) == sock)
+            return POLLIN | POLLOUT;
+
+        element = LinkedList_getNext(element);
+    }
+
+    return POLLIN;
+}
+
 int
 Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 {
@@ -125,7 +158,8 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 
         self->nfds = LinkedList_size(self->sockets);
 
-        self->fds = GLOBAL_CALLOC(self->nfds, sizeof(struct pollfd));
+        /* additional element for the wakeup handle */
+        self->fds = GLOBAL_CALLOC(self->nfds + 1, sizeof(struct pollfd));
 
         int i;
 
@@ -140,17 +174,28 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
                 if (sock)
                 {
                     self->fds[i].fd = sock->fd;
-                    self->fds[i].events = POLL_IN;
+                    self->fds[i].events = getPollEvents(self, sock);
                 }
             }
         }
 
         self->pollfdIsUpdated = true;
+        self->nextIndex = 0;
+    }
+
+    int nfds = self->nfds;
+
+    if (self->fds && (self->wakeupFd != -1))
+    {
+        self->fds[nfds].fd = self->wakeupFd;
+        self->fds[nfds].events = POLL_IN;
+        self->fds[nfds].revents = 0;
+        nfds++;
     }
 
-    if (self->fds && self->nfds > 0)
+    if (self->fds && nfds > 0)
     {
-        int result = poll(self->fds, self->nfds, timeoutMs);
+        int result = poll(self->fds, nfds, timeoutMs);
 
         if (result == -1 && errno == EINTR)
         {
@@ -162,6 +207,19 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
             if (DEBUG_SOCKET)
                 printf("SOCKET: poll error (errno: %i)\n", errno);
         }
+        else if ((nfds > self->nfds) && (self->fds[self->nfds].revents & POLLIN))
+        {
+            /* consume the wakeup event - only the sockets are counted */
+            uint64_t value;
+
+            if (read(self->wakeupFd, &value, sizeof(value)) == -1)
+            {
+                if (DEBUG_SOCKET)
+                    printf("SOCKET: failed to read wakeup event (errno: %i)\n", errno);
+            }
+
+            result--;
+        }
 
         return result;
     }
@@ -172,14 +230,137 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
     }
 }
 
+bool
+Handleset_isReady(HandleSet self, const Socket sock)
+{
+    if (self && self->fds && sock && self->pollfdIsUpdated)
+    {
+        int i;
+
+        for (i = 0; i < self->nfds; i++)
+        {
+            int index = (self->nextIndex + i) % self->nfds;
+
+            if (self->fds[index].fd == sock->fd)
+            {
+                self->nextIndex = (index + 1) % self->nfds;
+
+                if (self->fds[index].revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
+                    return true;
+                else
+                    return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+Handleset_setWriteInterest(HandleSet self, const Socket sock, bool enable)
+{
+    if (self && self->writeSockets && sock && (sock->fd != -1))
+    {
+        LinkedList_remove(self->writeSockets, sock);
+
+        if (enable)
+            LinkedList_add(self->writeSockets, sock);
+
+        /* update the pollfd array in place to avoid a rebuild */
+        if (self->pollfdIsUpdated && self->fds)
+        {
+            int i;
+
+            for (i = 0; i < self->nfds; i++)
+            {
+                if (self->fds[i].fd == sock->fd)
+                {
+                    self->fds[i].events = enable ? (POLLIN | POLLOUT) : POLLIN;
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool
+Handleset_isWritable(HandleSet self, const Socket sock)
+{
+    if (self && self->fds && sock && self->pollfdIsUpdated)
+    {
+        int i;
+
+        for (i = 0; i < self->nfds; i++)
+        {
+            if (self->fds[i].fd == sock->fd)
+            {
+                if ((self->fds[i].events & POLLOUT) && (self->fds[i].revents & (POLLOUT | POLLERR | POLLHUP | POLLNVAL)))
+                    return true;
+                else
+                    return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool
+Handleset_enableWakeup(HandleSet self)
+{
+    if (self == NULL)
+        return false;
+
+    if (self->wakeupFd == -1)
+    {
+        self->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (self->wakeupFd == -1)
+        {
+            if (DEBUG_SOCKET)
+                printf("SOCKET: failed to create eventfd (errno: %i)\n", errno);
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+Handleset_wakeup(HandleSet self)
+{
+    if (self && (self->wakeupFd != -1))
+    {
+        uint64_t value = 1;
+
+        if (write(self->wakeupFd, &value, sizeof(value)) == -1)
+        {
+            /* EAGAIN: counter overflow -> the wakeup is already pending */
+            if (DEBUG_SOCKET && (errno != EAGAIN))
+                printf("SOCKET: failed to signal wakeup event (errno: %i)\n", errno);
+        }
+    }
+}
+
 void
 Handleset_destroy(HandleSet self)
 {
     if (self)
     {
+        if (self->wakeupFd != -1)
+            close(self->wakeupFd);
+
         if (self->sockets)
             LinkedList_destroyStatic(self->sockets);
 
+        if (self->writeSockets)
+            LinkedList_destroyStatic(self->writeSockets);
+
         if (self->fds)
             GLOBAL_FREEMEM(self->fds);
 
@@ -287,8 +468,8 @@ activateTcpNoDelay(Socket self)
     setsockopt(self->fd, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, sizeof(int));
 }
 
-ServerSocket
-TcpServerSocket_create(const char* address, int port)
+static ServerSocket
+createServerSocket(const char* address, int port, bool reusePort)
 {
     ServerSocket serverSocket = NULL;
 
@@ -307,6 +488,26 @@ TcpServerSocket_create(const char* address, int port)
         int optionReuseAddr = 1;
         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char*)&optionReuseAddr, sizeof(int));
 
+        if (reusePort)
+        {
+#if defined SO_REUSEPORT
+            /* the kernel distributes incoming connections over all sockets bound to the port */
+            int optionReusePort = 1;
+
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char*)&optionReusePort, sizeof(int)) < 0)
+            {
+                if (DEBUG_SOCKET)
+                    printf("SOCKET: failed to set SO_REUSEPORT (errno: %i)\n", errno);
+
+                close(fd);
+                return NULL;
+            }
+#else
+            close(fd);
+            return NULL;
+#endif
+        }
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 37)
         int tcpUserTimeout = 10000;
         int result = setsockopt(fd, SOL_TCP, TCP_USER_TIMEOUT, &tcpUserTimeout, sizeof(tcpUserTimeout));
@@ -338,6 +539,18 @@ TcpServerSocket_create(const char* address, int port)
     return serverSocket;
 }
 
+ServerSocket
+TcpServerSocket_create(const char* address, int port)
+{
+    return createServerSocket(address, port, false);
+}
+
+ServerSocket
+TcpServerSocket_createReusePort(const char* address, int port)
+{
+    return createServerSocket(address, port, true);
+}
+
 void
 ServerSocket_listen(ServerSocket self)
 {
@@ -725,6 +938,47 @@ Socket_getPeerAddressStatic(Socket self, char* peerAddressString)
     return peerAddressString;
 }
 
+int
+Socket_getPeerIpAddress(Socket self, uint8_t* ipAddress)
+{
+    struct sockaddr_storage addr;
+    socklen_t addrLen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+
+    if (getpeername(self->fd, (struct sockaddr*)&addr, &addrLen) != 0)
+        return 0;
+
+    if (addr.ss_family == AF_INET)
+    {
+        struct sockaddr_in* ipv4Addr = (struct sockaddr_in*)&addr;
+
+        memcpy(ipAddress, &(ipv4Addr->sin_addr), 4);
+
+        return 4;
+    }
+    else if (addr.ss_family == AF_INET6)
+    {
+        struct sockaddr_in6* ipv6Addr = (struct sockaddr_in6*)&addr;
+
+        uint8_t* addrBytes = (uint8_t*)&(ipv6Addr->sin6_addr);
+
+        static const uint8_t ipv4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+        if (memcmp(addrBytes, ipv4MappedPrefix, 12) == 0)
+        {
+            memcpy(ipAddress, addrBytes + 12, 4);
+
+            return 4;
+        }
+
+        memcpy(ipAddress, addrBytes, 16);
+
+        return 16;
+    }
+
+    return 0;
+}
+
 int
 Socket_read(Socket self, uint8_t* buf, int size)
 {
@@ -785,6 +1039,15 @@ Socket_write(Socket self, uint8_t* buf, int size)
     return retVal;
 }
 
+int
+Socket_getFd(Socket self)
+{
+    if (self == NULL)
+        return -1;
+
+    return self->fd;
+}
+
 void
 Socket_destroy(Socket self)
 {
@@ -51,7 +51,11 @@ struct sServerSocket
 struct sHandleSet
 {
     fd_set handles;
+    fd_set readyHandles; /* result of last Handleset_waitReady call */
+    fd_set writeHandles; /* sockets that are also monitored for writability */
+    fd_set writableHandles; /* result of last Handleset_waitReady call */
     SOCKET maxHandle;
+    SOCKET wakeupSocket; /* loopback UDP socket to interrupt select (INVALID_SOCKET when not enabled) */
 };
 
 struct sUdpSocket
@@ -68,7 +72,11 @@ Handleset_new(void)
     if (result != NULL)
     {
         FD_ZERO(&result->handles);
+        FD_ZERO(&result->readyHandles);
+        FD_ZERO(&result->writeHandles);
+        FD_ZERO(&result->writableHandles);
         result->maxHandle = INVALID_SOCKET;
+        result->wakeupSocket = INVALID_SOCKET;
     }
 
     return result;
@@ -78,6 +86,9 @@ void
 Handleset_reset(HandleSet self)
 {
     FD_ZERO(&self->handles);
+    FD_ZERO(&self->readyHandles);
+    FD_ZERO(&self->writeHandles);
+    FD_ZERO(&self->writableHandles);
     self->maxHandle = INVALID_SOCKET;
 }
 
@@ -100,6 +111,7 @@ Handleset_removeSocket(HandleSet self, const Socket sock)
     if (self != NULL && sock != NULL && sock->fd != INVALID_SOCKET)
     {
         FD_CLR(sock->fd, &self->handles);
+        FD_CLR(sock->fd, &self->writeHandles);
     }
 }
 
@@ -108,7 +120,7 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 {
     int result;
 
-    if ((self != NULL) && (self->maxHandle != INVALID_SOCKET))
+    if ((self != NULL) && ((self->maxHandle != INVALID_SOCKET) || (self->wakeupSocket != INVALID_SOCKET)))
     {
         struct timeval timeout;
 
@@ -116,10 +128,39 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
         timeout.tv_usec = (timeoutMs % 1000) * 1000;
 
         fd_set handles;
+        fd_set writeHandles;
 
         memcpy((void*)&handles, &(self->handles), sizeof(fd_set));
+        memcpy((void*)&writeHandles, &(self->writeHandles), sizeof(fd_set));
 
-        result = select(0, &handles, NULL, NULL, &timeout);
+        if (self->wakeupSocket != INVALID_SOCKET)
+            FD_SET(self->wakeupSocket, &handles);
+
+        result = select(0, &handles, &writeHandles, NULL, &timeout);
+
+        if ((result > 0) && (self->wakeupSocket != INVALID_SOCKET) && FD_ISSET(self->wakeupSocket, &handles))
+        {
+            /* consume all pending wakeup events - only the sockets are counted */
+            char buf[64];
+
+            while (recv(self->wakeupSocket, buf, sizeof(buf), 0) > 0)
+                ;
+
+            FD_CLR(self->wakeupSocket, &handles);
+
+            result--;
+        }
+
+        if (result > 0)
+        {
+            memcpy((void*)&(self->readyHandles), &handles, sizeof(fd_set));
+            memcpy((void*)&(self->writableHandles), &writeHandles, sizeof(fd_set));
+        }
+        else
+        {
+            FD_ZERO(&self->readyHandles);
+            FD_ZERO(&self->writableHandles);
+        }
     }
     else
     {
@@ -129,15 +170,130 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
     return result;
 }
 
-void
-Handleset_destroy(HandleSet self)
+bool
+Handleset_isReady(HandleSet self, const Socket sock)
 {
-    GLOBAL_FREEMEM(self);
+    if ((self != NULL) && (sock != NULL) && (sock->fd != INVALID_SOCKET))
+    {
+        if (FD_ISSET(sock->fd, &self->readyHandles))
+            return true;
+    }
+
+    return false;
+}
+
+bool
+Handleset_setWriteInterest(HandleSet self, const Socket sock, bool enable)
+{
+    if ((self != NULL) && (sock != NULL) && (sock->fd != INVALID_SOCKET))
+    {
+        if (enable)
+            FD_SET(sock->fd, &self->writeHandles);
+        else
+            FD_CLR(sock->fd, &self->writeHandles);
+
+        return true;
+    }
+
+    return false;
+}
+
+bool
+Handleset_isWritable(HandleSet self, const Socket sock)
+{
+    if ((self != NULL) && (sock != NULL) && (sock->fd != INVALID_SOCKET))
+    {
+        if (FD_ISSET(sock->fd, &self->writableHandles))
+            return true;
+    }
+
+    return false;
 }
 
 static bool wsaStartupCalled = false;
 static int socketCount = 0;
 
+static bool
+wsaStartUp(void);
+
+static void
+wsaShutdown(void);
+
+bool
+Handleset_enableWakeup(HandleSet self)
+{
+    if (self == NULL)
+        return false;
+
+    if (self->wakeupSocket != INVALID_SOCKET)
+        return true;
+
+    if (wsaStartUp() == false)
+        return false;
+
+    /* UDP socket connected to itself - a datagram sent by Handleset_wakeup makes it readable */
+    SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (sock == INVALID_SOCKET)
+        return false;
+
+    struct sockaddr_in addr;
+    int addrLen = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    if ((bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) ||
+        (getsockname(sock, (struct sockaddr*)&addr, &addrLen) == SOCKET_ERROR) ||
+        (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR))
+    {
+        if (DEBUG_SOCKET)
+            printf("WIN32_SOCKET: failed to create wakeup socket: %d\n", WSAGetLastError());
+
+        closesocket(sock);
+        wsaShutdown();
+        return false;
+    }
+
+    unsigned long mode = 1;
+    ioctlsocket(sock, FIONBIO, &mode);
+
+    self->wakeupSocket = sock;
+
+    socketCount++;
+
+    return true;
+}
+
+void
+Handleset_wakeup(HandleSet self)
+{
+    if (self && (self->wakeupSocket != INVALID_SOCKET))
+    {
+        char value = 1;
+
+        send(self->wakeupSocket, &value, 1, 0);
+    }
+}
+
+void
+Handleset_destroy(HandleSet self)
+{
+    if (self)
+    {
+        if (self->wakeupSocket != INVALID_SOCKET)
+        {
+            closesocket(self->wakeupSocket);
+            socketCount--;
+            wsaShutdown();
+        }
+
+        GLOBAL_FREEMEM(self);
+    }
+}
+
 void
 Socket_activateTcpKeepAlive(Socket self, int idleTime, int interval, int count)
 {
@@ -299,6 +455,16 @@ TcpServerSocket_create(const char* address, int port)
     return serverSocket;
 }
 
+ServerSocket
+TcpServerSocket_createReusePort(const char* address, int port)
+{
+    /* not supported (SO_REUSEADDR doesn't distribute incoming connections) */
+    (void)address;
+    (void)port;
+
+    return NULL;
+}
+
 void
 ServerSocket_listen(ServerSocket self)
 {
@@ -653,6 +819,47 @@ Socket_getPeerAddressStatic(Socket self, char* peerAddressString)
     return peerAddressString;
 }
 
+int
+Socket_getPeerIpAddress(Socket self, uint8_t* ipAddress)
+{
+    struct sockaddr_storage addr;
+    int addrLen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+
+    if (getpeername(self->fd, (struct sockaddr*)&addr, &addrLen) != 0)
+        return 0;
+
+    if (addr.ss_family == AF_INET)
+    {
+        struct sockaddr_in* ipv4Addr = (struct sockaddr_in*)&addr;
+
+        memcpy(ipAddress, &(ipv4Addr->sin_addr), 4);
+
+        return 4;
+    }
+    else if (addr.ss_family == AF_INET6)
+    {
+        struct sockaddr_in6* ipv6Addr = (struct sockaddr_in6*)&addr;
+
+        uint8_t* addrBytes = (uint8_t*)&(ipv6Addr->sin6_addr);
+
+        static const uint8_t ipv4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+        if (memcmp(addrBytes, ipv4MappedPrefix, 12) == 0)
+        {
+            memcpy(ipAddress, addrBytes + 12, 4);
+
+            return 4;
+        }
+
+        memcpy(ipAddress, addrBytes, 16);
+
+        return 16;
+    }
+
+    return 0;
+}
+
 int
 Socket_read(Socket self, uint8_t* buf, int size)
 {
@@ -690,6 +897,18 @@ Socket_write(Socket self, uint8_t* buf, int size)
     return bytes_sent;
 }
 
+int
+Socket_getFd(Socket self)
+{
+    if (self == NULL)
+        return -1;
+
+    if (self->fd == INVALID_SOCKET)
+        return -1;
+
+    return (int)self->fd;
+}
+
 void
 Socket_destroy(Socket self)
 {
@@ -1610,8 +1610,43 @@ getMinorVersion(TLSConfigVersion version)
     }
 }
 
+/* wait for more handshake data of the peer (returns false when the handshake timeout elapsed) */
+static bool
+waitForHandshakeData(TLSSocket self, HandleSet handleSet, int ret, uint64_t startTime, int handshakeTimeoutInMs)
+{
+    unsigned int waitTime = 100;
+
+    if (handshakeTimeoutInMs > 0)
+    {
+        uint64_t elapsedTime = Hal_getMonotonicTimeInMs() - startTime;
+
+        if (elapsedTime >= (uint64_t)handshakeTimeoutInMs)
+            return false;
+
+        if ((uint64_t)handshakeTimeoutInMs - elapsedTime < waitTime)
+            waitTime = (unsigned int)((uint64_t)handshakeTimeoutInMs - elapsedTime);
+    }
+
+    /* don't spin while the peer doesn't send data */
+    if (handleSet && (ret == MBEDTLS_ERR_SSL_WANT_READ))
+    {
+        Handleset_reset(handleSet);
+        Handleset_addSocket(handleSet, self->socket);
+
+        Handleset_waitReady(handleSet, waitTime);
+    }
+
+    return true;
+}
+
 TLSSocket
 TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClientCert)
+{
+    return TLSSocket_createEx(socket, configuration, storeClientCert, 0);
+}
+
+TLSSocket
+TLSSocket_createEx(Socket socket, TLSConfiguration configuration, bool storeClientCert, int handshakeTimeoutInMs)
 {
     TLSSocket self = (TLSSocket)GLOBAL_CALLOC(1, sizeof(struct sTLSSocket));
 
@@ -1756,19 +1791,41 @@ TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClient
         /* disable host name verification */
         mbedtls_ssl_set_hostname(&(self->ssl), NULL);
 
+        uint64_t handshakeStartTime = Hal_getMonotonicTimeInMs();
+
+        HandleSet handleSet = Handleset_new();
+
         while ((ret = mbedtls_ssl_handshake(&(self->ssl))) != 0)
         {
-            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
-            {
-                DEBUG_PRINT("TLS", "handshake failed - mbedtls_ssl_handshake returned -0x%x\n", -ret );
+            bool timeout = false;
 
-                uint32_t flags = mbedtls_ssl_get_verify_result(&(self->ssl));
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+                timeout = (waitForHandshakeData(self, handleSet, ret, handshakeStartTime, handshakeTimeoutInMs) == false);
 
-                if (self->versionMismatchDetected == false)
+            if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) || timeout)
+            {
+                if (timeout)
                 {
-                    createSecurityEvents(configuration, ret, flags, self);
+                    DEBUG_PRINT("TLS", "handshake failed - no response within %i ms\n", handshakeTimeoutInMs);
+
+                    raiseSecurityEvent(configuration, TLS_SEC_EVT_INCIDENT, TLS_EVENT_CODE_ALM_HANDSHAKE_TIMEOUT,
+                        "Alarm: handshake timeout", self);
+                }
+                else
+                {
+                    DEBUG_PRINT("TLS", "handshake failed - mbedtls_ssl_handshake returned -0x%x\n", -ret );
+
+                    uint32_t flags = mbedtls_ssl_get_verify_result(&(self->ssl));
+
+                    if (self->versionMismatchDetected == false)
+                    {
+                        createSecurityEvents(configuration, ret, flags, self);
+                    }
                 }
 
+                if (handleSet)
+                    Handleset_destroy(handleSet);
+
                 self->sessionResumptionPending = false;
                 mbedtls_ssl_free(&(self->ssl));
 
@@ -1784,6 +1841,9 @@ TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClient
             }
         }
 
+        if (handleSet)
+            Handleset_destroy(handleSet);
+
         if (self->versionMismatchDetected)
         {
             DEBUG_PRINT("TLS", "Handshake flagged TLS version mismatch after completion\n");
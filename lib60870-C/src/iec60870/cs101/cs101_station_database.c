@@ -0,0 +1,1237 @@
+/*
+ *  cs101_station_database.c
+ *
+ *  Process image of a slave (current values of the data points) that is used to
+ *  answer interrogation and read commands.
+ *
+ *  Copyright 2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "cs101_station_database_internal.h"
+
+#include "apl_types_internal.h"
+#include "buffer_frame.h"
+#include "cs101_asdu_internal.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+#include "lib_memory.h"
+#include "platform_endian.h"
+
+#define STATION_DB_STATE_ACT_CON 0
+#define STATION_DB_STATE_DATA 1
+#define STATION_DB_STATE_ACT_TERM 2
+
+/* number of points that are evaluated together by CS101_StationDatabase_updateMeasuredValues */
+#define STATION_DB_UPDATE_CHUNK_SIZE 64
+
+/*
+ * Deadband filter of a block of measured values. The parameters are stored as structure of
+ * arrays, so the compiler can vectorize the evaluation loop (see evaluateDeadbands).
+ * The deadband types are mapped to the limits:
+ *   NONE:       absLimit = 0,         relLimit = 0,       integralLimit = INFINITY
+ *   ABSOLUTE:   absLimit = threshold, relLimit = 0,       integralLimit = INFINITY
+ *   PERCENT:    absLimit = 0,         relLimit = t / 100, integralLimit = INFINITY
+ *   INTEGRATED: absLimit = INFINITY,  relLimit = 0,       integralLimit = threshold
+ */
+typedef struct
+{
+    uint64_t baseTime;        /* the times are stored in ms relative to the base time (32 bit -> vectorizable) */
+    uint32_t* lastReportTime;
+    uint32_t* lastUpdateTime;
+    uint32_t* maxInterval;    /* UINT32_MAX -> not used */
+    float* reported;        /* last reported value */
+    float* integral;        /* integral of the deviation from the reported value (value * s) */
+    float* absLimit;
+    float* relLimit;
+    float* integralLimit;
+} sDeadbandFilter;
+
+/* points with the same type and contiguous IOAs */
+typedef struct
+{
+    IEC60870_5_TypeID typeId;
+    int startIoa;
+    int count;
+    int group; /* interrogation group (0 -> only station interrogation) */
+    bool spontaneous;
+
+    int elementSize; /* size of the encoded value without IOA */
+    uint8_t* values; /* encoded values (as in an ASDU with SQ=1) */
+
+    sDeadbandFilter* filter; /* NULL -> every change is reported */
+} sDataBlock;
+
+typedef struct
+{
+    int ca;
+
+    int numberOfBlocks;
+    int maxNumberOfBlocks;
+    sDataBlock* blocks; /* sorted by startIoa */
+} sStation;
+
+struct sCS101_StationDatabase
+{
+    struct sCS101_AppLayerParameters alParams;
+
+    int numberOfStations;
+    int maxNumberOfStations;
+    sStation* stations;
+
+    CS101_StationDatabase_EventHandler eventHandler;
+    void* eventHandlerParameter;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore lock;
+#endif
+};
+
+/* type that is stored in the database for a type with or without time tag (0 -> not supported) */
+static IEC60870_5_TypeID
+getBlockType(IEC60870_5_TypeID typeId)
+{
+    switch (typeId)
+    {
+    case M_SP_NA_1:
+    case M_SP_TA_1:
+    case M_SP_TB_1:
+        return M_SP_NA_1;
+
+    case M_DP_NA_1:
+    case M_DP_TA_1:
+    case M_DP_TB_1:
+        return M_DP_NA_1;
+
+    case M_ST_NA_1:
+    case M_ST_TA_1:
+    case M_ST_TB_1:
+        return M_ST_NA_1;
+
+    case M_BO_NA_1:
+    case M_BO_TA_1:
+    case M_BO_TB_1:
+        return M_BO_NA_1;
+
+    case M_ME_NA_1:
+    case M_ME_TA_1:
+    case M_ME_TD_1:
+        return M_ME_NA_1;
+
+    case M_ME_NB_1:
+    case M_ME_TB_1:
+    case M_ME_TE_1:
+        return M_ME_NB_1;
+
+    case M_ME_NC_1:
+    case M_ME_TC_1:
+    case M_ME_TF_1:
+        return M_ME_NC_1;
+
+    case M_PS_NA_1:
+        return M_PS_NA_1;
+
+    case M_ME_ND_1:
+        return M_ME_ND_1;
+
+    default:
+        return (IEC60870_5_TypeID)0;
+    }
+}
+
+/* size of the encoded value (without IOA) of a block type */
+static int
+getElementSize(IEC60870_5_TypeID typeId)
+{
+    switch (typeId)
+    {
+    case M_SP_NA_1:
+    case M_DP_NA_1:
+        return 1;
+
+    case M_ST_NA_1:
+    case M_ME_ND_1:
+        return 2;
+
+    case M_ME_NA_1:
+    case M_ME_NB_1:
+        return 3;
+
+    case M_BO_NA_1:
+    case M_ME_NC_1:
+    case M_PS_NA_1:
+        return 5;
+
+    default:
+        return 0;
+    }
+}
+
+static bool
+isMeasuredValueType(IEC60870_5_TypeID typeId)
+{
+    return ((typeId == M_ME_NA_1) || (typeId == M_ME_NB_1) || (typeId == M_ME_NC_1) || (typeId == M_ME_ND_1));
+}
+
+/* type with CP56Time2a time tag of a measured value block type (block type when there is no such type) */
+static IEC60870_5_TypeID
+getTimeTaggedType(IEC60870_5_TypeID typeId)
+{
+    switch (typeId)
+    {
+    case M_ME_NA_1:
+        return M_ME_TD_1;
+
+    case M_ME_NB_1:
+        return M_ME_TE_1;
+
+    case M_ME_NC_1:
+        return M_ME_TF_1;
+
+    default:
+        return typeId;
+    }
+}
+
+static int
+getScaledValue(const uint8_t* encodedValue)
+{
+    int value = encodedValue[0] + (encodedValue[1] * 0x100);
+
+    if (value > 32767)
+        value = value - 65536;
+
+    return value;
+}
+
+static void
+setScaledValue(uint8_t* encodedValue, int value)
+{
+    if (value > 32767)
+        value = 32767;
+    else if (value < -32768)
+        value = -32768;
+
+    if (value < 0)
+        value += 65536;
+
+    encodedValue[0] = (uint8_t)(value % 256);
+    encodedValue[1] = (uint8_t)(value / 256);
+}
+
+/* value of an encoded measured value as float (normalized, scaled or short floating point value) */
+static float
+decodeMeasuredValue(IEC60870_5_TypeID typeId, const uint8_t* encodedValue)
+{
+    if (typeId == M_ME_NB_1)
+        return (float)getScaledValue(encodedValue);
+
+    if (typeId == M_ME_NC_1)
+    {
+        float value;
+        uint8_t* valueBytes = (uint8_t*)&value;
+
+#if (ORDER_LITTLE_ENDIAN == 1)
+        memcpy(valueBytes, encodedValue, 4);
+#else
+        valueBytes[0] = encodedValue[3];
+        valueBytes[1] = encodedValue[2];
+        valueBytes[2] = encodedValue[1];
+        valueBytes[3] = encodedValue[0];
+#endif
+
+        return value;
+    }
+
+    return NormalizedValue_fromScaled(getScaledValue(encodedValue));
+}
+
+/* encode the value of a measured value (without the quality) */
+static void
+encodeMeasuredValue(IEC60870_5_TypeID typeId, uint8_t* encodedValue, float value)
+{
+    if (typeId == M_ME_NB_1)
+    {
+        setScaledValue(encodedValue, (int)(value < 0 ? value - 0.5f : value + 0.5f));
+    }
+    else if (typeId == M_ME_NC_1)
+    {
+        uint8_t* valueBytes = (uint8_t*)&value;
+
+#if (ORDER_LITTLE_ENDIAN == 1)
+        memcpy(encodedValue, valueBytes, 4);
+#else
+        encodedValue[0] = valueBytes[3];
+        encodedValue[1] = valueBytes[2];
+        encodedValue[2] = valueBytes[1];
+        encodedValue[3] = valueBytes[0];
+#endif
+    }
+    else
+    {
+        setScaledValue(encodedValue, NormalizedValue_toScaled(value));
+    }
+}
+
+static void
+lock(CS101_StationDatabase self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+}
+
+static void
+unlock(CS101_StationDatabase self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+}
+
+CS101_StationDatabase
+CS101_StationDatabase_create(CS101_AppLayerParameters alParams)
+{
+    CS101_StationDatabase self = (CS101_StationDatabase)GLOBAL_CALLOC(1, sizeof(struct sCS101_StationDatabase));
+
+    if (self)
+    {
+        self->alParams = *alParams;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->lock = Semaphore_create(1);
+#endif
+    }
+
+    return self;
+}
+
+void
+CS101_StationDatabase_destroy(CS101_StationDatabase self)
+{
+    if (self)
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfStations; i++)
+        {
+            int j;
+
+            for (j = 0; j < self->stations[i].numberOfBlocks; j++)
+            {
+                GLOBAL_FREEMEM(self->stations[i].blocks[j].values);
+
+                if (self->stations[i].blocks[j].filter)
+                {
+                    GLOBAL_FREEMEM(self->stations[i].blocks[j].filter->lastReportTime);
+                    GLOBAL_FREEMEM(self->stations[i].blocks[j].filter);
+                }
+            }
+
+            GLOBAL_FREEMEM(self->stations[i].blocks);
+        }
+
+        GLOBAL_FREEMEM(self->stations);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_destroy(self->lock);
+#endif
+
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+static sStation*
+getStation(CS101_StationDatabase self, int ca)
+{
+    int i;
+
+    for (i = 0; i < self->numberOfStations; i++)
+    {
+        if (self->stations[i].ca == ca)
+            return &(self->stations[i]);
+    }
+
+    return NULL;
+}
+
+/* index of the first block with startIoa > ioa (binary search) */
+static int
+getUpperBlockIndex(sStation* station, int ioa)
+{
+    int low = 0;
+    int high = station->numberOfBlocks;
+
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+
+        if (station->blocks[mid].startIoa <= ioa)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+static sDataBlock*
+getBlock(sStation* station, int ioa)
+{
+    int index = getUpperBlockIndex(station, ioa) - 1;
+
+    if (index >= 0)
+    {
+        sDataBlock* block = &(station->blocks[index]);
+
+        if (ioa < block->startIoa + block->count)
+            return block;
+    }
+
+    return NULL;
+}
+
+static sStation*
+addStation(CS101_StationDatabase self, int ca)
+{
+    if (self->numberOfStations == self->maxNumberOfStations)
+    {
+        int newSize = (self->maxNumberOfStations == 0) ? 4 : self->maxNumberOfStations * 2;
+
+        sStation* stations = (sStation*)GLOBAL_REALLOC(self->stations, newSize * sizeof(sStation));
+
+        if (stations == NULL)
+            return NULL;
+
+        self->stations = stations;
+        self->maxNumberOfStations = newSize;
+    }
+
+    sStation* station = &(self->stations[self->numberOfStations++]);
+
+    station->ca = ca;
+    station->numberOfBlocks = 0;
+    station->maxNumberOfBlocks = 0;
+    station->blocks = NULL;
+
+    return station;
+}
+
+bool
+CS101_StationDatabase_addPoints(CS101_StationDatabase self, int ca, IEC60870_5_TypeID typeId, int startIoa,
+                                int count, int group, bool spontaneous)
+{
+    bool retVal = false;
+
+    int elementSize = getElementSize(typeId);
+
+    if ((elementSize == 0) || (count < 1) || (startIoa < 0) || (group < 0) || (group > 16))
+    {
+        DEBUG_PRINT("STATION DB: invalid parameters for data block\n");
+        return false;
+    }
+
+    lock(self);
+
+    sStation* station = getStation(self, ca);
+
+    if (station == NULL)
+        station = addStation(self, ca);
+
+    if (station)
+    {
+        int index = getUpperBlockIndex(station, startIoa);
+
+        /* check overlap with the preceding and the following block */
+        bool overlaps = false;
+
+        if ((index > 0) &&
+            (station->blocks[index - 1].startIoa + station->blocks[index - 1].count > startIoa))
+            overlaps = true;
+
+        if ((index < station->numberOfBlocks) && (startIoa + count > station->blocks[index].startIoa))
+            overlaps = true;
+
+        if (overlaps)
+        {
+            DEBUG_PRINT("STATION DB: data block overlaps with existing block\n");
+        }
+        else
+        {
+            if (station->numberOfBlocks == station->maxNumberOfBlocks)
+            {
+                int newSize = (station->maxNumberOfBlocks == 0) ? 4 : station->maxNumberOfBlocks * 2;
+
+                sDataBlock* blocks = (sDataBlock*)GLOBAL_REALLOC(station->blocks, newSize * sizeof(sDataBlock));
+
+                if (blocks)
+                {
+                    station->blocks = blocks;
+                    station->maxNumberOfBlocks = newSize;
+                }
+            }
+
+            uint8_t* values = NULL;
+
+            if (station->numberOfBlocks < station->maxNumberOfBlocks)
+                values = (uint8_t*)GLOBAL_CALLOC(count, elementSize);
+
+            if (values)
+            {
+                /* points are invalid until the first update (IV flag in the last byte of the value) */
+                if (typeId != M_ME_ND_1)
+                {
+                    int i;
+
+                    for (i = 0; i < count; i++)
+                        values[(i * elementSize) + elementSize - 1] = IEC60870_QUALITY_INVALID;
+                }
+
+                memmove(&(station->blocks[index + 1]), &(station->blocks[index]),
+                        (station->numberOfBlocks - index) * sizeof(sDataBlock));
+
+                sDataBlock* block = &(station->blocks[index]);
+
+                block->typeId = typeId;
+                block->startIoa = startIoa;
+                block->count = count;
+                block->group = group;
+                block->spontaneous = spontaneous;
+                block->elementSize = elementSize;
+                block->values = values;
+                block->filter = NULL;
+
+                station->numberOfBlocks++;
+
+                retVal = true;
+            }
+        }
+    }
+
+    unlock(self);
+
+    return retVal;
+}
+
+void
+CS101_StationDatabase_setEventHandler(CS101_StationDatabase self, CS101_StationDatabase_EventHandler handler,
+                                      void* parameter)
+{
+    lock(self);
+
+    self->eventHandler = handler;
+    self->eventHandlerParameter = parameter;
+
+    unlock(self);
+}
+
+/*
+ * Evaluate the deadbands of the points first .. first + count - 1 (count <= STATION_DB_UPDATE_CHUNK_SIZE)
+ * for the new values. Sets report[i] to 1 when the value of the point has to be reported.
+ * The evaluation is split into simple loops without branches and with only a few arrays that are
+ * written, so the compiler can vectorize the loops (with run-time alias checks).
+ */
+static void
+evaluateDeadbands(sDeadbandFilter* filter, int first, int count, const float* values, uint64_t currentTime,
+                  uint8_t* report)
+{
+    uint32_t now = (uint32_t)(currentTime - filter->baseTime);
+
+    uint32_t* lastReportTime = filter->lastReportTime + first;
+    uint32_t* lastUpdateTime = filter->lastUpdateTime + first;
+    uint32_t* maxInterval = filter->maxInterval + first;
+    float* reported = filter->reported + first;
+    float* integral = filter->integral + first;
+    float* absLimit = filter->absLimit + first;
+    float* relLimit = filter->relLimit + first;
+    float* integralLimit = filter->integralLimit + first;
+
+    float deviation[STATION_DB_UPDATE_CHUNK_SIZE];
+
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        float difference = values[i] - reported[i];
+
+        deviation[i] = (difference < 0.f) ? -difference : difference;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        integral[i] += deviation[i] * ((float)(int32_t)(now - lastUpdateTime[i]) * 0.001f);
+        lastUpdateTime[i] = now;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        float magnitude = (reported[i] < 0.f) ? -reported[i] : reported[i];
+
+        report[i] = (uint8_t)((deviation[i] > (absLimit[i] + relLimit[i] * magnitude)) |
+                              (integral[i] > integralLimit[i]) | ((now - lastReportTime[i]) >= maxInterval[i]));
+    }
+}
+
+static void
+setReported(sDeadbandFilter* filter, int index, float value, uint64_t now)
+{
+    filter->reported[index] = value;
+    filter->integral[index] = 0.f;
+    filter->lastReportTime[index] = (uint32_t)(now - filter->baseTime);
+}
+
+static sDeadbandFilter*
+createDeadbandFilter(sDataBlock* block, uint64_t now)
+{
+    sDeadbandFilter* filter = (sDeadbandFilter*)GLOBAL_MALLOC(sizeof(sDeadbandFilter));
+
+    if (filter)
+    {
+        int count = block->count;
+
+        /* all arrays in a single allocation */
+        uint8_t* memory = (uint8_t*)GLOBAL_MALLOC(count * (3 * sizeof(uint32_t) + 5 * sizeof(float)));
+
+        if (memory == NULL)
+        {
+            GLOBAL_FREEMEM(filter);
+            return NULL;
+        }
+
+        filter->baseTime = now;
+        filter->lastReportTime = (uint32_t*)memory;
+        filter->lastUpdateTime = filter->lastReportTime + count;
+        filter->maxInterval = filter->lastUpdateTime + count;
+        filter->reported = (float*)(filter->maxInterval + count);
+        filter->integral = filter->reported + count;
+        filter->absLimit = filter->integral + count;
+        filter->relLimit = filter->absLimit + count;
+        filter->integralLimit = filter->relLimit + count;
+
+        int i;
+
+        for (i = 0; i < count; i++)
+        {
+            filter->lastReportTime[i] = 0;
+            filter->lastUpdateTime[i] = 0;
+            filter->maxInterval[i] = UINT32_MAX;
+            filter->reported[i] = decodeMeasuredValue(block->typeId, block->values + (i * block->elementSize));
+            filter->integral[i] = 0.f;
+            filter->absLimit[i] = 0.f;
+            filter->relLimit[i] = 0.f;
+            filter->integralLimit[i] = INFINITY;
+        }
+    }
+
+    return filter;
+}
+
+/* get the block that contains all points of the range (requires lock) */
+static sDataBlock*
+getBlockForRange(CS101_StationDatabase self, int ca, int startIoa, int count)
+{
+    sStation* station = getStation(self, ca);
+
+    if (station && (count > 0))
+    {
+        sDataBlock* block = getBlock(station, startIoa);
+
+        if (block && (startIoa + count <= block->startIoa + block->count))
+            return block;
+    }
+
+    return NULL;
+}
+
+bool
+CS101_StationDatabase_setDeadband(CS101_StationDatabase self, int ca, int startIoa, int count, CS101_DeadbandType type,
+                                  float threshold, int maxReportInterval)
+{
+    bool retVal = false;
+
+    lock(self);
+
+    sDataBlock* block = getBlockForRange(self, ca, startIoa, count);
+
+    if (block && isMeasuredValueType(block->typeId))
+    {
+        uint64_t now = Hal_getMonotonicTimeInMs();
+
+        if (block->filter == NULL)
+            block->filter = createDeadbandFilter(block, now);
+
+        sDeadbandFilter* filter = block->filter;
+
+        if (filter)
+        {
+            int i;
+
+            for (i = startIoa - block->startIoa; i < startIoa - block->startIoa + count; i++)
+            {
+                filter->absLimit[i] = 0.f;
+                filter->relLimit[i] = 0.f;
+                filter->integralLimit[i] = INFINITY;
+
+                if (type == CS101_DEADBAND_ABSOLUTE)
+                {
+                    filter->absLimit[i] = threshold;
+                }
+                else if (type == CS101_DEADBAND_PERCENT)
+                {
+                    filter->relLimit[i] = threshold / 100.f;
+                }
+                else if (type == CS101_DEADBAND_INTEGRATED)
+                {
+                    filter->absLimit[i] = INFINITY;
+                    filter->integralLimit[i] = threshold;
+                }
+
+                filter->maxInterval[i] = (maxReportInterval > 0) ? (uint32_t)maxReportInterval : UINT32_MAX;
+                filter->integral[i] = 0.f;
+                filter->lastUpdateTime[i] = (uint32_t)(now - filter->baseTime);
+            }
+
+            retVal = true;
+        }
+    }
+    else
+    {
+        DEBUG_PRINT("STATION DB: deadband requires a range of measured values\n");
+    }
+
+    unlock(self);
+
+    return retVal;
+}
+
+bool
+CS101_StationDatabase_update(CS101_StationDatabase self, int ca, InformationObject io)
+{
+    bool updated = false;
+    bool changed = false;
+
+    CS101_StationDatabase_EventHandler eventHandler = NULL;
+    void* eventHandlerParameter = NULL;
+
+    IEC60870_5_TypeID blockType = getBlockType(InformationObject_getType(io));
+
+    if (blockType == (IEC60870_5_TypeID)0)
+        return false;
+
+    /* encode the value without IOA -> the value of the type without time tag comes first */
+    uint8_t encodedValue[32];
+    struct sBufferFrame bufferFrame;
+
+    Frame frame = BufferFrame_initialize(&bufferFrame, encodedValue, 0, sizeof(encodedValue));
+
+    if (InformationObject_encode(io, frame, &(self->alParams), true) == false)
+        return false;
+
+    lock(self);
+
+    sStation* station = getStation(self, ca);
+
+    if (station)
+    {
+        int ioa = InformationObject_getObjectAddress(io);
+
+        sDataBlock* block = getBlock(station, ioa);
+
+        if (block && (block->typeId == blockType) && (Frame_getMsgSize(frame) >= block->elementSize))
+        {
+            int index = ioa - block->startIoa;
+
+            uint8_t* value = block->values + (index * block->elementSize);
+
+            if (block->filter)
+            {
+                uint8_t report;
+                float newValue = decodeMeasuredValue(block->typeId, encodedValue);
+                uint64_t now = Hal_getMonotonicTimeInMs();
+
+                evaluateDeadbands(block->filter, index, 1, &newValue, now, &report);
+
+                /* a change of the quality is always reported */
+                if ((block->typeId != M_ME_ND_1) &&
+                    (value[block->elementSize - 1] != encodedValue[block->elementSize - 1]))
+                    report = 1;
+
+                if (report)
+                    setReported(block->filter, index, newValue, now);
+
+                memcpy(value, encodedValue, block->elementSize);
+
+                changed = (report && block->spontaneous);
+            }
+            else if (memcmp(value, encodedValue, block->elementSize) != 0)
+            {
+                memcpy(value, encodedValue, block->elementSize);
+
+                changed = block->spontaneous;
+            }
+
+            eventHandler = self->eventHandler;
+            eventHandlerParameter = self->eventHandlerParameter;
+
+            updated = true;
+        }
+    }
+
+    unlock(self);
+
+    /* report outside of the lock -> the handler can use other locks (e.g. of the event queue) */
+    if (changed && eventHandler)
+    {
+        sCS101_StaticASDU _asdu;
+
+        CS101_ASDU asdu = CS101_ASDU_initializeStatic(&_asdu, &(self->alParams), false, CS101_COT_SPONTANEOUS, 0, ca,
+                                                      false, false);
+
+        if (CS101_ASDU_addInformationObject(asdu, io))
+            eventHandler(eventHandlerParameter, asdu);
+    }
+
+    return updated;
+}
+
+static void
+addObjectAddress(CS101_StationDatabase self, CS101_ASDU asdu, int ioa);
+
+/* send the reported points of a chunk as spontaneous events (packed into ASDUs with SQ=0) */
+static void
+sendMeasuredValueEvents(CS101_StationDatabase self, int ca, IEC60870_5_TypeID typeId, int elementSize,
+                        const int* ioas, const uint8_t* encodedValues, int numberOfEvents, CP56Time2a timestamp,
+                        CS101_StationDatabase_EventHandler eventHandler, void* eventHandlerParameter)
+{
+    sCS101_StaticASDU _asdu;
+    CS101_ASDU asdu = NULL;
+
+    int headerSize = 2 + self->alParams.sizeOfCOT + self->alParams.sizeOfCA;
+    int eventSize = self->alParams.sizeOfIOA + elementSize + ((timestamp) ? 7 : 0);
+
+    int asduSize = 0;
+    int numberOfElements = 0;
+
+    int i;
+
+    for (i = 0; i < numberOfEvents; i++)
+    {
+        if (asdu && ((asduSize + eventSize > self->alParams.maxSizeOfASDU) || (numberOfElements == 127)))
+        {
+            CS101_ASDU_setNumberOfElements(asdu, numberOfElements);
+            eventHandler(eventHandlerParameter, asdu);
+
+            asdu = NULL;
+        }
+
+        if (asdu == NULL)
+        {
+            asdu = CS101_ASDU_initializeStatic(&_asdu, &(self->alParams), false, CS101_COT_SPONTANEOUS, 0, ca, false,
+                                               false);
+
+            CS101_ASDU_setTypeID(asdu, (timestamp) ? getTimeTaggedType(typeId) : typeId);
+
+            asduSize = headerSize;
+            numberOfElements = 0;
+        }
+
+        addObjectAddress(self, asdu, ioas[i]);
+        CS101_ASDU_addPayload(asdu, (uint8_t*)(encodedValues + (i * elementSize)), elementSize);
+
+        if (timestamp)
+            CS101_ASDU_addPayload(asdu, CP56Time2a_getEncodedValue(timestamp), 7);
+
+        asduSize += eventSize;
+        numberOfElements++;
+    }
+
+    if (asdu)
+    {
+        CS101_ASDU_setNumberOfElements(asdu, numberOfElements);
+        eventHandler(eventHandlerParameter, asdu);
+    }
+}
+
+int
+CS101_StationDatabase_updateMeasuredValues(CS101_StationDatabase self, int ca, int startIoa, int count,
+                                           const float* values, const QualityDescriptor* qualities,
+                                           CP56Time2a timestamp)
+{
+    int reportedPoints = 0;
+
+    /* M_ME_ND_1 has no time tagged type */
+    if (timestamp)
+    {
+        lock(self);
+
+        sDataBlock* block = getBlockForRange(self, ca, startIoa, count);
+
+        if (block && (block->typeId == M_ME_ND_1))
+            timestamp = NULL;
+
+        unlock(self);
+    }
+
+    int chunkStart;
+
+    for (chunkStart = 0; chunkStart < count; chunkStart += STATION_DB_UPDATE_CHUNK_SIZE)
+    {
+        int chunkSize = count - chunkStart;
+
+        if (chunkSize > STATION_DB_UPDATE_CHUNK_SIZE)
+            chunkSize = STATION_DB_UPDATE_CHUNK_SIZE;
+
+        uint8_t report[STATION_DB_UPDATE_CHUNK_SIZE];
+
+        int ioas[STATION_DB_UPDATE_CHUNK_SIZE];
+        uint8_t encodedValues[STATION_DB_UPDATE_CHUNK_SIZE * 5];
+        int numberOfEvents = 0;
+
+        IEC60870_5_TypeID typeId = (IEC60870_5_TypeID)0;
+        int elementSize = 0;
+
+        CS101_StationDatabase_EventHandler eventHandler = NULL;
+        void* eventHandlerParameter = NULL;
+
+        lock(self);
+
+        /* the block is checked for each chunk -> the lock is only held for a single chunk */
+        sDataBlock* block = getBlockForRange(self, ca, startIoa, count);
+
+        if ((block == NULL) || (isMeasuredValueType(block->typeId) == false))
+        {
+            unlock(self);
+
+            DEBUG_PRINT("STATION DB: update requires a range of measured values\n");
+
+            return -1;
+        }
+
+        typeId = block->typeId;
+        elementSize = block->elementSize;
+
+        int firstIndex = startIoa + chunkStart - block->startIoa;
+
+        const float* chunkValues = values + chunkStart;
+
+        uint64_t now = Hal_getMonotonicTimeInMs();
+
+        if (block->filter)
+        {
+            evaluateDeadbands(block->filter, firstIndex, chunkSize, chunkValues, now, report);
+        }
+        else
+        {
+            /* without filter every change is reported (compare the encoded values) */
+            int i;
+
+            for (i = 0; i < chunkSize; i++)
+            {
+                uint8_t newValue[5];
+                uint8_t* value = block->values + ((firstIndex + i) * elementSize);
+
+                encodeMeasuredValue(typeId, newValue, chunkValues[i]);
+
+                report[i] = (uint8_t)(memcmp(value, newValue, (typeId == M_ME_ND_1) ? 2 : elementSize - 1) != 0);
+            }
+        }
+
+        int i;
+
+        for (i = 0; i < chunkSize; i++)
+        {
+            uint8_t* value = block->values + ((firstIndex + i) * elementSize);
+
+            encodeMeasuredValue(typeId, value, chunkValues[i]);
+
+            if (typeId != M_ME_ND_1)
+            {
+                QualityDescriptor quality = (qualities) ? qualities[chunkStart + i] : IEC60870_QUALITY_GOOD;
+
+                /* a change of the quality is always reported */
+                if (value[elementSize - 1] != quality)
+                    report[i] = 1;
+
+                value[elementSize - 1] = quality;
+            }
+
+            if (report[i])
+            {
+                if (block->filter)
+                    setReported(block->filter, firstIndex + i, chunkValues[i], now);
+
+                reportedPoints++;
+
+                if (block->spontaneous)
+                {
+                    ioas[numberOfEvents] = startIoa + chunkStart + i;
+                    memcpy(encodedValues + (numberOfEvents * elementSize), value, elementSize);
+                    numberOfEvents++;
+                }
+            }
+        }
+
+        eventHandler = self->eventHandler;
+        eventHandlerParameter = self->eventHandlerParameter;
+
+        unlock(self);
+
+        /* report outside of the lock -> the handler can use other locks (e.g. of the event queue) */
+        if ((numberOfEvents > 0) && eventHandler)
+        {
+            sendMeasuredValueEvents(self, ca, typeId, elementSize, ioas, encodedValues, numberOfEvents, timestamp,
+                                    eventHandler, eventHandlerParameter);
+        }
+    }
+
+    return reportedPoints;
+}
+
+bool
+CS101_StationDatabase_hasStation(CS101_StationDatabase self, int ca)
+{
+    lock(self);
+
+    bool retVal = (getStation(self, ca) != NULL);
+
+    unlock(self);
+
+    return retVal;
+}
+
+static bool
+isBroadcastCA(CS101_StationDatabase self, int ca)
+{
+    if (self->alParams.sizeOfCA == 1)
+        return (ca == 0xff);
+    else
+        return (ca == 0xffff);
+}
+
+static void
+addObjectAddress(CS101_StationDatabase self, CS101_ASDU asdu, int ioa)
+{
+    uint8_t buffer[3];
+
+    buffer[0] = (uint8_t)(ioa & 0xff);
+    buffer[1] = (uint8_t)((ioa / 0x100) & 0xff);
+    buffer[2] = (uint8_t)((ioa / 0x10000) & 0xff);
+
+    CS101_ASDU_addPayload(asdu, buffer, self->alParams.sizeOfIOA);
+}
+
+bool
+CS101_StationDatabase_startInterrogation(CS101_StationDatabase self, sCS101_StationDatabaseCursor* cursor, int ca,
+                                         int oa, uint8_t qoi)
+{
+    bool retVal = false;
+
+    lock(self);
+
+    cursor->ca = ca;
+    cursor->oa = oa;
+    cursor->qoi = qoi;
+    cursor->state = STATION_DB_STATE_ACT_CON;
+    cursor->stationIndex = 0;
+    cursor->blockIndex = 0;
+    cursor->pointIndex = 0;
+
+    if (isBroadcastCA(self, ca))
+    {
+        retVal = (self->numberOfStations > 0);
+    }
+    else
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfStations; i++)
+        {
+            if (self->stations[i].ca == ca)
+            {
+                cursor->stationIndex = i;
+                retVal = true;
+                break;
+            }
+        }
+    }
+
+    if (retVal == false)
+        cursor->stationIndex = self->numberOfStations;
+
+    unlock(self);
+
+    return retVal;
+}
+
+/* check if the block is part of the requested interrogation */
+static bool
+isBlockRequested(sDataBlock* block, uint8_t qoi)
+{
+    if (qoi == IEC60870_QOI_STATION)
+        return true;
+
+    return (block->group == (int)qoi - IEC60870_QOI_STATION);
+}
+
+static CS101_ASDU
+createInterrogationCommand(CS101_StationDatabase self, sCS101_StationDatabaseCursor* cursor, sStation* station,
+                           CS101_CauseOfTransmission cot, CS101_StaticASDU asduBuffer)
+{
+    CS101_ASDU asdu = CS101_ASDU_initializeStatic(asduBuffer, &(self->alParams), false, cot, cursor->oa, station->ca,
+                                                  false, false);
+
+    CS101_ASDU_setTypeID(asdu, C_IC_NA_1);
+
+    addObjectAddress(self, asdu, 0);
+    CS101_ASDU_addPayload(asdu, &(cursor->qoi), 1);
+
+    CS101_ASDU_setNumberOfElements(asdu, 1);
+
+    return asdu;
+}
+
+/* pack as many points of the block as possible into an ASDU with SQ=1 (requires lock) */
+static CS101_ASDU
+createDataASDU(CS101_StationDatabase self, sCS101_StationDatabaseCursor* cursor, sStation* station,
+               sDataBlock* block, CS101_StaticASDU asduBuffer)
+{
+    CS101_ASDU asdu = CS101_ASDU_initializeStatic(asduBuffer, &(self->alParams), true,
+                                                  (CS101_CauseOfTransmission)cursor->qoi, cursor->oa, station->ca,
+                                                  false, false);
+
+    CS101_ASDU_setTypeID(asdu, block->typeId);
+
+    int headerSize = 2 + self->alParams.sizeOfCOT + self->alParams.sizeOfCA;
+
+    int maxElements = (self->alParams.maxSizeOfASDU - headerSize - self->alParams.sizeOfIOA) / block->elementSize;
+
+    if (maxElements > 127)
+        maxElements = 127;
+
+    int numberOfElements = block->count - cursor->pointIndex;
+
+    if (numberOfElements > maxElements)
+        numberOfElements = maxElements;
+
+    addObjectAddress(self, asdu, block->startIoa + cursor->pointIndex);
+
+    CS101_ASDU_addPayload(asdu, block->values + (cursor->pointIndex * block->elementSize),
+                          numberOfElements * block->elementSize);
+
+    CS101_ASDU_setNumberOfElements(asdu, numberOfElements);
+
+    cursor->pointIndex += numberOfElements;
+
+    if (cursor->pointIndex >= block->count)
+    {
+        cursor->blockIndex++;
+        cursor->pointIndex = 0;
+    }
+
+    return asdu;
+}
+
+CS101_ASDU
+CS101_StationDatabase_getNextInterrogationASDU(CS101_StationDatabase self, sCS101_StationDatabaseCursor* cursor,
+                                               CS101_StaticASDU asduBuffer)
+{
+    CS101_ASDU asdu = NULL;
+
+    lock(self);
+
+    while ((asdu == NULL) && (cursor->stationIndex < self->numberOfStations))
+    {
+        sStation* station = &(self->stations[cursor->stationIndex]);
+
+        if (cursor->state == STATION_DB_STATE_ACT_CON)
+        {
+            asdu = createInterrogationCommand(self, cursor, station, CS101_COT_ACTIVATION_CON, asduBuffer);
+
+            cursor->state = STATION_DB_STATE_DATA;
+            cursor->blockIndex = 0;
+            cursor->pointIndex = 0;
+        }
+        else if (cursor->state == STATION_DB_STATE_DATA)
+        {
+            /* skip blocks that are not part of the requested group */
+            while ((cursor->blockIndex < station->numberOfBlocks) &&
+                   (isBlockRequested(&(station->blocks[cursor->blockIndex]), cursor->qoi) == false))
+                cursor->blockIndex++;
+
+            if (cursor->blockIndex < station->numberOfBlocks)
+                asdu = createDataASDU(self, cursor, station, &(station->blocks[cursor->blockIndex]), asduBuffer);
+            else
+                cursor->state = STATION_DB_STATE_ACT_TERM;
+        }
+        else
+        {
+            asdu = createInterrogationCommand(self, cursor, station, CS101_COT_ACTIVATION_TERMINATION, asduBuffer);
+
+            cursor->state = STATION_DB_STATE_ACT_CON;
+
+            /* a broadcast request is answered by all stations */
+            if (isBroadcastCA(self, cursor->ca))
+                cursor->stationIndex++;
+            else
+                cursor->stationIndex = self->numberOfStations;
+        }
+    }
+
+    unlock(self);
+
+    return asdu;
+}
+
+CS101_ASDU
+CS101_StationDatabase_read(CS101_StationDatabase self, int ca, int ioa, int oa, CS101_StaticASDU asduBuffer)
+{
+    CS101_ASDU asdu = NULL;
+
+    lock(self);
+
+    sStation* station = getStation(self, ca);
+
+    if (station)
+    {
+        sDataBlock* block = getBlock(station, ioa);
+
+        if (block)
+        {
+            asdu = CS101_ASDU_initializeStatic(asduBuffer, &(self->alParams), false, CS101_COT_REQUEST, oa, ca, false,
+                                               false);
+
+            CS101_ASDU_setTypeID(asdu, block->typeId);
+
+            addObjectAddress(self, asdu, ioa);
+            CS101_ASDU_addPayload(asdu, block->values + ((ioa - block->startIoa) * block->elementSize),
+                                  block->elementSize);
+
+            CS101_ASDU_setNumberOfElements(asdu, 1);
+        }
+    }
+
+    unlock(self);
+
+    return asdu;
+}
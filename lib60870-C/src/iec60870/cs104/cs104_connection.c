@@ -95,8 +95,11 @@ struct sCS104_Connection
     struct sCS104_APCIParameters parameters;
     struct sCS101_AppLayerParameters alParameters;
 
-    uint8_t recvBuffer[260];
-    int recvBufPos;
+    uint8_t* rxBuffer; /* data received from the socket (can contain multiple APDUs) */
+    int rxBufferStart; /* start of the first unprocessed APDU in rxBuffer */
+    int rxBufferEnd;   /* end of the received data in rxBuffer */
+
+    uint8_t* recvBuffer; /* last received APDU (points into rxBuffer) */
 
     int connectTimeoutInMs;
     uint8_t sMessage[6];
@@ -162,7 +165,10 @@ struct sCS104_Connection
 
 /* Forward prototypes for internal static functions referenced by threadless API before their definitions */
 static int
-receiveMessage(CS104_Connection self);
+receiveMessage(CS104_Connection self, bool readSocket);
+
+static bool
+handleReceivedMessages(CS104_Connection self);
 
 static void
 confirmOutstandingMessages(CS104_Connection self);
@@ -435,6 +441,15 @@ createConnection(const char* hostname, int tcpPort)
 
     if (self)
     {
+        self->rxBuffer = (uint8_t*)GLOBAL_MALLOC(CONFIG_CS104_RX_BUFFER_SIZE);
+
+        if (self->rxBuffer == NULL)
+        {
+            DEBUG_PRINT("Failed to allocate memory for receive buffer\n");
+            GLOBAL_FREEMEM(self);
+            return NULL;
+        }
+
         strncpy(self->hostname, hostname, HOST_NAME_MAX);
         self->hostname[HOST_NAME_MAX] = 0;
         self->tcpPort = tcpPort;
@@ -614,7 +629,8 @@ resetConnection(CS104_Connection self)
 #endif /* (CONFIG_USE_SEMAPHORES == 1) */
 
     self->connectTimeoutInMs = self->parameters.t0 * 1000;
-    self->recvBufPos = 0;
+    self->rxBufferStart = 0;
+    self->rxBufferEnd = 0;
 
     self->running = false;
     self->failure = false;
@@ -770,6 +786,9 @@ CS104_Connection_destroy(CS104_Connection self)
     if (self->sentASDUs != NULL)
         GLOBAL_FREEMEM(self->sentASDUs);
 
+    if (self->rxBuffer != NULL)
+        GLOBAL_FREEMEM(self->rxBuffer);
+
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_destroy(self->conStateLock);
 #endif
@@ -917,44 +936,8 @@ CS104_Connection_run(CS104_Connection self, int timeoutMs)
     int waitTime = (timeoutMs > 0) ? timeoutMs : 0;
     if (Handleset_waitReady(handleSet, waitTime))
     {
-        int bytesRec = receiveMessage(self);
-        if (bytesRec == -1)
-        {
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->conStateLock);
-#endif
-            self->failure = true;
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->conStateLock);
-#endif
+        if (handleReceivedMessages(self) == false)
             continueLoop = false;
-        }
-        else if (bytesRec > 0)
-        {
-            if (self->rawMessageHandler)
-                self->rawMessageHandler(self->rawMessageHandlerParameter, self->recvBuffer, bytesRec, false);
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->conStateLock);
-#endif
-            CS104_ConState oldState = self->conState;
-            if (checkMessage(self, self->recvBuffer, bytesRec) == false)
-            {
-                self->failure = true;
-                continueLoop = false;
-            }
-            CS104_ConState newState = self->conState;
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->conStateLock);
-#endif
-            if (newState != oldState)
-            {
-                if (newState == STATE_ACTIVE)
-                    invokeConnectionHandler(self, CS104_CONNECTION_STARTDT_CON_RECEIVED);
-                else if (newState == STATE_INACTIVE)
-                    invokeConnectionHandler(self, CS104_CONNECTION_STOPDT_CON_RECEIVED);
-            }
-        }
     }
 
     /* confirmations */
@@ -1081,77 +1064,177 @@ readFromSocket(CS104_Connection self, uint8_t* buffer, int size)
 }
 
 /**
- * \brief Read message part into receive buffer
+ * \brief Get the size of the first complete message in the receive buffer
  *
- * \return -1 in case of an error, 0 when no complete message can be read, > 0 when a complete message is in buffer
+ * \return -1 in case of a framing error, 0 when no complete message is in the buffer, otherwise the message size
  */
 static int
-receiveMessage(CS104_Connection self)
+getBufferedMessageSize(CS104_Connection self)
 {
-    uint8_t* buffer = self->recvBuffer;
-    int bufPos = self->recvBufPos;
+    int available = self->rxBufferEnd - self->rxBufferStart;
 
-    /* read start byte */
-    if (bufPos == 0)
-    {
-        int readFirst = readFromSocket(self, buffer, 1);
+    if (available < 1)
+        return 0;
 
-        if (readFirst < 1)
-            return readFirst;
+    uint8_t* msg = self->rxBuffer + self->rxBufferStart;
 
-        if (buffer[0] != 0x68)
-            return -1; /* message error */
+    if (msg[0] != 0x68)
+        return -1; /* message error */
 
-        bufPos++;
-    }
+    if (available < 2)
+        return 0;
 
-    /* read length byte */
-    if (bufPos == 1)
-    {
-        int readCnt = readFromSocket(self, buffer + 1, 1);
+    int msgSize = msg[1] + 2;
 
-        if (readCnt < 0)
+    if (available < msgSize)
+        return 0;
+
+    return msgSize;
+}
+
+/**
+ * \brief Get the next message from the receive buffer. Read all available data from the socket
+ * when no complete message is in the buffer.
+ *
+ * The message is available in recvBuffer until the next call of this function.
+ *
+ * \param readSocket when false only messages already in the receive buffer are returned
+ *
+ * \return -1 in case of an error, 0 when no complete message can be read, > 0 when a complete message is in buffer
+ */
+static int
+receiveMessage(CS104_Connection self, bool readSocket)
+{
+    int msgSize = getBufferedMessageSize(self);
+
+    if ((msgSize == 0) && readSocket)
+    {
+        /* move incomplete message to beginning of buffer */
+        if (self->rxBufferStart > 0)
         {
-            self->recvBufPos = 0;
-            return -1;
+            int available = self->rxBufferEnd - self->rxBufferStart;
+
+            if (available > 0)
+                memmove(self->rxBuffer, self->rxBuffer + self->rxBufferStart, available);
+
+            self->rxBufferStart = 0;
+            self->rxBufferEnd = available;
         }
-        else if (readCnt == 0)
+
+        int readCnt = readFromSocket(self, self->rxBuffer + self->rxBufferEnd,
+                                     CONFIG_CS104_RX_BUFFER_SIZE - self->rxBufferEnd);
+
+        if (readCnt < 0)
+            msgSize = -1;
+        else
         {
-            self->recvBufPos = 1;
-            return 0;
-        }
+            self->rxBufferEnd += readCnt;
 
-        bufPos++;
+            msgSize = getBufferedMessageSize(self);
+        }
     }
 
-    /* read remaining frame */
-    if (bufPos > 1)
+    if (msgSize > 0)
+    {
+        self->recvBuffer = self->rxBuffer + self->rxBufferStart;
+        self->rxBufferStart += msgSize;
+    }
+    else if (msgSize < 0)
     {
-        int length = buffer[1];
+        self->rxBufferStart = 0;
+        self->rxBufferEnd = 0;
+    }
+
+    return msgSize;
+}
 
-        int remainingLength = length - bufPos + 2;
+/**
+ * \brief Handle all complete messages that were received with a single socket read
+ *
+ * \return false when the connection has to be closed (socket or message error), true otherwise
+ */
+static bool
+handleReceivedMessages(CS104_Connection self)
+{
+    bool retVal = true;
 
-        int readCnt = readFromSocket(self, buffer + bufPos, remainingLength);
+    int bytesRec = receiveMessage(self, true);
 
-        if (readCnt == remainingLength)
+    do
+    {
+        if (bytesRec == -1)
         {
-            self->recvBufPos = 0;
-            return length + 2;
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->conStateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+            self->failure = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->conStateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+            return false;
         }
-        else if (readCnt == -1)
+
+        if (bytesRec > 0)
         {
-            self->recvBufPos = 0;
-            return -1;
+            if (self->rawMessageHandler)
+                self->rawMessageHandler(self->rawMessageHandlerParameter, self->recvBuffer, bytesRec, false);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->conStateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+            CS104_ConState oldState = self->conState;
+
+            if (checkMessage(self, self->recvBuffer, bytesRec) == false)
+            {
+                /* close connection on error */
+                retVal = false;
+
+                self->failure = true;
+            }
+
+            CS104_ConState newState = self->conState;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->conStateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+            /* call connection handler when required */
+            if (newState != oldState)
+            {
+                if (newState == STATE_ACTIVE)
+                    invokeConnectionHandler(self, CS104_CONNECTION_STARTDT_CON_RECEIVED);
+                else if (newState == STATE_INACTIVE)
+                    invokeConnectionHandler(self, CS104_CONNECTION_STOPDT_CON_RECEIVED);
+            }
         }
-        else
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->conStateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+        if ((self->unconfirmedReceivedIMessages >= self->parameters.w) ||
+            ((self->conState == STATE_WAITING_FOR_STOPDT_CON) && (self->unconfirmedReceivedIMessages > 0)))
         {
-            self->recvBufPos = bufPos + readCnt;
-            return 0;
+            confirmOutstandingMessages(self);
         }
-    }
 
-    self->recvBufPos = bufPos;
-    return 0;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->conStateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+        if (retVal == false)
+            break;
+
+        if (bytesRec > 0)
+            bytesRec = receiveMessage(self, false);
+
+    } while (bytesRec != 0);
+
+    return retVal;
 }
 
 static bool
@@ -1525,72 +1608,8 @@ handleConnection(void* parameter)
 
                     if (Handleset_waitReady(handleSet, 100))
                     {
-                        int bytesRec = receiveMessage(self);
-
-                        if (bytesRec == -1)
-                        {
+                        if (handleReceivedMessages(self) == false)
                             loopRunning = false;
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                            Semaphore_wait(self->conStateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-
-                            self->failure = true;
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                            Semaphore_post(self->conStateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-                        }
-
-                        if (bytesRec > 0)
-                        {
-                            if (self->rawMessageHandler)
-                                self->rawMessageHandler(self->rawMessageHandlerParameter, self->recvBuffer, bytesRec,
-                                                        false);
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                            Semaphore_wait(self->conStateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-
-                            CS104_ConState oldState = self->conState;
-
-                            if (checkMessage(self, self->recvBuffer, bytesRec) == false)
-                            {
-                                /* close connection on error */
-                                loopRunning = false;
-
-                                self->failure = true;
-                            }
-
-                            CS104_ConState newState = self->conState;
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                            Semaphore_post(self->conStateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-
-                            /* call connection handler when required */
-                            if (newState != oldState)
-                            {
-                                if (newState == STATE_ACTIVE)
-                                    invokeConnectionHandler(self, CS104_CONNECTION_STARTDT_CON_RECEIVED);
-                                else if (newState == STATE_INACTIVE)
-                                    invokeConnectionHandler(self, CS104_CONNECTION_STOPDT_CON_RECEIVED);
-                            }
-                        }
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                        Semaphore_wait(self->conStateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-
-                        if ((self->unconfirmedReceivedIMessages >= self->parameters.w) ||
-                            ((self->conState == STATE_WAITING_FOR_STOPDT_CON) && (self->unconfirmedReceivedIMessages > 0)))
-                        {
-                            confirmOutstandingMessages(self);
-                        }
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                        Semaphore_post(self->conStateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
                     }
 
                     if (handleTimeouts(self) == false)
@@ -0,0 +1,505 @@
+/*
+ *  cs104_message_log_journal.c
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "cs104_message_log_journal.h"
+#include "hal_time.h"
+#include "lib60870_internal.h"
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+
+#define MESSAGE_LOG_JOURNAL_MAGIC 0x4a343031 /* "104J" */
+#define MESSAGE_LOG_JOURNAL_VERSION 6
+#define MESSAGE_LOG_JOURNAL_QUEUES 16
+
+/* position and ID of the oldest entry of a persistent log */
+struct sMessageLogJournalPosition
+{
+    uint64_t entryId;
+    uint32_t offset;
+    uint32_t reserved;
+};
+
+/* new content of an entry that is replaced by coalescing */
+struct sMessageLogJournalUpdate
+{
+    uint64_t entryId;
+    uint32_t offset;
+    uint32_t size;
+    uint8_t asdu[256];
+};
+
+/**
+ * Header of the journal file of a persistent log. The header is followed by the
+ * ring buffer of the log. The state of the ring buffer is restored by following
+ * the chain of valid entries starting with the first entry.
+ *
+ * The first entry is stored in two alternating records. A new record is written
+ * before it becomes valid by switching firstEntryRecord, so a crash can never
+ * leave a partially written record.
+ *
+ * An entry that is replaced by coalescing is first written to the update record.
+ * When the update was interrupted by a crash it is repeated by the recovery.
+ */
+struct sMessageLogJournal
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bufferSize;
+    uint32_t entryInfoSize;
+
+    volatile uint32_t firstEntryRecord; /* index of the valid record in firstEntry */
+    uint32_t reserved;
+
+    volatile uint64_t nextEntryId;
+
+    struct sMessageLogJournalPosition firstEntry[2];
+
+    /* ID of the last confirmed entry of each message queue */
+    volatile uint64_t confirmedId[MESSAGE_LOG_JOURNAL_QUEUES];
+
+    /* key of the message queue that owns the slot (empty -> slot is unused) */
+    char queueKey[MESSAGE_LOG_JOURNAL_QUEUES][MESSAGE_QUEUE_KEY_SIZE];
+
+    volatile uint32_t isUpdatePending; /* 1 -> update has to be applied by the recovery */
+    uint32_t reserved2;
+
+    struct sMessageLogJournalUpdate update;
+};
+
+/* FNV-1a hash of an entry folded to 24 bit */
+static uint32_t
+MessageLog_calculateChecksum(uint64_t entryId, const uint8_t* asdu, int asduSize)
+{
+    uint32_t hash = 2166136261u;
+
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        hash ^= (uint8_t)(entryId >> (i * 8));
+        hash *= 16777619u;
+    }
+
+    hash ^= (uint8_t)asduSize;
+    hash *= 16777619u;
+
+    for (i = 0; i < asduSize; i++)
+    {
+        hash ^= asdu[i];
+        hash *= 16777619u;
+    }
+
+    return ((hash >> 24) ^ hash) & 0xffffff;
+}
+
+/* store the checksum of the entry with the given ID (requires lock) */
+static void
+MessageLog_updateChecksum(uint8_t* entryPtr, uint64_t entryId)
+{
+    struct sMessageQueueEntryInfo entryInfo;
+
+    memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+    entryInfo.checksum = MessageLog_calculateChecksum(entryId, entryPtr + sizeof(struct sMessageQueueEntryInfo),
+                                                      entryInfo.size);
+
+    memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+}
+
+/* store the position of the oldest entry in the journal (requires lock) */
+void
+MessageLog_setJournalFirstEntry(MessageLog self, uint64_t entryId, uint32_t offset)
+{
+    struct sMessageLogJournal* journal = self->journal;
+
+    uint32_t current = journal->firstEntryRecord;
+
+    if ((journal->firstEntry[current].entryId != entryId) || (journal->firstEntry[current].offset != offset))
+    {
+        uint32_t next = (current + 1) % 2;
+
+        journal->firstEntry[next].entryId = entryId;
+        journal->firstEntry[next].offset = offset;
+
+        journal->firstEntryRecord = next;
+    }
+}
+
+/**
+ * Complete the last entry of the log in the journal (requires lock)
+ */
+void
+MessageLog_commitJournalEntry(MessageLog self)
+{
+    MessageLog_updateChecksum(self->lastEntry, self->entryId - 1);
+
+    self->journal->nextEntryId = self->entryId;
+}
+
+/**
+ * Store the new ASDU of an entry in the update record before the entry is overwritten (requires lock)
+ */
+void
+MessageLog_beginJournalUpdate(MessageLog self, uint8_t* entryPtr, uint64_t entryId, const uint8_t* asdu, int asduSize)
+{
+    struct sMessageLogJournal* journal = self->journal;
+
+    journal->update.entryId = entryId;
+    journal->update.offset = (uint32_t)(entryPtr - self->buffer);
+    journal->update.size = (uint32_t)asduSize;
+    memcpy(journal->update.asdu, asdu, asduSize);
+
+    if (self->syncOnWrite)
+        MappedFile_sync(self->journalFile, true);
+
+    journal->isUpdatePending = 1;
+
+    if (self->syncOnWrite)
+        MappedFile_sync(self->journalFile, true);
+}
+
+/**
+ * Complete the replacement of an entry after the new ASDU has been stored (requires lock)
+ */
+void
+MessageLog_endJournalUpdate(MessageLog self, uint8_t* entryPtr, uint64_t entryId)
+{
+    MessageLog_updateChecksum(entryPtr, entryId);
+
+    self->journal->isUpdatePending = 0;
+}
+
+/**
+ * Remove all entries from the journal (requires lock). No valid entry can be found in the
+ * buffer afterwards, so the log is restored as empty log with the given next entry ID.
+ */
+void
+MessageLog_resetJournal(MessageLog self, uint64_t nextEntryId)
+{
+    memset(self->buffer, 0, self->size);
+
+    MessageLog_setJournalFirstEntry(self, nextEntryId, 0);
+
+    self->journal->nextEntryId = nextEntryId;
+}
+
+/**
+ * Check if a completely written entry with the given ID is stored at the given position
+ * of the journal. When the new entry would overlap the oldest entry (limit) it is not valid.
+ */
+static bool
+MessageLog_isValidJournalEntry(MessageLog self, uint8_t* entryPtr, uint64_t entryId, uint8_t* limit)
+{
+    struct sMessageQueueEntryInfo entryInfo;
+
+    if (entryPtr + sizeof(struct sMessageQueueEntryInfo) > limit)
+        return false;
+
+    memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+    if (entryInfo.size == 0)
+        return false;
+
+    if (entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size > limit)
+        return false;
+
+    return (entryInfo.checksum == MessageLog_calculateChecksum(entryId,
+                                                               entryPtr + sizeof(struct sMessageQueueEntryInfo),
+                                                               entryInfo.size));
+}
+
+/**
+ * Restore the state of the log from the journal. Starting with the oldest entry the
+ * chain of entries with consecutive IDs is followed until the first missing or
+ * incomplete entry. The free space of the buffer is cleared so that incomplete
+ * entries cannot be mistaken for valid entries later.
+ */
+static void
+MessageLog_recoverJournal(MessageLog self)
+{
+    struct sMessageLogJournal* journal = self->journal;
+
+    uint8_t* bufferEnd = self->buffer + self->size;
+
+    /* complete the replacement of an entry that was interrupted */
+    if (journal->isUpdatePending)
+    {
+        struct sMessageLogJournalUpdate* update = &(journal->update);
+
+        if ((update->size <= sizeof(update->asdu)) &&
+            (update->offset + sizeof(struct sMessageQueueEntryInfo) + update->size <= (uint32_t)self->size))
+        {
+            uint8_t* entryPtr = self->buffer + update->offset;
+
+            if (MessageLog_getEntrySize(entryPtr) == (int)(sizeof(struct sMessageQueueEntryInfo) + update->size))
+            {
+                memcpy(entryPtr + sizeof(struct sMessageQueueEntryInfo), update->asdu, update->size);
+
+                MessageLog_updateChecksum(entryPtr, update->entryId);
+            }
+        }
+
+        journal->isUpdatePending = 0;
+    }
+
+    struct sMessageLogJournalPosition firstEntry = journal->firstEntry[journal->firstEntryRecord % 2];
+
+    if ((firstEntry.offset < (uint32_t)self->size) && (firstEntry.entryId != 0))
+    {
+        uint8_t* entryPtr = self->buffer + firstEntry.offset;
+
+        if (MessageLog_isValidJournalEntry(self, entryPtr, firstEntry.entryId, bufferEnd))
+        {
+            self->firstEntry = entryPtr;
+            self->lastEntry = entryPtr;
+            self->lastInBufferEntry = entryPtr;
+            self->entryCounter = 1;
+            self->entryId = firstEntry.entryId + 1;
+
+            while (true)
+            {
+                uint8_t* nextEntry = self->lastEntry + MessageLog_getEntrySize(self->lastEntry);
+
+                if (self->lastEntry < self->firstEntry)
+                {
+                    /* behind the wrap-around -> entries have to end before the oldest entry */
+                    if (MessageLog_isValidJournalEntry(self, nextEntry, self->entryId, self->firstEntry) == false)
+                        break;
+                }
+                else if (MessageLog_isValidJournalEntry(self, nextEntry, self->entryId, bufferEnd) == false)
+                {
+                    nextEntry = self->buffer;
+
+                    if (MessageLog_isValidJournalEntry(self, nextEntry, self->entryId, self->firstEntry) == false)
+                        break;
+                }
+
+                self->lastEntry = nextEntry;
+
+                if (self->lastEntry > self->lastInBufferEntry)
+                    self->lastInBufferEntry = self->lastEntry;
+
+                self->entryCounter++;
+                self->entryId++;
+            }
+        }
+    }
+
+    if (self->entryCounter > 0)
+    {
+        uint8_t* lastEntryEnd = self->lastEntry + MessageLog_getEntrySize(self->lastEntry);
+
+        if (self->lastEntry >= self->firstEntry)
+        {
+            memset(lastEntryEnd, 0, bufferEnd - lastEntryEnd);
+            memset(self->buffer, 0, self->firstEntry - self->buffer);
+        }
+        else
+        {
+            uint8_t* lastInBufferEntryEnd = self->lastInBufferEntry + MessageLog_getEntrySize(self->lastInBufferEntry);
+
+            memset(lastEntryEnd, 0, self->firstEntry - lastEntryEnd);
+            memset(lastInBufferEntryEnd, 0, bufferEnd - lastInBufferEntryEnd);
+        }
+    }
+    else
+    {
+        memset(self->buffer, 0, self->size);
+
+        /* keep the IDs unique -> IDs of the confirmation watermarks stay valid */
+        if (journal->nextEntryId > self->entryId)
+            self->entryId = journal->nextEntryId;
+    }
+
+    journal->nextEntryId = self->entryId;
+
+    /* the time when the restored entries were added is unknown -> use the time of the restart */
+    if (self->entryCounter > 0)
+        MessageLog_addTimeMark(self, MessageLog_getFirstEntryId(self), Hal_getMonotonicTimeInMs());
+
+    /* entries may be lost after a system crash -> new entries must not count as confirmed */
+    {
+        int i;
+
+        for (i = 0; i < MESSAGE_LOG_JOURNAL_QUEUES; i++)
+        {
+            if (journal->confirmedId[i] >= self->entryId)
+                journal->confirmedId[i] = self->entryId - 1;
+        }
+    }
+}
+
+/**
+ * Create a log that is stored in a memory mapped file. When the file contains the journal
+ * of a log with the same size the entries of the journal are restored.
+ */
+MessageLog
+MessageLog_createPersistent(int bufferSize, const char* filename, bool syncOnWrite)
+{
+    MessageLog self = MessageLog_createInstance(bufferSize);
+
+    if (self)
+    {
+        bool isNew = false;
+
+        self->journalFile = MappedFile_open(filename, sizeof(struct sMessageLogJournal) + self->size, &isNew);
+
+        if (self->journalFile == NULL)
+        {
+            DEBUG_PRINT("CS104 SLAVE: failed to open event queue file %s\n", filename);
+
+            MessageLog_destroyInstance(self);
+            return NULL;
+        }
+
+        uint8_t* fileBuffer = MappedFile_getBuffer(self->journalFile);
+
+        self->journal = (struct sMessageLogJournal*)fileBuffer;
+        self->buffer = fileBuffer + sizeof(struct sMessageLogJournal);
+        self->syncOnWrite = syncOnWrite;
+
+        struct sMessageLogJournal* journal = self->journal;
+
+        if (isNew || (journal->magic != MESSAGE_LOG_JOURNAL_MAGIC) || (journal->version != MESSAGE_LOG_JOURNAL_VERSION) ||
+            (journal->bufferSize != (uint32_t)self->size) ||
+            (journal->entryInfoSize != sizeof(struct sMessageQueueEntryInfo)))
+        {
+            if (isNew)
+                DEBUG_PRINT("CS104 SLAVE: initialize event queue file %s\n", filename);
+            else if (journal->magic != MESSAGE_LOG_JOURNAL_MAGIC)
+                DEBUG_PRINT("CS104 SLAVE: %s is no event queue file -> file is overwritten\n", filename);
+            else
+                DEBUG_PRINT("CS104 SLAVE: event queue file %s has a different format (version %u, buffer size %u) -> "
+                            "stored events are discarded\n",
+                            filename, journal->version, journal->bufferSize);
+
+            memset(fileBuffer, 0, MappedFile_getSize(self->journalFile));
+
+            journal->magic = MESSAGE_LOG_JOURNAL_MAGIC;
+            journal->version = MESSAGE_LOG_JOURNAL_VERSION;
+            journal->bufferSize = (uint32_t)self->size;
+            journal->entryInfoSize = sizeof(struct sMessageQueueEntryInfo);
+            journal->nextEntryId = self->entryId;
+
+            MappedFile_sync(self->journalFile, true);
+        }
+        else
+        {
+            MessageLog_recoverJournal(self);
+
+            DEBUG_PRINT("CS104 SLAVE: restored %i events from event queue file %s\n", self->entryCounter, filename);
+        }
+    }
+
+    return self;
+}
+
+/**
+ * Get the slot in the journal header for the confirmation state of a message queue (requires lock)
+ *
+ * The slot is found by the key of the message queue, so the confirmation state is restored
+ * for the same redundancy group also when the groups are created in a different order.
+ * A queue without a slot in the journal gets an unused slot.
+ *
+ * \return the slot index or -1 when the log is not persistent or no slot is available
+ */
+int
+MessageLog_allocateJournalSlot(MessageLog self, const char* queueKey)
+{
+    int i;
+    int freeSlot = -1;
+
+    if (self->journal == NULL)
+        return -1;
+
+    for (i = 0; i < MESSAGE_LOG_JOURNAL_QUEUES; i++)
+    {
+        const char* slotKey = self->journal->queueKey[i];
+
+        if (slotKey[0] == 0)
+        {
+            if (freeSlot == -1)
+                freeSlot = i;
+        }
+        else if (strncmp(slotKey, queueKey, MESSAGE_QUEUE_KEY_SIZE) == 0)
+        {
+            if (self->usedJournalSlots & (1U << i))
+            {
+                DEBUG_PRINT("CS104 SLAVE: duplicate message queue key %s -> confirmations are not stored\n", queueKey);
+                return -1;
+            }
+
+            self->usedJournalSlots |= (1U << i);
+
+            return i;
+        }
+    }
+
+    if (freeSlot == -1)
+    {
+        DEBUG_PRINT("CS104 SLAVE: no journal slot available for %s -> confirmations are not stored\n", queueKey);
+        return -1;
+    }
+
+    /* new queue -> all entries of the journal are unconfirmed */
+    self->journal->confirmedId[freeSlot] = 0;
+
+    strncpy(self->journal->queueKey[freeSlot], queueKey, MESSAGE_QUEUE_KEY_SIZE - 1);
+
+    if (self->journalFile)
+        MappedFile_sync(self->journalFile, true);
+
+    self->usedJournalSlots |= (1U << freeSlot);
+
+    return freeSlot;
+}
+
+/**
+ * Release the slot of a message queue that is destroyed (requires lock)
+ *
+ * The slot keeps the key and the confirmation state for the next queue with the same key.
+ */
+void
+MessageLog_releaseJournalSlot(MessageLog self, int slot)
+{
+    if (slot != -1)
+        self->usedJournalSlots &= ~(1U << slot);
+}
+
+/* ID of the last confirmed entry stored in the given slot (requires lock) */
+uint64_t
+MessageLog_getJournalConfirmedId(MessageLog self, int slot)
+{
+    return self->journal->confirmedId[slot];
+}
+
+/* store the ID of the last confirmed entry of the queue that owns the given slot (requires lock) */
+void
+MessageLog_setJournalConfirmedId(MessageLog self, int slot, uint64_t entryId)
+{
+    self->journal->confirmedId[slot] = entryId;
+}
+
+#endif /* (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1) */
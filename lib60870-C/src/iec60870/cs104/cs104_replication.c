@@ -0,0 +1,926 @@
+/*
+ *  cs104_replication.c
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "cs104_replication.h"
+#include "hal_socket.h"
+#include "hal_time.h"
+#include "lib60870_internal.h"
+#include "lib_memory.h"
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+
+/*
+ * Frames: type (1 byte), payload size (2 bytes), payload. All values are little endian.
+ *   HELLO:     magic, version (first frame of the active server)
+ *   RESET:     ID of the first entry, ID of the next entry (a snapshot of the entries in between follows)
+ *   ENTRY:     entry ID, age in ms, ASDU (new entry or entry replaced by coalescing)
+ *   CONFIRMED: for each message queue: key size (1 byte), key, ID of the last confirmed entry
+ */
+
+#define CS104_REPLICATION_MAGIC 0x52343031 /* "104R" */
+#define CS104_REPLICATION_VERSION 3
+
+#define CS104_REPLICATION_HELLO 1
+#define CS104_REPLICATION_RESET 2
+#define CS104_REPLICATION_ENTRY 3
+#define CS104_REPLICATION_CONFIRMED 4
+
+#define CS104_REPLICATION_HEADER_SIZE 3
+
+/* maximum number of message queues (redundancy groups) with replicated confirmation state */
+#define CS104_REPLICATION_MAX_QUEUES 64
+
+#define CS104_REPLICATION_MAX_ENTRY_FRAME (CS104_REPLICATION_HEADER_SIZE + 12 + 256)
+#define CS104_REPLICATION_MAX_CONFIRMED_PAYLOAD (CS104_REPLICATION_MAX_QUEUES * (1 + MESSAGE_QUEUE_KEY_SIZE + 8))
+#define CS104_REPLICATION_MAX_CONFIRMED_FRAME (CS104_REPLICATION_HEADER_SIZE + CS104_REPLICATION_MAX_CONFIRMED_PAYLOAD)
+
+#define CS104_REPLICATION_BUFFER_SIZE 16384
+
+/* time in ms between two connection attempts of the standby server */
+#define CS104_REPLICATION_RECONNECT_TIME 1000
+
+struct sCS104_Replication
+{
+    MessageLog log;
+
+    CS104_ReplicationCollectHandler collectHandler; /* called before the changes are collected (only active server) */
+    void* collectHandlerParameter;
+
+    char* activeAddress; /* address of the active server (NULL -> this is the active server) */
+    int port;
+
+    Thread thread;
+    bool isRunning;   /* protected by lock */
+    bool isConnected; /* protected by lock */
+    Semaphore lock;
+
+    ServerSocket serverSocket; /* waits for the standby server (only active server) */
+    Socket socket;
+    HandleSet handleSet;
+
+    uint64_t nextEntryId; /* next entry that has to be sent (only active server) */
+    bool resetRequired;   /* the standby has to remove its entries (only active server) */
+    bool helloReceived;   /* the peer is an active server (only standby server) */
+
+    /* snapshot that is received after a RESET (only standby server, NULL -> entries are added to the log) */
+    MessageLog resyncLog;
+    uint64_t resyncEndId; /* the snapshot is complete when this entry has been received */
+
+    /* last CONFIRMED frame received during the resync (applied again when the snapshot is complete) */
+    int resyncConfirmedSize;
+    uint8_t resyncConfirmed[CS104_REPLICATION_MAX_CONFIRMED_PAYLOAD];
+
+    /* confirmation state known by the standby (only active server) */
+    int numberOfConfirmedIds;
+    uint64_t confirmedIds[CS104_REPLICATION_MAX_QUEUES];
+
+    /* active server: frames waiting for transmission (bufferPos to bufferSize), standby server: received data */
+    uint8_t buffer[CS104_REPLICATION_BUFFER_SIZE];
+    int bufferPos;
+    int bufferSize;
+};
+
+static int
+CS104_Replication_encodeUint(uint8_t* buffer, uint64_t value, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buffer[i] = (uint8_t)(value >> (i * 8));
+
+    return size;
+}
+
+static uint64_t
+CS104_Replication_decodeUint(const uint8_t* buffer, int size)
+{
+    uint64_t value = 0;
+
+    int i;
+
+    for (i = 0; i < size; i++)
+        value |= ((uint64_t)buffer[i]) << (i * 8);
+
+    return value;
+}
+
+static int
+CS104_Replication_encodeHeader(uint8_t* buffer, int type, int payloadSize)
+{
+    buffer[0] = (uint8_t)type;
+
+    CS104_Replication_encodeUint(buffer + 1, (uint64_t)payloadSize, 2);
+
+    return CS104_REPLICATION_HEADER_SIZE;
+}
+
+static bool
+CS104_Replication_isRunning(CS104_Replication self)
+{
+    bool retVal;
+
+    Semaphore_wait(self->lock);
+    retVal = self->isRunning;
+    Semaphore_post(self->lock);
+
+    return retVal;
+}
+
+static void
+CS104_Replication_setConnected(CS104_Replication self, bool isConnected)
+{
+    Semaphore_wait(self->lock);
+    self->isConnected = isConnected;
+    Semaphore_post(self->lock);
+}
+
+bool
+CS104_Replication_isConnected(CS104_Replication self)
+{
+    bool retVal;
+
+    Semaphore_wait(self->lock);
+    retVal = self->isConnected;
+    Semaphore_post(self->lock);
+
+    return retVal;
+}
+
+static void
+CS104_Replication_updateHandleSet(CS104_Replication self)
+{
+    Handleset_reset(self->handleSet);
+
+    if (self->serverSocket)
+        Handleset_addSocket(self->handleSet, (Socket)self->serverSocket);
+
+    if (self->socket)
+        Handleset_addSocket(self->handleSet, self->socket);
+}
+
+/* the old entries of the standby are kept when the snapshot is not completed */
+static void
+CS104_Replication_discardResync(CS104_Replication self)
+{
+    if (self->resyncLog)
+    {
+        MessageLog_release(self->resyncLog);
+        self->resyncLog = NULL;
+    }
+}
+
+static void
+CS104_Replication_closeConnection(CS104_Replication self)
+{
+    CS104_Replication_discardResync(self);
+
+    if (self->socket)
+    {
+        Socket_destroy(self->socket);
+        self->socket = NULL;
+
+        CS104_Replication_updateHandleSet(self);
+
+        CS104_Replication_setConnected(self, false);
+    }
+}
+
+/**
+ * Add an ENTRY frame for the entry with the given ID (requires log lock). The time of the entry
+ * is sent as age, so the clocks of the servers don't have to be synchronized.
+ */
+static int
+CS104_Replication_encodeEntry(MessageLog log, uint8_t* buffer, uint64_t entryId, uint8_t* entryPtr)
+{
+    struct sMessageQueueEntryInfo entryInfo;
+
+    memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+    uint64_t age = Hal_getMonotonicTimeInMs() - MessageLog_getEntryTime(log, entryId);
+
+    if (age > UINT32_MAX)
+        age = UINT32_MAX;
+
+    int pos = CS104_Replication_encodeHeader(buffer, CS104_REPLICATION_ENTRY, 12 + entryInfo.size);
+
+    pos += CS104_Replication_encodeUint(buffer + pos, entryId, 8);
+    pos += CS104_Replication_encodeUint(buffer + pos, age, 4);
+
+    memcpy(buffer + pos, entryPtr + sizeof(struct sMessageQueueEntryInfo), entryInfo.size);
+
+    return pos + entryInfo.size;
+}
+
+/**
+ * Encode the changes of the event log since the last call into the buffer (active server).
+ * When the buffer is full the remaining changes are sent with the next batch.
+ */
+static void
+CS104_Replication_collectChanges(CS104_Replication self)
+{
+    MessageLog log = self->log;
+
+    uint8_t* buffer = self->buffer;
+    int size = 0;
+
+    /* room for the confirmation state is always kept */
+    int maxEntriesSize =
+        CS104_REPLICATION_BUFFER_SIZE - CS104_REPLICATION_MAX_CONFIRMED_FRAME - CS104_REPLICATION_MAX_ENTRY_FRAME;
+
+    if (self->collectHandler)
+        self->collectHandler(self->collectHandlerParameter);
+
+    MessageLog_lock(log);
+
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(log);
+
+    /* new standby or entries have been removed from the log before they were sent */
+    if (self->resetRequired || (self->nextEntryId < firstEntryId) || (self->nextEntryId > log->entryId))
+    {
+        size += CS104_Replication_encodeHeader(buffer + size, CS104_REPLICATION_RESET, 16);
+        size += CS104_Replication_encodeUint(buffer + size, firstEntryId, 8);
+        size += CS104_Replication_encodeUint(buffer + size, log->entryId, 8);
+
+        self->nextEntryId = firstEntryId;
+        self->numberOfConfirmedIds = 0;
+        self->resetRequired = false;
+
+        log->firstModifiedId = UINT64_MAX;
+    }
+
+    /* entries that have been replaced by coalescing after they were sent */
+    if (log->firstModifiedId < self->nextEntryId)
+    {
+        uint64_t entryId = log->firstModifiedId;
+
+        if (entryId < firstEntryId)
+            entryId = firstEntryId;
+
+        uint8_t* entryPtr = MessageLog_getEntry(log, entryId);
+
+        while ((entryId < self->nextEntryId) && (size <= maxEntriesSize))
+        {
+            size += CS104_Replication_encodeEntry(log, buffer + size, entryId, entryPtr);
+
+            entryId++;
+
+            if (entryId < self->nextEntryId)
+                entryPtr = MessageLog_getFollowingEntry(log, entryPtr);
+        }
+
+        log->firstModifiedId = (entryId < self->nextEntryId) ? entryId : UINT64_MAX;
+    }
+    else
+    {
+        /* entries that are not yet sent are sent with the latest value */
+        log->firstModifiedId = UINT64_MAX;
+    }
+
+    /* new entries */
+    if (self->nextEntryId < log->entryId)
+    {
+        uint8_t* entryPtr = MessageLog_getEntry(log, self->nextEntryId);
+
+        while ((self->nextEntryId < log->entryId) && (size <= maxEntriesSize))
+        {
+            size += CS104_Replication_encodeEntry(log, buffer + size, self->nextEntryId, entryPtr);
+
+            self->nextEntryId++;
+
+            if (self->nextEntryId < log->entryId)
+                entryPtr = MessageLog_getFollowingEntry(log, entryPtr);
+        }
+    }
+
+    /* confirmation state of the message queues (limited to the entries that are known by the standby) */
+    {
+        MessageQueue queues[CS104_REPLICATION_MAX_QUEUES];
+        uint64_t confirmedIds[CS104_REPLICATION_MAX_QUEUES];
+        int numberOfQueues = 0;
+        int payloadSize = 0;
+
+        bool changed = false;
+
+        LinkedList element = LinkedList_getNext(log->queues);
+
+        while (element && (numberOfQueues < CS104_REPLICATION_MAX_QUEUES))
+        {
+            MessageQueue queue = (MessageQueue)LinkedList_getData(element);
+
+            MessageQueue_updateCursors(queue);
+
+            uint64_t confirmedId = queue->firstUnconfirmedId - 1;
+
+            if (confirmedId >= self->nextEntryId)
+                confirmedId = self->nextEntryId - 1;
+
+            if ((numberOfQueues >= self->numberOfConfirmedIds) || (self->confirmedIds[numberOfQueues] != confirmedId))
+                changed = true;
+
+            payloadSize += 1 + (int)strlen(queue->key) + 8;
+
+            queues[numberOfQueues] = queue;
+            confirmedIds[numberOfQueues++] = confirmedId;
+
+            element = LinkedList_getNext(element);
+        }
+
+        if (numberOfQueues != self->numberOfConfirmedIds)
+            changed = true;
+
+        if (changed)
+        {
+            int i;
+
+            size += CS104_Replication_encodeHeader(buffer + size, CS104_REPLICATION_CONFIRMED, payloadSize);
+
+            /* the queues are identified by their key (the standby can have created them in a different order) */
+            for (i = 0; i < numberOfQueues; i++)
+            {
+                int keySize = (int)strlen(queues[i]->key);
+
+                buffer[size++] = (uint8_t)keySize;
+
+                memcpy(buffer + size, queues[i]->key, keySize);
+                size += keySize;
+
+                size += CS104_Replication_encodeUint(buffer + size, confirmedIds[i], 8);
+
+                self->confirmedIds[i] = confirmedIds[i];
+            }
+
+            self->numberOfConfirmedIds = numberOfQueues;
+        }
+    }
+
+    MessageLog_unlock(log);
+
+    self->bufferPos = 0;
+    self->bufferSize = size;
+}
+
+static void
+CS104_Replication_acceptStandby(CS104_Replication self)
+{
+    Socket newSocket = ServerSocket_accept(self->serverSocket);
+
+    if (newSocket)
+    {
+        /* a restarted standby replaces the old connection */
+        CS104_Replication_closeConnection(self);
+
+        self->socket = newSocket;
+
+        CS104_Replication_updateHandleSet(self);
+
+        int pos = CS104_Replication_encodeHeader(self->buffer, CS104_REPLICATION_HELLO, 8);
+
+        pos += CS104_Replication_encodeUint(self->buffer + pos, CS104_REPLICATION_MAGIC, 4);
+        pos += CS104_Replication_encodeUint(self->buffer + pos, CS104_REPLICATION_VERSION, 4);
+
+        self->bufferPos = 0;
+        self->bufferSize = pos;
+
+        self->resetRequired = true;
+
+        CS104_Replication_setConnected(self, true);
+
+        DEBUG_PRINT("CS104 SLAVE: standby server connected\n");
+    }
+}
+
+/* thread of the active server */
+static void*
+CS104_Replication_sendThread(void* parameter)
+{
+    CS104_Replication self = (CS104_Replication)parameter;
+
+    while (CS104_Replication_isRunning(self))
+    {
+        unsigned int waitTime = CONFIG_CS104_EVENT_QUEUE_REPLICATION_INTERVAL;
+
+        if (self->socket)
+        {
+            if (self->bufferPos == self->bufferSize)
+                CS104_Replication_collectChanges(self);
+
+            if (self->bufferPos < self->bufferSize)
+            {
+                int sentBytes =
+                    Socket_write(self->socket, self->buffer + self->bufferPos, self->bufferSize - self->bufferPos);
+
+                if (sentBytes < 0)
+                {
+                    DEBUG_PRINT("CS104 SLAVE: connection to standby server lost\n");
+
+                    CS104_Replication_closeConnection(self);
+                }
+                else
+                    self->bufferPos += sentBytes;
+            }
+
+            /* send the rest of the batch as soon as the standby can receive it */
+            if (self->socket && (self->bufferPos < self->bufferSize))
+                waitTime = 1;
+        }
+
+        if (Handleset_waitReady(self->handleSet, waitTime) > 0)
+        {
+            if (self->socket && Handleset_isReady(self->handleSet, self->socket))
+            {
+                uint8_t discardBuffer[64];
+
+                /* the standby doesn't send data -> only detect a closed connection */
+                if (Socket_read(self->socket, discardBuffer, sizeof(discardBuffer)) < 0)
+                {
+                    DEBUG_PRINT("CS104 SLAVE: standby server closed connection\n");
+
+                    CS104_Replication_closeConnection(self);
+                }
+            }
+
+            if (Handleset_isReady(self->handleSet, (Socket)self->serverSocket))
+                CS104_Replication_acceptStandby(self);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Apply the confirmation state of a CONFIRMED frame to the message queues with the same key (requires log lock)
+ *
+ * \return false when the frame is invalid
+ */
+static bool
+CS104_Replication_applyConfirmed(MessageLog log, const uint8_t* payload, int payloadSize)
+{
+    int pos = 0;
+
+    while (pos < payloadSize)
+    {
+        int keySize = payload[pos];
+
+        if ((keySize >= MESSAGE_QUEUE_KEY_SIZE) || (pos + 1 + keySize + 8 > payloadSize))
+            return false;
+
+        char key[MESSAGE_QUEUE_KEY_SIZE];
+
+        memcpy(key, payload + pos + 1, keySize);
+        key[keySize] = 0;
+
+        uint64_t confirmedId = CS104_Replication_decodeUint(payload + pos + 1 + keySize, 8);
+
+        /* queues that don't exist on the standby are ignored */
+        LinkedList element = LinkedList_getNext(log->queues);
+
+        while (element)
+        {
+            MessageQueue queue = (MessageQueue)LinkedList_getData(element);
+
+            if (strcmp(queue->key, key) == 0)
+            {
+                MessageQueue_setConfirmed(queue, confirmedId);
+                break;
+            }
+
+            element = LinkedList_getNext(element);
+        }
+
+        pos += 1 + keySize + 8;
+    }
+
+    return true;
+}
+
+/* replace the old entries by the completely received snapshot (requires log lock) */
+static void
+CS104_Replication_completeResync(CS104_Replication self)
+{
+    MessageLog log = self->log;
+    MessageLog snapshot = self->resyncLog;
+
+    uint64_t entryId = MessageLog_getFirstEntryId(snapshot);
+
+    MessageLog_reset(log, entryId);
+
+    uint8_t* entryPtr = snapshot->firstEntry;
+
+    while (entryId < snapshot->entryId)
+    {
+        int asduSize = MessageLog_getEntrySize(entryPtr) - (int)sizeof(struct sMessageQueueEntryInfo);
+
+        uint8_t* asduBuffer = MessageLog_addEntry(log, asduSize, MessageLog_getEntryTime(snapshot, entryId));
+
+        memcpy(asduBuffer, entryPtr + sizeof(struct sMessageQueueEntryInfo), asduSize);
+
+        MessageLog_commitEntry(log);
+
+        entryId++;
+
+        if (entryId < snapshot->entryId)
+            entryPtr = MessageLog_getFollowingEntry(snapshot, entryPtr);
+    }
+
+    if (self->resyncConfirmedSize > 0)
+        CS104_Replication_applyConfirmed(log, self->resyncConfirmed, self->resyncConfirmedSize);
+
+    CS104_Replication_discardResync(self);
+
+    DEBUG_PRINT("CS104 SLAVE: replicated event queue synchronized\n");
+}
+
+/* apply a frame of the active server to the event log (requires log lock) */
+static bool
+CS104_Replication_handleFrame(CS104_Replication self, int type, const uint8_t* payload, int payloadSize)
+{
+    MessageLog log = self->log;
+
+    if (type == CS104_REPLICATION_HELLO)
+    {
+        if ((payloadSize != 8) || (CS104_Replication_decodeUint(payload, 4) != CS104_REPLICATION_MAGIC) ||
+            (CS104_Replication_decodeUint(payload + 4, 4) != CS104_REPLICATION_VERSION))
+        {
+            DEBUG_PRINT("CS104 SLAVE: peer is not a compatible active server\n");
+            return false;
+        }
+
+        self->helloReceived = true;
+
+        CS104_Replication_setConnected(self, true);
+
+        return true;
+    }
+
+    if (self->helloReceived == false)
+        return false;
+
+    switch (type)
+    {
+    case CS104_REPLICATION_RESET:
+    {
+        if (payloadSize != 16)
+            return false;
+
+        uint64_t firstEntryId = CS104_Replication_decodeUint(payload, 8);
+        uint64_t endEntryId = CS104_Replication_decodeUint(payload + 8, 8);
+
+        if ((firstEntryId == 0) || (endEntryId < firstEntryId))
+            return false;
+
+        CS104_Replication_discardResync(self);
+
+        /* keep the old entries until all entries of the snapshot have been received */
+        if ((log->entryCounter > 0) && (endEntryId > firstEntryId))
+        {
+            self->resyncLog = MessageLog_create(log->size);
+
+            if (self->resyncLog == NULL)
+                DEBUG_PRINT("CS104 SLAVE: cannot keep replicated event queue during resync\n");
+        }
+
+        if (self->resyncLog)
+        {
+            MessageLog_reset(self->resyncLog, firstEntryId);
+
+            self->resyncEndId = endEntryId;
+            self->resyncConfirmedSize = 0;
+        }
+        else
+        {
+            MessageLog_reset(log, firstEntryId);
+        }
+    }
+    break;
+
+    case CS104_REPLICATION_ENTRY:
+    {
+        int asduSize = payloadSize - 12;
+
+        if ((asduSize < 1) || (asduSize > 256 - IEC60870_5_104_APCI_LENGTH))
+            return false;
+
+        uint64_t entryId = CS104_Replication_decodeUint(payload, 8);
+        uint64_t age = CS104_Replication_decodeUint(payload + 8, 4);
+
+        const uint8_t* asdu = payload + 12;
+
+        /* entries of a snapshot are collected until the snapshot is complete */
+        MessageLog target = self->resyncLog ? self->resyncLog : log;
+
+        if (entryId == target->entryId)
+        {
+            /* keep the age of the event when it was added by the active server */
+            uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+            uint64_t entryTime = (age < currentTime) ? (currentTime - age) : 0;
+
+            uint8_t* asduBuffer = MessageLog_addEntry(target, asduSize, entryTime);
+
+            memcpy(asduBuffer, asdu, asduSize);
+
+            MessageLog_commitEntry(target);
+
+            log->enqueuedEntries++;
+
+            if (self->resyncLog && (self->resyncLog->entryId >= self->resyncEndId))
+                CS104_Replication_completeResync(self);
+        }
+        else if (entryId < target->entryId)
+        {
+            /* entry replaced by coalescing (ignored when it is no longer in the log) */
+            uint8_t* entryPtr = MessageLog_getEntry(target, entryId);
+
+            if (entryPtr && (MessageLog_getEntrySize(entryPtr) == (int)sizeof(struct sMessageQueueEntryInfo) + asduSize))
+                MessageLog_replaceEntry(target, entryPtr, entryId, asdu, asduSize);
+        }
+        else
+        {
+            DEBUG_PRINT("CS104 SLAVE: missing entries in replicated event queue\n");
+            return false;
+        }
+    }
+    break;
+
+    case CS104_REPLICATION_CONFIRMED:
+    {
+        if (payloadSize > CS104_REPLICATION_MAX_CONFIRMED_PAYLOAD)
+            return false;
+
+        /* the IDs refer to the snapshot -> applied when the snapshot is complete */
+        if (self->resyncLog)
+        {
+            memcpy(self->resyncConfirmed, payload, payloadSize);
+            self->resyncConfirmedSize = payloadSize;
+        }
+        else if (CS104_Replication_applyConfirmed(log, payload, payloadSize) == false)
+            return false;
+    }
+    break;
+
+    default:
+        /* unknown frames are ignored */
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * Handle all complete frames in the receive buffer (standby server)
+ *
+ * \return false when the connection has to be closed (protocol error)
+ */
+static bool
+CS104_Replication_handleReceivedData(CS104_Replication self)
+{
+    bool retVal = true;
+
+    int pos = 0;
+
+    MessageLog_lock(self->log);
+
+    while (self->bufferSize - pos >= CS104_REPLICATION_HEADER_SIZE)
+    {
+        int payloadSize = (int)CS104_Replication_decodeUint(self->buffer + pos + 1, 2);
+
+        if (payloadSize > CS104_REPLICATION_BUFFER_SIZE - CS104_REPLICATION_HEADER_SIZE)
+        {
+            retVal = false;
+            break;
+        }
+
+        /* incomplete frame */
+        if (self->bufferSize - pos < CS104_REPLICATION_HEADER_SIZE + payloadSize)
+            break;
+
+        if (CS104_Replication_handleFrame(self, self->buffer[pos], self->buffer + pos + CS104_REPLICATION_HEADER_SIZE,
+                                          payloadSize) == false)
+        {
+            retVal = false;
+            break;
+        }
+
+        pos += CS104_REPLICATION_HEADER_SIZE + payloadSize;
+    }
+
+    MessageLog_unlock(self->log);
+
+    if (pos > 0)
+    {
+        memmove(self->buffer, self->buffer + pos, self->bufferSize - pos);
+        self->bufferSize -= pos;
+
+        MessageLog_sync(self->log);
+    }
+
+    return retVal;
+}
+
+static bool
+CS104_Replication_connect(CS104_Replication self)
+{
+    Socket socket = TcpSocket_create();
+
+    if (socket == NULL)
+        return false;
+
+    Socket_setConnectTimeout(socket, CS104_REPLICATION_RECONNECT_TIME);
+
+    if (Socket_connect(socket, self->activeAddress, self->port) == false)
+    {
+        Socket_destroy(socket);
+        return false;
+    }
+
+    self->socket = socket;
+    self->bufferSize = 0;
+    self->helloReceived = false;
+
+    CS104_Replication_updateHandleSet(self);
+
+    return true;
+}
+
+/* thread of the standby server */
+static void*
+CS104_Replication_receiveThread(void* parameter)
+{
+    CS104_Replication self = (CS104_Replication)parameter;
+
+    while (CS104_Replication_isRunning(self))
+    {
+        if (self->socket == NULL)
+        {
+            if (CS104_Replication_connect(self) == false)
+            {
+                int waitTime = 0;
+
+                while ((waitTime < CS104_REPLICATION_RECONNECT_TIME) && CS104_Replication_isRunning(self))
+                {
+                    Thread_sleep(10);
+                    waitTime += 10;
+                }
+
+                continue;
+            }
+
+            DEBUG_PRINT("CS104 SLAVE: connected to active server %s:%i\n", self->activeAddress, self->port);
+        }
+
+        if (Handleset_waitReady(self->handleSet, 100) > 0)
+        {
+            int readBytes = Socket_read(self->socket, self->buffer + self->bufferSize,
+                                        CS104_REPLICATION_BUFFER_SIZE - self->bufferSize);
+
+            if (readBytes > 0)
+                self->bufferSize += readBytes;
+
+            if ((readBytes < 0) || (CS104_Replication_handleReceivedData(self) == false))
+            {
+                DEBUG_PRINT("CS104 SLAVE: connection to active server closed\n");
+
+                CS104_Replication_closeConnection(self);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void
+CS104_Replication_destroy(CS104_Replication self)
+{
+    if (self->thread)
+    {
+        Semaphore_wait(self->lock);
+        self->isRunning = false;
+        Semaphore_post(self->lock);
+
+        Thread_destroy(self->thread);
+    }
+
+    if (self->socket)
+        Socket_destroy(self->socket);
+
+    CS104_Replication_discardResync(self);
+
+    if (self->serverSocket)
+        ServerSocket_destroy(self->serverSocket);
+
+    if (self->handleSet)
+        Handleset_destroy(self->handleSet);
+
+    if (self->activeAddress)
+        GLOBAL_FREEMEM(self->activeAddress);
+
+    Semaphore_destroy(self->lock);
+
+    MessageLog_release(self->log);
+
+    GLOBAL_FREEMEM(self);
+}
+
+/**
+ * Create and start the replication of the given event log
+ *
+ * \param localAddress local IP address the active server listens on (NULL -> all interfaces)
+ * \param activeAddress address of the active server (standby server) or NULL (active server)
+ * \param port TCP port of the replication connection
+ * \param collectHandler called by the active server before the changes of the log are collected (can be NULL)
+ *
+ * \return the new instance or NULL when the replication cannot be started
+ */
+CS104_Replication
+CS104_Replication_create(MessageLog log, const char* localAddress, const char* activeAddress, int port,
+                         CS104_ReplicationCollectHandler collectHandler, void* collectHandlerParameter)
+{
+    CS104_Replication self = (CS104_Replication)GLOBAL_CALLOC(1, sizeof(struct sCS104_Replication));
+
+    if (self == NULL)
+        return NULL;
+
+    self->port = port;
+
+    self->collectHandler = collectHandler;
+    self->collectHandlerParameter = collectHandlerParameter;
+
+    MessageLog_retain(log);
+    self->log = log;
+
+    self->lock = Semaphore_create(1);
+    self->resetRequired = true;
+
+    self->handleSet = Handleset_new();
+
+    if (self->handleSet == NULL)
+        goto exit_error;
+
+    if (activeAddress)
+    {
+        self->activeAddress = (char*)GLOBAL_MALLOC(strlen(activeAddress) + 1);
+
+        if (self->activeAddress == NULL)
+            goto exit_error;
+
+        strcpy(self->activeAddress, activeAddress);
+    }
+    else
+    {
+        if (localAddress)
+            self->serverSocket = TcpServerSocket_create(localAddress, port);
+        else
+            self->serverSocket = TcpServerSocket_create("0.0.0.0", port);
+
+        if (self->serverSocket == NULL)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Cannot create server socket for standby server\n");
+            goto exit_error;
+        }
+
+        ServerSocket_listen(self->serverSocket);
+
+        CS104_Replication_updateHandleSet(self);
+    }
+
+    self->isRunning = true;
+
+    self->thread = Thread_create(activeAddress ? CS104_Replication_receiveThread : CS104_Replication_sendThread,
+                                 (void*)self, false);
+
+    if (self->thread == NULL)
+        goto exit_error;
+
+    Thread_start(self->thread);
+
+    return self;
+
+exit_error:
+    CS104_Replication_destroy(self);
+
+    return NULL;
+}
+
+#endif /* (CS104_SLAVE_HAS_REPLICATION == 1) */
@@ -30,8 +30,13 @@
 
 #include "buffer_frame.h"
 #include "cs104_frame.h"
+#include "cs104_message_log.h"
+#include "cs104_message_log_journal.h"
+#include "cs104_replication.h"
 #include "cs104_slave.h"
+#include "cs104_timer_wheel.h"
 #include "frame.h"
+#include "hal_mapped_file.h"
 #include "hal_socket.h"
 #include "hal_thread.h"
 #include "hal_time.h"
@@ -44,6 +49,7 @@
 
 #include "apl_types_internal.h"
 #include "cs101_asdu_internal.h"
+#include "cs101_station_database_internal.h"
 
 #if (CONFIG_CS104_SUPPORT_TLS == 1)
 #include "tls_socket.h"
@@ -66,8 +72,40 @@ typedef enum
     M_CON_STATE_UNCONFIRMED_STOPPED /* only U, S frames allowed */
 } MasterConnectionState;
 
+typedef enum
+{
+    INTERROGATION_RESPONSE_NONE,
+    INTERROGATION_RESPONSE_DATABASE, /* response is created by the station database */
+    INTERROGATION_RESPONSE_HANDLER   /* response is pulled from the application (getNextInterrogationASDUHandler) */
+} InterrogationResponseSource;
+
 typedef struct sMasterConnection* MasterConnection;
 
+#if (CONFIG_USE_THREADS == 1)
+typedef struct sCS104_SlaveWorker* CS104_SlaveWorker;
+
+typedef struct sCS104_CommandWorker* CS104_CommandWorker;
+
+static bool
+CS104_Slave_assignConnectionToWorker(CS104_Slave self, MasterConnection connection, CS104_SlaveWorker worker);
+
+static MasterConnection
+CS104_Slave_openConnection(CS104_Slave self, Socket newSocket);
+
+static void
+MasterConnection_start(MasterConnection self);
+#endif
+
+/* TLS handshakes of the threading model CS104_THREADING_MODEL_EVENT_LOOP are performed by a thread pool */
+#if ((CONFIG_CS104_SUPPORT_TLS == 1) && (CONFIG_USE_THREADS == 1) && (CONFIG_USE_SEMAPHORES == 1))
+#define CS104_SLAVE_HAS_HANDSHAKE_THREADS 1
+#else
+#define CS104_SLAVE_HAS_HANDSHAKE_THREADS 0
+#endif
+
+static void
+MasterConnection_wakeup(MasterConnection self);
+
 static void
 MasterConnection_close(MasterConnection self);
 
@@ -112,13 +150,6 @@ typedef struct
     int msgSize;
 } FrameBuffer;
 
-typedef enum
-{
-    QUEUE_ENTRY_STATE_NOT_USED_OR_CONFIRMED,
-    QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION,
-    QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED
-} QueueEntryState;
-
 static bool
 handleASDU(MasterConnection self, CS101_ASDU asdu, CS101_SlavePlugin callingPlugin);
 
@@ -131,119 +162,321 @@ CS104_Slave_forwardASDU(CS101_SlavePlugin plugin, void* ctx, CS101_ASDU asdu, vo
 }
 
 /***************************************************
- * MessageQueue
+ * MessageLog (see cs104_message_log.h)
  ***************************************************/
 
-struct sMessageQueueEntryInfo
+MessageLog
+MessageLog_createInstance(int bufferSize)
 {
-    uint64_t entryId;
-    unsigned int entryState : 2;
-    unsigned int size : 8;
-};
+    MessageLog self = (MessageLog)GLOBAL_MALLOC(sizeof(struct sMessageLog));
 
-struct sMessageQueue
-{
-    int size;         /* size of buffer in bytes */
-    int entryCounter; /* number of messages (ASDU) in the queue */
+    if (self)
+    {
+        self->size = bufferSize;
+        self->buffer = NULL;
 
-    uint8_t* firstEntry;        /* first entry in FIFO */
-    uint8_t* lastEntry;         /* last entry in FIFO */
-    uint8_t* lastInBufferEntry; /* entry with highest address in FIFO buffer */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->logLock = Semaphore_create(1);
+#endif
 
-    uint64_t entryId; /* ID of next entry; will be increased by one for each new entry */
-    uint8_t* buffer;
+        self->entryCounter = 0;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore queueLock;
+        self->firstEntry = NULL;
+        self->lastEntry = NULL;
+        self->lastInBufferEntry = NULL;
+        self->entryId = 1;
+
+        self->refCount = 1;
+
+        self->queues = LinkedList_create();
+
+        self->overflowPolicy = CS104_QUEUE_OVERFLOW_DROP_OLDEST;
+        self->coalesceKeySize = 0;
+
+        memset(self->coalescedTypes, 0, sizeof(self->coalescedTypes));
+        self->index = NULL;
+        self->indexMask = 0;
+
+        self->enqueuedEntries = 0;
+        self->coalescedEntries = 0;
+
+        self->firstTimeMark = 0;
+        self->timeMarkCount = 0;
+        self->timeMarkInterval = MESSAGE_LOG_TIME_MARK_INTERVAL;
+
+        self->blockedProducers = LinkedList_create();
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+        self->firstModifiedId = UINT64_MAX;
 #endif
-};
 
-typedef struct sMessageQueue* MessageQueue;
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+        self->journalFile = NULL;
+        self->journal = NULL;
+        self->usedJournalSlots = 0;
+        self->syncOnWrite = false;
+#endif
+    }
 
-static void
-MessageQueue_initialize(MessageQueue self)
+    return self;
+}
+
+void
+MessageLog_destroyInstance(MessageLog self)
 {
-    self->entryCounter = 0;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_destroy(self->logLock);
+#endif
 
-    self->firstEntry = NULL;
-    self->lastEntry = NULL;
-    self->lastInBufferEntry = NULL;
-    self->entryId = 1;
+    LinkedList_destroyStatic(self->queues);
+    LinkedList_destroyStatic(self->blockedProducers);
+
+    if (self->index)
+        GLOBAL_FREEMEM(self->index);
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journalFile)
+        MappedFile_close(self->journalFile);
+    else
+        GLOBAL_FREEMEM(self->buffer);
+#else
+    GLOBAL_FREEMEM(self->buffer);
+#endif
+
+    GLOBAL_FREEMEM(self);
 }
 
-static MessageQueue
-MessageQueue_create(int maxQueueSize)
+/**
+ * Create a log with a buffer of the given size (in bytes)
+ */
+MessageLog
+MessageLog_create(int bufferSize)
 {
-    MessageQueue self = (MessageQueue)GLOBAL_MALLOC(sizeof(struct sMessageQueue));
+    MessageLog self = MessageLog_createInstance(bufferSize);
 
     if (self)
     {
-        self->size = maxQueueSize * (sizeof(struct sMessageQueueEntryInfo) + 256);
-
         DEBUG_PRINT("CS104 SLAVE: event queue buffer size: %i bytes\n", self->size);
 
         self->buffer = (uint8_t*)GLOBAL_CALLOC(1, self->size);
 
+        if (self->buffer == NULL)
+        {
+            MessageLog_destroyInstance(self);
+            self = NULL;
+        }
+    }
+
+    return self;
+}
+
+void
+MessageLog_lock(MessageLog self)
+{
 #if (CONFIG_USE_SEMAPHORES == 1)
-        self->queueLock = Semaphore_create(1);
+    Semaphore_wait(self->logLock);
 #endif
+}
 
-        MessageQueue_initialize(self);
-    }
+void
+MessageLog_unlock(MessageLog self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->logLock);
+#endif
+}
 
-    return self;
+void
+MessageLog_retain(MessageLog self)
+{
+    MessageLog_lock(self);
+
+    self->refCount++;
+
+    MessageLog_unlock(self);
 }
 
-static void
-MessageQueue_destroy(MessageQueue self)
+/**
+ * Release a reference to the log. The log is destroyed when the last reference is released.
+ */
+void
+MessageLog_release(MessageLog self)
 {
     if (self != NULL)
     {
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_destroy(self->queueLock);
-#endif
+        MessageLog_lock(self);
 
-        GLOBAL_FREEMEM(self->buffer);
-        GLOBAL_FREEMEM(self);
+        int refCount = --self->refCount;
+
+        MessageLog_unlock(self);
+
+        if (refCount == 0)
+            MessageLog_destroyInstance(self);
     }
 }
 
-static void
-MessageQueue_lock(MessageQueue self)
+/**
+ * Enable coalescing of ASDUs that refer to the same data point. The index has two slots
+ * for each data point (at least 64 slots).
+ *
+ * \param coalescedTypes bit set of the types that only keep the latest waiting value
+ * \param numberOfDataPoints expected number of data points with waiting entries that can be coalesced
+ */
+static bool
+MessageLog_enableCoalescing(MessageLog self, int coalesceKeySize, const uint8_t* coalescedTypes,
+                            int numberOfDataPoints)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+    uint32_t slots = 64;
+
+    while ((int)slots < numberOfDataPoints * 2)
+        slots = slots * 2;
+
+    self->index = (struct sMessageLogIndexSlot*)GLOBAL_CALLOC(slots, sizeof(struct sMessageLogIndexSlot));
+
+    if (self->index == NULL)
+        return false;
+
+    self->indexMask = slots - 1;
+    self->coalesceKeySize = coalesceKeySize;
+
+    memcpy(self->coalescedTypes, coalescedTypes, sizeof(self->coalescedTypes));
+
+    return true;
 }
 
-static void
-MessageQueue_unlock(MessageQueue self)
+static bool
+MessageLog_isCoalescedType(MessageLog self, uint8_t typeId)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    return ((self->coalescedTypes[typeId / 8] & (1 << (typeId % 8))) != 0);
+}
+
+/* size of the entry at the given position (header and ASDU) */
+int
+MessageLog_getEntrySize(uint8_t* entryPtr)
+{
+    struct sMessageQueueEntryInfo entryInfo;
+
+    memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+    return sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
 }
 
+/* number of bytes used by the given entry and all following entries of the log (requires lock) */
 static int
-MessageQueue_getEntryCount(MessageQueue self)
+MessageLog_getUsedBytesFrom(MessageLog self, uint8_t* entryPtr)
 {
-    int count = 0;
+    if ((self->entryCounter == 0) || (entryPtr == NULL))
+        return 0;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+    uint8_t* lastEntryEnd = self->lastEntry + MessageLog_getEntrySize(self->lastEntry);
 
-    count = self->entryCounter;
+    if (self->lastEntry >= entryPtr)
+        return (int)(lastEntryEnd - entryPtr);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    uint8_t* lastInBufferEntryEnd = self->lastInBufferEntry + MessageLog_getEntrySize(self->lastInBufferEntry);
 
-    return count;
+    return (int)((lastInBufferEntryEnd - entryPtr) + (lastEntryEnd - self->buffer));
+}
+
+/* number of bytes used by the entries of the log (requires lock) */
+static int
+MessageLog_getUsedBytes(MessageLog self)
+{
+    return MessageLog_getUsedBytesFrom(self, self->firstEntry);
+}
+
+/* ID of the oldest entry in the log (requires lock) */
+uint64_t
+MessageLog_getFirstEntryId(MessageLog self)
+{
+    return self->entryId - (uint64_t)self->entryCounter;
+}
+
+static struct sMessageLogTimeMark*
+MessageLog_getTimeMark(MessageLog self, int index)
+{
+    return &(self->timeMarks[(self->firstTimeMark + index) % MESSAGE_LOG_TIME_MARKS]);
+}
+
+/**
+ * Record the time when an entry was added (requires lock). A new mark is only added when the
+ * last mark is older than the mark interval. When the table is full every second mark is removed,
+ * so the marks always cover all entries of the log.
+ */
+void
+MessageLog_addTimeMark(MessageLog self, uint64_t entryId, uint64_t time)
+{
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(self);
+
+    /* remove the marks of entries that are no longer in the log */
+    while ((self->timeMarkCount > 1) && (MessageLog_getTimeMark(self, 1)->entryId <= firstEntryId))
+    {
+        self->firstTimeMark = (self->firstTimeMark + 1) % MESSAGE_LOG_TIME_MARKS;
+        self->timeMarkCount--;
+    }
+
+    if (self->timeMarkCount > 0)
+    {
+        struct sMessageLogTimeMark* lastMark = MessageLog_getTimeMark(self, self->timeMarkCount - 1);
+
+        if (time < lastMark->time)
+            time = lastMark->time;
+
+        if (time - lastMark->time < (uint64_t)self->timeMarkInterval)
+            return;
+    }
+
+    if (self->timeMarkCount == MESSAGE_LOG_TIME_MARKS)
+    {
+        int i;
+
+        for (i = 1; i < MESSAGE_LOG_TIME_MARKS / 2; i++)
+            *MessageLog_getTimeMark(self, i) = *MessageLog_getTimeMark(self, 2 * i);
+
+        self->timeMarkCount = MESSAGE_LOG_TIME_MARKS / 2;
+        self->timeMarkInterval *= 2;
+    }
+    else if ((self->timeMarkCount < MESSAGE_LOG_TIME_MARKS / 4) &&
+             (self->timeMarkInterval > MESSAGE_LOG_TIME_MARK_INTERVAL))
+    {
+        self->timeMarkInterval /= 2;
+    }
+
+    struct sMessageLogTimeMark* mark = MessageLog_getTimeMark(self, self->timeMarkCount);
+
+    mark->entryId = entryId;
+    mark->time = time;
+
+    self->timeMarkCount++;
+}
+
+/**
+ * Get the (monotonic) time when the entry with the given ID was added (requires lock).
+ * The result can be earlier than the real time by up to the current mark interval.
+ */
+uint64_t
+MessageLog_getEntryTime(MessageLog self, uint64_t entryId)
+{
+    int i = self->timeMarkCount;
+
+    while (i > 0)
+    {
+        i--;
+
+        struct sMessageLogTimeMark* mark = MessageLog_getTimeMark(self, i);
+
+        if (mark->entryId <= entryId)
+            return mark->time;
+    }
+
+    if (self->timeMarkCount > 0)
+        return MessageLog_getTimeMark(self, 0)->time;
+
+    return Hal_getMonotonicTimeInMs();
 }
 
 static int
-MessageQueue_countEntriesUntilEndOfBuffer(MessageQueue self, uint8_t* firstEntry)
+MessageLog_countEntriesUntilEndOfBuffer(MessageLog self, uint8_t* firstEntry)
 {
     int count = 0;
 
@@ -268,33 +501,90 @@ MessageQueue_countEntriesUntilEndOfBuffer(MessageQueue self, uint8_t* firstEntry
 }
 
 /**
- * Add an ASDU to the queue. When queue is full, override oldest entry.
+ * Complete the last entry after the ASDU has been stored (requires lock). For
+ * persistent logs this makes the entry valid in the journal.
  */
-static void
-MessageQueue_enqueueASDU(MessageQueue self, CS101_ASDU asdu)
+void
+MessageLog_commitEntry(MessageLog self)
 {
-    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journal)
+        MessageLog_commitJournalEntry(self);
+#else
+    (void)self;
+#endif
+}
 
-    if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH)
+/**
+ * Replace the ASDU of an entry with a new ASDU of the same size (requires lock). In a persistent
+ * log the new ASDU is first stored in the update record of the journal, so a crash while the
+ * entry is overwritten cannot invalidate the entry.
+ */
+void
+MessageLog_replaceEntry(MessageLog self, uint8_t* entryPtr, uint64_t entryId, const uint8_t* asdu, int asduSize)
+{
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journal)
+        MessageLog_beginJournalUpdate(self, entryPtr, entryId, asdu, asduSize);
+#endif
+
+    memcpy(entryPtr + sizeof(struct sMessageQueueEntryInfo), asdu, asduSize);
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journal)
+        MessageLog_endJournalUpdate(self, entryPtr, entryId);
+#else
+    (void)entryId;
+#endif
+}
+
+/**
+ * Write the new entries of a persistent log to the storage device (when configured)
+ */
+void
+MessageLog_sync(MessageLog self)
+{
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journalFile && self->syncOnWrite)
     {
-        DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
-        return;
+        if (MappedFile_sync(self->journalFile, true) == false)
+            DEBUG_PRINT("CS104 SLAVE: failed to sync event queue file\n");
     }
+#else
+    (void)self;
+#endif
+}
 
-    int entrySize = sizeof(struct sMessageQueueEntryInfo) + asduSize;
+/* state of the log after a new entry has been added */
+struct sMessageLogLayout
+{
+    int entryCounter;           /* number of old entries that are kept */
+    uint8_t* firstEntry;
+    uint8_t* lastInBufferEntry;
+    uint8_t* newEntry;          /* position of the new entry */
+};
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+/**
+ * Calculate the position of a new entry of the given size and the old entries that have
+ * to be removed to make room for it (requires lock). The log is not changed.
+ */
+static void
+MessageLog_planEntry(MessageLog self, int asduSize, struct sMessageLogLayout* layout)
+{
+    int entrySize = sizeof(struct sMessageQueueEntryInfo) + asduSize;
 
     struct sMessageQueueEntryInfo entryInfo;
 
     uint8_t* nextMsgPtr;
 
-    if (self->entryCounter == 0)
+    layout->entryCounter = self->entryCounter;
+    layout->firstEntry = self->firstEntry;
+    layout->lastInBufferEntry = self->lastInBufferEntry;
+
+    if (layout->entryCounter == 0)
     {
-        self->firstEntry = self->buffer;
-        self->lastInBufferEntry = self->firstEntry;
+        layout->firstEntry = self->buffer;
+        layout->lastInBufferEntry = layout->firstEntry;
         nextMsgPtr = self->buffer;
     }
     else
@@ -306,4847 +596,10218 @@ MessageQueue_enqueueASDU(MessageQueue self, CS101_ASDU asdu)
         if (nextMsgPtr + entrySize > self->buffer + self->size)
         {
             /* remove all entries from last entry to end of buffer */
-            if (nextMsgPtr <= self->firstEntry)
+            if (nextMsgPtr <= layout->firstEntry)
             {
-                self->entryCounter -= MessageQueue_countEntriesUntilEndOfBuffer(self, self->firstEntry);
-                self->firstEntry = self->buffer;
+                layout->entryCounter -= MessageLog_countEntriesUntilEndOfBuffer(self, layout->firstEntry);
+                layout->firstEntry = self->buffer;
             }
 
             /* put new message at beginning of buffer */
             nextMsgPtr = self->buffer;
 
-            if (self->lastEntry > self->firstEntry)
-                self->lastInBufferEntry = self->lastEntry;
+            if (self->lastEntry > layout->firstEntry)
+                layout->lastInBufferEntry = self->lastEntry;
         }
 
-        if (nextMsgPtr <= self->firstEntry)
+        if (nextMsgPtr <= layout->firstEntry)
         {
             /* remove old entries until we have enough space for the new ASDU */
-            while ((nextMsgPtr + entrySize > self->firstEntry) && (self->entryCounter > 0))
+            while ((nextMsgPtr + entrySize > layout->firstEntry) && (layout->entryCounter > 0))
             {
-                self->entryCounter--;
+                layout->entryCounter--;
 
-                if (self->firstEntry == self->lastInBufferEntry)
+                if (layout->firstEntry == layout->lastInBufferEntry)
                 {
-                    self->firstEntry = self->buffer;
-                    self->lastInBufferEntry = nextMsgPtr;
+                    layout->firstEntry = self->buffer;
+                    layout->lastInBufferEntry = nextMsgPtr;
                     break;
                 }
                 else
                 {
-                    memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
-                    self->firstEntry = self->firstEntry + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+                    memcpy(&entryInfo, layout->firstEntry, sizeof(struct sMessageQueueEntryInfo));
+                    layout->firstEntry = layout->firstEntry + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
                 }
             }
         }
     }
 
-    self->lastEntry = nextMsgPtr;
+    layout->newEntry = nextMsgPtr;
+}
 
-    if (self->lastEntry > self->lastInBufferEntry)
-        self->lastInBufferEntry = self->lastEntry;
+static void
+MessageLog_countDroppedEntries(MessageLog self, uint64_t firstEntryId, uint64_t newFirstEntryId);
 
-    self->entryCounter++;
+/**
+ * Add a new entry for an ASDU of the given size to the log (requires lock). When the
+ * log is full, override oldest entry.
+ *
+ * \param entryTime monotonic time when the ASDU was added
+ *
+ * \return pointer to the buffer where the encoded ASDU has to be stored
+ */
+uint8_t*
+MessageLog_addEntry(MessageLog self, int asduSize, uint64_t entryTime)
+{
+    struct sMessageLogLayout layout;
 
-    struct sBufferFrame bufferFrame;
+    struct sMessageQueueEntryInfo entryInfo;
 
-    Frame frame = BufferFrame_initialize(&bufferFrame, nextMsgPtr + sizeof(struct sMessageQueueEntryInfo), 0, 256);
-    CS101_ASDU_encode(asdu, frame);
+    MessageLog_planEntry(self, asduSize, &layout);
 
-    entryInfo.size = asduSize;
-    entryInfo.entryId = self->entryId++;
-    entryInfo.entryState = QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION;
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(self);
+    uint64_t newFirstEntryId = self->entryId - (uint64_t)layout.entryCounter;
 
-    memcpy(nextMsgPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+    if (newFirstEntryId > firstEntryId)
+        MessageLog_countDroppedEntries(self, firstEntryId, newFirstEntryId);
 
-    DEBUG_PRINT("CS104 SLAVE: ASDUs in FIFO: %i (new(size=%i/%i): %p, first: %p, last: %p lastInBuf: %p)\n",
-                self->entryCounter, entrySize, asduSize, nextMsgPtr, self->firstEntry, self->lastEntry,
-                self->lastInBufferEntry);
+    self->entryCounter = layout.entryCounter;
+    self->firstEntry = layout.firstEntry;
+    self->lastInBufferEntry = layout.lastInBufferEntry;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
-}
-
-static bool
-MessageQueue_isAsduAvailable(MessageQueue self, TypeID* typeId)
-{
-    bool retVal = false;
+    uint8_t* nextMsgPtr = layout.newEntry;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    /* the journal must not refer to removed entries when the new entry is written */
+    if (self->journal)
+        MessageLog_setJournalFirstEntry(self, newFirstEntryId, (uint32_t)(self->firstEntry - self->buffer));
 #endif
 
-    if (self->entryCounter != 0)
-    {
-        uint8_t* entryPtr = self->firstEntry;
-
-        struct sMessageQueueEntryInfo entryInfo;
-
-        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+    self->lastEntry = nextMsgPtr;
 
-        while (entryInfo.entryState != QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION)
-        {
-            if (entryPtr == self->lastEntry)
-                break;
+    if (self->lastEntry > self->lastInBufferEntry)
+        self->lastInBufferEntry = self->lastEntry;
 
-            /* move to next entry */
-            if (entryPtr == self->lastInBufferEntry)
-                entryPtr = self->buffer;
-            else
-                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+    self->entryCounter++;
 
-            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
-        }
+    entryInfo.size = asduSize;
+    entryInfo.checksum = 0;
 
-        if (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION)
-        {
-            if (typeId)
-            {
-                uint8_t* buffer = entryPtr + sizeof(struct sMessageQueueEntryInfo);
+    self->entryId++;
 
-                *typeId = (TypeID)(buffer[0]);
-            }
+    MessageLog_addTimeMark(self, self->entryId - 1, entryTime);
 
-            retVal = true;
-        }
-    }
+    memcpy(nextMsgPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    DEBUG_PRINT("CS104 SLAVE: ASDUs in FIFO: %i (new(size=%i/%i): %p, first: %p, last: %p lastInBuf: %p)\n",
+                self->entryCounter, (int)(sizeof(struct sMessageQueueEntryInfo) + asduSize), asduSize, nextMsgPtr,
+                self->firstEntry, self->lastEntry, self->lastInBufferEntry);
 
-    return retVal;
+    return nextMsgPtr + sizeof(struct sMessageQueueEntryInfo);
 }
 
-static uint8_t*
-MessageQueue_getNextWaitingASDU(MessageQueue self, uint64_t* entryId, uint8_t** queueEntry, int* size)
+/**
+ * Get the entry with the given ID (requires lock)
+ *
+ * \return pointer to the entry or NULL when the entry is not in the log
+ */
+uint8_t*
+MessageLog_getEntry(MessageLog self, uint64_t entryId)
 {
-    uint8_t* buffer = NULL;
-
-    if (self->entryCounter != 0)
-    {
-        uint8_t* entryPtr = self->firstEntry;
-
-        struct sMessageQueueEntryInfo entryInfo;
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(self);
 
-        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+    if ((entryId < firstEntryId) || (entryId >= self->entryId))
+        return NULL;
 
-        while (entryInfo.entryState != QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION)
-        {
-            if (entryPtr == self->lastEntry)
-                break;
+    uint64_t entriesToSkip = entryId - firstEntryId;
 
-            /* move to next entry */
-            if (entryPtr == self->lastInBufferEntry)
-                entryPtr = self->buffer;
-            else
-                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+    uint8_t* entryPtr = self->firstEntry;
 
-            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
-        }
+    while (entriesToSkip > 0)
+    {
+        struct sMessageQueueEntryInfo entryInfo;
 
-        if (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION)
-        {
-            *entryId = entryInfo.entryId;
-            *queueEntry = entryPtr;
-            entryInfo.entryState = QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED;
+        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
 
-            memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+        /* move to next entry */
+        if (entryPtr == self->lastInBufferEntry)
+            entryPtr = self->buffer;
+        else
+            entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
 
-            buffer = entryPtr + sizeof(struct sMessageQueueEntryInfo);
-            *size = entryInfo.size;
-        }
+        entriesToSkip--;
     }
 
-    return buffer;
+    return entryPtr;
 }
 
-static bool
-MessageQueue_hasUnconfirmedIMessages(MessageQueue self)
+/* get the entry following the given entry (requires lock) */
+uint8_t*
+MessageLog_getFollowingEntry(MessageLog self, uint8_t* entryPtr)
 {
-    bool retVal = false;
-
-    if (self->entryCounter != 0)
+    if (entryPtr == self->lastInBufferEntry)
+        return self->buffer;
+    else
     {
-        uint8_t* entryPtr = self->firstEntry;
-
         struct sMessageQueueEntryInfo entryInfo;
 
-        while (entryPtr)
-        {
-            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
-
-            if (entryInfo.entryState == QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED)
-            {
-                retVal = true;
-                break;
-            }
-
-            if (entryPtr == self->lastEntry)
-                break;
+        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
 
-            /* move to next entry */
-            if (entryPtr == self->lastInBufferEntry)
-                entryPtr = self->buffer;
-            else
-                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
-        }
+        return entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
     }
-
-    return retVal;
 }
 
-static void
-MessageQueue_setWaitingForTransmissionWhenNotConfirmed(MessageQueue self)
+typedef enum
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+    MESSAGE_LOG_ADDED,     /* ASDU was added as new entry */
+    MESSAGE_LOG_COALESCED, /* ASDU replaced a waiting entry */
+    MESSAGE_LOG_DROPPED,   /* ASDU was rejected */
+    MESSAGE_LOG_FULL       /* ASDU was not added, caller can wait and retry */
+} MessageLogResult;
 
-    if (self->entryCounter != 0)
-    {
-        uint8_t* entryPtr = self->firstEntry;
+static MessageLogResult
+MessageLog_storeASDU(MessageLog self, const uint8_t* asdu, int asduSize, bool canWait);
 
-        struct sMessageQueueEntryInfo entryInfo;
+/***************************************************
+ * IngressQueue
+ *
+ * Bounded lock-free multi-producer/single-consumer queue of encoded ASDUs
+ * (based on the sequence numbers of D. Vyukov's bounded queue). Application
+ * threads encode the ASDUs into the queue without taking a lock. The entries
+ * are moved to the event log by the connection handling while it holds the
+ * log lock (single consumer).
+ ***************************************************/
 
-        while (entryPtr)
-        {
-            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CS104_SLAVE_HAS_ATOMICS 1
 
-            if (entryInfo.entryState == QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED)
-            {
-                entryInfo.entryState = QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION;
-            }
+static uint32_t
+atomicLoad(volatile uint32_t* value)
+{
+    return (uint32_t)_InterlockedOr((volatile long*)value, 0);
+}
 
-            memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+static void
+atomicStore(volatile uint32_t* value, uint32_t newValue)
+{
+    _InterlockedExchange((volatile long*)value, (long)newValue);
+}
 
-            if (entryPtr == self->lastEntry)
-                break;
+static bool
+atomicCompareExchange(volatile uint32_t* value, uint32_t expected, uint32_t newValue)
+{
+    return ((uint32_t)_InterlockedCompareExchange((volatile long*)value, (long)newValue, (long)expected) == expected);
+}
 
-            /* move to next entry */
-            if (entryPtr == self->lastInBufferEntry)
-                entryPtr = self->buffer;
-            else
-                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
-        }
-    }
+static uint32_t
+atomicExchange(volatile uint32_t* value, uint32_t newValue)
+{
+    return (uint32_t)_InterlockedExchange((volatile long*)value, (long)newValue);
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+#if defined(_M_X64) || defined(_M_ARM64)
+#define CS104_SLAVE_HAS_ATOMICS64 1
+
+/* 64 bit counters (no ordering required) */
+static uint64_t
+atomicLoad64(volatile uint64_t* value)
+{
+    return (uint64_t)_InterlockedOr64((volatile __int64*)value, 0);
 }
 
 static void
-MessageQueue_releaseAllQueuedASDUs(MessageQueue self)
+atomicAdd64(volatile uint64_t* value, uint64_t increment)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
+    _InterlockedExchangeAdd64((volatile __int64*)value, (__int64)increment);
+}
+
+static uint64_t
+atomicExchange64(volatile uint64_t* value, uint64_t newValue)
+{
+    return (uint64_t)_InterlockedExchange64((volatile __int64*)value, (__int64)newValue);
+}
 #endif
 
-    self->firstEntry = NULL;
-    self->lastEntry = NULL;
-    self->lastInBufferEntry = NULL;
-    self->entryCounter = 0;
+#elif defined(__GNUC__)
+#define CS104_SLAVE_HAS_ATOMICS 1
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+static uint32_t
+atomicLoad(volatile uint32_t* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
 }
 
 static void
-removeFirstEntry(MessageQueue self)
+atomicStore(volatile uint32_t* value, uint32_t newValue)
 {
-    if (self->firstEntry == self->lastInBufferEntry)
-    {
-        if (self->firstEntry == self->lastEntry)
-        {
-            self->firstEntry = NULL;
-            self->lastEntry = NULL;
-            self->lastInBufferEntry = NULL;
-        }
-        else
-        {
-            self->firstEntry = self->buffer;
-            self->lastInBufferEntry = self->lastEntry;
-        }
-    }
-    else
-    {
-        struct sMessageQueueEntryInfo entryInfo;
-
-        memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
-        self->firstEntry = self->firstEntry + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
-    }
-
-    self->entryCounter--;
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
 }
 
-static void
-MessageQueue_markAsduAsConfirmed(MessageQueue self, uint8_t* queueEntry, uint64_t entryId)
+static bool
+atomicCompareExchange(volatile uint32_t* value, uint32_t expected, uint32_t newValue)
 {
-    if (self->entryCounter > 0)
-    {
-        /* entryId plausibility check */
-        uint64_t entryIdDiff = self->entryId - 1 - entryId;
+    return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
 
-        if (entryIdDiff < (unsigned)self->entryCounter)
-        {
-            struct sMessageQueueEntryInfo entryInfo;
-            memcpy(&entryInfo, queueEntry, sizeof(struct sMessageQueueEntryInfo));
+static uint32_t
+atomicExchange(volatile uint32_t* value, uint32_t newValue)
+{
+    return __atomic_exchange_n(value, newValue, __ATOMIC_ACQ_REL);
+}
 
-            /* check if ASDU is matching */
-            if (entryInfo.entryId == entryId)
-            {
-                entryInfo.entryState = QUEUE_ENTRY_STATE_NOT_USED_OR_CONFIRMED;
-                memcpy(queueEntry, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+/* 64 bit atomics are only used when they don't require libatomic */
+#if defined(__GCC_ATOMIC_LLONG_LOCK_FREE) && (__GCC_ATOMIC_LLONG_LOCK_FREE == 2)
+#define CS104_SLAVE_HAS_ATOMICS64 1
 
-                if (queueEntry == self->firstEntry)
-                {
-                    removeFirstEntry(self);
-                }
-            }
-            else
-            {
-                /* we shouldn't be here - probably bug in queue handling code */
-                DEBUG_PRINT("CS104 SLAVE: message queue corrupted\n");
-            }
-        }
-    }
+/* 64 bit counters (no ordering required) */
+static uint64_t
+atomicLoad64(volatile uint64_t* value)
+{
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
 }
 
-/***************************************************
- * HighPriorityASDUQueue
- ***************************************************/
-
-struct sHighPriorityASDUQueue
+static void
+atomicAdd64(volatile uint64_t* value, uint64_t increment)
 {
-    int size;         /* size of buffer in bytes */
-    int entryCounter; /* number of messages (ASDU) in the queue */
+    __atomic_fetch_add(value, increment, __ATOMIC_RELAXED);
+}
 
-    uint8_t* firstEntry;
-    uint8_t* lastEntry;
-    uint8_t* lastInBufferEntry;
+static uint64_t
+atomicExchange64(volatile uint64_t* value, uint64_t newValue)
+{
+    return __atomic_exchange_n(value, newValue, __ATOMIC_RELAXED);
+}
+#endif
 
-    uint8_t* buffer;
+#else
+#define CS104_SLAVE_HAS_ATOMICS 0
+#endif
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore queueLock;
+#ifndef CS104_SLAVE_HAS_ATOMICS64
+#define CS104_SLAVE_HAS_ATOMICS64 0
 #endif
-};
 
-typedef struct sHighPriorityASDUQueue* HighPriorityASDUQueue;
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
 
-static void
-HighPriorityASDUQueue_initialize(HighPriorityASDUQueue self)
+typedef struct
 {
-    self->entryCounter = 0;
+    volatile uint32_t sequence; /* position for which the cell can be written (== pos) or read (== pos + 1) */
+    uint8_t size;
+    uint8_t asdu[256 - IEC60870_5_104_APCI_LENGTH];
+} IngressQueueCell;
 
-    self->firstEntry = NULL;
-    self->lastEntry = NULL;
-    self->lastInBufferEntry = NULL;
-}
+struct sIngressQueue
+{
+    uint32_t mask; /* number of cells - 1 (number of cells is a power of two) */
+    IngressQueueCell* cells;
 
-static HighPriorityASDUQueue
-HighPriorityASDUQueue_create(int maxQueueSize)
+    volatile uint32_t enqueuePos; /* next position to write (producers) */
+    uint32_t dequeuePos;          /* next position to read (consumer, protected by log lock) */
+
+    volatile uint32_t wakeupPending; /* 1 when the consumers were woken up and have not yet drained the queue */
+};
+
+typedef struct sIngressQueue* IngressQueue;
+
+static IngressQueue
+IngressQueue_create(int minSize)
 {
-    HighPriorityASDUQueue self = (HighPriorityASDUQueue)GLOBAL_MALLOC(sizeof(struct sHighPriorityASDUQueue));
+    IngressQueue self = (IngressQueue)GLOBAL_MALLOC(sizeof(struct sIngressQueue));
 
     if (self)
     {
-        self->size = maxQueueSize * (sizeof(uint16_t) + 256);
+        uint32_t size = 2;
 
-        self->buffer = (uint8_t*)GLOBAL_CALLOC(1, self->size);
+        while ((int)size < minSize)
+            size = size * 2;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        self->queueLock = Semaphore_create(1);
-#endif
+        self->cells = (IngressQueueCell*)GLOBAL_MALLOC(size * sizeof(IngressQueueCell));
 
-        HighPriorityASDUQueue_initialize(self);
+        if (self->cells == NULL)
+        {
+            GLOBAL_FREEMEM(self);
+            return NULL;
+        }
+
+        uint32_t i;
+
+        for (i = 0; i < size; i++)
+            self->cells[i].sequence = i;
+
+        self->mask = size - 1;
+        self->enqueuePos = 0;
+        self->dequeuePos = 0;
+        self->wakeupPending = 0;
     }
 
     return self;
 }
 
 static void
-HighPriorityASDUQueue_destroy(HighPriorityASDUQueue self)
+IngressQueue_destroy(IngressQueue self)
 {
     if (self)
     {
-        if (self->buffer)
-            GLOBAL_FREEMEM(self->buffer);
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_destroy(self->queueLock);
-#endif
-
+        GLOBAL_FREEMEM(self->cells);
         GLOBAL_FREEMEM(self);
     }
 }
 
-static void
-HighPriorityASDUQueue_lock(HighPriorityASDUQueue self)
-{
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
-}
-
-static void
-HighPriorityASDUQueue_unlock(HighPriorityASDUQueue self)
-{
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
-}
-
+/**
+ * Encode the ASDU into the next free cell (can be called by multiple threads)
+ *
+ * \return true when the ASDU was added, false when the queue is full
+ */
 static bool
-HighPriorityASDUQueue_isAsduAvailable(HighPriorityASDUQueue self)
+IngressQueue_enqueueASDU(IngressQueue self, CS101_ASDU asdu, int asduSize)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
-
-    bool retVal;
+    IngressQueueCell* cell;
 
-    if (self->entryCounter > 0)
-        retVal = true;
-    else
-        retVal = false;
+    uint32_t pos = atomicLoad(&(self->enqueuePos));
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    while (true)
+    {
+        cell = &(self->cells[pos & self->mask]);
 
-    return retVal;
-}
+        int32_t diff = (int32_t)(atomicLoad(&(cell->sequence)) - pos);
 
-static uint8_t*
-HighPriorityASDUQueue_getNextASDU(HighPriorityASDUQueue self, int* size)
-{
-    uint8_t* buffer = NULL;
+        if (diff == 0)
+        {
+            /* cell is free -> try to reserve it */
+            if (atomicCompareExchange(&(self->enqueuePos), pos, pos + 1))
+                break;
+        }
+        else if (diff < 0)
+        {
+            /* queue is full */
+            return false;
+        }
 
-    if (self->entryCounter > 0)
-    {
-        self->entryCounter--;
+        /* cell was taken by another producer */
+        pos = atomicLoad(&(self->enqueuePos));
+    }
 
-        uint16_t msgSize;
+    struct sBufferFrame bufferFrame;
 
-        memcpy(&msgSize, self->firstEntry, 2);
-        *size = (int)msgSize;
+    Frame frame = BufferFrame_initialize(&bufferFrame, cell->asdu, 0, sizeof(cell->asdu));
+    CS101_ASDU_encode(asdu, frame);
 
-        buffer = self->firstEntry + 2;
+    cell->size = (uint8_t)asduSize;
 
-        if (self->entryCounter > 0)
-        {
-            if (self->firstEntry == self->lastEntry)
-            {
-                self->firstEntry = NULL;
-                self->lastEntry = NULL;
-                self->lastInBufferEntry = NULL;
-            }
-            else
-            {
-                if (self->firstEntry == self->lastInBufferEntry)
-                {
-                    self->firstEntry = self->buffer;
-                    self->lastInBufferEntry = self->lastEntry;
-                }
-                else
-                {
-                    self->firstEntry = self->firstEntry + 2 + msgSize;
-                }
-            }
-        }
-    }
+    /* publish the cell to the consumer */
+    atomicStore(&(cell->sequence), pos + 1);
 
-    return buffer;
+    return true;
 }
 
-/* Depends on ASDU size! */
-static bool
-HighPriorityASDUQueue_isFull(HighPriorityASDUQueue self)
+/**
+ * Move all published ASDUs to the log (requires log lock)
+ *
+ * \return number of moved ASDUs
+ */
+static int
+IngressQueue_moveToLog(IngressQueue self, MessageLog log)
 {
-    bool full = false;
-
-    int entrySize = sizeof(uint16_t) + (256 - IEC60870_5_104_APCI_LENGTH);
+    int count = 0;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+    /* allow the producers to trigger the next wakeup */
+    atomicStore(&(self->wakeupPending), 0);
 
-    uint16_t msgSize;
+    while (true)
+    {
+        IngressQueueCell* cell = &(self->cells[self->dequeuePos & self->mask]);
 
-    uint8_t* nextMsgPtr;
+        if ((int32_t)(atomicLoad(&(cell->sequence)) - (self->dequeuePos + 1)) < 0)
+            break; /* queue is empty or next cell is not yet published */
 
-    if (self->entryCounter > 0)
-    {
-        memcpy(&msgSize, self->lastEntry, sizeof(uint16_t));
-        nextMsgPtr = self->lastEntry + sizeof(uint16_t) + msgSize;
+        /* the producers cannot wait here -> policy CS104_QUEUE_OVERFLOW_BLOCK doesn't use the ingress queue */
+        MessageLog_storeASDU(log, cell->asdu, cell->size, false);
 
-        if (nextMsgPtr + entrySize > self->buffer + self->size)
-        {
-            nextMsgPtr = self->buffer;
-        }
+        /* release the cell for the next round */
+        atomicStore(&(cell->sequence), self->dequeuePos + self->mask + 1);
 
-        if (nextMsgPtr <= self->firstEntry)
-        {
-            if (nextMsgPtr + entrySize > self->firstEntry)
-            {
-                full = true;
-            }
-        }
+        self->dequeuePos++;
+        count++;
     }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    return count;
+}
 
-    return full;
+/**
+ * Check if the consumers have to be woken up after an ASDU was added
+ *
+ * \return true for the first ASDU after the last drain, false otherwise
+ */
+static bool
+IngressQueue_requestWakeup(IngressQueue self)
+{
+    return (atomicExchange(&(self->wakeupPending), 1) == 0);
 }
 
+#if (CONFIG_USE_THREADS == 1)
+/**
+ * Check if ASDUs were added since the last drain (can be called without log lock)
+ */
 static bool
-HighPriorityASDUQueue_enqueue(HighPriorityASDUQueue self, CS101_ASDU asdu)
+IngressQueue_isWakeupPending(IngressQueue self)
 {
-    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
+    return (atomicLoad(&(self->wakeupPending)) != 0);
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
 
-    if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH)
-    {
-        DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
-        return false;
-    }
+#endif /* (CS104_SLAVE_HAS_ATOMICS == 1) */
 
-    int entrySize = sizeof(uint16_t) + asduSize;
+/***************************************************
+ * MessageQueue (see cs104_message_log.h)
+ ***************************************************/
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+/**
+ * Get the entry with the given ID using the known preceding entry (requires lock)
+ *
+ * \param entryId ID of the requested entry
+ * \param prevId ID of the preceding entry
+ * \param prevEntry the preceding entry or NULL when unknown
+ *
+ * \return pointer to the entry or NULL when the entry is not in the log
+ */
+static uint8_t*
+MessageQueue_getEntry(MessageQueue self, uint64_t entryId, uint64_t prevId, uint8_t* prevEntry)
+{
+    MessageLog log = self->log;
 
-    bool enqueued = true;
+    if ((entryId >= log->entryId) || (log->entryCounter == 0))
+        return NULL;
 
-    uint16_t msgSize;
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(log);
 
-    uint8_t* nextMsgPtr;
+    if (entryId == firstEntryId)
+        return log->firstEntry;
 
-    if (self->entryCounter == 0)
-    {
-        self->firstEntry = self->buffer;
-        self->lastInBufferEntry = self->firstEntry;
-        nextMsgPtr = self->buffer;
-    }
-    else
-    {
-        memcpy(&msgSize, self->lastEntry, sizeof(uint16_t));
-        nextMsgPtr = self->lastEntry + sizeof(uint16_t) + msgSize;
-    }
+    /* the preceding entry is still in the log -> the requested entry follows directly */
+    if (prevEntry && (prevId + 1 == entryId) && (prevId >= firstEntryId))
+        return MessageLog_getFollowingEntry(log, prevEntry);
 
-    if (nextMsgPtr + entrySize > self->buffer + self->size)
-    {
-        nextMsgPtr = self->buffer;
-        self->lastInBufferEntry = self->lastEntry;
-    }
+    return MessageLog_getEntry(log, entryId);
+}
 
-    if (self->entryCounter > 0)
-    {
-        if (nextMsgPtr <= self->firstEntry)
-        {
-            if (nextMsgPtr + entrySize > self->firstEntry)
-            {
-                enqueued = false;
-            }
-        }
-        else
-        {
-            self->lastInBufferEntry = nextMsgPtr;
-        }
-    }
+/* drop all entries that are no longer in the log (requires lock) */
+void
+MessageQueue_updateCursors(MessageQueue self)
+{
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(self->log);
 
-    if (enqueued)
-    {
-        self->lastEntry = nextMsgPtr;
-        self->entryCounter++;
+    if (self->firstUnconfirmedId < firstEntryId)
+        self->firstUnconfirmedId = firstEntryId;
 
-        struct sBufferFrame bufferFrame;
+    if (self->nextWaitingId < self->firstUnconfirmedId)
+        self->nextWaitingId = self->firstUnconfirmedId;
+}
 
-        Frame frame = BufferFrame_initialize(&bufferFrame, nextMsgPtr + sizeof(uint16_t), 0, 256);
-        CS101_ASDU_encode(asdu, frame);
+/*
+ * Overflow handling of the log. The log is full when a new entry would remove entries
+ * that are not yet confirmed by all message queues using the log.
+ */
 
-        msgSize = asduSize;
+/* ID of the oldest entry that is not yet confirmed by all message queues (requires lock) */
+static uint64_t
+MessageLog_getFirstUnconfirmedId(MessageLog self)
+{
+    uint64_t firstUnconfirmedId = self->entryId;
 
-        memcpy(nextMsgPtr, &msgSize, sizeof(uint16_t));
+    LinkedList element = LinkedList_getNext(self->queues);
 
-        DEBUG_PRINT("CS104 SLAVE: ASDUs in PRIO-FIFO: %i (new(size=%i/%i): %p, first: %p, last: %p lastInBuf: %p)\n",
-                    self->entryCounter, entrySize, asduSize, nextMsgPtr, self->firstEntry, self->lastEntry,
-                    self->lastInBufferEntry);
+    while (element)
+    {
+        MessageQueue queue = (MessageQueue)LinkedList_getData(element);
+
+        MessageQueue_updateCursors(queue);
+
+        if (queue->firstUnconfirmedId < firstUnconfirmedId)
+            firstUnconfirmedId = queue->firstUnconfirmedId;
+
+        element = LinkedList_getNext(element);
     }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    return firstUnconfirmedId;
+}
 
-    return enqueued;
+/* check if a new entry of the given size would remove unconfirmed entries (requires lock) */
+static bool
+MessageLog_isFull(MessageLog self, int asduSize)
+{
+    struct sMessageLogLayout layout;
+
+    MessageLog_planEntry(self, asduSize, &layout);
+
+    uint64_t newFirstEntryId = self->entryId - (uint64_t)layout.entryCounter;
+
+    return (newFirstEntryId > MessageLog_getFirstUnconfirmedId(self));
 }
 
+/* count the unconfirmed entries with IDs firstEntryId to newFirstEntryId - 1 that are removed from the log (requires lock) */
 static void
-HighPriorityASDUQueue_resetConnectionQueue(HighPriorityASDUQueue self)
+MessageLog_countDroppedEntries(MessageLog self, uint64_t firstEntryId, uint64_t newFirstEntryId)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+    LinkedList element = LinkedList_getNext(self->queues);
 
-    self->firstEntry = NULL;
-    self->lastEntry = NULL;
-    self->lastInBufferEntry = NULL;
-    self->entryCounter = 0;
+    while (element)
+    {
+        MessageQueue queue = (MessageQueue)LinkedList_getData(element);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
-}
+        uint64_t firstDroppedId = queue->firstUnconfirmedId;
 
-/***************************************************
- * RedundancyGroup
- ***************************************************/
+        if (firstDroppedId < firstEntryId)
+            firstDroppedId = firstEntryId;
 
-typedef struct sCS104_IPAddress* CS104_IPAddress;
+        if (newFirstEntryId > firstDroppedId)
+            queue->droppedEntries += newFirstEntryId - firstDroppedId;
 
-struct sCS104_IPAddress
-{
-    uint8_t address[16];
-    eCS104_IPAddressType type;
-};
+        element = LinkedList_getNext(element);
+    }
+}
 
+/* count a rejected ASDU for all message queues (requires lock) */
 static void
-CS104_IPAddress_setFromString(CS104_IPAddress self, const char* ipAddrStr)
+MessageLog_countRejectedEntry(MessageLog self)
 {
-    if (strchr(ipAddrStr, '.') != NULL)
+    LinkedList element = LinkedList_getNext(self->queues);
+
+    while (element)
     {
-        /* parse IPv4 string */
-        self->type = IP_ADDRESS_TYPE_IPV4;
+        MessageQueue queue = (MessageQueue)LinkedList_getData(element);
 
-        int i;
+        queue->droppedEntries++;
 
-        for (i = 0; i < 4; i++)
-        {
-            self->address[i] = (uint8_t)strtoul(ipAddrStr, NULL, 10);
+        element = LinkedList_getNext(element);
+    }
+}
+
+/* update the high-water marks of the message queues (requires lock) */
+static void
+MessageLog_updatePendingEntries(MessageLog self)
+{
+    LinkedList element = LinkedList_getNext(self->queues);
 
-            ipAddrStr = strchr(ipAddrStr, '.');
+    while (element)
+    {
+        MessageQueue queue = (MessageQueue)LinkedList_getData(element);
 
-            if ((ipAddrStr == NULL) || (*ipAddrStr == 0))
-                break;
+        MessageQueue_updateCursors(queue);
 
-            ipAddrStr++;
-        }
+        int pendingEntries = (int)(self->entryId - queue->firstUnconfirmedId);
+
+        if (pendingEntries > queue->maxPendingEntries)
+            queue->maxPendingEntries = pendingEntries;
+
+        element = LinkedList_getNext(element);
     }
-    else
-    {
-        self->type = IP_ADDRESS_TYPE_IPV6;
+}
 
-        int i;
+/* ID of the oldest entry that is not yet sent by any message queue (requires lock) */
+static uint64_t
+MessageLog_getFirstWaitingId(MessageLog self)
+{
+    uint64_t firstWaitingId = MessageLog_getFirstEntryId(self);
 
-        for (i = 0; i < 8; i++)
-        {
-            uint32_t val = strtoul(ipAddrStr, NULL, 16);
+    LinkedList element = LinkedList_getNext(self->queues);
 
-            self->address[i * 2] = val / 0x100;
-            self->address[i * 2 + 1] = val % 0x100;
+    while (element)
+    {
+        MessageQueue queue = (MessageQueue)LinkedList_getData(element);
 
-            ipAddrStr = strchr(ipAddrStr, ':');
+        MessageQueue_updateCursors(queue);
 
-            if ((ipAddrStr == NULL) || (*ipAddrStr == 0))
-                break;
+        if (queue->nextWaitingId > firstWaitingId)
+            firstWaitingId = queue->nextWaitingId;
 
-            ipAddrStr++;
-        }
+        element = LinkedList_getNext(element);
     }
+
+    return firstWaitingId;
 }
 
+/* check if the ASDU can replace or be replaced by another ASDU of the same data point */
 static bool
-CS104_IPAddress_equals(CS104_IPAddress self, CS104_IPAddress other)
+MessageLog_isCoalescable(MessageLog self, const uint8_t* asdu, int asduSize)
 {
-    if (self->type != other->type)
+    if ((self->index == NULL) || (self->coalesceKeySize == 0) || (asduSize < self->coalesceKeySize))
         return false;
 
-    int size;
+    /* only ASDUs with a single information object (SQ=0, number of objects = 1) */
+    if (asdu[1] != 1)
+        return false;
 
-    if (self->type == IP_ADDRESS_TYPE_IPV4)
-        size = 4;
-    else
-        size = 16;
+    return ((self->overflowPolicy == CS104_QUEUE_OVERFLOW_COALESCE) || MessageLog_isCoalescedType(self, asdu[0]));
+}
+
+/* FNV-1a hash of the data point address (type, VSQ, COT, CA, IOA) */
+static uint32_t
+MessageLog_calculateKeyHash(MessageLog self, const uint8_t* asdu)
+{
+    uint32_t hash = 2166136261u;
 
     int i;
 
-    for (i = 0; i < size; i++)
+    for (i = 0; i < self->coalesceKeySize; i++)
     {
-        if (self->address[i] != other->address[i])
-            return false;
+        hash ^= asdu[i];
+        hash *= 16777619u;
     }
 
-    return true;
+    return hash;
 }
 
-struct sCS104_RedundancyGroup
+/**
+ * Find the waiting entry of the same data point using the index (requires lock)
+ *
+ * \return the index slot of the entry or NULL when there is no such entry
+ */
+static struct sMessageLogIndexSlot*
+MessageLog_findWaitingEntry(MessageLog self, const uint8_t* asdu, int asduSize, uint32_t keyHash,
+                            uint64_t firstWaitingId)
 {
-    char* name; /**< name of the group to be shown in debug messages, or NULL */
+    int i;
 
-    MessageQueue asduQueue;                    /**< low priority ASDU queue and buffer */
-    HighPriorityASDUQueue connectionAsduQueue; /**< high priority ASDU queue */
+    for (i = 0; i < MESSAGE_LOG_INDEX_PROBES; i++)
+    {
+        struct sMessageLogIndexSlot* slot = &(self->index[(keyHash + i) & self->indexMask]);
 
-    LinkedList allowedClients;
+        if ((slot->entryId >= firstWaitingId) && (slot->entryId < self->entryId) && (slot->keyHash == keyHash))
+        {
+            uint8_t* entryPtr = self->buffer + slot->offset;
 
-#ifdef SEC_AUTH_60870_5_7
-    SecureEndpoint secureEndpoint;
-    CS104_Slave slave;
-#endif
-};
-
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-static void
-CS104_RedundancyGroup_initializeMessageQueues(CS104_RedundancyGroup self, int lowPrioMaxQueueSize,
-                                              int highPrioMaxQueueSize)
-{
-    /* initialized low priority queue */
-    if (lowPrioMaxQueueSize < 1)
-        lowPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_SIZE;
+            struct sMessageQueueEntryInfo entryInfo;
 
-    self->asduQueue = MessageQueue_create(lowPrioMaxQueueSize);
+            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
 
-    /* initialize high priority queue */
-    if (highPrioMaxQueueSize < 1)
-        highPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE;
+            if ((entryInfo.size == asduSize) &&
+                (memcmp(entryPtr + sizeof(struct sMessageQueueEntryInfo), asdu, self->coalesceKeySize) == 0))
+                return slot;
+        }
+    }
 
-    self->connectionAsduQueue = HighPriorityASDUQueue_create(highPrioMaxQueueSize);
+    return NULL;
 }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-CS104_RedundancyGroup
-CS104_RedundancyGroup_create(const char* name)
+/**
+ * Add the last entry to the index (requires lock). Slots of entries that are no longer
+ * waiting are reused. When all probed slots are in use the first one is replaced.
+ */
+static void
+MessageLog_addToIndex(MessageLog self, uint32_t keyHash, uint64_t firstWaitingId)
 {
-    CS104_RedundancyGroup self = (CS104_RedundancyGroup)GLOBAL_MALLOC(sizeof(struct sCS104_RedundancyGroup));
-
-    if (self)
-    {
-        if (name)
-            self->name = strdup(name);
-        else
-            self->name = NULL;
+    struct sMessageLogIndexSlot* slot = &(self->index[keyHash & self->indexMask]);
 
-        self->asduQueue = NULL;
-        self->connectionAsduQueue = NULL;
+    int i;
 
-        self->allowedClients = NULL;
+    for (i = 0; i < MESSAGE_LOG_INDEX_PROBES; i++)
+    {
+        struct sMessageLogIndexSlot* candidate = &(self->index[(keyHash + i) & self->indexMask]);
 
-#ifdef SEC_AUTH_60870_5_7
-        self->secureEndpoint = NULL;
-        self->slave = NULL;
-#endif
+        if (candidate->entryId < firstWaitingId)
+        {
+            slot = candidate;
+            break;
+        }
     }
 
-    return self;
+    slot->keyHash = keyHash;
+    slot->offset = (uint32_t)(self->lastEntry - self->buffer);
+    slot->entryId = self->entryId - 1;
 }
 
-void
-CS104_RedundancyGroup_destroy(CS104_RedundancyGroup self)
+/**
+ * Replace the entry of the same data point that is not yet sent by any message queue with
+ * the new ASDU (requires lock). The entry keeps its position and time.
+ *
+ * \return true when an entry was replaced, false otherwise
+ */
+static bool
+MessageLog_coalesceASDU(MessageLog self, const uint8_t* asdu, int asduSize, uint32_t keyHash,
+                        uint64_t firstWaitingId)
 {
-    if (self)
-    {
-        if (self->name)
-            GLOBAL_FREEMEM(self->name);
-
-        MessageQueue_destroy(self->asduQueue);
-        HighPriorityASDUQueue_destroy(self->connectionAsduQueue);
+    struct sMessageLogIndexSlot* slot = MessageLog_findWaitingEntry(self, asdu, asduSize, keyHash, firstWaitingId);
 
-        if (self->allowedClients)
-            LinkedList_destroy(self->allowedClients);
+    if (slot == NULL)
+        return false;
 
-        GLOBAL_FREEMEM(self);
-    }
-}
+    MessageLog_replaceEntry(self, self->buffer + slot->offset, slot->entryId, asdu, asduSize);
 
-void
-CS104_RedundancyGroup_addAllowedClient(CS104_RedundancyGroup self, const char* ipAddress)
-{
-    struct sCS104_IPAddress ipAddr;
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    /* the standby may already have the old value */
+    if (slot->entryId < self->firstModifiedId)
+        self->firstModifiedId = slot->entryId;
+#endif
 
-    CS104_IPAddress_setFromString(&ipAddr, ipAddress);
+    self->enqueuedEntries++;
+    self->coalescedEntries++;
 
-    CS104_RedundancyGroup_addAllowedClientEx(self, ipAddr.address, ipAddr.type);
+    return true;
 }
 
-void
-CS104_RedundancyGroup_addAllowedClientEx(CS104_RedundancyGroup self, const uint8_t* ipAddress,
-                                         eCS104_IPAddressType addressType)
+/**
+ * Add an encoded ASDU to the log according to the overflow policy (requires lock)
+ *
+ * \param canWait true when the caller can wait for free space (policy CS104_QUEUE_OVERFLOW_BLOCK)
+ *
+ * \return MESSAGE_LOG_FULL when the caller can wait and the log is full
+ */
+static MessageLogResult
+MessageLog_storeASDU(MessageLog self, const uint8_t* asdu, int asduSize, bool canWait)
 {
-    if (self->allowedClients == NULL)
-        self->allowedClients = LinkedList_create();
+    bool coalescable = MessageLog_isCoalescable(self, asdu, asduSize);
 
-    CS104_IPAddress ipAddr = (CS104_IPAddress)GLOBAL_CALLOC(1, sizeof(struct sCS104_IPAddress));
+    uint32_t keyHash = 0;
+    uint64_t firstWaitingId = 0;
 
-    if (ipAddr)
+    if (coalescable)
     {
-        ipAddr->type = addressType;
+        keyHash = MessageLog_calculateKeyHash(self, asdu);
+        firstWaitingId = MessageLog_getFirstWaitingId(self);
 
-        int size;
+        /* latest value only -> replace the waiting value of the data point */
+        if (MessageLog_isCoalescedType(self, asdu[0]))
+        {
+            if (MessageLog_coalesceASDU(self, asdu, asduSize, keyHash, firstWaitingId))
+                return MESSAGE_LOG_COALESCED;
+        }
+    }
 
-        if (addressType == IP_ADDRESS_TYPE_IPV4)
-            size = 4;
-        else
-            size = 16;
+    if ((self->overflowPolicy != CS104_QUEUE_OVERFLOW_DROP_OLDEST) && MessageLog_isFull(self, asduSize))
+    {
+        if (self->overflowPolicy == CS104_QUEUE_OVERFLOW_COALESCE)
+        {
+            if (coalescable && MessageLog_coalesceASDU(self, asdu, asduSize, keyHash, firstWaitingId))
+                return MESSAGE_LOG_COALESCED;
 
-        int i;
+            /* no entry to replace -> override oldest entry */
+        }
+        else if ((self->overflowPolicy == CS104_QUEUE_OVERFLOW_BLOCK) && canWait)
+        {
+            return MESSAGE_LOG_FULL;
+        }
+        else
+        {
+            DEBUG_PRINT("CS104 SLAVE: event queue full -> ASDU dropped\n");
 
-        for (i = 0; i < size; i++)
-            ipAddr->address[i] = ipAddress[i];
+            MessageLog_countRejectedEntry(self);
 
-        LinkedList_add(self->allowedClients, ipAddr);
-    }
-    else
-    {
-        DEBUG_PRINT("CS104_SLAVE: failed to add allowed client");
+            return MESSAGE_LOG_DROPPED;
+        }
     }
-}
 
-#ifdef SEC_AUTH_60870_5_7
+    uint8_t* asduBuffer = MessageLog_addEntry(self, asduSize, Hal_getMonotonicTimeInMs());
 
-void
-CS104_RedundancyGroup_setSecureEndpoint(CS104_RedundancyGroup self, SecureEndpoint secureEndpoint)
-{
-    self->secureEndpoint = secureEndpoint;
+    memcpy(asduBuffer, asdu, asduSize);
 
-    if (self->slave)
-    {
-        SecureEndpoint_addForwardASDUFunctionForSlave(secureEndpoint, (CS101_PluginForwardAsduFunc)CS104_Slave_forwardASDU, self->slave);
-    }
-}
+    MessageLog_commitEntry(self);
 
-#endif /* SEC_AUTH_60870_5_7 */
+    if (coalescable)
+        MessageLog_addToIndex(self, keyHash, firstWaitingId);
 
-static bool
-CS104_RedundancyGroup_matches(CS104_RedundancyGroup self, CS104_IPAddress ipAddress)
-{
-    if (self->allowedClients == NULL)
-        return false;
+    self->enqueuedEntries++;
 
-    LinkedList element = LinkedList_getNext(self->allowedClients);
+    MessageLog_updatePendingEntries(self);
+
+    return MESSAGE_LOG_ADDED;
+}
+
+/**
+ * Wake up the producers waiting for free space after entries have been confirmed (requires lock)
+ */
+static void
+MessageLog_signalFreeSpace(MessageLog self)
+{
+    LinkedList element = LinkedList_getNext(self->blockedProducers);
 
     while (element)
     {
-        CS104_IPAddress allowedAddress = (CS104_IPAddress)LinkedList_getData(element);
-
-        if (CS104_IPAddress_equals(ipAddress, allowedAddress))
-            return true;
+        Handleset_wakeup((HandleSet)LinkedList_getData(element));
 
         element = LinkedList_getNext(element);
     }
-
-    return false;
 }
 
+/**
+ * Add an ASDU to the log according to the overflow policy
+ *
+ * \param blockTimeout maximum time in ms to wait for free space (policy CS104_QUEUE_OVERFLOW_BLOCK)
+ *
+ * \return true when the ASDU was added, false when it was rejected
+ */
 static bool
-CS104_RedundancyGroup_isCatchAll(CS104_RedundancyGroup self)
+MessageLog_enqueueASDU(MessageLog self, CS101_ASDU asdu, int blockTimeout)
 {
-    if (self->allowedClients)
+    uint8_t asduBuffer[256 - IEC60870_5_104_APCI_LENGTH];
+
+    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
+
+    if (asduSize > (int)sizeof(asduBuffer))
+    {
+        DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
         return false;
-    else
-        return true;
-}
+    }
 
-/***************************************************
- * Slave
- ***************************************************/
+    struct sBufferFrame bufferFrame;
 
-struct sCS104_Slave
-{
-    CS101_InterrogationHandler interrogationHandler;
-    void* interrogationHandlerParameter;
+    Frame frame = BufferFrame_initialize(&bufferFrame, asduBuffer, 0, sizeof(asduBuffer));
+    CS101_ASDU_encode(asdu, frame);
 
-    CS101_CounterInterrogationHandler counterInterrogationHandler;
-    void* counterInterrogationHandlerParameter;
+    bool canWait = (blockTimeout > 0);
+    uint64_t waitUntil = 0;
 
-    CS101_ReadHandler readHandler;
-    void* readHandlerParameter;
+    /* signaled when entries are confirmed (created when the producer has to wait for the first time) */
+    HandleSet waitSignal = NULL;
+    bool isSignalEnabled = false;
 
-    CS101_ClockSynchronizationHandler clockSyncHandler;
-    void* clockSyncHandlerParameter;
+    MessageLogResult result;
 
-    CS101_ResetProcessHandler resetProcessHandler;
-    void* resetProcessHandlerParameter;
+    while (true)
+    {
+        MessageLog_lock(self);
 
-    CS101_DelayAcquisitionHandler delayAcquisitionHandler;
-    void* delayAcquisitionHandlerParameter;
+        result = MessageLog_storeASDU(self, asduBuffer, asduSize, canWait);
 
-    CS101_ASDUHandler asduHandler;
-    void* asduHandlerParameter;
+        if (result != MESSAGE_LOG_FULL)
+        {
+            MessageLog_unlock(self);
+            break;
+        }
 
-    CS104_ConnectionRequestHandler connectionRequestHandler;
-    void* connectionRequestHandlerParameter;
+        uint64_t currentTime = Hal_getMonotonicTimeInMs();
 
-    CS104_ConnectionEventHandler connectionEventHandler;
-    void* connectionEventHandlerParameter;
+        if (waitUntil == 0)
+            waitUntil = currentTime + (uint64_t)blockTimeout;
 
-    CS104_SlaveRawMessageHandler rawMessageHandler;
-    void* rawMessageHandlerParameter;
+        if (currentTime >= waitUntil)
+        {
+            /* timeout -> the ASDU is dropped by the next attempt */
+            canWait = false;
 
-    CS101_IsCAAllowedHandler isCAAllowedHandler;
-    void* isCAAllowedHandlerParameter;
+            MessageLog_unlock(self);
+            continue;
+        }
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-    TLSConfiguration tlsConfig;
-#endif
+        if (waitSignal == NULL)
+        {
+            waitSignal = Handleset_new();
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP)
-    MessageQueue asduQueue;                    /**< low priority ASDU queue and buffer */
-    HighPriorityASDUQueue connectionAsduQueue; /**< high priority ASDU queue */
-#endif
+            if (waitSignal)
+                isSignalEnabled = Handleset_enableWakeup(waitSignal);
+        }
 
-    int maxLowPrioQueueSize;
-    int maxHighPrioQueueSize;
+        if (isSignalEnabled)
+            LinkedList_add(self->blockedProducers, waitSignal);
 
-    int openConnections; /**< number of connected clients */
-    MasterConnection masterConnections[CONFIG_CS104_MAX_CLIENT_CONNECTIONS]; /**< references to all MasterConnection objects */
+        MessageLog_unlock(self);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore openConnectionsLock;
-#endif
+        unsigned int waitTime = (unsigned int)(waitUntil - currentTime);
 
-#if (CONFIG_USE_THREADS == 1)
-    bool isThreadlessMode;
-#endif
+        /* without wakeup support the log is checked again after 1 ms */
+        if (isSignalEnabled == false)
+            waitTime = 1;
 
-    int maxOpenConnections; /**< maximum accepted open client connections */
+        if (waitSignal)
+            Handleset_waitReady(waitSignal, waitTime);
+        else
+            Thread_sleep(waitTime);
 
-    struct sCS104_APCIParameters conParameters;
+        if (isSignalEnabled)
+        {
+            MessageLog_lock(self);
+            LinkedList_remove(self->blockedProducers, waitSignal);
+            MessageLog_unlock(self);
+        }
+    }
 
-    struct sCS101_AppLayerParameters alParameters;
+    if (waitSignal)
+        Handleset_destroy(waitSignal);
 
-    bool isStarting;
-    bool isRunning;
-    bool stopRunning;
+    if (result == MESSAGE_LOG_DROPPED)
+        return false;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore stateLock; /* protect isStarting, isRunning, stopRunning */
-#endif
+    MessageLog_sync(self);
 
-    int tcpPort;
+    return true;
+}
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS)
-    LinkedList redundancyGroups;
-#endif
+static void
+MessageQueue_initialize(MessageQueue self)
+{
+    MessageLog_lock(self->log);
 
-    CS104_ServerMode serverMode;
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journalSlot != -1)
+    {
+        /* continue with the oldest entry that has not been confirmed (also before a restart) */
+        uint64_t firstUnconfirmedId = MessageLog_getJournalConfirmedId(self->log, self->journalSlot) + 1;
 
-    char* localAddress;
+        uint64_t firstEntryId = MessageLog_getFirstEntryId(self->log);
 
-#if (CONFIG_USE_THREADS == 1)
-    Thread listeningThread;
-#endif
+        if (firstUnconfirmedId < firstEntryId)
+            firstUnconfirmedId = firstEntryId;
 
-    ServerSocket serverSocket;
+        if (firstUnconfirmedId > self->log->entryId)
+            firstUnconfirmedId = self->log->entryId;
 
-    LinkedList plugins;
+        self->firstUnconfirmedId = firstUnconfirmedId;
+        self->nextWaitingId = firstUnconfirmedId;
 
-#ifdef SEC_AUTH_60870_5_7
-    SecureEndpoint secureEndpoint;
-#endif
-};
+        self->lastSentId = firstUnconfirmedId - 1;
+        self->lastSentEntry = NULL;
 
-typedef struct
-{
-    uint64_t entryId;    /* required to identify message in server (low-priority) queue */
-    uint8_t* queueEntry; /* NULL if ASDU is not from low-priority queue */
+        self->lastConfirmedId = self->lastSentId;
+        self->lastConfirmedEntry = NULL;
 
-    uint64_t sentTime; /* required for T1 timeout */
-    int seqNo;
-} SentASDUSlave;
+        MessageLog_unlock(self->log);
 
-struct sMasterConnection
-{
-    Socket socket;
+        return;
+    }
+#endif /* (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1) */
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-    TLSSocket tlsSocket;
-#endif
+    self->firstUnconfirmedId = self->log->entryId;
+    self->nextWaitingId = self->log->entryId;
 
-    /* can be moved to CS104_Slave struct? */
-    struct sIPeerConnection iMasterConnection;
+    self->lastSentId = self->log->entryId - 1;
+    self->lastSentEntry = self->log->lastEntry;
 
-    CS104_Slave slave;
+    self->lastConfirmedId = self->lastSentId;
+    self->lastConfirmedEntry = self->lastSentEntry;
 
-    MasterConnectionState state;
-    unsigned int isUsed : 1;
-    unsigned int isRunning : 1;
-    unsigned int timeoutT2Triggered : 1;
-    unsigned int waitingForTestFRcon : 1;
-    unsigned int requeuedOnActivate : 1;  /* set by CS104_Slave_activate to suppress redundant requeue in thread exit */
-    uint16_t maxSentASDUs;  /* k-parameter */
-    int16_t oldestSentASDU; /* oldest sent ASDU in k-buffer */
-    int16_t newestSentASDU; /* newest sent ASDU in k-buffer */
-    uint16_t sendCount;     /* sent messages - sequence counter */
-    uint16_t receiveCount;  /* received messages - sequence counter */
-
-    int unconfirmedReceivedIMessages; /* number of unconfirmed messages received (stateLock protected)*/
-
-    /* timeout T2 handling */
-    uint64_t lastConfirmationTime; /* timestamp when the last confirmation message (for I messages) was sent */
+    MessageLog_signalFreeSpace(self->log);
 
-    uint64_t nextT3Timeout;
-    uint64_t nextTestFRConTimeout; /* timeout T1 when waiting for TEST FR con */
+    MessageLog_unlock(self->log);
+}
 
-    SentASDUSlave* sentASDUs;
+/**
+ * Create a message queue that uses an existing (shared) message log
+ *
+ * \param key identifies the queue in the journal of a persistent log (redundancy group or connection)
+ */
+static MessageQueue
+MessageQueue_createWithLog(MessageLog log, const char* key)
+{
+    MessageQueue self = (MessageQueue)GLOBAL_MALLOC(sizeof(struct sMessageQueue));
 
-#if (CONFIG_USE_THREADS == 1)
-    Thread connectionThread;
-#endif
+    if (self)
+    {
+        MessageLog_retain(log);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore sentASDUsLock;
-    Semaphore stateLock;
-#endif
+        self->log = log;
 
-    HandleSet handleSet;
+        self->droppedEntries = 0;
+        self->maxPendingEntries = 0;
 
-    uint8_t recvBuffer[260];
-    int recvBufPos;
+        strncpy(self->key, key, MESSAGE_QUEUE_KEY_SIZE - 1);
+        self->key[MESSAGE_QUEUE_KEY_SIZE - 1] = 0;
 
-    uint8_t sendBuffer[260];
+        MessageLog_lock(log);
 
-    MessageQueue lowPrioQueue;
-    HighPriorityASDUQueue highPrioQueue;
+        LinkedList_add(log->queues, self);
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-    CS104_RedundancyGroup redundancyGroup;
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+        self->journalSlot = MessageLog_allocateJournalSlot(log, self->key);
 #endif
-};
 
-static uint8_t STARTDT_CON_MSG[] = {0x68, 0x04, 0x0b, 0x00, 0x00, 0x00};
+        MessageLog_unlock(log);
 
-#define STARTDT_CON_MSG_SIZE 6
+        MessageQueue_initialize(self);
+    }
 
-static uint8_t STOPDT_CON_MSG[] = {0x68, 0x04, 0x23, 0x00, 0x00, 0x00};
+    return self;
+}
 
-#define STOPDT_CON_MSG_SIZE 6
+static void
+MessageQueue_destroy(MessageQueue self)
+{
+    if (self != NULL)
+    {
+        MessageLog_lock(self->log);
+        LinkedList_remove(self->log->queues, self);
 
-static uint8_t TESTFR_CON_MSG[] = {0x68, 0x04, 0x83, 0x00, 0x00, 0x00};
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+        MessageLog_releaseJournalSlot(self->log, self->journalSlot);
+#endif
 
-#define TESTFR_CON_MSG_SIZE 6
+        /* the entries are no longer required by this queue */
+        MessageLog_signalFreeSpace(self->log);
 
-static uint8_t TESTFR_ACT_MSG[] = {0x68, 0x04, 0x43, 0x00, 0x00, 0x00};
+        MessageLog_unlock(self->log);
 
-#define TESTFR_ACT_MSG_SIZE 6
+        MessageLog_release(self->log);
+
+        GLOBAL_FREEMEM(self);
+    }
+}
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
 static void
-initializeMessageQueues(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
+MessageQueue_lock(MessageQueue self)
 {
-    /* initialized low priority queue */
-    if (lowPrioMaxQueueSize < 1)
-        lowPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_SIZE;
-
-    self->asduQueue = MessageQueue_create(lowPrioMaxQueueSize);
+    MessageLog_lock(self->log);
+}
 
-    /* initialize high priority queue */
-    if (highPrioMaxQueueSize < 1)
-        highPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE;
+static void
+MessageQueue_unlock(MessageQueue self)
+{
+    MessageLog_unlock(self->log);
+}
 
-    self->connectionAsduQueue = HighPriorityASDUQueue_create(highPrioMaxQueueSize);
+static bool
+MessageQueue_enqueueASDU(MessageQueue self, CS101_ASDU asdu, int blockTimeout)
+{
+    return MessageLog_enqueueASDU(self->log, asdu, blockTimeout);
 }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-static void
-initializeConnectionSpecificQueues(CS104_Slave self)
+static int
+MessageQueue_getEntryCount(MessageQueue self)
 {
-    int i;
+    int count = 0;
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-    {
-        self->masterConnections[i]->lowPrioQueue = MessageQueue_create(self->maxLowPrioQueueSize);
-        self->masterConnections[i]->highPrioQueue = HighPriorityASDUQueue_create(self->maxHighPrioQueueSize);
-    }
+    MessageLog_lock(self->log);
+
+    MessageQueue_updateCursors(self);
+
+    count = (int)(self->log->entryId - self->firstUnconfirmedId);
+
+    MessageLog_unlock(self->log);
+
+    return count;
 }
 
-static void
-deleteConnectionSpecificQueues(CS104_Slave self)
+static bool
+MessageQueue_isAsduAvailable(MessageQueue self, TypeID* typeId)
 {
-    int i;
+    bool retVal = false;
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
+    MessageLog_lock(self->log);
+
+    MessageQueue_updateCursors(self);
+
+    if (self->nextWaitingId < self->log->entryId)
     {
-        if (self->masterConnections[i]->lowPrioQueue)
+        if (typeId)
         {
-            MessageQueue_destroy(self->masterConnections[i]->lowPrioQueue);
-            self->masterConnections[i]->lowPrioQueue = NULL;
-        }
+            uint8_t* entryPtr = MessageQueue_getEntry(self, self->nextWaitingId, self->lastSentId, self->lastSentEntry);
 
-        if (self->masterConnections[i]->highPrioQueue)
-        {
-            HighPriorityASDUQueue_destroy(self->masterConnections[i]->highPrioQueue);
-            self->masterConnections[i]->highPrioQueue = NULL;
+            uint8_t* buffer = entryPtr + sizeof(struct sMessageQueueEntryInfo);
+
+            *typeId = (TypeID)(buffer[0]);
         }
+
+        retVal = true;
     }
+
+    MessageLog_unlock(self->log);
+
+    return retVal;
 }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1) */
 
-static bool
-isRunning(CS104_Slave self)
+/* requires lock */
+static uint8_t*
+MessageQueue_getNextWaitingASDU(MessageQueue self, uint64_t* entryId, uint8_t** queueEntry, int* size)
 {
-    bool isRunning;
+    uint8_t* buffer = NULL;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif
+    MessageQueue_updateCursors(self);
 
-    isRunning = self->isRunning;
+    uint8_t* entryPtr = MessageQueue_getEntry(self, self->nextWaitingId, self->lastSentId, self->lastSentEntry);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif
+    if (entryPtr)
+    {
+        struct sMessageQueueEntryInfo entryInfo;
 
-    return isRunning;
+        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+        *entryId = self->nextWaitingId;
+        *queueEntry = entryPtr;
+
+        buffer = entryPtr + sizeof(struct sMessageQueueEntryInfo);
+        *size = entryInfo.size;
+
+        self->lastSentId = self->nextWaitingId;
+        self->lastSentEntry = entryPtr;
+
+        self->nextWaitingId++;
+    }
+
+    return buffer;
 }
 
 static bool
-isStarting(CS104_Slave self)
+MessageQueue_hasUnconfirmedIMessages(MessageQueue self)
 {
-    bool isStarting;
+    bool retVal;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif
+    MessageLog_lock(self->log);
 
-    isStarting = self->isStarting;
+    MessageQueue_updateCursors(self);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif
+    retVal = (self->firstUnconfirmedId < self->nextWaitingId);
 
-    return isStarting;
+    MessageLog_unlock(self->log);
+
+    return retVal;
 }
 
-static bool
-isStopRunningSet(CS104_Slave self)
+static void
+MessageQueue_setWaitingForTransmissionWhenNotConfirmed(MessageQueue self)
 {
-    bool isStopRunningSet;
+    MessageLog_lock(self->log);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif
+    MessageQueue_updateCursors(self);
 
-    isStopRunningSet = self->stopRunning;
+    self->nextWaitingId = self->firstUnconfirmedId;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif
+    self->lastSentId = self->lastConfirmedId;
+    self->lastSentEntry = self->lastConfirmedEntry;
 
-    return isStopRunningSet;
+    MessageLog_unlock(self->log);
 }
 
-static MasterConnection
-MasterConnection_create(CS104_Slave slave);
+static void
+MessageQueue_releaseAllQueuedASDUs(MessageQueue self)
+{
+    MessageQueue_initialize(self);
+}
 
-static CS104_Slave
-createSlave(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
+/* requires lock */
+static void
+MessageQueue_markAsduAsConfirmed(MessageQueue self, uint8_t* queueEntry, uint64_t entryId)
 {
-    CS104_Slave self = (CS104_Slave)GLOBAL_CALLOC(1, sizeof(struct sCS104_Slave));
+    MessageQueue_updateCursors(self);
 
-    if (self)
+    /* entries are sent and confirmed in order -> confirmation of an entry also confirms all older entries */
+    if ((entryId >= self->firstUnconfirmedId) && (entryId < self->nextWaitingId))
     {
-        self->conParameters = defaultConnectionParameters;
-        self->alParameters = defaultAppLayerParameters;
-
-        self->asduHandler = NULL;
-        self->interrogationHandler = NULL;
-        self->counterInterrogationHandler = NULL;
-        self->readHandler = NULL;
-        self->clockSyncHandler = NULL;
-        self->resetProcessHandler = NULL;
-        self->delayAcquisitionHandler = NULL;
-        self->connectionRequestHandler = NULL;
-        self->connectionEventHandler = NULL;
-        self->rawMessageHandler = NULL;
-        self->maxLowPrioQueueSize = maxLowPrioQueueSize;
-        self->maxHighPrioQueueSize = maxHighPrioQueueSize;
-
-        {
-            int i;
+        self->firstUnconfirmedId = entryId + 1;
 
-            for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-            {
-                self->masterConnections[i] = MasterConnection_create(self);
-            }
-        }
+        /* entry is still in the log -> queueEntry is valid */
+        self->lastConfirmedId = entryId;
+        self->lastConfirmedEntry = queueEntry;
 
-        self->maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
-#if (CONFIG_USE_SEMAPHORES == 1)
-        self->openConnectionsLock = Semaphore_create(1);
-        self->stateLock = Semaphore_create(1);
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+        if (self->journalSlot != -1)
+            MessageLog_setJournalConfirmedId(self->log, self->journalSlot, entryId);
 #endif
 
-#if (CONFIG_USE_THREADS == 1)
-        self->isThreadlessMode = false;
-#endif
+        MessageLog_signalFreeSpace(self->log);
+    }
+}
 
-        self->isRunning = false;
-        self->stopRunning = false;
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+/**
+ * Set the last confirmed entry of the queue (requires lock). The entries that are not
+ * confirmed are waiting for transmission. Used by the standby server of a replicated queue.
+ */
+void
+MessageQueue_setConfirmed(MessageQueue self, uint64_t confirmedId)
+{
+    MessageLog log = self->log;
 
-        self->localAddress = NULL;
-        self->tcpPort = CS104_DEFAULT_PORT;
-        self->openConnections = 0;
+    uint64_t firstEntryId = MessageLog_getFirstEntryId(log);
 
-#if (CONFIG_USE_THREADS == 1)
-        self->listeningThread = NULL;
-#endif
+    if (confirmedId + 1 < firstEntryId)
+        confirmedId = firstEntryId - 1;
 
-        self->serverSocket = NULL;
+    if (confirmedId >= log->entryId)
+        confirmedId = log->entryId - 1;
 
-        self->plugins = NULL;
+    self->firstUnconfirmedId = confirmedId + 1;
+    self->nextWaitingId = self->firstUnconfirmedId;
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        self->tlsConfig = NULL;
-#endif
+    self->lastSentId = confirmedId;
+    self->lastSentEntry = NULL;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        self->redundancyGroups = NULL;
-#endif
+    self->lastConfirmedId = confirmedId;
+    self->lastConfirmedEntry = NULL;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-        self->serverMode = CS104_MODE_SINGLE_REDUNDANCY_GROUP;
-#else
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-        self->serverMode = CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP;
-#endif
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journalSlot != -1)
+        MessageLog_setJournalConfirmedId(log, self->journalSlot, confirmedId);
 #endif
-    }
-
-    return self;
-}
 
-CS104_Slave
-CS104_Slave_create(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
-{
-    return createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
+    MessageLog_signalFreeSpace(log);
 }
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-CS104_Slave
-CS104_Slave_createSecure(int maxLowPrioQueueSize, int maxHighPrioQueueSize, TLSConfiguration tlsConfig)
+/**
+ * Remove all entries from the log and continue with the given entry ID (requires lock).
+ * All message queues using the log are empty afterwards.
+ */
+void
+MessageLog_reset(MessageLog self, uint64_t nextEntryId)
 {
-    CS104_Slave self = createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
+    self->entryCounter = 0;
 
-    if (self)
+    self->firstEntry = NULL;
+    self->lastEntry = NULL;
+    self->lastInBufferEntry = NULL;
+
+    self->entryId = nextEntryId;
+
+    self->firstModifiedId = UINT64_MAX;
+
+    self->firstTimeMark = 0;
+    self->timeMarkCount = 0;
+    self->timeMarkInterval = MESSAGE_LOG_TIME_MARK_INTERVAL;
+
+    if (self->index)
+        memset(self->index, 0, (self->indexMask + 1) * sizeof(struct sMessageLogIndexSlot));
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->journal)
+        MessageLog_resetJournal(self, nextEntryId);
+#endif
+
+    LinkedList element = LinkedList_getNext(self->queues);
+
+    while (element)
     {
-        self->tcpPort = 19998;
-        self->tlsConfig = tlsConfig;
-    }
+        MessageQueue queue = (MessageQueue)LinkedList_getData(element);
 
-    return self;
+        MessageQueue_setConfirmed(queue, nextEntryId - 1);
+
+        element = LinkedList_getNext(element);
+    }
 }
-#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+#endif /* (CS104_SLAVE_HAS_REPLICATION == 1) */
 
-#ifdef SEC_AUTH_60870_5_7
-void
-CS104_Slave_setSecureEndpoint(CS104_Slave self, SecureEndpoint secureEndpoint)
+static void
+MessageQueue_getStatistics(MessageQueue self, CS104_QueueStatistics stats)
 {
-    self->secureEndpoint = secureEndpoint;
+    MessageLog log = self->log;
 
-    SecureEndpoint_addForwardASDUFunctionForSlave(secureEndpoint, (CS101_PluginForwardAsduFunc)CS104_Slave_forwardASDU, self);
-}
-#endif /* SEC_AUTH_60870_5_7 */
+    MessageLog_lock(log);
 
-void
-CS104_Slave_addPlugin(CS104_Slave self, CS101_SlavePlugin plugin)
-{
-    if (self->plugins == NULL)
-        self->plugins = LinkedList_create();
+    MessageQueue_updateCursors(self);
 
-    if (self->plugins)
-        LinkedList_add(self->plugins, plugin);
-}
+    stats->enqueuedASDUs = log->enqueuedEntries;
+    stats->coalescedASDUs = log->coalescedEntries;
+    stats->droppedASDUs = self->droppedEntries;
+    stats->pendingASDUs = (int)(log->entryId - self->firstUnconfirmedId);
+    stats->pendingBytes = 0;
+    stats->oldestPendingAge = 0;
 
-void
-CS104_Slave_setServerMode(CS104_Slave self, CS104_ServerMode serverMode)
-{
-    self->serverMode = serverMode;
-}
+    if (stats->pendingASDUs > self->maxPendingEntries)
+        self->maxPendingEntries = stats->pendingASDUs;
 
-void
-CS104_Slave_setLocalAddress(CS104_Slave self, const char* ipAddress)
-{
-    if (self->localAddress)
-        GLOBAL_FREEMEM(self->localAddress);
+    stats->maxPendingASDUs = self->maxPendingEntries;
 
-    self->localAddress = (char*)GLOBAL_MALLOC(strlen(ipAddress) + 1);
+    if (stats->pendingASDUs > 0)
+    {
+        uint8_t* entryPtr =
+            MessageQueue_getEntry(self, self->firstUnconfirmedId, self->lastConfirmedId, self->lastConfirmedEntry);
 
-    if (self->localAddress)
-        strcpy(self->localAddress, ipAddress);
-}
+        if (entryPtr)
+        {
+            stats->pendingBytes = MessageLog_getUsedBytesFrom(log, entryPtr);
+            stats->oldestPendingAge =
+                (uint32_t)(Hal_getMonotonicTimeInMs() - MessageLog_getEntryTime(log, self->firstUnconfirmedId));
+        }
+    }
 
-void
-CS104_Slave_setLocalPort(CS104_Slave self, int tcpPort)
-{
-    self->tcpPort = tcpPort;
+    MessageLog_unlock(log);
 }
 
-int
-CS104_Slave_getOpenConnections(CS104_Slave self)
+/***************************************************
+ * HighPriorityASDUQueue
+ ***************************************************/
+
+struct sHighPriorityASDUQueue
 {
-    int openConnections;
+    int size;         /* size of buffer in bytes */
+    int entryCounter; /* number of messages (ASDU) in the queue */
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    uint8_t* firstEntry;
+    uint8_t* lastEntry;
+    uint8_t* lastInBufferEntry;
 
-    openConnections = self->openConnections;
+    uint8_t* buffer;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->openConnectionsLock);
+    Semaphore queueLock;
 #endif
+};
 
-    return openConnections;
-}
+typedef struct sHighPriorityASDUQueue* HighPriorityASDUQueue;
 
-static MasterConnection
-getFreeConnection(CS104_Slave self)
+static void
+HighPriorityASDUQueue_initialize(HighPriorityASDUQueue self)
 {
-    MasterConnection connection = NULL;
+    self->entryCounter = 0;
 
-    int i;
+    self->firstEntry = NULL;
+    self->lastEntry = NULL;
+    self->lastInBufferEntry = NULL;
+}
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-    {
-        MasterConnection con = self->masterConnections[i];
+static HighPriorityASDUQueue
+HighPriorityASDUQueue_create(int maxQueueSize)
+{
+    HighPriorityASDUQueue self = (HighPriorityASDUQueue)GLOBAL_MALLOC(sizeof(struct sHighPriorityASDUQueue));
 
-        if (con)
-        {
-#if (CONFIG_USE_SEMAPHORES)
-            Semaphore_wait(con->stateLock);
-#endif
+    if (self)
+    {
+        self->size = maxQueueSize * (sizeof(uint16_t) + 256);
 
-            if (con->isUsed == false)
-            {
-                connection = con;
-                connection->isUsed = true;
-            }
+        self->buffer = (uint8_t*)GLOBAL_CALLOC(1, self->size);
 
-#if (CONFIG_USE_SEMAPHORES)
-            Semaphore_post(con->stateLock);
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->queueLock = Semaphore_create(1);
 #endif
-        }
 
-        if (connection)
-            break;
+        HighPriorityASDUQueue_initialize(self);
     }
 
-    return connection;
+    return self;
 }
 
-void
-CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections)
+static void
+HighPriorityASDUQueue_destroy(HighPriorityASDUQueue self)
 {
-    if (CONFIG_CS104_MAX_CLIENT_CONNECTIONS > 0)
+    if (self)
     {
-        if (maxOpenConnections > CONFIG_CS104_MAX_CLIENT_CONNECTIONS)
-            maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
-    }
+        if (self->buffer)
+            GLOBAL_FREEMEM(self->buffer);
 
-    self->maxOpenConnections = maxOpenConnections;
-}
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_destroy(self->queueLock);
+#endif
 
-void
-CS104_Slave_setConnectionRequestHandler(CS104_Slave self, CS104_ConnectionRequestHandler handler, void* parameter)
-{
-    self->connectionRequestHandler = handler;
-    self->connectionRequestHandlerParameter = parameter;
+        GLOBAL_FREEMEM(self);
+    }
 }
 
-void
-CS104_Slave_setConnectionEventHandler(CS104_Slave self, CS104_ConnectionEventHandler handler, void* parameter)
+static void
+HighPriorityASDUQueue_lock(HighPriorityASDUQueue self)
 {
-    self->connectionEventHandler = handler;
-    self->connectionEventHandlerParameter = parameter;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->queueLock);
+#endif
 }
 
-void
-CS104_Slave_setAllowedCAHandler(CS104_Slave self, CS101_IsCAAllowedHandler handler, void* parameter)
+static void
+HighPriorityASDUQueue_unlock(HighPriorityASDUQueue self)
 {
-    self->isCAAllowedHandler = handler;
-    self->isCAAllowedHandlerParameter = parameter;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->queueLock);
+#endif
 }
 
-/**
- * Activate connection and deactivate existing active connections if required
- */
-static void
-CS104_Slave_activate(CS104_Slave self, MasterConnection connectionToActivate)
+static bool
+HighPriorityASDUQueue_isAsduAvailable(HighPriorityASDUQueue self)
 {
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-    {
-        /* Close the active connection */
 #if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
+    Semaphore_wait(self->queueLock);
 #endif
-        int i;
 
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-        {
-            MasterConnection con = self->masterConnections[i];
+    bool retVal;
 
-            if (con && con->isUsed)
-            {
-                if (con != connectionToActivate)
-                {
-                    if (MasterConnection_isActive(con))
-                    {
-                        MasterConnection_close(con);
-                        MessageQueue_setWaitingForTransmissionWhenNotConfirmed(con->lowPrioQueue);
-                        con->requeuedOnActivate = 1;
-                    }
-                }
-            }
-        }
+    if (self->entryCounter > 0)
+        retVal = true;
+    else
+        retVal = false;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
+    Semaphore_post(self->queueLock);
 #endif
-    }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    return retVal;
+}
 
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+static uint8_t*
+HighPriorityASDUQueue_getNextASDU(HighPriorityASDUQueue self, int* size)
+{
+    uint8_t* buffer = NULL;
+
+    if (self->entryCounter > 0)
     {
+        self->entryCounter--;
 
-        /* Deactivate all other connections of the same redundancy group */
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
-#endif
+        uint16_t msgSize;
 
-        int i;
+        memcpy(&msgSize, self->firstEntry, 2);
+        *size = (int)msgSize;
 
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-        {
-            MasterConnection con = self->masterConnections[i];
+        buffer = self->firstEntry + 2;
 
-            if (con && con->isUsed)
+        if (self->entryCounter > 0)
+        {
+            if (self->firstEntry == self->lastEntry)
             {
-                if (con->redundancyGroup == connectionToActivate->redundancyGroup)
+                self->firstEntry = NULL;
+                self->lastEntry = NULL;
+                self->lastInBufferEntry = NULL;
+            }
+            else
+            {
+                if (self->firstEntry == self->lastInBufferEntry)
                 {
-                    if (con != connectionToActivate)
-                    {
-                        if (MasterConnection_isActive(con))
-                        {
-                            MasterConnection_close(con);
-                            MessageQueue_setWaitingForTransmissionWhenNotConfirmed(con->lowPrioQueue);
-                            con->requeuedOnActivate = 1;
-                        }
-                    }
+                    self->firstEntry = self->buffer;
+                    self->lastInBufferEntry = self->lastEntry;
+                }
+                else
+                {
+                    self->firstEntry = self->firstEntry + 2 + msgSize;
                 }
             }
         }
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
-#endif
     }
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
-
-    MasterConnection_activate(connectionToActivate);
+    return buffer;
 }
 
-void
-CS104_Slave_setInterrogationHandler(CS104_Slave self, CS101_InterrogationHandler handler, void* parameter)
+/* Depends on ASDU size! */
+static bool
+HighPriorityASDUQueue_isFull(HighPriorityASDUQueue self)
 {
-    self->interrogationHandler = handler;
-    self->interrogationHandlerParameter = parameter;
-}
+    bool full = false;
 
-void
-CS104_Slave_setCounterInterrogationHandler(CS104_Slave self, CS101_CounterInterrogationHandler handler, void* parameter)
-{
-    self->counterInterrogationHandler = handler;
-    self->counterInterrogationHandlerParameter = parameter;
-}
+    int entrySize = sizeof(uint16_t) + (256 - IEC60870_5_104_APCI_LENGTH);
 
-void
-CS104_Slave_setReadHandler(CS104_Slave self, CS101_ReadHandler handler, void* parameter)
-{
-    self->readHandler = handler;
-    self->readHandlerParameter = parameter;
-}
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->queueLock);
+#endif
 
-void
-CS104_Slave_setASDUHandler(CS104_Slave self, CS101_ASDUHandler handler, void* parameter)
-{
-    self->asduHandler = handler;
-    self->asduHandlerParameter = parameter;
-}
+    uint16_t msgSize;
 
-void
-CS104_Slave_setClockSyncHandler(CS104_Slave self, CS101_ClockSynchronizationHandler handler, void* parameter)
-{
-    self->clockSyncHandler = handler;
-    self->clockSyncHandlerParameter = parameter;
-}
+    uint8_t* nextMsgPtr;
 
-void
-CS104_Slave_setResetProcessHandler(CS104_Slave self, CS101_ResetProcessHandler handler, void* parameter)
-{
-    self->resetProcessHandler = handler;
-    self->resetProcessHandlerParameter = parameter;
-}
+    if (self->entryCounter > 0)
+    {
+        memcpy(&msgSize, self->lastEntry, sizeof(uint16_t));
+        nextMsgPtr = self->lastEntry + sizeof(uint16_t) + msgSize;
 
-void
-CS104_Slave_setDelayAcquisitionHandler(CS104_Slave self, CS101_DelayAcquisitionHandler handler, void* parameter)
-{
-    self->delayAcquisitionHandler = handler;
-    self->delayAcquisitionHandlerParameter = parameter;
-}
+        if (nextMsgPtr + entrySize > self->buffer + self->size)
+        {
+            nextMsgPtr = self->buffer;
+        }
 
-void
-CS104_Slave_setRawMessageHandler(CS104_Slave self, CS104_SlaveRawMessageHandler handler, void* parameter)
-{
-    self->rawMessageHandler = handler;
-    self->rawMessageHandlerParameter = parameter;
-}
+        if (nextMsgPtr <= self->firstEntry)
+        {
+            if (nextMsgPtr + entrySize > self->firstEntry)
+            {
+                full = true;
+            }
+        }
+    }
 
-CS104_APCIParameters
-CS104_Slave_getConnectionParameters(CS104_Slave self)
-{
-    return &(self->conParameters);
-}
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->queueLock);
+#endif
 
-CS101_AppLayerParameters
-CS104_Slave_getAppLayerParameters(CS104_Slave self)
-{
-    return &(self->alParameters);
+    return full;
 }
 
-/********************************************************
- * MasterConnection
- *********************************************************/
-
-static void
-printSendBuffer(MasterConnection self)
+static bool
+HighPriorityASDUQueue_enqueue(HighPriorityASDUQueue self, CS101_ASDU asdu)
 {
-    if (self->oldestSentASDU != -1)
+    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
+
+    if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH)
     {
-        int currentIndex = self->oldestSentASDU;
+        DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
+        return false;
+    }
 
-        int nextIndex = 0;
+    int entrySize = sizeof(uint16_t) + asduSize;
 
-        DEBUG_PRINT("CS104 SLAVE: ------k-buffer------\n");
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->queueLock);
+#endif
 
-        do
-        {
-            DEBUG_PRINT("CS104 SLAVE: %02i : SeqNo=%i time=%llu : queueEntry=%p\n", currentIndex,
-                        self->sentASDUs[currentIndex].seqNo, self->sentASDUs[currentIndex].sentTime,
-                        self->sentASDUs[currentIndex].queueEntry);
+    bool enqueued = true;
 
-            if (currentIndex == self->newestSentASDU)
-                nextIndex = -1;
-            else
-                currentIndex = (currentIndex + 1) % self->maxSentASDUs;
+    uint16_t msgSize;
 
-        } while (nextIndex != -1);
+    uint8_t* nextMsgPtr;
 
-        DEBUG_PRINT("CS104 SLAVE: --------------------\n");
+    if (self->entryCounter == 0)
+    {
+        self->firstEntry = self->buffer;
+        self->lastInBufferEntry = self->firstEntry;
+        nextMsgPtr = self->buffer;
     }
     else
-        DEBUG_PRINT("CS104 SLAVE: k-buffer is empty\n");
-}
-
-/**
- * \return number of bytes read, or -1 in case of an error
- */
-static int
-readFromSocket(MasterConnection self, uint8_t* buffer, int size)
-{
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-    if (self->tlsSocket != NULL)
-        return TLSSocket_read(self->tlsSocket, buffer, size);
-    else
-        return Socket_read(self->socket, buffer, size);
-#else
-    return Socket_read(self->socket, buffer, size);
-#endif
-}
-
-/**
- * \brief Read message part into receive buffer
- *
- * \return -1 in case of an error, 0 when no complete message can be read, > 0 when a complete message is in buffer
- */
-static int
-receiveMessage(MasterConnection self)
-{
-    uint8_t* buffer = self->recvBuffer;
-    int bufPos = self->recvBufPos;
-
-    /* read start byte */
-    if (bufPos == 0)
     {
-        int readFirst = readFromSocket(self, buffer, 1);
-
-        if (readFirst < 1)
-            return readFirst;
-
-        if (buffer[0] != 0x68)
-            return -1; /* message error */
-
-        bufPos++;
+        memcpy(&msgSize, self->lastEntry, sizeof(uint16_t));
+        nextMsgPtr = self->lastEntry + sizeof(uint16_t) + msgSize;
     }
 
-    /* read length byte */
-    if (bufPos == 1)
+    if (nextMsgPtr + entrySize > self->buffer + self->size)
     {
-        if (readFromSocket(self, buffer + 1, 1) != 1)
-        {
-            self->recvBufPos = 0;
-            return -1;
-        }
-
-        bufPos++;
+        nextMsgPtr = self->buffer;
+        self->lastInBufferEntry = self->lastEntry;
     }
 
-    /* read remaining frame */
-    if (bufPos > 1)
+    if (self->entryCounter > 0)
     {
-        int length = buffer[1];
-
-        int remainingLength = length - bufPos + 2;
-
-        int readCnt = readFromSocket(self, buffer + bufPos, remainingLength);
-
-        if (readCnt == remainingLength)
-        {
-            self->recvBufPos = 0;
-            return length + 2;
-        }
-        else if (readCnt == -1)
+        if (nextMsgPtr <= self->firstEntry)
         {
-            self->recvBufPos = 0;
-            return -1;
+            if (nextMsgPtr + entrySize > self->firstEntry)
+            {
+                enqueued = false;
+            }
         }
         else
         {
-            self->recvBufPos = bufPos + readCnt;
-            return 0;
+            self->lastInBufferEntry = nextMsgPtr;
         }
     }
 
-    self->recvBufPos = bufPos;
-    return 0;
-}
-
-static int
-writeToSocket(MasterConnection self, uint8_t* buf, int size)
-{
-    if (self->slave->rawMessageHandler)
-        self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter, &(self->iMasterConnection), buf, size,
-                                       true);
-
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-    if (self->tlsSocket)
-        return TLSSocket_write(self->tlsSocket, buf, size);
-    else
-        return Socket_write(self->socket, buf, size);
-#else
-    return Socket_write(self->socket, buf, size);
-#endif
-}
+    if (enqueued)
+    {
+        self->lastEntry = nextMsgPtr;
+        self->entryCounter++;
 
-static int
-sendIMessage(MasterConnection self, uint8_t* buffer, int msgSize)
-{
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif
+        struct sBufferFrame bufferFrame;
 
-    buffer[0] = (uint8_t)0x68;
-    buffer[1] = (uint8_t)(msgSize - 2);
+        Frame frame = BufferFrame_initialize(&bufferFrame, nextMsgPtr + sizeof(uint16_t), 0, 256);
+        CS101_ASDU_encode(asdu, frame);
 
-    buffer[2] = (uint8_t)((self->sendCount % 128) * 2);
-    buffer[3] = (uint8_t)(self->sendCount / 128);
+        msgSize = asduSize;
 
-    buffer[4] = (uint8_t)((self->receiveCount % 128) * 2);
-    buffer[5] = (uint8_t)(self->receiveCount / 128);
+        memcpy(nextMsgPtr, &msgSize, sizeof(uint16_t));
 
-    if (writeToSocket(self, buffer, msgSize) > 0)
-    {
-        DEBUG_PRINT("CS104 SLAVE: SEND I (size = %i) N(S) = %i N(R) = %i\n", msgSize, self->sendCount,
-                    self->receiveCount);
-        self->sendCount = (self->sendCount + 1) % 32768;
-        self->unconfirmedReceivedIMessages = 0;
-        self->timeoutT2Triggered = false;
+        DEBUG_PRINT("CS104 SLAVE: ASDUs in PRIO-FIFO: %i (new(size=%i/%i): %p, first: %p, last: %p lastInBuf: %p)\n",
+                    self->entryCounter, entrySize, asduSize, nextMsgPtr, self->firstEntry, self->lastEntry,
+                    self->lastInBufferEntry);
     }
-    else
-        self->isRunning = false;
-
-    self->unconfirmedReceivedIMessages = 0;
-
-    int sendCount = self->sendCount;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+    Semaphore_post(self->queueLock);
 #endif
 
-    return sendCount;
+    return enqueued;
 }
 
-static bool
-isSentBufferFull(MasterConnection self)
+static void
+HighPriorityASDUQueue_resetConnectionQueue(HighPriorityASDUQueue self)
 {
-    /* locking of k-buffer has to be done by caller! */
-    if (self->oldestSentASDU == -1)
-        return false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->queueLock);
+#endif
 
-    int newIndex = (self->newestSentASDU + 1) % (self->maxSentASDUs);
+    self->firstEntry = NULL;
+    self->lastEntry = NULL;
+    self->lastInBufferEntry = NULL;
+    self->entryCounter = 0;
 
-    if (newIndex == self->oldestSentASDU)
-        return true;
-    else
-        return false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->queueLock);
+#endif
 }
 
-static bool
-sendASDU(MasterConnection self, uint8_t* buffer, int msgSize, uint64_t entryId, uint8_t* queueEntry)
-{
-#ifdef SEC_AUTH_60870_5_7
-
-    SecureEndpoint secureEndpoint = NULL;
+/***************************************************
+ * RedundancyGroup
+ ***************************************************/
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+typedef struct sCS104_IPAddress* CS104_IPAddress;
 
-    if (self->redundancyGroup)
-    {
-        if (self->redundancyGroup->secureEndpoint)
-            secureEndpoint = self->redundancyGroup->secureEndpoint;
-    }
+struct sCS104_IPAddress
+{
+    uint8_t address[16];
+    eCS104_IPAddressType type;
+    int prefixLength; /* number of significant bits (32/128 for a single address) */
+};
 
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+static int
+CS104_IPAddress_getSize(eCS104_IPAddressType type)
+{
+    if (type == IP_ADDRESS_TYPE_IPV4)
+        return 4;
+    else
+        return 16;
+}
 
-    if ((secureEndpoint == NULL) && (self->slave->secureEndpoint != NULL))
-        secureEndpoint = self->slave->secureEndpoint;
+/* set all bits after the prefix to zero */
+static void
+CS104_IPAddress_applyPrefix(uint8_t* address, int size, int prefixLength)
+{
+    int i;
 
-    if (secureEndpoint)
+    for (i = 0; i < size; i++)
     {
-        struct sCS101_ASDU _asdu;
+        int bits = prefixLength - (i * 8);
 
-        CS101_ASDU asdu = CS101_ASDU_createFromBufferEx(&_asdu, &(self->slave->alParameters), buffer + 6, msgSize - 6);
-        
-        if (asdu)
-        {
-            if (SecureEndpoint_sendAsdu(secureEndpoint, &(self->iMasterConnection), asdu) == true)
-            {
-                return true;
-            }
-        }
+        if (bits <= 0)
+            address[i] = 0;
+        else if (bits < 8)
+            address[i] &= (uint8_t)(0xff << (8 - bits));
     }
+}
 
-#endif /* SEC_AUTH_60870_5_7 */
+static bool
+parseIPv4Address(const char* str, const char* end, uint8_t* address)
+{
+    int i;
 
-    /* call plugins */
-    if (self->slave->plugins)
+    for (i = 0; i < 4; i++)
     {
-        struct sCS101_ASDU _asdu;
+        int value = 0;
+        int digits = 0;
 
-        CS101_ASDU asdu = CS101_ASDU_createFromBufferEx(&_asdu, &(self->slave->alParameters), buffer + 6, msgSize - 6);
-        
-        if (asdu)
+        while ((str < end) && (*str >= '0') && (*str <= '9'))
         {
-            LinkedList pluginElem = LinkedList_getNext(self->slave->plugins);
+            value = (value * 10) + (*str - '0');
+            digits++;
+            str++;
 
-            while (pluginElem)
-            {
-                CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+            if ((digits > 3) || (value > 255))
+                return false;
+        }
 
-                if (plugin->sendAsdu)
-                {
-                    if (plugin->sendAsdu(plugin->parameter, &(self->iMasterConnection), asdu) == CS101_PLUGIN_RESULT_HANDLED)
-                    {
-                        return false;
-                    }
-                }
+        if (digits == 0)
+            return false;
 
-                pluginElem = LinkedList_getNext(pluginElem);
-            }
+        address[i] = (uint8_t)value;
+
+        if (i < 3)
+        {
+            if ((str >= end) || (*str != '.'))
+                return false;
+
+            str++;
         }
     }
-    
-    int currentIndex = 0;
 
-    if (self->oldestSentASDU == -1)
-    {
-        self->oldestSentASDU = 0;
-        self->newestSentASDU = 0;
-    }
-    else
-    {
-        currentIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
-    }
+    return (str == end);
+}
 
-    self->sentASDUs[currentIndex].entryId = entryId;
-    self->sentASDUs[currentIndex].queueEntry = queueEntry;
-    self->sentASDUs[currentIndex].seqNo = sendIMessage(self, buffer, msgSize);
-    self->sentASDUs[currentIndex].sentTime = Hal_getMonotonicTimeInMs();
+static int
+hexDigitValue(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
 
-    self->newestSentASDU = currentIndex;
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
 
-    printSendBuffer(self);
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
 
-    return true;
+    return -1;
 }
 
+/* parse IPv6 address (with "::" compression and optional IPv4 address in the last 32 bit) */
 static bool
-sendASDUInternal(MasterConnection self, CS101_ASDU asdu, bool dontQueueIfBufferFull)
+parseIPv6Address(const char* str, const char* end, uint8_t* address)
 {
-    bool asduSent = false;
+    uint16_t groups[8];
+    int numberOfGroups = 0;
+    int compressedPos = -1; /* position of "::" */
 
-    if (MasterConnection_isActive(self))
+    if (((end - str) >= 2) && (str[0] == ':') && (str[1] == ':'))
     {
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->sentASDUsLock);
-#endif
+        compressedPos = 0;
+        str += 2;
+    }
 
-        if (isSentBufferFull(self) == false)
-        {
-            FrameBuffer frameBuffer;
+    while (str < end)
+    {
+        const char* groupEnd = str;
 
-            struct sBufferFrame bufferFrame;
+        while ((groupEnd < end) && (*groupEnd != ':'))
+            groupEnd++;
 
-            Frame frame = BufferFrame_initialize(&bufferFrame, frameBuffer.msg, IEC60870_5_104_APCI_LENGTH, 256);
-            CS101_ASDU_encode(asdu, frame);
+        if (memchr(str, '.', groupEnd - str))
+        {
+            /* IPv4 address has to be the last part */
+            uint8_t ipv4Address[4];
 
-            frameBuffer.msgSize = Frame_getMsgSize(frame);
+            if ((groupEnd != end) || (numberOfGroups > 6))
+                return false;
 
-            sendASDU(self, frameBuffer.msg, frameBuffer.msgSize, 0, NULL);
+            if (parseIPv4Address(str, end, ipv4Address) == false)
+                return false;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->sentASDUsLock);
-#endif
+            groups[numberOfGroups++] = (uint16_t)((ipv4Address[0] << 8) | ipv4Address[1]);
+            groups[numberOfGroups++] = (uint16_t)((ipv4Address[2] << 8) | ipv4Address[3]);
 
-            asduSent = true;
-        }
-        else if (dontQueueIfBufferFull == false)
-        {
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->sentASDUsLock);
-#endif
-            asduSent = HighPriorityASDUQueue_enqueue(self->highPrioQueue, asdu);
+            str = end;
+            break;
         }
-        else
+
+        int digits = (int)(groupEnd - str);
+
+        if ((digits < 1) || (digits > 4) || (numberOfGroups > 7))
+            return false;
+
+        int value = 0;
+
+        while (str < groupEnd)
         {
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->sentASDUsLock);
-#endif
+            int digitValue = hexDigitValue(*str);
+
+            if (digitValue < 0)
+                return false;
+
+            value = (value << 4) | digitValue;
+            str++;
         }
-    }
 
-    if (asduSent == false)
-        DEBUG_PRINT("CS104 SLAVE: unable to send ASDU (state=%i)\n", self->state);
+        groups[numberOfGroups++] = (uint16_t)value;
 
-    return asduSent;
-}
+        if (str < end)
+        {
+            /* skip ':' */
+            str++;
 
-static void
-responseNegative(CS101_ASDU asdu, MasterConnection self, CS101_CauseOfTransmission cot)
-{
-    CS101_ASDU_setCOT(asdu, cot);
-    CS101_ASDU_setNegative(asdu, true);
-    sendASDUInternal(self, asdu, false);
-}
+            if ((str < end) && (*str == ':'))
+            {
+                if (compressedPos != -1)
+                    return false;
 
-static void
-responseCOTUnknown(CS101_ASDU asdu, MasterConnection self)
-{
-    DEBUG_PRINT("CS104 SLAVE:   with unknown COT\n");
-    responseNegative(asdu, self, CS101_COT_UNKNOWN_COT);
-}
+                compressedPos = numberOfGroups;
+                str++;
+            }
+            else if (str == end)
+            {
+                return false;
+            }
+        }
+    }
 
-static bool
-isBroadcastCA(CS104_Slave self, int ca)
-{
-    if (self->alParameters.sizeOfCA == 2)
+    if (compressedPos == -1)
     {
-        if (ca == 65535)
-            return true;
+        if (numberOfGroups != 8)
+            return false;
     }
-    else if (self->alParameters.sizeOfCA == 1)
+    else if (numberOfGroups > 7)
     {
-        if (ca == 255)
-            return true;
+        return false;
     }
 
-    return false;
+    memset(address, 0, 16);
+
+    int i;
+
+    for (i = 0; i < numberOfGroups; i++)
+    {
+        int pos = i;
+
+        /* groups after "::" are placed at the end of the address */
+        if ((compressedPos != -1) && (i >= compressedPos))
+            pos = i + (8 - numberOfGroups);
+
+        address[pos * 2] = (uint8_t)(groups[i] >> 8);
+        address[pos * 2 + 1] = (uint8_t)(groups[i] & 0xff);
+    }
+
+    return true;
 }
 
-/*
- * Handle received ASDUs
- *
- * Call the appropriate callbacks according to ASDU type and CoT
+/**
+ * \brief Parse an IP address or subnet (e.g. "192.168.1.10", "10.0.0.0/8", "2001:db8::/32")
  *
- * \return true when ASDU is valid, false otherwise (e.g. corrupted message data)
+ * \return true on success, false when the string is not a valid address
  */
 static bool
-handleASDU(MasterConnection self, CS101_ASDU asdu, CS101_SlavePlugin callingPlugin)
+CS104_IPAddress_setFromString(CS104_IPAddress self, const char* ipAddrStr)
 {
-    bool messageHandled = false;
+    const char* end = ipAddrStr + strlen(ipAddrStr);
 
-    CS104_Slave slave = self->slave;
+    const char* prefixStr = strchr(ipAddrStr, '/');
 
-    int ca = CS101_ASDU_getCA(asdu);
+    if (prefixStr)
+        end = prefixStr;
 
-    /* check with user callback if CA address is known/used by application */
-    if (slave->isCAAllowedHandler && (isBroadcastCA(slave, ca) == false))
-    {
-        if (slave->isCAAllowedHandler(slave->isCAAllowedHandlerParameter, ca) == false)
-        {
-            DEBUG_PRINT("CS104 SLAVE: Rcvd ASDU with unknown CA\n");
+    memset(self->address, 0, sizeof(self->address));
 
-            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+    if (memchr(ipAddrStr, ':', end - ipAddrStr))
+    {
+        self->type = IP_ADDRESS_TYPE_IPV6;
 
-            return true;
-        }
+        if (parseIPv6Address(ipAddrStr, end, self->address) == false)
+            return false;
     }
-
-    /* handle test commands with invalid COT before the 62351-5 module gets them */
-    if (CS101_ASDU_getTypeID(asdu) == C_TS_TA_1)
+    else
     {
-        if (CS101_ASDU_getCOT(asdu) != CS101_COT_ACTIVATION)
-        {
-            responseNegative(asdu, self, CS101_COT_UNKNOWN_COT);
+        self->type = IP_ADDRESS_TYPE_IPV4;
 
-            return true;
-        }
+        if (parseIPv4Address(ipAddrStr, end, self->address) == false)
+            return false;
     }
 
-#ifdef SEC_AUTH_60870_5_7
-    SecureEndpoint secureEndpoint = NULL;
+    int maxPrefixLength = CS104_IPAddress_getSize(self->type) * 8;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    self->prefixLength = maxPrefixLength;
 
-    if (self->redundancyGroup)
+    if (prefixStr)
     {
-        if (self->redundancyGroup->secureEndpoint)
-            secureEndpoint = self->redundancyGroup->secureEndpoint;
-    }
+        char* prefixEnd = NULL;
 
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+        long prefixLength = strtol(prefixStr + 1, &prefixEnd, 10);
 
-    if (secureEndpoint == NULL && slave->secureEndpoint != NULL)
-        secureEndpoint = slave->secureEndpoint;
+        if ((prefixEnd == prefixStr + 1) || (*prefixEnd != 0) || (prefixLength < 0) || (prefixLength > maxPrefixLength))
+            return false;
 
-    if (secureEndpoint)
-    {
-        if (callingPlugin != SecureEndpoint_getSlavePlugin(secureEndpoint))
-        {
-            if (SecureEndpoint_asduReceived(secureEndpoint, &(self->iMasterConnection), asdu, NULL, 0) == true)
-                return true;
-        }
+        self->prefixLength = (int)prefixLength;
+
+        CS104_IPAddress_applyPrefix(self->address, maxPrefixLength / 8, self->prefixLength);
     }
-#endif /* SEC_AUTH_60870_5_7 */
 
-    /* call plugins */
-    if (slave->plugins)
-    {
-        LinkedList pluginElem = LinkedList_getNext(slave->plugins);
+    return true;
+}
 
-        while (pluginElem)
-        {
-            CS101_SlavePlugin plugin = (CS101_SlavePlugin)LinkedList_getData(pluginElem);
+/* check if the address is part of the (sub)net */
+static bool
+CS104_IPAddress_contains(CS104_IPAddress self, const uint8_t* address, eCS104_IPAddressType type)
+{
+    if (self->type != type)
+        return false;
 
-            if (plugin != callingPlugin)
-            {
-                if (plugin->handleAsdu)
-                {
-                    CS101_SlavePlugin_Result result = plugin->handleAsdu(plugin->parameter, &(self->iMasterConnection), asdu);
+    uint8_t maskedAddress[16];
 
-                    if (result == CS101_PLUGIN_RESULT_HANDLED)
-                        return true;
+    int size = CS104_IPAddress_getSize(type);
 
-                    if (result == CS101_PLUGIN_RESULT_INVALID_ASDU)
-                        return false;
-                }
-            }
-
-            pluginElem = LinkedList_getNext(pluginElem);
-        }
-    }
-
-    uint8_t cot = CS101_ASDU_getCOT(asdu);
+    memcpy(maskedAddress, address, size);
 
-    switch (CS101_ASDU_getTypeID(asdu))
-    {
+    CS104_IPAddress_applyPrefix(maskedAddress, size, self->prefixLength);
 
-    case C_IC_NA_1: /* 100 - interrogation command */
+    return (memcmp(maskedAddress, self->address, size) == 0);
+}
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd interrogation command C_IC_NA_1\n");
+struct sCS104_RedundancyGroup
+{
+    char* name; /**< name of the group to be shown in debug messages, or NULL */
 
-        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION))
-        {
-            if (slave->interrogationHandler != NULL)
-            {
-                union uInformationObject _io;
+    MessageQueue asduQueue;                    /**< low priority ASDU queue and buffer */
+    HighPriorityASDUQueue connectionAsduQueue; /**< high priority ASDU queue */
 
-                InterrogationCommand irc =
-                    (InterrogationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+    LinkedList allowedClients;
 
-                if (irc)
-                {
-                    /* Verify IOA = 0 */
-                    if (InformationObject_getObjectAddress((InformationObject)irc) != 0)
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: interrogation command has invalid IOA - should be 0\n");
-                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
-                        messageHandled = true;
-                    }
-                    else
-                    {
-                        if (slave->interrogationHandler(slave->interrogationHandlerParameter,
-                                                        &(self->iMasterConnection), asdu,
-                                                        InterrogationCommand_getQOI(irc)))
-                            messageHandled = true;
-                    }
-                }
-                else
-                    return false;
-            }
-        }
-        else
-        {
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
-        }
+    struct sCS104_ConnectionMetrics closedConnectionMetrics; /**< counters of closed connections (protected by slave metricsLock) */
 
-        break;
+#ifdef SEC_AUTH_60870_5_7
+    SecureEndpoint secureEndpoint;
+    CS104_Slave slave;
+#endif
+};
 
-    case C_CI_NA_1: /* 101 - counter interrogation command */
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+static void
+CS104_RedundancyGroup_initializeMessageQueues(CS104_RedundancyGroup self, MessageLog eventLog, const char* queueKey,
+                                              int highPrioMaxQueueSize)
+{
+    /* initialized low priority queue (uses the event log shared by all groups) */
+    self->asduQueue = MessageQueue_createWithLog(eventLog, queueKey);
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd counter interrogation command C_CI_NA_1\n");
+    /* initialize high priority queue */
+    if (highPrioMaxQueueSize < 1)
+        highPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE;
 
-        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION))
-        {
-            if (slave->counterInterrogationHandler != NULL)
-            {
-                union uInformationObject _io;
+    self->connectionAsduQueue = HighPriorityASDUQueue_create(highPrioMaxQueueSize);
+}
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-                CounterInterrogationCommand cic =
-                    (CounterInterrogationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+CS104_RedundancyGroup
+CS104_RedundancyGroup_create(const char* name)
+{
+    CS104_RedundancyGroup self = (CS104_RedundancyGroup)GLOBAL_MALLOC(sizeof(struct sCS104_RedundancyGroup));
 
-                if (cic)
-                {
-                    /* Verify IOA = 0 */
-                    if (InformationObject_getObjectAddress((InformationObject)cic) != 0)
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: counter interrogation command has invalid IOA - should be 0\n");
-                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
-                        messageHandled = true;
-                    }
-                    else
-                    {
-                        if (slave->counterInterrogationHandler(slave->counterInterrogationHandlerParameter,
-                                                               &(self->iMasterConnection), asdu,
-                                                               CounterInterrogationCommand_getQCC(cic)))
-                            messageHandled = true;
-                    }
-                }
-                else
-                    return false;
-            }
-        }
+    if (self)
+    {
+        if (name)
+            self->name = strdup(name);
         else
-        {
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
-        }
-
-        break;
-
-    case C_RD_NA_1: /* 102 - read command */
+            self->name = NULL;
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd read command C_RD_NA_1\n");
+        self->asduQueue = NULL;
+        self->connectionAsduQueue = NULL;
 
-        if (isBroadcastCA(slave, ca) == true)
-        {
-            DEBUG_PRINT("CS104_SLAVE: command with broadcast CA not allowed\n");
+        self->allowedClients = NULL;
 
-            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+        memset(&(self->closedConnectionMetrics), 0, sizeof(struct sCS104_ConnectionMetrics));
 
-            return true;
-        }
+#ifdef SEC_AUTH_60870_5_7
+        self->secureEndpoint = NULL;
+        self->slave = NULL;
+#endif
+    }
 
-        if (cot == CS101_COT_REQUEST)
-        {
-            if (slave->readHandler != NULL)
-            {
-                union uInformationObject _io;
+    return self;
+}
 
-                ReadCommand rc = (ReadCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+void
+CS104_RedundancyGroup_destroy(CS104_RedundancyGroup self)
+{
+    if (self)
+    {
+        if (self->name)
+            GLOBAL_FREEMEM(self->name);
 
-                if (rc)
-                {
-                    if (slave->readHandler(slave->readHandlerParameter, &(self->iMasterConnection), asdu,
-                                           InformationObject_getObjectAddress((InformationObject)rc)))
-                        messageHandled = true;
-                }
-                else
-                    return false;
-            }
-        }
-        else
-        {
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
-        }
+        MessageQueue_destroy(self->asduQueue);
+        HighPriorityASDUQueue_destroy(self->connectionAsduQueue);
 
-        break;
+        if (self->allowedClients)
+            LinkedList_destroy(self->allowedClients);
 
-    case C_CS_NA_1: /* 103 - Clock synchronization command */
+        GLOBAL_FREEMEM(self);
+    }
+}
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd clock sync command C_CS_NA_1\n");
+void
+CS104_RedundancyGroup_addAllowedClient(CS104_RedundancyGroup self, const char* ipAddress)
+{
+    struct sCS104_IPAddress ipAddr;
 
-        if (cot == CS101_COT_ACTIVATION)
-        {
-            if (slave->clockSyncHandler)
-            {
-                union uInformationObject _io;
+    if (CS104_IPAddress_setFromString(&ipAddr, ipAddress))
+        CS104_RedundancyGroup_addAllowedSubnet(self, ipAddr.address, ipAddr.type, ipAddr.prefixLength);
+    else
+        DEBUG_PRINT("CS104_SLAVE: invalid IP address %s -> ignored\n", ipAddress);
+}
 
-                ClockSynchronizationCommand csc =
-                    (ClockSynchronizationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+void
+CS104_RedundancyGroup_addAllowedClientEx(CS104_RedundancyGroup self, const uint8_t* ipAddress,
+                                         eCS104_IPAddressType addressType)
+{
+    CS104_RedundancyGroup_addAllowedSubnet(self, ipAddress, addressType, CS104_IPAddress_getSize(addressType) * 8);
+}
 
-                if (csc)
-                {
-                    /* Verify IOA = 0 */
-                    if (InformationObject_getObjectAddress((InformationObject)csc) != 0)
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: time sync command has invalid IOA - should be 0\n");
-                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
-                    }
-                    else
-                    {
-                        CP56Time2a newTime = ClockSynchronizationCommand_getTime(csc);
+void
+CS104_RedundancyGroup_addAllowedSubnet(CS104_RedundancyGroup self, const uint8_t* ipAddress,
+                                       eCS104_IPAddressType addressType, int prefixLength)
+{
+    int size = CS104_IPAddress_getSize(addressType);
 
-                        if (slave->clockSyncHandler(slave->clockSyncHandlerParameter, &(self->iMasterConnection), asdu,
-                                                    newTime))
-                        {
-                            CS101_ASDU_removeAllElements(asdu);
+    if ((prefixLength < 0) || (prefixLength > (size * 8)))
+    {
+        DEBUG_PRINT("CS104_SLAVE: invalid prefix length %i -> ignored\n", prefixLength);
+        return;
+    }
 
-                            ClockSynchronizationCommand_create(csc, 0, newTime);
+    if (self->allowedClients == NULL)
+        self->allowedClients = LinkedList_create();
 
-                            CS101_ASDU_addInformationObject(asdu, (InformationObject)csc);
+    CS104_IPAddress ipAddr = (CS104_IPAddress)GLOBAL_CALLOC(1, sizeof(struct sCS104_IPAddress));
 
-                            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+    if (ipAddr)
+    {
+        static const uint8_t ipv4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
 
-                            sendASDUInternal(self, asdu, false);
-                        }
-                        else
-                        {
-                            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-                            CS101_ASDU_setNegative(asdu, true);
+        ipAddr->type = addressType;
+        ipAddr->prefixLength = prefixLength;
 
-                            sendASDUInternal(self, asdu, false);
-                        }
-                    }
+        memcpy(ipAddr->address, ipAddress, size);
 
-                    messageHandled = true;
-                }
-                else
-                    return false;
-            }
-        }
-        else
+        /* IPv4-mapped IPv6 addresses are stored as IPv4 (peer addresses are reported the same way) */
+        if ((addressType == IP_ADDRESS_TYPE_IPV6) && (prefixLength >= 96) &&
+            (memcmp(ipAddress, ipv4MappedPrefix, 12) == 0))
         {
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
+            ipAddr->type = IP_ADDRESS_TYPE_IPV4;
+            ipAddr->prefixLength = prefixLength - 96;
+            memmove(ipAddr->address, ipAddr->address + 12, 4);
+            memset(ipAddr->address + 4, 0, 12);
+            size = 4;
         }
 
-        break;
+        CS104_IPAddress_applyPrefix(ipAddr->address, size, ipAddr->prefixLength);
 
-    case C_TS_NA_1: /* 104 - test command */
+        LinkedList_add(self->allowedClients, ipAddr);
+    }
+    else
+    {
+        DEBUG_PRINT("CS104_SLAVE: failed to add allowed client");
+    }
+}
 
-#if (CONFIG_ALLOW_C_TS_NA_1_FOR_CS104 == 1)
-        DEBUG_PRINT("CS104 SLAVE: Rcvd test command C_TS_NA_1\n");
+#ifdef SEC_AUTH_60870_5_7
 
-        if (isBroadcastCA(slave, ca) == true)
-        {
-            DEBUG_PRINT("CS104_SLAVE: test command with broadcast CA not allowed\n");
+void
+CS104_RedundancyGroup_setSecureEndpoint(CS104_RedundancyGroup self, SecureEndpoint secureEndpoint)
+{
+    self->secureEndpoint = secureEndpoint;
 
-            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+    if (self->slave)
+    {
+        SecureEndpoint_addForwardASDUFunctionForSlave(secureEndpoint, (CS101_PluginForwardAsduFunc)CS104_Slave_forwardASDU, self->slave);
+    }
+}
 
-            return true;
-        }
-
-        if (cot == CS101_COT_ACTIVATION)
-        {
-            union uInformationObject _io;
+#endif /* SEC_AUTH_60870_5_7 */
 
-            TestCommand tc = (TestCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+/* returns the prefix length of the best matching allowed client entry or -1 when the address doesn't match */
+static int
+CS104_RedundancyGroup_matches(CS104_RedundancyGroup self, const uint8_t* address, eCS104_IPAddressType type)
+{
+    int bestPrefixLength = -1;
 
-            if (tc)
-            {
-                /* Verify IOA = 0 */
-                if (InformationObject_getObjectAddress((InformationObject)tc) != 0)
-                {
-                    DEBUG_PRINT("CS104 SLAVE: test command has invalid IOA - should be 0\n");
-                    responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
-                }
-                else
-                {
-                    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-                    sendASDUInternal(self, asdu);
-                }
-            }
-            else
-            {
-                DEBUG_PRINT("CS104 SLAVE: invalid test command\n");
-                return false;
-            }
+    if (self->allowedClients == NULL)
+        return -1;
 
-            messageHandled = true;
-        }
-        else
-        {
-            DEBUG_PRINT("CS104 SLAVE: test command has invalid COT - should be ACTIVATION(6)\n");
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
-        }
-#else
-        /* this command is not supported/allowed for IEC 104 */
-        DEBUG_PRINT("CS104 SLAVE: Rcvd test command C_TS_NA_1 -> not allowed\n");
-        messageHandled = false;
-#endif /* (CONFIG_ALLOW_C_TS_NA_1_FOR_CS104 == 1) */
+    LinkedList element = LinkedList_getNext(self->allowedClients);
 
-        break;
+    while (element)
+    {
+        CS104_IPAddress allowedAddress = (CS104_IPAddress)LinkedList_getData(element);
 
-    case C_RP_NA_1: /* 105 - Reset process command */
+        if ((allowedAddress->prefixLength > bestPrefixLength) && CS104_IPAddress_contains(allowedAddress, address, type))
+            bestPrefixLength = allowedAddress->prefixLength;
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd reset process command C_RP_NA_1\n");
+        element = LinkedList_getNext(element);
+    }
 
-        if (cot == CS101_COT_ACTIVATION)
-        {
-            if (slave->resetProcessHandler)
-            {
-                union uInformationObject _io;
+    return bestPrefixLength;
+}
 
-                ResetProcessCommand rpc =
-                    (ResetProcessCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+static bool
+CS104_RedundancyGroup_isCatchAll(CS104_RedundancyGroup self)
+{
+    if (self->allowedClients)
+        return false;
+    else
+        return true;
+}
 
-                if (rpc)
-                {
-                    /* Verify IOA = 0 */
-                    if (InformationObject_getObjectAddress((InformationObject)rpc) != 0)
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: reset process command has invalid IOA - should be 0\n");
-                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
 
-                        messageHandled = true;
-                    }
-                    else
-                    {
-                        if (slave->resetProcessHandler(slave->resetProcessHandlerParameter, &(self->iMasterConnection),
-                                                       asdu, ResetProcessCommand_getQRP(rpc)))
-                            messageHandled = true;
-                    }
-                }
-                else
-                    return false;
-            }
-        }
-        else
-        {
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
-        }
+/***************************************************
+ * ClientAddressIndex
+ *
+ * Index of the allowed clients of all redundancy groups that is built when the
+ * slave is started. The addresses and subnets are stored in a hash table (open
+ * addressing) with the address masked by the prefix length as key. A lookup
+ * checks the prefix lengths that are used in the table from longest to shortest,
+ * so the most specific entry wins. When entries of several groups are equal the
+ * group that was added first to the slave is used. Clients without matching
+ * entry are assigned to the (last) group without allowed clients.
+ ***************************************************/
 
-        break;
+typedef struct sClientAddressIndex* ClientAddressIndex;
 
-    case C_CD_NA_1: /* 106 - Delay acquisition command */
+typedef struct sClientAddressIndexEntry
+{
+    CS104_RedundancyGroup group; /* NULL -> unused entry */
+    uint8_t address[16];         /* address masked by the prefix length */
+    uint8_t type;
+    uint8_t prefixLength;
+} ClientAddressIndexEntry;
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd delay acquisition command C_CD_NA_1\n");
+struct sClientAddressIndex
+{
+    ClientAddressIndexEntry* entries;
+    uint32_t mask; /* number of entries - 1 (number of entries is a power of two) */
 
-        if (isBroadcastCA(slave, ca) == true)
-        {
-            DEBUG_PRINT("CS104_SLAVE: command with broadcast CA not allowed\n");
+    /* prefix lengths used in the table (in descending order) */
+    uint8_t ipv4PrefixLengths[33];
+    int numberOfIpv4PrefixLengths;
+    uint8_t ipv6PrefixLengths[129];
+    int numberOfIpv6PrefixLengths;
 
-            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+    CS104_RedundancyGroup catchAllGroup;
+};
 
-            return true;
-        }
+static uint32_t
+ClientAddressIndex_hash(const uint8_t* address, int size, int prefixLength)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
 
-        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_SPONTANEOUS))
-        {
-            if (slave->delayAcquisitionHandler)
-            {
-                union uInformationObject _io;
+    int i;
 
-                DelayAcquisitionCommand dac =
-                    (DelayAcquisitionCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+    for (i = 0; i < size; i++)
+    {
+        hash ^= address[i];
+        hash *= 16777619u;
+    }
 
-                if (dac)
-                {
-                    /* Verify IOA = 0 */
-                    if (InformationObject_getObjectAddress((InformationObject)dac) != 0)
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: delay aquisition command has invalid IOA - should be 0\n");
-                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+    hash ^= (uint32_t)prefixLength;
+    hash *= 16777619u;
 
-                        messageHandled = true;
-                    }
-                    else
-                    {
-                        if (slave->delayAcquisitionHandler(slave->delayAcquisitionHandlerParameter,
-                                                           &(self->iMasterConnection), asdu,
-                                                           DelayAcquisitionCommand_getDelay(dac)))
-                            messageHandled = true;
-                    }
-                }
-                else
-                    return false;
-            }
-        }
-        else
-        {
-            responseCOTUnknown(asdu, self);
-            messageHandled = true;
-        }
+    return hash;
+}
 
-        break;
+static ClientAddressIndexEntry*
+ClientAddressIndex_find(ClientAddressIndex self, const uint8_t* maskedAddress, eCS104_IPAddressType type,
+                        int prefixLength)
+{
+    int size = CS104_IPAddress_getSize(type);
 
-    case C_TS_TA_1: /* 107 - test command with timestamp */
+    uint32_t pos = ClientAddressIndex_hash(maskedAddress, size, prefixLength) & self->mask;
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd test command with CP56Time2a C_TS_TA_1\n");
+    /* the table is never full -> there is always an unused entry */
+    while (self->entries[pos].group)
+    {
+        ClientAddressIndexEntry* entry = &(self->entries[pos]);
 
-        if (isBroadcastCA(slave, ca) == true)
-        {
-            DEBUG_PRINT("CS104_SLAVE: test command with broadcast CA not allowed\n");
+        if ((entry->type == (uint8_t)type) && (entry->prefixLength == (uint8_t)prefixLength) &&
+            (memcmp(entry->address, maskedAddress, size) == 0))
+            return entry;
 
-            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+        pos = (pos + 1) & self->mask;
+    }
 
-            return true;
-        }
-        else
-        {
-            union uInformationObject _io;
+    return &(self->entries[pos]);
+}
 
-            TestCommandWithCP56Time2a tc =
-                (TestCommandWithCP56Time2a)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+static void
+ClientAddressIndex_addPrefixLength(uint8_t* prefixLengths, int* numberOfPrefixLengths, int prefixLength)
+{
+    int i = 0;
 
-            if (tc)
-            {
-                /* Verify IOA = 0 */
-                if (InformationObject_getObjectAddress((InformationObject)tc) != 0)
-                {
-                    DEBUG_PRINT("CS104 SLAVE: test command has invalid IOA - should be 0\n");
-                    responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
-                    return true;
-                }
+    while ((i < *numberOfPrefixLengths) && (prefixLengths[i] > prefixLength))
+        i++;
 
-                /* Only COT = ACTIVATION is allowed */
-                if (cot != CS101_COT_ACTIVATION)
-                {
-                    DEBUG_PRINT("CS104 SLAVE: test command has invalid COT - should be ACTIVATION(6)\n");
-                    responseNegative(asdu, self, CS101_COT_UNKNOWN_COT);
-                    return true;
-                }
+    if ((i < *numberOfPrefixLengths) && (prefixLengths[i] == prefixLength))
+        return;
 
-                CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-                sendASDUInternal(self, asdu, false);
+    memmove(prefixLengths + i + 1, prefixLengths + i, *numberOfPrefixLengths - i);
 
-                return true;
-            }
-            else
-            {
-                DEBUG_PRINT("CS104 SLAVE: invalid test command\n");
-                return false;
-            }
-        }
+    prefixLengths[i] = (uint8_t)prefixLength;
+    (*numberOfPrefixLengths)++;
+}
 
-        break;
+static void
+ClientAddressIndex_destroy(ClientAddressIndex self)
+{
+    if (self)
+    {
+        if (self->entries)
+            GLOBAL_FREEMEM(self->entries);
 
-    default: /* no special handler available -> use default handler */
-        break;
+        GLOBAL_FREEMEM(self);
     }
+}
 
-    if ((messageHandled == false) && (slave->asduHandler != NULL))
-        if (slave->asduHandler(slave->asduHandlerParameter, &(self->iMasterConnection), asdu))
-            messageHandled = true;
+static ClientAddressIndex
+ClientAddressIndex_create(LinkedList redundancyGroups)
+{
+    ClientAddressIndex self = (ClientAddressIndex)GLOBAL_CALLOC(1, sizeof(struct sClientAddressIndex));
 
-    if (messageHandled == false)
+    if (self == NULL)
+        return NULL;
+
+    int numberOfAddresses = 0;
+
+    LinkedList groupElement = LinkedList_getNext(redundancyGroups);
+
+    while (groupElement)
     {
-        /* send error response */
-        CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_TYPE_ID);
-        CS101_ASDU_setNegative(asdu, true);
-        sendASDUInternal(self, asdu, false);
-    }
+        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup)LinkedList_getData(groupElement);
 
-    return true;
-}
+        if (CS104_RedundancyGroup_isCatchAll(redGroup))
+            self->catchAllGroup = redGroup;
+        else
+            numberOfAddresses += LinkedList_size(redGroup->allowedClients);
 
-static bool
-checkSequenceNumber(MasterConnection self, int seqNo)
-{
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
-#endif
+        groupElement = LinkedList_getNext(groupElement);
+    }
 
-    /* check if received sequence number is valid */
+    /* keep the load factor below 50% */
+    uint32_t tableSize = 8;
 
-    bool seqNoIsValid = false;
-    bool counterOverflowDetected = false;
-    int oldestValidSeqNo = -1;
+    while (tableSize < (uint32_t)(numberOfAddresses * 2))
+        tableSize *= 2;
 
-    if (self->oldestSentASDU == -1) /* if k-Buffer is empty */
+    self->entries = (ClientAddressIndexEntry*)GLOBAL_CALLOC(tableSize, sizeof(ClientAddressIndexEntry));
+
+    if (self->entries == NULL)
     {
-        if (seqNo == self->sendCount)
-            seqNoIsValid = true;
+        ClientAddressIndex_destroy(self);
+        return NULL;
     }
-    else
+
+    self->mask = tableSize - 1;
+
+    groupElement = LinkedList_getNext(redundancyGroups);
+
+    while (groupElement)
     {
-        /* two cases are required to reflect sequence number overflow */
-        int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
-        int newestAsduSeqNo = self->sentASDUs[self->newestSentASDU].seqNo;
+        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup)LinkedList_getData(groupElement);
 
-        if (oldestAsduSeqNo <= newestAsduSeqNo)
-        {
-            if ((seqNo >= oldestAsduSeqNo) && (seqNo <= newestAsduSeqNo))
-                seqNoIsValid = true;
-        }
-        else
+        if (redGroup->allowedClients)
         {
-            if ((seqNo >= oldestAsduSeqNo) || (seqNo <= newestAsduSeqNo))
-                seqNoIsValid = true;
+            LinkedList element = LinkedList_getNext(redGroup->allowedClients);
 
-            counterOverflowDetected = true;
-        }
+            while (element)
+            {
+                CS104_IPAddress allowedAddress = (CS104_IPAddress)LinkedList_getData(element);
 
-        /* check if confirmed message was already removed from list */
-        if (oldestAsduSeqNo == 0)
-            oldestValidSeqNo = 32767;
-        else
-            oldestValidSeqNo = (oldestAsduSeqNo - 1) % 32768;
+                ClientAddressIndexEntry* entry =
+                    ClientAddressIndex_find(self, allowedAddress->address, allowedAddress->type, allowedAddress->prefixLength);
 
-        if (oldestValidSeqNo == seqNo)
-            seqNoIsValid = true;
+                /* an existing entry is not replaced (first group wins) */
+                if (entry->group == NULL)
+                {
+                    entry->group = redGroup;
+                    memcpy(entry->address, allowedAddress->address, sizeof(entry->address));
+                    entry->type = (uint8_t)allowedAddress->type;
+                    entry->prefixLength = (uint8_t)allowedAddress->prefixLength;
+
+                    if (allowedAddress->type == IP_ADDRESS_TYPE_IPV4)
+                        ClientAddressIndex_addPrefixLength(self->ipv4PrefixLengths, &(self->numberOfIpv4PrefixLengths),
+                                                           allowedAddress->prefixLength);
+                    else
+                        ClientAddressIndex_addPrefixLength(self->ipv6PrefixLengths, &(self->numberOfIpv6PrefixLengths),
+                                                           allowedAddress->prefixLength);
+                }
+
+                element = LinkedList_getNext(element);
+            }
+        }
+
+        groupElement = LinkedList_getNext(groupElement);
     }
 
-    if (seqNoIsValid)
+    return self;
+}
+
+/**
+ * \brief Get the redundancy group for the client address
+ *
+ * \param address the IPv4 (4 byte) or IPv6 (16 byte) address of the client
+ *
+ * \return the group with the longest matching entry, the catch-all group, or NULL
+ */
+static CS104_RedundancyGroup
+ClientAddressIndex_lookup(ClientAddressIndex self, const uint8_t* address, eCS104_IPAddressType type)
+{
+    const uint8_t* prefixLengths;
+    int numberOfPrefixLengths;
+
+    if (type == IP_ADDRESS_TYPE_IPV4)
     {
-        if (self->oldestSentASDU != -1)
-        {
-            do
-            {
-                int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
+        prefixLengths = self->ipv4PrefixLengths;
+        numberOfPrefixLengths = self->numberOfIpv4PrefixLengths;
+    }
+    else
+    {
+        prefixLengths = self->ipv6PrefixLengths;
+        numberOfPrefixLengths = self->numberOfIpv6PrefixLengths;
+    }
 
-                if (counterOverflowDetected == false)
-                {
-                    if (seqNo < oldestAsduSeqNo)
-                        break;
-                }
+    int size = CS104_IPAddress_getSize(type);
 
-                if (seqNo == oldestValidSeqNo)
-                    break;
+    int i;
 
-                /* remove from server (low-priority) queue if required */
-                if (self->sentASDUs[self->oldestSentASDU].queueEntry != NULL)
-                {
-                    MessageQueue_lock(self->lowPrioQueue);
+    for (i = 0; i < numberOfPrefixLengths; i++)
+    {
+        uint8_t maskedAddress[16];
 
-                    MessageQueue_markAsduAsConfirmed(self->lowPrioQueue,
-                                                     self->sentASDUs[self->oldestSentASDU].queueEntry,
-                                                     self->sentASDUs[self->oldestSentASDU].entryId);
+        memcpy(maskedAddress, address, size);
 
-                    self->sentASDUs[self->oldestSentASDU].queueEntry = NULL;
+        CS104_IPAddress_applyPrefix(maskedAddress, size, prefixLengths[i]);
 
-                    self->sentASDUs[self->oldestSentASDU].seqNo = -1;
+        ClientAddressIndexEntry* entry = ClientAddressIndex_find(self, maskedAddress, type, prefixLengths[i]);
 
-                    MessageQueue_unlock(self->lowPrioQueue);
-                }
+        if (entry->group)
+            return entry->group;
+    }
 
-                /* clear sent buffer entry */
-                self->sentASDUs[self->oldestSentASDU].queueEntry = NULL;
-                self->sentASDUs[self->oldestSentASDU].entryId = 0;
-                self->sentASDUs[self->oldestSentASDU].sentTime = 0;
-                self->sentASDUs[self->oldestSentASDU].seqNo = -1;
+    return self->catchAllGroup;
+}
 
-                if (oldestAsduSeqNo == seqNo)
-                {
-                    /* we arrived at the seq# that has been confirmed */
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-                    if (self->oldestSentASDU == self->newestSentASDU)
-                        self->oldestSentASDU = -1;
-                    else
-                        self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+/***************************************************
+ * Slave
+ ***************************************************/
 
-                    break;
-                }
+struct sCS104_Slave
+{
+    CS101_InterrogationHandler interrogationHandler;
+    void* interrogationHandlerParameter;
 
-                self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+    CS101_CounterInterrogationHandler counterInterrogationHandler;
+    void* counterInterrogationHandlerParameter;
 
-                int checkIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
+    CS101_ReadHandler readHandler;
+    void* readHandlerParameter;
 
-                if (self->oldestSentASDU == checkIndex)
-                {
-                    self->oldestSentASDU = -1;
-                    break;
-                }
+    CS101_StationDatabase stationDatabase; /**< answers interrogation and read commands (NULL -> not used) */
 
-            } while (true);
-        }
-    }
-    else
-        DEBUG_PRINT("CS104 SLAVE: Received sequence number out of range");
+    CS101_GetNextInterrogationASDUHandler getNextInterrogationASDUHandler;
+    void* getNextInterrogationASDUHandlerParameter;
+
+    CS104_AsyncCommandHandler asyncCommandHandler;
+    void* asyncCommandHandlerParameter;
+
+    LinkedList commands; /**< open commands of the async command handler (protected by commandsLock) */
+    int numberOfCommands;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
+    Semaphore commandsLock;
 #endif
 
-    return seqNoIsValid;
-}
+#if (CONFIG_USE_THREADS == 1)
+    int numberOfCommandWorkers;
+    CS104_CommandWorker commandWorkers; /**< worker threads of the async command handler (NULL -> not running) */
+    bool commandWorkersRunning;         /* protected by commandsLock */
+#endif
 
-static bool
-MasterConnection_isRunning(MasterConnection self)
-{
-    bool retVal;
+    CS101_ClockSynchronizationHandler clockSyncHandler;
+    void* clockSyncHandlerParameter;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+    CS101_ResetProcessHandler resetProcessHandler;
+    void* resetProcessHandlerParameter;
+
+    CS101_DelayAcquisitionHandler delayAcquisitionHandler;
+    void* delayAcquisitionHandlerParameter;
+
+    CS101_ASDUHandler asduHandler;
+    void* asduHandlerParameter;
+
+    CS104_ConnectionRequestHandler connectionRequestHandler;
+    void* connectionRequestHandlerParameter;
+
+    CS104_ConnectionEventHandler connectionEventHandler;
+    void* connectionEventHandlerParameter;
+
+    CS104_SlaveRawMessageHandler rawMessageHandler;
+    void* rawMessageHandlerParameter;
+
+    CS101_IsCAAllowedHandler isCAAllowedHandler;
+    void* isCAAllowedHandlerParameter;
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    TLSConfiguration tlsConfig;
 #endif
 
-    retVal = self->isRunning;
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP)
+    MessageQueue asduQueue;                    /**< low priority ASDU queue and buffer */
+    HighPriorityASDUQueue connectionAsduQueue; /**< high priority ASDU queue */
+#endif
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+#if ((CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) || (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1))
+    MessageLog sharedEventLog; /**< low priority ASDU buffer shared by all redundancy groups or connections */
 #endif
 
-    return retVal;
-}
+    int maxLowPrioQueueSize;
+    int maxHighPrioQueueSize;
 
-static bool
-MasterConnection_isActive(MasterConnection self)
-{
-    bool isActive = false;
+    int maxTxBatchSize; /**< size of the connection output buffers (0 -> no output buffers) */
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+    int ingressQueueSize; /**< size of the lock-free ingress queue (0 -> not used) */
+
+    int eventQueueMemorySize; /**< size of the low priority event buffer in bytes (0 -> depends on maxLowPrioQueueSize) */
+
+    CS104_QueueOverflowPolicy overflowPolicy; /**< behavior of the event buffer when it is full */
+    int overflowBlockTimeout; /**< maximum time to wait for free space in ms (CS104_QUEUE_OVERFLOW_BLOCK) */
+
+    uint8_t coalescedTypes[32]; /**< bit set of the types that only keep the latest waiting value */
+    bool hasCoalescedTypes;     /**< true when at least one bit of coalescedTypes is set */
+    int coalescingCapacity;     /**< expected number of data points that can be coalesced (0 -> maxLowPrioQueueSize) */
+
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+    IngressQueue ingressQueue; /**< ASDUs enqueued by the application but not yet added to the event log */
 #endif
 
-    if (self->state == M_CON_STATE_STARTED)
-        isActive = true;
+#if (CONFIG_USE_THREADS == 1)
+    HandleSet serverHandleSet; /**< listening socket and wakeup handle of the server thread (protected by stateLock) */
+    bool isIngressDrainerRunning; /**< server thread drains the ingress queue when woken up (protected by stateLock) */
+#endif
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    char* eventQueueFile;       /**< file of the persistent event queue (NULL -> event queue in memory) */
+    bool eventQueueSyncOnWrite; /**< write each event to the storage device before returning */
 #endif
 
-    return isActive;
-}
+    int openConnections; /**< number of connected clients */
+    MasterConnection* masterConnections; /**< all MasterConnection objects (created on demand, protected by openConnectionsLock) */
+    int numberOfConnectionObjects;       /**< number of created MasterConnection objects */
+    int connectionTableSize;             /**< allocated size of masterConnections and activeConnections */
 
-static void
-_resetT3Timeout(MasterConnection self, uint64_t currentTime)
-{
-    self->nextT3Timeout = currentTime + (uint64_t)(self->slave->conParameters.t3 * 1000);
-}
+    MasterConnection* activeConnections; /**< connections in use (isUsed set, protected by openConnectionsLock) */
+    int numberOfActiveConnections;
+
+    MasterConnection freeConnections; /**< list of unused connection objects (linked by nextFreeConnection) */
 
-static void
-resetT3Timeout(MasterConnection self, uint64_t currentTime)
-{
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+    Semaphore openConnectionsLock;
 #endif
 
-    _resetT3Timeout(self, currentTime);
+    struct sCS104_ConnectionMetrics closedConnectionMetrics; /**< counters of all closed connections */
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+    Semaphore metricsLock; /* protect closedConnectionMetrics (also of the redundancy groups) */
 #endif
-}
 
-static bool
-checkT3Timeout(MasterConnection self, uint64_t currentTime)
-{
-    bool retVal = false;
+#if (CONFIG_USE_THREADS == 1)
+    bool isThreadlessMode;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+    CS104_ThreadingModel threadingModel;
+    int numberOfWorkers;
+    CS104_SlaveWorker workers; /**< worker threads for threading model CS104_THREADING_MODEL_EVENT_LOOP */
+    bool acceptSharding;         /**< each worker accepts connections with its own listening socket */
+    bool isAcceptShardingActive; /**< listening sockets of the workers are open (server thread doesn't listen) */
 #endif
 
-    if (self->waitingForTestFRcon)
-        goto exit_function;
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+    Thread* handshakeThreads;     /**< TLS handshake threads for threading model CS104_THREADING_MODEL_EVENT_LOOP */
+    LinkedList handshakeQueue;    /* connections waiting for the TLS handshake (protected by handshakeLock) */
+    bool handshakeThreadsRunning; /* protected by handshakeLock */
+    Semaphore handshakeLock;
+    Semaphore handshakeSignal; /* counts the queued connections (and the stop requests) */
+#endif
 
-    if (self->nextT3Timeout > (currentTime + (uint64_t)(self->slave->conParameters.t3 * 1000)))
-    {
-        /* timeout value not plausible (maybe system time changed) */
-        _resetT3Timeout(self, currentTime);
-    }
+    int maxOpenConnections; /**< maximum accepted open client connections */
 
-    if (currentTime > self->nextT3Timeout)
-        retVal = true;
+    struct sCS104_APCIParameters conParameters;
 
-exit_function:
+    struct sCS101_AppLayerParameters alParameters;
+
+    bool isStarting;
+    bool isRunning;
+    bool stopRunning;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+    Semaphore stateLock; /* protect isStarting, isRunning, stopRunning */
 #endif
 
-    return retVal;
-}
+    int tcpPort;
 
-static void
-resetTestFRConTimeout(MasterConnection self, uint64_t currentTime)
-{
-    self->nextTestFRConTimeout = currentTime + (uint64_t)(self->slave->conParameters.t1 * 1000);
-}
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+    LinkedList redundancyGroups;
+    ClientAddressIndex clientAddressIndex; /**< built from the allowed clients of the groups when the slave is started */
+#endif
 
-static bool
-checkTestFRConTimeout(MasterConnection self, uint64_t currentTime)
-{
-    if (self->nextTestFRConTimeout > (currentTime + (uint64_t)(self->slave->conParameters.t1 * 1000)))
-    {
-        /* timeout value not plausible (maybe system time changed) */
-        resetTestFRConTimeout(self, currentTime);
-    }
+    CS104_ServerMode serverMode;
 
-    if (currentTime > self->nextTestFRConTimeout)
-        return true;
-    else
-        return false;
-}
+    char* localAddress;
 
-/* unprotected version of sendSMessage */
-static void
-_sendSMessage(MasterConnection self)
-{
-    uint8_t msg[6];
+#if (CONFIG_USE_THREADS == 1)
+    Thread listeningThread;
+#endif
 
-    msg[0] = 0x68;
-    msg[1] = 0x04;
-    msg[2] = 0x01;
-    msg[3] = 0;
-    msg[4] = (uint8_t)((self->receiveCount % 128) * 2);
-    msg[5] = (uint8_t)(self->receiveCount / 128);
+    ServerSocket serverSocket;
 
-    if (writeToSocket(self, msg, 6) < 0)
-        self->isRunning = false;
-}
+    HandleSet threadlessHandleSet;  /**< server socket and sockets of running connections (only threadless mode) */
+    bool threadlessHandleSetChanged; /**< handle set has to be rebuilt before the next poll */
+    struct sTimerWheel threadlessTimers; /**< protocol timers of the connections (only threadless mode) */
+    bool threadlessWakeupRequested;      /**< ASDUs were enqueued since the last tick (protected by stateLock) */
+    bool threadlessAsduWaiting;          /**< ASDUs could not be sent completely by the last tick */
 
-static void
-sendSMessage(MasterConnection self)
-{
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    int replicationPort;           /**< TCP port for the standby server (0 -> event queue is not replicated) */
+    CS104_Replication replication; /**< sends the event queue to the standby server (NULL -> not running) */
+    CS104_Replication standby;     /**< receives the event queue from the active server (NULL -> not in standby) */
 #endif
 
-    _sendSMessage(self);
+    LinkedList plugins;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+#ifdef SEC_AUTH_60870_5_7
+    SecureEndpoint secureEndpoint;
 #endif
-}
+};
 
-static bool
-handleMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+typedef struct
 {
-    uint64_t currentTime = Hal_getMonotonicTimeInMs();
-
-    if (msgSize >= 3)
-    {
-        if (buffer[0] != 0x68)
-        {
-            DEBUG_PRINT("CS104 SLAVE: Invalid START character!");
-            return false;
-        }
+    uint64_t entryId;    /* required to identify message in server (low-priority) queue */
+    uint8_t* queueEntry; /* NULL if ASDU is not from low-priority queue */
 
-        uint8_t lengthOfApdu = buffer[1];
+    uint64_t sentTime; /* required for T1 timeout */
+    int seqNo;
 
-        if (lengthOfApdu != msgSize - 2)
-        {
-            DEBUG_PRINT("CS104 SLAVE: Invalid length of APDU");
-            return false;
-        }
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+    bool hasEnqueueTime;  /* true when the ASDU is from the low-priority queue */
+    uint64_t enqueueTime; /* time stamp of the queue entry (Hal_getMonotonicTimeInMs) */
+#endif
+} SentASDUSlave;
 
-        if ((buffer[2] & 1) == 0) /* I message */
-        {
-            if (msgSize < 7)
-            {
-                DEBUG_PRINT("CS104 SLAVE: Received I msg too small!");
-                return false;
-            }
+struct sMasterConnection
+{
+    Socket socket;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    TLSSocket tlsSocket;
 #endif
 
-            if (self->state != M_CON_STATE_STARTED)
-            {
-                DEBUG_PRINT("CS104 SLAVE: Received I message while connection not active -> close connection");
+    /* can be moved to CS104_Slave struct? */
+    struct sIPeerConnection iMasterConnection;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_post(self->stateLock);
-#endif
+    CS104_Slave slave;
 
-                return false;
-            }
+    MasterConnectionState state;
 
-            if (self->timeoutT2Triggered == false)
-            {
-                self->timeoutT2Triggered = true;
-                self->lastConfirmationTime = currentTime; /* start timeout T2 */
-            }
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
+    int activeIndex;                     /* position in the active connections of the slave (-1 -> not used) */
+    MasterConnection nextFreeConnection; /* next unused connection object */
+
+#if (CONFIG_USE_THREADS == 1)
+    int runningCommandHandlers; /* calls of the async command handler for this connection (protected by commandsLock) */
 #endif
 
-            int frameSendSequenceNumber = ((buffer[3] * 0x100) + (buffer[2] & 0xfe)) / 2;
-            int frameRecvSequenceNumber = ((buffer[5] * 0x100) + (buffer[4] & 0xfe)) / 2;
+    struct sTimerWheelEntry timer; /* next protocol timer in the timer wheel of the worker or the threadless mode */
 
-            DEBUG_PRINT("CS104 SLAVE: Received I frame: N(S) = %i N(R) = %i\n", frameSendSequenceNumber,
-                        frameRecvSequenceNumber);
+    unsigned int isUsed : 1;
+    unsigned int isRunning : 1;
+    unsigned int timeoutT2Triggered : 1;
+    unsigned int waitingForTestFRcon : 1;
+    unsigned int requeuedOnActivate : 1;  /* set by CS104_Slave_activate to suppress redundant requeue in thread exit */
+    uint16_t maxSentASDUs;  /* k-parameter */
+    int16_t oldestSentASDU; /* oldest sent ASDU in k-buffer */
+    int16_t newestSentASDU; /* newest sent ASDU in k-buffer */
+    uint16_t sendCount;     /* sent messages - sequence counter */
+    uint16_t receiveCount;  /* received messages - sequence counter */
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
+    int unconfirmedReceivedIMessages; /* number of unconfirmed messages received (stateLock protected)*/
+
+    /* timeout T2 handling */
+    uint64_t lastConfirmationTime; /* timestamp when the last confirmation message (for I messages) was sent */
+
+    uint64_t nextT3Timeout;
+    uint64_t nextTestFRConTimeout; /* timeout T1 when waiting for TEST FR con */
+
+    SentASDUSlave* sentASDUs;
+
+#if (CONFIG_USE_THREADS == 1)
+    Thread connectionThread;
+    CS104_SlaveWorker worker; /* worker handling the connection (only for CS104_THREADING_MODEL_EVENT_LOOP) */
 #endif
-            if (frameSendSequenceNumber != self->receiveCount)
-            {
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_post(self->stateLock);
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+    bool handshakePending; /* connection is owned by the TLS handshake threads (protected by stateLock) */
 #endif
 
-                DEBUG_PRINT("CS104 SLAVE: Sequence error - close connection");
-                return false;
-            }
 #if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
+    Semaphore sentASDUsLock;
+    Semaphore stateLock;
 #endif
 
-            if (checkSequenceNumber(self, frameRecvSequenceNumber) == false)
-            {
-                DEBUG_PRINT("CS104 SLAVE: Sequence number check failed - close connection");
-                return false;
-            }
+    HandleSet handleSet;
+
+    uint8_t* rxBuffer; /* data received from the socket (can contain multiple APDUs) */
+    int rxBufferStart; /* start of the first unprocessed APDU in rxBuffer */
+    int rxBufferEnd;   /* end of the received data in rxBuffer */
+
+    uint8_t* recvBuffer; /* last received APDU (points into rxBuffer) */
+
+    uint8_t sendBuffer[260];
+
+    /* output buffer to send multiple APDUs with a single socket write (NULL when not used) */
+    uint8_t* txBuffer;
+    int txBufferSize;
+    int txBufferPos;    /* number of bytes waiting in the output buffer */
+    bool txBatchActive; /* when true the APDUs are only written to the socket when the buffer is full or the batch ends */
+    bool txWriteInterest; /* socket is monitored for writability by the event loop (output buffer congested) */
+
+    bool wakeupRequested; /* connection thread was woken up and has not yet handled the connection (protected by stateLock) */
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
-#endif
-            self->receiveCount = (self->receiveCount + 1) % 32768;
-            self->unconfirmedReceivedIMessages++;
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
+    Semaphore txBufferLock;
 #endif
 
-            if (MasterConnection_isActive(self))
-            {
-                struct sCS101_ASDU _asdu;
+    MessageQueue lowPrioQueue;
+    HighPriorityASDUQueue highPrioQueue;
 
-                CS101_ASDU asdu =
-                    CS101_ASDU_createFromBufferEx(&_asdu, &(self->slave->alParameters), buffer + 6, msgSize - 6);
+    /* counters of the connection (relaxed atomics or protected by metricsLock, see MasterConnection_addToCounter) */
+    struct sCS104_ConnectionMetrics metrics;
 
-                if (asdu)
-                {
-                    bool validAsdu = handleASDU(self, asdu, NULL);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore metricsLock;
+#endif
 
-                    if (validAsdu == false)
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: ASDU corrupted");
-                        return false;
-                    }
-                }
-                else
-                {
-                    DEBUG_PRINT("CS104 SLAVE: Invalid ASDU");
-                    return false;
-                }
-            }
-            else
-            {
-                DEBUG_PRINT("CS104 SLAVE: Received I message while connection not activate -> close connection");
-                return false;
-            }
-        }
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+    /* latency histograms (indexed by CS104_LatencyType, protected by sentASDUsLock) */
+    struct sCS104_LatencyHistogram latency[3];
+#endif
 
-        /* Check for TESTFR_ACT message */
-        else if ((buffer[2] & 0x43) == 0x43)
-        {
-            DEBUG_PRINT("CS104 SLAVE: Send TESTFR_CON\n");
+    /* source of the running interrogation response (protected by sentASDUsLock) */
+    InterrogationResponseSource interrogationResponse;
+    sCS101_StationDatabaseCursor interrogationCursor;
 
-            if (writeToSocket(self, TESTFR_CON_MSG, TESTFR_CON_MSG_SIZE) < 0)
-                return false;
-        }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    CS104_RedundancyGroup redundancyGroup;
+#endif
+};
 
-        /* Check for STARTDT_ACT message */
-        else if ((buffer[2] & 0x07) == 0x07)
-        {
-            CS104_Slave_activate(self->slave, self);
+static uint8_t STARTDT_CON_MSG[] = {0x68, 0x04, 0x0b, 0x00, 0x00, 0x00};
 
-            HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
+#define STARTDT_CON_MSG_SIZE 6
 
-            DEBUG_PRINT("CS104 SLAVE: Send STARTDT_CON\n");
+static uint8_t STOPDT_CON_MSG[] = {0x68, 0x04, 0x23, 0x00, 0x00, 0x00};
 
-            if (writeToSocket(self, STARTDT_CON_MSG, STARTDT_CON_MSG_SIZE) < 0)
-                return false;
-        }
+#define STOPDT_CON_MSG_SIZE 6
 
-        /* Check for STOPDT_ACT message */
-        else if ((buffer[2] & 0x13) == 0x13)
-        {
-            DEBUG_PRINT("CS104 SLAVE: Received STOPDT_ACT\n");
+static uint8_t TESTFR_CON_MSG[] = {0x68, 0x04, 0x83, 0x00, 0x00, 0x00};
 
-            MasterConnection_deactivate(self);
+#define TESTFR_CON_MSG_SIZE 6
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
-#endif
+static uint8_t TESTFR_ACT_MSG[] = {0x68, 0x04, 0x43, 0x00, 0x00, 0x00};
 
-            if (self->unconfirmedReceivedIMessages > 0)
-            {
-                /* Send S-Message to confirm all outstanding messages */
+#define TESTFR_ACT_MSG_SIZE 6
 
-                self->lastConfirmationTime = Hal_getMonotonicTimeInMs();
+/* space of the output buffer that is kept free for S and U frames when a batch of APDUs is collected */
+#define TX_BUFFER_CONTROL_RESERVE (8 * TESTFR_ACT_MSG_SIZE)
 
-                self->unconfirmedReceivedIMessages = 0;
+/* retry interval to send the output buffer when the socket cannot be monitored for writability */
+#define TX_BUFFER_RETRY_INTERVAL 10
 
-                self->timeoutT2Triggered = false;
+/* create the log for the ASDUs of CS104_Slave_enqueueASDU (stored in the event queue file when configured) */
+static MessageLog
+createEventLog(CS104_Slave self, int maxQueueSize)
+{
+    int bufferSize = maxQueueSize * (sizeof(struct sMessageQueueEntryInfo) + 256);
 
-                _sendSMessage(self);
-            }
+    /* byte budget configured by the user -> independent of the number of entries */
+    if (self->eventQueueMemorySize > 0)
+        bufferSize = self->eventQueueMemorySize;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
-#endif
+    /* the buffer has to hold at least one ASDU of maximum size */
+    if (bufferSize < (int)sizeof(struct sMessageQueueEntryInfo) + 256)
+        bufferSize = sizeof(struct sMessageQueueEntryInfo) + 256;
 
-            if (MasterConnection_hasUnconfirmedMessages(self))
-            {
-                DEBUG_PRINT(
-                    "CS104 SLAVE: Unconfirmed messages after STOPDT_ACT -> pending unconfirmed stopped state\n");
-            }
-            else
-            {
-                DEBUG_PRINT("CS104 SLAVE: Send STOPDT_CON\n");
+    MessageLog log = NULL;
 
-                self->state = M_CON_STATE_STOPPED;
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->eventQueueFile)
+    {
+        if (self->serverMode != CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+        {
+            log = MessageLog_createPersistent(bufferSize, self->eventQueueFile, self->eventQueueSyncOnWrite);
 
-                if (writeToSocket(self, STOPDT_CON_MSG, STOPDT_CON_MSG_SIZE) < 0)
-                {
-#if (CONFIG_USE_SEMAPHORES == 1)
-                    Semaphore_post(self->stateLock);
-#endif
+            if (log == NULL)
+                DEBUG_PRINT("CS104 SLAVE: failed to create persistent event queue -> use event queue in memory\n");
+        }
+        else
+            DEBUG_PRINT("CS104 SLAVE: persistent event queue not supported in mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP\n");
+    }
+#endif /* (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1) */
 
-                    return false;
-                }
-            }
+    if (log == NULL)
+        log = MessageLog_create(bufferSize);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
-#endif
-        }
+    if (log)
+    {
+        /* the queue of a new connection must not block the other connections */
+        if (self->serverMode != CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+            log->overflowPolicy = self->overflowPolicy;
 
-        /* Check for TESTFR_CON message */
-        else if ((buffer[2] & 0x83) == 0x83)
+        if (self->hasCoalescedTypes || (log->overflowPolicy == CS104_QUEUE_OVERFLOW_COALESCE))
         {
-            DEBUG_PRINT("CS104 SLAVE: Recv TESTFR_CON\n");
+            int coalesceKeySize = self->alParameters.sizeOfTypeId + self->alParameters.sizeOfVSQ +
+                                  self->alParameters.sizeOfCOT + self->alParameters.sizeOfCA +
+                                  self->alParameters.sizeOfIOA;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
-#endif
-            self->waitingForTestFRcon = false;
+            /* by default the index can hold one data point per entry of maximum size */
+            int numberOfDataPoints = self->coalescingCapacity;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
-#endif
+            if (numberOfDataPoints < 1)
+                numberOfDataPoints = maxQueueSize;
+
+            if (MessageLog_enableCoalescing(log, coalesceKeySize, self->coalescedTypes, numberOfDataPoints) == false)
+                DEBUG_PRINT("CS104 SLAVE: failed to allocate event queue index -> no coalescing\n");
         }
+    }
 
-        else if (buffer[2] == 0x01) /* S-message */
-        {
-            int seqNo = (buffer[4] + buffer[5] * 0x100) / 2;
+    return log;
+}
 
-            DEBUG_PRINT("CS104 SLAVE: Rcvd S(%i) (own sendcounter = %i)\n", seqNo, self->sendCount);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+static void
+initializeMessageQueues(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
+{
+    /* queues are kept when the server is restarted */
+    if (self->asduQueue)
+        return;
 
-            if (checkSequenceNumber(self, seqNo) == false)
-            {
-                DEBUG_PRINT("CS104 SLAVE: S message - sequence number mismatch");
-                return false;
-            }
+    /* initialized low priority queue */
+    if (lowPrioMaxQueueSize < 1)
+        lowPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_SIZE;
 
-            printSendBuffer(self);
+    MessageLog eventLog = createEventLog(self, lowPrioMaxQueueSize);
 
-            if (self->state == M_CON_STATE_UNCONFIRMED_STOPPED)
-            {
-                if (MasterConnection_hasUnconfirmedMessages(self) == false)
-                {
-                    self->state = M_CON_STATE_STOPPED;
+    if (eventLog)
+    {
+        self->asduQueue = MessageQueue_createWithLog(eventLog, "default");
 
-                    DEBUG_PRINT("CS104 SLAVE: Send STOPDT_CON\n");
+        MessageLog_release(eventLog);
+    }
 
-                    if (writeToSocket(self, STOPDT_CON_MSG, STOPDT_CON_MSG_SIZE) < 0)
-                        return false;
-                }
-            }
-            else if (self->state == M_CON_STATE_STOPPED)
-            {
-                DEBUG_PRINT("CS104 SLAVE: S message in stopped state -> active close\n");
-                /* actively close connection */
-                return false;
-            }
-        }
-        else
-        {
-            DEBUG_PRINT("CS104 SLAVE: unknown message - IGNORE\n");
-            return true;
-        }
+    /* initialize high priority queue */
+    if (highPrioMaxQueueSize < 1)
+        highPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE;
 
-        resetT3Timeout(self, currentTime);
+    self->connectionAsduQueue = HighPriorityASDUQueue_create(highPrioMaxQueueSize);
+}
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-        return true;
-    }
-    else
+#if ((CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) || (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1))
+static void
+initializeSharedEventLog(CS104_Slave self, int lowPrioMaxQueueSize)
+{
+    if (self->sharedEventLog == NULL)
     {
-        DEBUG_PRINT("CS104 SLAVE: Invalid message (too small)");
-        return false;
+        if (lowPrioMaxQueueSize < 1)
+            lowPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_SIZE;
+
+        self->sharedEventLog = createEventLog(self, lowPrioMaxQueueSize);
     }
 }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) || (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1) */
 
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
 static void
-MasterConnection_deinit(MasterConnection self)
+initializeConnectionSpecificQueues(CS104_Slave self)
 {
-    if (self)
+    int i;
+
+    initializeSharedEventLog(self, self->maxLowPrioQueueSize);
+
+    for (i = 0; i < self->numberOfConnectionObjects; i++)
     {
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        if (self->tlsSocket != NULL)
-            TLSSocket_close(self->tlsSocket);
-#endif
+        char queueKey[MESSAGE_QUEUE_KEY_SIZE];
 
-        if (self->socket)
-        {
-            Socket_destroy(self->socket);
-            self->socket = NULL;
-        }
+        snprintf(queueKey, sizeof(queueKey), "connection#%i", i);
 
-        self->state = M_CON_STATE_STOPPED;
+        self->masterConnections[i]->lowPrioQueue = MessageQueue_createWithLog(self->sharedEventLog, queueKey);
+        self->masterConnections[i]->highPrioQueue = HighPriorityASDUQueue_create(self->maxHighPrioQueueSize);
     }
 }
 
 static void
-MasterConnection_destroy(MasterConnection self)
+deleteConnectionSpecificQueues(CS104_Slave self)
 {
-    if (self)
-    {
-        GLOBAL_FREEMEM(self->sentASDUs);
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_destroy(self->sentASDUsLock);
-        Semaphore_destroy(self->stateLock);
-#endif
-
-        Handleset_destroy(self->handleSet);
+    int i;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-        if (self->slave->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+    for (i = 0; i < self->numberOfConnectionObjects; i++)
+    {
+        if (self->masterConnections[i]->lowPrioQueue)
         {
-            MessageQueue_destroy(self->lowPrioQueue);
-            HighPriorityASDUQueue_destroy(self->highPrioQueue);
+            MessageQueue_destroy(self->masterConnections[i]->lowPrioQueue);
+            self->masterConnections[i]->lowPrioQueue = NULL;
         }
-#endif
 
-        GLOBAL_FREEMEM(self);
+        if (self->masterConnections[i]->highPrioQueue)
+        {
+            HighPriorityASDUQueue_destroy(self->masterConnections[i]->highPrioQueue);
+            self->masterConnections[i]->highPrioQueue = NULL;
+        }
     }
 }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1) */
 
-static void
-sendNextLowPriorityASDU(MasterConnection self)
+/* log that stores the ASDUs of CS104_Slave_enqueueASDU (NULL when the queues are not yet initialized) */
+static MessageLog
+CS104_Slave_getEventLog(CS104_Slave self)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+    {
+        if (self->asduQueue)
+            return self->asduQueue->log;
+    }
 #endif
 
-    uint8_t* asduBuffer;
+#if ((CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) || (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1))
+    if ((self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) || (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP))
+        return self->sharedEventLog;
+#endif
 
-    if (isSentBufferFull(self))
-        goto exit_function;
+    return NULL;
+}
 
-    MessageQueue_lock(self->lowPrioQueue);
+static void
+initializeIngressQueue(CS104_Slave self)
+{
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+    if ((self->ingressQueue == NULL) && (self->ingressQueueSize > 0))
+    {
+        self->ingressQueue = IngressQueue_create(self->ingressQueueSize);
 
-    uint64_t entryId;
-    uint8_t* queueEntry;
-    int msgSize;
+        if (self->ingressQueue == NULL)
+            DEBUG_PRINT("CS104 SLAVE: Failed to allocate ingress queue\n");
+    }
+#else
+    (void)self;
+#endif
+}
 
-    asduBuffer = MessageQueue_getNextWaitingASDU(self->lowPrioQueue, &entryId, &queueEntry, &msgSize);
+/**
+ * Move the ASDUs of the ingress queue to the event log
+ *
+ * \return number of moved ASDUs
+ */
+static int
+CS104_Slave_drainIngressQueue(CS104_Slave self)
+{
+    int count = 0;
 
-    if (asduBuffer)
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+    if (self->ingressQueue)
     {
-        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, asduBuffer, msgSize);
+        MessageLog log = CS104_Slave_getEventLog(self);
 
-        msgSize += IEC60870_5_104_APCI_LENGTH;
-
-        MessageQueue_unlock(self->lowPrioQueue);
+        if (log)
+        {
+            MessageLog_lock(log);
 
-        sendASDU(self, self->sendBuffer, msgSize, entryId, queueEntry);
-    }
-    else
-    {
-        MessageQueue_unlock(self->lowPrioQueue);
-    }
+            count = IngressQueue_moveToLog(self->ingressQueue, log);
 
-exit_function:
+            MessageLog_unlock(log);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
+            if (count > 0)
+                MessageLog_sync(log);
+        }
+    }
+#else
+    (void)self;
 #endif
 
-    return;
+    return count;
 }
 
 static bool
-sendNextHighPriorityASDU(MasterConnection self)
+isRunning(CS104_Slave self)
 {
-    bool retVal = false;
-    uint8_t* buffer = NULL;
-    int msgSize = 0;
+    bool isRunning;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
+    Semaphore_wait(self->stateLock);
 #endif
 
-    if (isSentBufferFull(self))
-        goto exit_function;
-
-    HighPriorityASDUQueue_lock(self->highPrioQueue);
+    isRunning = self->isRunning;
 
-    buffer = HighPriorityASDUQueue_getNextASDU(self->highPrioQueue, &msgSize);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
 
-    if (buffer)
-    {
-        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, buffer, msgSize);
+    return isRunning;
+}
 
-        HighPriorityASDUQueue_unlock(self->highPrioQueue);
+static bool
+isStarting(CS104_Slave self)
+{
+    bool isStarting;
 
-        msgSize += IEC60870_5_104_APCI_LENGTH;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
 
-        retVal = sendASDU(self, self->sendBuffer, msgSize, 0, NULL);
-    }
-    else
-    {
-        HighPriorityASDUQueue_unlock(self->highPrioQueue);
-    }
+    isStarting = self->isStarting;
 
-exit_function:
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
+    Semaphore_post(self->stateLock);
 #endif
 
-    return retVal;
+    return isStarting;
 }
 
-/**
- * Send all high-priority ASDUs and the last waiting ASDU from the low-priority queue.
- * Returns true if ASDUs are still waiting. This can happen when there are more ASDUs
- * in the event (low-priority) buffer, or the connection is unavailable to send the high-priority
- * ASDUs (congestion or connection lost).
- */
 static bool
-sendWaitingASDUs(MasterConnection self)
+isStopRunningSet(CS104_Slave self)
 {
-#ifdef SEC_AUTH_60870_5_7
+    bool isStopRunningSet;
 
-    SecureEndpoint secureEndpoint = NULL;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
 
-    secureEndpoint = self->slave->secureEndpoint;
+    isStopRunningSet = self->stopRunning;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
 
-    if (self->redundancyGroup)
-    {
-        if (self->redundancyGroup->secureEndpoint)
-            secureEndpoint = self->redundancyGroup->secureEndpoint;
-    }
+    return isStopRunningSet;
+}
 
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+static MasterConnection
+MasterConnection_create(CS104_Slave slave);
 
-    if (secureEndpoint)
-    {
-        if (SecureEndpoint_hasWaitingAsdu(secureEndpoint))
-        {
-            uint8_t buffer[256];
-            struct sBufferFrame _bufferFrame;
-            Frame bufferFrame = BufferFrame_initialize(&_bufferFrame, buffer, 0, 256);
+static CS104_Slave
+createSlave(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
+{
+    CS104_Slave self = (CS104_Slave)GLOBAL_CALLOC(1, sizeof(struct sCS104_Slave));
 
-            bool trySend = true;
-            bool sentBufferFull = false;
+    if (self)
+    {
+        self->conParameters = defaultConnectionParameters;
+        self->alParameters = defaultAppLayerParameters;
 
-            while (trySend)
-            {
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_wait(self->sentASDUsLock);
+        self->asduHandler = NULL;
+        self->interrogationHandler = NULL;
+        self->counterInterrogationHandler = NULL;
+        self->readHandler = NULL;
+        self->stationDatabase = NULL;
+        self->getNextInterrogationASDUHandler = NULL;
+        self->asyncCommandHandler = NULL;
+        self->commands = LinkedList_create();
+        self->numberOfCommands = 0;
+#if (CONFIG_USE_THREADS == 1)
+        self->numberOfCommandWorkers = 0;
+        self->commandWorkers = NULL;
+        self->commandWorkersRunning = false;
+#endif
+        self->clockSyncHandler = NULL;
+        self->resetProcessHandler = NULL;
+        self->delayAcquisitionHandler = NULL;
+        self->connectionRequestHandler = NULL;
+        self->connectionEventHandler = NULL;
+        self->rawMessageHandler = NULL;
+        self->maxLowPrioQueueSize = maxLowPrioQueueSize;
+        self->maxHighPrioQueueSize = maxHighPrioQueueSize;
+        self->maxTxBatchSize = CONFIG_CS104_DEFAULT_TX_BATCH_SIZE;
+        self->ingressQueueSize = CONFIG_CS104_DEFAULT_INGRESS_QUEUE_SIZE;
+        self->eventQueueMemorySize = 0;
+        self->overflowPolicy = CS104_QUEUE_OVERFLOW_DROP_OLDEST;
+        self->overflowBlockTimeout = 0;
+        memset(self->coalescedTypes, 0, sizeof(self->coalescedTypes));
+        self->hasCoalescedTypes = false;
+        self->coalescingCapacity = 0;
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+        self->ingressQueue = NULL;
 #endif
 
-                if (isSentBufferFull(self) == false)
-                {
-                    bufferFrame = BufferFrame_initialize(&_bufferFrame, buffer, 0, 256);
+#if (CONFIG_USE_THREADS == 1)
+        self->serverHandleSet = NULL;
+        self->isIngressDrainerRunning = false;
+#endif
 
-                    Frame asdu = SecureEndpoint_getNextWaitingAsdu(secureEndpoint, bufferFrame);
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+        self->eventQueueFile = NULL;
+        self->eventQueueSyncOnWrite = false;
+#endif
 
-                    if (asdu)
-                    {
-                        int msgSize = Frame_getMsgSize(asdu);
+        /* the connection objects are created when required */
+        self->masterConnections = NULL;
+        self->numberOfConnectionObjects = 0;
+        self->connectionTableSize = 0;
+        self->activeConnections = NULL;
+        self->numberOfActiveConnections = 0;
+        self->freeConnections = NULL;
 
-                        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, Frame_getBuffer(asdu), msgSize);
+        self->maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->openConnectionsLock = Semaphore_create(1);
+        self->stateLock = Semaphore_create(1);
+        self->metricsLock = Semaphore_create(1);
+        self->commandsLock = Semaphore_create(1);
+#endif
 
-                        msgSize += IEC60870_5_104_APCI_LENGTH;
+#if (CONFIG_USE_THREADS == 1)
+        self->isThreadlessMode = false;
 
-                        sendASDU(self, self->sendBuffer, msgSize, 0, NULL); 
-                    }
-                    else
-                    {
-                        trySend = false;
-                    }
-                }
-                else
-                {
-                    trySend = false;
-                    sentBufferFull = true;
-                }
+        self->threadingModel = CS104_THREADING_MODEL_THREAD_PER_CONNECTION;
+        self->numberOfWorkers = CONFIG_CS104_EVENT_LOOP_DEFAULT_WORKERS;
+        self->acceptSharding = false;
+        self->isAcceptShardingActive = false;
+        self->workers = NULL;
+#endif
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_post(self->sentASDUsLock);
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+        self->handshakeThreads = NULL;
+        self->handshakeQueue = NULL;
+        self->handshakeThreadsRunning = false;
 #endif
 
-                if (sentBufferFull)
-                    return true;     
-            }
-        }
+        self->isRunning = false;
+        self->stopRunning = false;
 
-        /* check if M_EI_NA_1 is waiting and send when waiting */
-        TypeID typeId = (TypeID)0;
-        if (MessageQueue_isAsduAvailable(self->lowPrioQueue, &typeId) && (typeId == M_EI_NA_1))
-        {
-            sendNextLowPriorityASDU(self);
-        }
+        self->localAddress = NULL;
+        self->tcpPort = CS104_DEFAULT_PORT;
+        self->openConnections = 0;
 
-        if (SecureEndpoint_sessionReady(secureEndpoint) == false)
-        {
-            return false;
-        }
+#if (CONFIG_USE_THREADS == 1)
+        self->listeningThread = NULL;
+#endif
 
-        if (SecureEndpoint_isChallengeInitialized(secureEndpoint) == false)
-        {
-            return false;
-        }
-    }
+        self->serverSocket = NULL;
 
-#endif /* SEC_AUTH_60870_5_7 */
+        self->threadlessHandleSet = NULL;
+        self->threadlessHandleSetChanged = true;
+        TimerWheel_init(&(self->threadlessTimers), 0);
+        self->threadlessWakeupRequested = false;
+        self->threadlessAsduWaiting = false;
 
-    /* send all available high priority ASDUs first */
-    if (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue))
-    {
-        if (sendNextHighPriorityASDU(self) == false)
-            return true;
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+        self->replicationPort = 0;
+        self->replication = NULL;
+        self->standby = NULL;
+#endif
 
-        if (MasterConnection_isRunning(self) == false)
-            return true;
+        self->plugins = NULL;
 
-        if (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue) ||  MessageQueue_isAsduAvailable(self->lowPrioQueue, NULL))
-            return true;
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        self->tlsConfig = NULL;
+#endif
 
-        return false;
-    }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+        self->redundancyGroups = NULL;
+        self->clientAddressIndex = NULL;
+#endif
 
-    /* send messages from low-priority queue */
-    if (MessageQueue_isAsduAvailable(self->lowPrioQueue, NULL))
-        sendNextLowPriorityASDU(self);
+#if ((CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) || (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1))
+        self->sharedEventLog = NULL;
+#endif
 
-    if (MessageQueue_isAsduAvailable(self->lowPrioQueue, NULL))
-    {
-        return true;
-    }
-    else
-    {
-        return false;
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+        self->serverMode = CS104_MODE_SINGLE_REDUNDANCY_GROUP;
+#else
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+        self->serverMode = CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP;
+#endif
+#endif
     }
+
+    return self;
 }
 
-static bool
-handleTimeouts(MasterConnection self)
+CS104_Slave
+CS104_Slave_create(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
 {
-    uint64_t currentTime = Hal_getMonotonicTimeInMs();
+    return createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
+}
 
-    bool timeoutsOk = true;
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+CS104_Slave
+CS104_Slave_createSecure(int maxLowPrioQueueSize, int maxHighPrioQueueSize, TLSConfiguration tlsConfig)
+{
+    CS104_Slave self = createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
 
-    /* check T3 timeout */
-    if (checkT3Timeout(self, currentTime))
+    if (self)
     {
-        int writeToSocketResult = writeToSocket(self, TESTFR_ACT_MSG, TESTFR_ACT_MSG_SIZE);
-
-        if (writeToSocketResult < 0)
-        {
-            DEBUG_PRINT("CS104 SLAVE: Failed to write TESTFR ACT message\n");
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
-#endif
-            self->isRunning = false;
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
-#endif
-        }
-        else if (writeToSocketResult > 0)
-        {
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
-#endif
-            self->waitingForTestFRcon = true;
-            resetTestFRConTimeout(self, currentTime);
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
-#endif
-        }
+        self->tcpPort = 19998;
+        self->tlsConfig = tlsConfig;
     }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif
+    return self;
+}
+#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
 
-    /* Check for TEST FR con timeout */
-    if (self->waitingForTestFRcon && checkTestFRConTimeout(self, currentTime))
-    {
-        DEBUG_PRINT("CS104 SLAVE: Timeout for TESTFR CON message\n");
+#ifdef SEC_AUTH_60870_5_7
+void
+CS104_Slave_setSecureEndpoint(CS104_Slave self, SecureEndpoint secureEndpoint)
+{
+    self->secureEndpoint = secureEndpoint;
 
-        /* close connection */
-        timeoutsOk = false;
-    }
+    SecureEndpoint_addForwardASDUFunctionForSlave(secureEndpoint, (CS101_PluginForwardAsduFunc)CS104_Slave_forwardASDU, self);
+}
+#endif /* SEC_AUTH_60870_5_7 */
 
-    /* check timeout for others station I messages */
-    if (self->unconfirmedReceivedIMessages > 0)
-    {
-        /* Check validity of last confirmation time */
-        if (self->lastConfirmationTime != UINT64_MAX && self->lastConfirmationTime > currentTime)
-        {
-            /* last confirmation time is in the future (maybe caused by system time change) */
-            self->lastConfirmationTime = currentTime;
-        }
+void
+CS104_Slave_addPlugin(CS104_Slave self, CS101_SlavePlugin plugin)
+{
+    if (self->plugins == NULL)
+        self->plugins = LinkedList_create();
 
-        if (currentTime > self->lastConfirmationTime)
-        {
-            if ((currentTime - self->lastConfirmationTime) >= (uint64_t)(self->slave->conParameters.t2 * 1000))
-            {
-                self->lastConfirmationTime = currentTime;
-                self->unconfirmedReceivedIMessages = 0;
-                self->timeoutT2Triggered = false;
-                _sendSMessage(self);
-            }
-        }
-    }
+    if (self->plugins)
+        LinkedList_add(self->plugins, plugin);
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif
+void
+CS104_Slave_setServerMode(CS104_Slave self, CS104_ServerMode serverMode)
+{
+    self->serverMode = serverMode;
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
-#endif
+void
+CS104_Slave_setMaxTxBatchSize(CS104_Slave self, int maxBatchSize)
+{
+    if (maxBatchSize < 256)
+        maxBatchSize = 0;
 
-    /* check if counterpart confirmed I message */
-    if (self->oldestSentASDU != -1)
-    {
-        /* check validity of sent time */
+    self->maxTxBatchSize = maxBatchSize;
+}
 
-        if (self->sentASDUs[self->oldestSentASDU].sentTime > currentTime)
-        {
-            /* sent time is in the future (maybe caused by system time change) */
-            self->sentASDUs[self->oldestSentASDU].sentTime = currentTime;
-        }
+void
+CS104_Slave_setIngressQueueSize(CS104_Slave self, int size)
+{
+    if (size < 0)
+        size = 0;
 
-        if (currentTime > self->sentASDUs[self->oldestSentASDU].sentTime)
-        {
+#if (CS104_SLAVE_HAS_ATOMICS == 0)
+    if (size > 0)
+        DEBUG_PRINT("CS104 SLAVE: ingress queue not supported (no atomic operations)\n");
+#endif
 
-            if ((currentTime - self->sentASDUs[self->oldestSentASDU].sentTime) >=
-                (uint64_t)(self->slave->conParameters.t1 * 1000))
-            {
-                timeoutsOk = false;
+    self->ingressQueueSize = size;
+}
 
-                printSendBuffer(self);
+void
+CS104_Slave_setEventQueueMemorySize(CS104_Slave self, int size)
+{
+    if (size < 0)
+        size = 0;
 
-                DEBUG_PRINT("CS104 SLAVE: I message timeout for %i seqNo: %i\n", self->oldestSentASDU,
-                            self->sentASDUs[self->oldestSentASDU].seqNo);
-            }
-        }
-    }
+    self->eventQueueMemorySize = size;
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
-#endif
+void
+CS104_Slave_setQueueOverflowPolicy(CS104_Slave self, CS104_QueueOverflowPolicy policy, int blockTimeoutInMs)
+{
+    if (blockTimeoutInMs < 0)
+        blockTimeoutInMs = 0;
 
-    return timeoutsOk;
+    self->overflowPolicy = policy;
+    self->overflowBlockTimeout = blockTimeoutInMs;
 }
 
-static void
-CS104_Slave_closeAllConnections(CS104_Slave self)
+void
+CS104_Slave_setLatestValueCoalescing(CS104_Slave self, IEC60870_5_TypeID typeId, bool enable)
 {
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    uint8_t typeValue = (uint8_t)typeId;
+
+    if (enable)
+        self->coalescedTypes[typeValue / 8] |= (uint8_t)(1 << (typeValue % 8));
+    else
+        self->coalescedTypes[typeValue / 8] &= (uint8_t)~(1 << (typeValue % 8));
+
+    self->hasCoalescedTypes = false;
 
     int i;
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
+    for (i = 0; i < (int)sizeof(self->coalescedTypes); i++)
     {
-        if (self->masterConnections[i])
-        {
-            if (self->masterConnections[i]->isUsed)
-            {
-                self->masterConnections[i]->isUsed = false;
-                MasterConnection_deinit(self->masterConnections[i]);
-            }
-        }
+        if (self->coalescedTypes[i])
+            self->hasCoalescedTypes = true;
     }
-
-    self->openConnections = 0;
-
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_post(self->openConnectionsLock);
-#endif
 }
 
-static void*
-connectionHandlingThread(void* parameter)
+void
+CS104_Slave_setCoalescingCapacity(CS104_Slave self, int numberOfDataPoints)
 {
-    MasterConnection self = (MasterConnection)parameter;
-
-    resetT3Timeout(self, Hal_getMonotonicTimeInMs());
+    if (numberOfDataPoints < 0)
+        numberOfDataPoints = 0;
 
-    bool isAsduWaiting = false;
+    self->coalescingCapacity = numberOfDataPoints;
+}
 
-    if (self->slave->connectionEventHandler)
+void
+CS104_Slave_setEventQueueFile(CS104_Slave self, const char* filename, bool syncOnWrite)
+{
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    if (self->eventQueueFile)
     {
-        self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection),
-                                            CS104_CON_EVENT_CONNECTION_OPENED);
+        GLOBAL_FREEMEM(self->eventQueueFile);
+        self->eventQueueFile = NULL;
     }
 
-#ifdef SEC_AUTH_60870_5_7
-
-    if (self->slave->secureEndpoint)
+    if (filename)
     {
-        SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+        self->eventQueueFile = (char*)GLOBAL_MALLOC(strlen(filename) + 1);
+
+        if (self->eventQueueFile)
+            strcpy(self->eventQueueFile, filename);
     }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
-    {
-        SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
-    }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
-
-#endif /* SEC_AUTH_60870_5_7 */
-
-    while (MasterConnection_isRunning(self))
-    {
-        Handleset_reset(self->handleSet);
-        Handleset_addSocket(self->handleSet, self->socket);
-
-        int socketTimeout;
-
-        /*
-         * When an ASDU is waiting only have a short look to see if a client request
-         * was received. Otherwise wait to save CPU time.
-         */
-        if (isAsduWaiting)
-            socketTimeout = 0;
-        else
-            socketTimeout = 100;
+    self->eventQueueSyncOnWrite = syncOnWrite;
+#else
+    (void)self;
+    (void)filename;
+    (void)syncOnWrite;
 
-        if (Handleset_waitReady(self->handleSet, socketTimeout))
-        {
-            int bytesRec = receiveMessage(self);
+    DEBUG_PRINT("CS104 SLAVE: persistent event queue not supported\n");
+#endif
+}
 
-            if (bytesRec == -1)
-            {
-                DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
-                break;
-            }
+void
+CS104_Slave_setReplicationPort(CS104_Slave self, int port)
+{
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    self->replicationPort = port;
+#else
+    (void)self;
+    (void)port;
 
-            if (bytesRec > 0)
-            {
-                DEBUG_PRINT("CS104 SLAVE: Connection(%p): rcvd msg(%i bytes)\n", self, bytesRec);
+    DEBUG_PRINT("CS104 SLAVE: event queue replication not supported\n");
+#endif
+}
 
-                if (self->slave->rawMessageHandler)
-                    self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter, &(self->iMasterConnection),
-                                                   self->recvBuffer, bytesRec, false);
+void
+CS104_Slave_setThreadingModel(CS104_Slave self, CS104_ThreadingModel threadingModel, int numberOfWorkers)
+{
+#if (CONFIG_USE_THREADS == 1)
+    self->threadingModel = threadingModel;
 
-                if (handleMessage(self, self->recvBuffer, bytesRec) == false)
-                {
-#if (CONFIG_USE_SEMAPHORES == 1)
-                    Semaphore_wait(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-                    self->isRunning = false;
+    if (numberOfWorkers < 1)
+        numberOfWorkers = CONFIG_CS104_EVENT_LOOP_DEFAULT_WORKERS;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                    Semaphore_post(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-                }
+    self->numberOfWorkers = numberOfWorkers;
+#else
+    (void)self;
+    (void)threadingModel;
+    (void)numberOfWorkers;
+#endif
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_wait(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+void
+CS104_Slave_setAcceptSharding(CS104_Slave self, bool enable)
+{
+#if (CONFIG_USE_THREADS == 1)
+    self->acceptSharding = enable;
+#else
+    (void)self;
+    (void)enable;
+#endif
+}
 
-                if (self->unconfirmedReceivedIMessages >= self->slave->conParameters.w)
-                {
-                    self->lastConfirmationTime = Hal_getMonotonicTimeInMs();
+void
+CS104_Slave_setLocalAddress(CS104_Slave self, const char* ipAddress)
+{
+    if (self->localAddress)
+        GLOBAL_FREEMEM(self->localAddress);
 
-                    self->unconfirmedReceivedIMessages = 0;
+    self->localAddress = (char*)GLOBAL_MALLOC(strlen(ipAddress) + 1);
 
-                    self->timeoutT2Triggered = false;
+    if (self->localAddress)
+        strcpy(self->localAddress, ipAddress);
+}
 
-                    _sendSMessage(self);
-                }
+void
+CS104_Slave_setLocalPort(CS104_Slave self, int tcpPort)
+{
+    self->tcpPort = tcpPort;
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_post(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-            }
-        }
+int
+CS104_Slave_getOpenConnections(CS104_Slave self)
+{
+    int openConnections;
 
-        if (handleTimeouts(self) == false)
-        {
 #if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_wait(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+    Semaphore_wait(self->openConnectionsLock);
+#endif
 
-            self->isRunning = false;
+    openConnections = self->openConnections;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-        }
+    Semaphore_post(self->openConnectionsLock);
+#endif
 
-        if (MasterConnection_isRunning(self))
-        {
-            if (MasterConnection_isActive(self))
-            {
-                isAsduWaiting = sendWaitingASDUs(self);
-            }
-        }
+    return openConnections;
+}
 
-#ifdef SEC_AUTH_60870_5_7
-        if (self->slave->secureEndpoint)
-        {
-            if (SecureEndpoint_runTask(self->slave->secureEndpoint, &(self->iMasterConnection)) == false)
-            {
-                MasterConnection_close(self);
-            }
-        }
+/* add a new connection object to the connection table (caller has to hold the openConnectionsLock) */
+static MasterConnection
+CS104_Slave_createConnectionObject(CS104_Slave self)
+{
+    if (self->numberOfConnectionObjects == self->connectionTableSize)
+    {
+        int newSize = (self->connectionTableSize > 0) ? (self->connectionTableSize * 2) : 8;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
-        {
-            if (SecureEndpoint_runTask(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection)) == false)
-            {
-                MasterConnection_close(self);
-            }
-        }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+        MasterConnection* connections =
+            (MasterConnection*)GLOBAL_REALLOC(self->masterConnections, newSize * sizeof(MasterConnection));
 
-#endif /* SEC_AUTH_60870_5_7 */
+        if (connections == NULL)
+            return NULL;
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        if (self->tlsSocket != NULL)
-        {
-            if (TLSSocket_tick(self->tlsSocket) == false)
-            {
-                MasterConnection_close(self);
-            }
-        }
-#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+        self->masterConnections = connections;
 
-        /* call plugins */
-        if (self->slave->plugins)
-        {
-            LinkedList pluginElem = LinkedList_getNext(self->slave->plugins);
+        MasterConnection* activeConnections =
+            (MasterConnection*)GLOBAL_REALLOC(self->activeConnections, newSize * sizeof(MasterConnection));
 
-            while (pluginElem)
-            {
-                CS101_SlavePlugin plugin = (CS101_SlavePlugin)LinkedList_getData(pluginElem);
+        if (activeConnections == NULL)
+            return NULL;
 
-                if (plugin->runTask)
-                {
-                    plugin->runTask(plugin->parameter, &(self->iMasterConnection));
-                }
+        self->activeConnections = activeConnections;
 
-                pluginElem = LinkedList_getNext(pluginElem);
-            }
-        }
+        self->connectionTableSize = newSize;
     }
 
-    if (self->slave->connectionEventHandler)
+    MasterConnection connection = MasterConnection_create(self);
+
+    if (connection)
     {
-        self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection),
-                                            CS104_CON_EVENT_CONNECTION_CLOSED);
-    }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+        /* the queues of the existing connections are created when the slave is started */
+        if ((self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) && self->sharedEventLog)
+        {
+            char queueKey[MESSAGE_QUEUE_KEY_SIZE];
 
-#ifdef SEC_AUTH_60870_5_7
+            snprintf(queueKey, sizeof(queueKey), "connection#%i", self->numberOfConnectionObjects);
 
-    if (self->slave->secureEndpoint)
-    {
-        SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
-    }
+            connection->lowPrioQueue = MessageQueue_createWithLog(self->sharedEventLog, queueKey);
+            connection->highPrioQueue = HighPriorityASDUQueue_create(self->maxHighPrioQueueSize);
+        }
+#endif
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
-    {
-        SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+        self->masterConnections[self->numberOfConnectionObjects++] = connection;
     }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
 
-#endif /* SEC_AUTH_60870_5_7 */
+    return connection;
+}
+
+#if (CONFIG_USE_THREADS == 1)
+/* the connection object is still used by the async command handler (after the connection was closed) */
+static bool
+isConnectionPinned(CS104_Slave self, MasterConnection connection)
+{
+    bool isPinned;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+    Semaphore_wait(self->commandsLock);
+#endif
 
-    self->isRunning = false;
+    isPinned = (connection->runningCommandHandlers > 0);
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-
-    if (!self->requeuedOnActivate)
-        MessageQueue_setWaitingForTransmissionWhenNotConfirmed(self->lowPrioQueue);
+    Semaphore_post(self->commandsLock);
+#endif
 
-    return NULL;
+    return isPinned;
 }
+#endif /* (CONFIG_USE_THREADS == 1) */
 
-/********************************************
- * IMasterConnection
- *******************************************/
-
-static bool
-_IMasterConnection_isReady(IMasterConnection self)
+/* get an unused connection object and add it to the active connections (caller has to hold the openConnectionsLock) */
+static MasterConnection
+getFreeConnection(CS104_Slave self)
 {
-    MasterConnection con = (MasterConnection)self->object;
+    MasterConnection* freeConnection = &(self->freeConnections);
 
-    if (MasterConnection_isActive(con))
+#if (CONFIG_USE_THREADS == 1)
+    /* a connection object is not reused while a command handler of the closed connection is running */
+    while (*freeConnection && isConnectionPinned(self, *freeConnection))
+        freeConnection = &((*freeConnection)->nextFreeConnection);
+#endif
+
+    MasterConnection connection = *freeConnection;
+
+    if (connection)
+        *freeConnection = connection->nextFreeConnection;
+    else
+        connection = CS104_Slave_createConnectionObject(self);
+
+    if (connection)
     {
-        if (isSentBufferFull(con) == false)
-            return true;
+        connection->nextFreeConnection = NULL;
 
-        if (HighPriorityASDUQueue_isFull(con->highPrioQueue))
-            return false;
+#if (CONFIG_USE_SEMAPHORES)
+        Semaphore_wait(connection->stateLock);
+#endif
 
-        return true;
+        connection->isUsed = true;
+
+#if (CONFIG_USE_SEMAPHORES)
+        Semaphore_post(connection->stateLock);
+#endif
+
+        connection->activeIndex = self->numberOfActiveConnections;
+        self->activeConnections[self->numberOfActiveConnections++] = connection;
     }
-    else
-        return false;
+
+    return connection;
 }
 
-static bool
-_IMasterConnection_sendASDU(IMasterConnection self, CS101_ASDU asdu)
+/*
+ * Remove the connection from the active connections and add it to the free connection objects
+ * (caller has to hold the openConnectionsLock). The last active connection is moved to the position
+ * of the released connection, so loops that release connections have to iterate backwards.
+ */
+static void
+releaseConnection(CS104_Slave self, MasterConnection connection)
 {
-    MasterConnection con = (MasterConnection)self->object;
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_wait(connection->stateLock);
+#endif
 
-    return HighPriorityASDUQueue_enqueue(con->highPrioQueue, asdu);
-}
+    connection->isUsed = false;
 
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_post(connection->stateLock);
+#endif
 
-static bool
-_IMasterConnection_sendASDUEx(IMasterConnection self, CS101_ASDU asdu, bool bypassQueue)
-{
-    if (bypassQueue)
+    int index = connection->activeIndex;
+
+    if (index != -1)
     {
-        MasterConnection con = (MasterConnection)self->object;
+        MasterConnection last = self->activeConnections[--self->numberOfActiveConnections];
 
-        if (MessageQueue_isAsduAvailable(con->lowPrioQueue, NULL) || HighPriorityASDUQueue_isAsduAvailable(con->highPrioQueue))
-            return false;
+        self->activeConnections[index] = last;
+        last->activeIndex = index;
 
-        return sendASDUInternal(con, asdu, true);
+        connection->activeIndex = -1;
+
+        connection->nextFreeConnection = self->freeConnections;
+        self->freeConnections = connection;
     }
-    else
-        return _IMasterConnection_sendASDU(self, asdu);
 }
 
-static bool
-_IMasterConnection_sendACT_CON(IMasterConnection self, CS101_ASDU asdu, bool negative)
+void
+CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections)
 {
-    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-    CS101_ASDU_setNegative(asdu, negative);
-
-    return _IMasterConnection_sendASDU(self, asdu);
+    self->maxOpenConnections = maxOpenConnections;
 }
 
-static bool
-_IMasterConnection_sendACT_TERM(IMasterConnection self, CS101_ASDU asdu)
+void
+CS104_Slave_setConnectionRequestHandler(CS104_Slave self, CS104_ConnectionRequestHandler handler, void* parameter)
 {
-    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_TERMINATION);
-    CS101_ASDU_setNegative(asdu, false);
-
-    return _IMasterConnection_sendASDU(self, asdu);
+    self->connectionRequestHandler = handler;
+    self->connectionRequestHandlerParameter = parameter;
 }
 
-static void
-_IMasterConnection_close(IMasterConnection self)
+void
+CS104_Slave_setConnectionEventHandler(CS104_Slave self, CS104_ConnectionEventHandler handler, void* parameter)
 {
-    MasterConnection con = (MasterConnection)self->object;
-
-    MasterConnection_close(con);
+    self->connectionEventHandler = handler;
+    self->connectionEventHandlerParameter = parameter;
 }
 
-static int
-_IMasterConnection_getPeerAddress(IMasterConnection self, char* addrBuf, int addrBufSize)
+void
+CS104_Slave_setAllowedCAHandler(CS104_Slave self, CS101_IsCAAllowedHandler handler, void* parameter)
 {
-    MasterConnection con = (MasterConnection)self->object;
-
-    char buf[54];
+    self->isCAAllowedHandler = handler;
+    self->isCAAllowedHandlerParameter = parameter;
+}
 
-    if (con->socket == NULL)
+/**
+ * Activate connection and deactivate existing active connections if required
+ */
+static void
+CS104_Slave_activate(CS104_Slave self, MasterConnection connectionToActivate)
+{
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
     {
-        return 0;
-    }
+        /* Close the active connection */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
+        int i;
 
-    const char* addrStr = Socket_getPeerAddressStatic(con->socket, buf);
+        for (i = 0; i < self->numberOfActiveConnections; i++)
+        {
+            MasterConnection con = self->activeConnections[i];
 
-    if (addrStr == NULL)
-        return 0;
+            if (con && con->isUsed)
+            {
+                if (con != connectionToActivate)
+                {
+                    if (MasterConnection_isActive(con))
+                    {
+                        MasterConnection_close(con);
+                        MessageQueue_setWaitingForTransmissionWhenNotConfirmed(con->lowPrioQueue);
+                        con->requeuedOnActivate = 1;
+                    }
+                }
+            }
+        }
 
-    int len = (int)strnlen(buf, sizeof(buf));
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
+    }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-    if (len < addrBufSize)
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
     {
-        memcpy(addrBuf, buf, len);
-        addrBuf[len] = 0;
-        return len;
+
+        /* Deactivate all other connections of the same redundancy group */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
+
+        int i;
+
+        for (i = 0; i < self->numberOfActiveConnections; i++)
+        {
+            MasterConnection con = self->activeConnections[i];
+
+            if (con && con->isUsed)
+            {
+                if (con->redundancyGroup == connectionToActivate->redundancyGroup)
+                {
+                    if (con != connectionToActivate)
+                    {
+                        if (MasterConnection_isActive(con))
+                        {
+                            MasterConnection_close(con);
+                            MessageQueue_setWaitingForTransmissionWhenNotConfirmed(con->lowPrioQueue);
+                            con->requeuedOnActivate = 1;
+                        }
+                    }
+                }
+            }
+        }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
     }
-    else
-        return 0;
+
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+
+    MasterConnection_activate(connectionToActivate);
 }
 
-static CS101_AppLayerParameters
-_IMasterConnection_getApplicationLayerParameters(IMasterConnection self)
+void
+CS104_Slave_setInterrogationHandler(CS104_Slave self, CS101_InterrogationHandler handler, void* parameter)
 {
-    MasterConnection con = (MasterConnection)self->object;
+    self->interrogationHandler = handler;
+    self->interrogationHandlerParameter = parameter;
+}
 
-    return &(con->slave->alParameters);
+void
+CS104_Slave_setCounterInterrogationHandler(CS104_Slave self, CS101_CounterInterrogationHandler handler, void* parameter)
+{
+    self->counterInterrogationHandler = handler;
+    self->counterInterrogationHandlerParameter = parameter;
 }
 
-/********************************************
- * END IMasterConnection
- *******************************************/
+void
+CS104_Slave_setReadHandler(CS104_Slave self, CS101_ReadHandler handler, void* parameter)
+{
+    self->readHandler = handler;
+    self->readHandlerParameter = parameter;
+}
 
-static MasterConnection
-MasterConnection_create(CS104_Slave slave)
+static bool
+CS104_Slave_stationDatabaseEventHandler(void* parameter, CS101_ASDU asdu)
 {
-    MasterConnection self = (MasterConnection)GLOBAL_CALLOC(1, sizeof(struct sMasterConnection));
+    return CS104_Slave_enqueueASDU((CS104_Slave)parameter, asdu);
+}
 
-    if (self)
-    {
-        self->state = M_CON_STATE_STOPPED;
-        self->isUsed = false;
-        self->slave = slave;
-        self->maxSentASDUs = 0;
-        self->sentASDUs = NULL;
-        self->iMasterConnection.object = self;
-        self->iMasterConnection.getApplicationLayerParameters = _IMasterConnection_getApplicationLayerParameters;
-        self->iMasterConnection.isReady = _IMasterConnection_isReady;
-        self->iMasterConnection.sendASDU = _IMasterConnection_sendASDU;
-        self->iMasterConnection.sendASDUEx = _IMasterConnection_sendASDUEx;
-        self->iMasterConnection.sendACT_CON = _IMasterConnection_sendACT_CON;
-        self->iMasterConnection.sendACT_TERM = _IMasterConnection_sendACT_TERM;
-        self->iMasterConnection.close = _IMasterConnection_close;
-        self->iMasterConnection.getPeerAddress = _IMasterConnection_getPeerAddress;
+void
+CS104_Slave_setStationDatabase(CS104_Slave self, CS101_StationDatabase db)
+{
+    if (self->stationDatabase)
+        CS101_StationDatabase_setEventHandler(self->stationDatabase, NULL, NULL);
+
+    self->stationDatabase = db;
+
+    if (db)
+        CS101_StationDatabase_setEventHandler(db, CS104_Slave_stationDatabaseEventHandler, self);
+}
+
+void
+CS104_Slave_setGetNextInterrogationASDUHandler(CS104_Slave self, CS101_GetNextInterrogationASDUHandler handler,
+                                               void* parameter)
+{
+    self->getNextInterrogationASDUHandler = handler;
+    self->getNextInterrogationASDUHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setAsyncCommandHandler(CS104_Slave self, CS104_AsyncCommandHandler handler, void* parameter,
+                                   int numberOfThreads)
+{
+    self->asyncCommandHandler = handler;
+    self->asyncCommandHandlerParameter = parameter;
 
 #if (CONFIG_USE_THREADS == 1)
-        self->connectionThread = NULL;
+    if (numberOfThreads < 0)
+        numberOfThreads = 0;
+
+    self->numberOfCommandWorkers = numberOfThreads;
+#else
+    (void)numberOfThreads;
 #endif
+}
+
+void
+CS104_Slave_setASDUHandler(CS104_Slave self, CS101_ASDUHandler handler, void* parameter)
+{
+    self->asduHandler = handler;
+    self->asduHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setClockSyncHandler(CS104_Slave self, CS101_ClockSynchronizationHandler handler, void* parameter)
+{
+    self->clockSyncHandler = handler;
+    self->clockSyncHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setResetProcessHandler(CS104_Slave self, CS101_ResetProcessHandler handler, void* parameter)
+{
+    self->resetProcessHandler = handler;
+    self->resetProcessHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setDelayAcquisitionHandler(CS104_Slave self, CS101_DelayAcquisitionHandler handler, void* parameter)
+{
+    self->delayAcquisitionHandler = handler;
+    self->delayAcquisitionHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setRawMessageHandler(CS104_Slave self, CS104_SlaveRawMessageHandler handler, void* parameter)
+{
+    self->rawMessageHandler = handler;
+    self->rawMessageHandlerParameter = parameter;
+}
+
+CS104_APCIParameters
+CS104_Slave_getConnectionParameters(CS104_Slave self)
+{
+    return &(self->conParameters);
+}
+
+CS101_AppLayerParameters
+CS104_Slave_getAppLayerParameters(CS104_Slave self)
+{
+    return &(self->alParameters);
+}
+
+/********************************************************
+ * MasterConnection
+ *********************************************************/
+
+static void
+printSendBuffer(MasterConnection self)
+{
+    if (self->oldestSentASDU != -1)
+    {
+        int currentIndex = self->oldestSentASDU;
+
+        int nextIndex = 0;
+
+        DEBUG_PRINT("CS104 SLAVE: ------k-buffer------\n");
+
+        do
+        {
+            DEBUG_PRINT("CS104 SLAVE: %02i : SeqNo=%i time=%llu : queueEntry=%p\n", currentIndex,
+                        self->sentASDUs[currentIndex].seqNo, self->sentASDUs[currentIndex].sentTime,
+                        self->sentASDUs[currentIndex].queueEntry);
+
+            if (currentIndex == self->newestSentASDU)
+                nextIndex = -1;
+            else
+                currentIndex = (currentIndex + 1) % self->maxSentASDUs;
+
+        } while (nextIndex != -1);
+
+        DEBUG_PRINT("CS104 SLAVE: --------------------\n");
+    }
+    else
+        DEBUG_PRINT("CS104 SLAVE: k-buffer is empty\n");
+}
+
+/**
+ * Add to a counter of the connection metrics. With 64 bit atomics the counters are updated
+ * without lock (relaxed), otherwise they are protected by the metricsLock.
+ */
+static void
+MasterConnection_addToCounter(MasterConnection self, uint64_t* counter, uint64_t value)
+{
+#if (CS104_SLAVE_HAS_ATOMICS64 == 1)
+    (void)self;
+
+    atomicAdd64((volatile uint64_t*)counter, value);
+#else
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-        self->sentASDUsLock = Semaphore_create(1);
-        self->stateLock = Semaphore_create(1);
+    Semaphore_wait(self->metricsLock);
 #endif
-        self->handleSet = Handleset_new();
 
-        /* initialize pointers with NULL to avoid segmentation fault on destroy call */
-        self->socket = NULL;
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        self->tlsSocket = NULL;
+    *counter += value;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->metricsLock);
 #endif
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        self->redundancyGroup = NULL;
-#endif
-        self->lowPrioQueue = NULL;
-        self->highPrioQueue = NULL;
+#endif /* (CS104_SLAVE_HAS_ATOMICS64 == 1) */
+}
+
+static void
+MasterConnection_incrementCounter(MasterConnection self, uint64_t* counter)
+{
+    MasterConnection_addToCounter(self, counter, 1);
+}
+
+/* count a sent or received APDU (I, S or U frame) */
+static void
+MasterConnection_countFrame(MasterConnection self, const uint8_t* msg, int msgSize, bool sent)
+{
+    uint64_t* frames;
+
+    if ((msg[2] & 1) == 0)
+        frames = sent ? &(self->metrics.iFramesSent) : &(self->metrics.iFramesReceived);
+    else if ((msg[2] & 3) == 1)
+        frames = sent ? &(self->metrics.sFramesSent) : &(self->metrics.sFramesReceived);
+    else
+        frames = sent ? &(self->metrics.uFramesSent) : &(self->metrics.uFramesReceived);
+
+    MasterConnection_addToCounter(self, frames, 1);
+
+    if (sent)
+        MasterConnection_addToCounter(self, &(self->metrics.bytesSent), (uint64_t)msgSize);
+    else
+        MasterConnection_addToCounter(self, &(self->metrics.bytesReceived), (uint64_t)msgSize);
+}
+
+/**
+ * \return number of bytes read, or -1 in case of an error
+ */
+static int
+readFromSocket(MasterConnection self, uint8_t* buffer, int size)
+{
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket != NULL)
+        return TLSSocket_read(self->tlsSocket, buffer, size);
+    else
+        return Socket_read(self->socket, buffer, size);
+#else
+    return Socket_read(self->socket, buffer, size);
+#endif
+}
+
+/**
+ * \brief Get the size of the first complete message in the receive buffer
+ *
+ * \return -1 in case of a framing error, 0 when no complete message is in the buffer, otherwise the message size
+ */
+static int
+getBufferedMessageSize(MasterConnection self)
+{
+    int available = self->rxBufferEnd - self->rxBufferStart;
+
+    if (available < 1)
+        return 0;
+
+    uint8_t* msg = self->rxBuffer + self->rxBufferStart;
+
+    if (msg[0] != 0x68)
+        return -1; /* message error */
+
+    if (available < 2)
+        return 0;
+
+    int msgSize = msg[1] + 2;
+
+    if (available < msgSize)
+        return 0;
+
+    return msgSize;
+}
+
+/**
+ * \brief Get the next message from the receive buffer. Read all available data from the socket
+ * when no complete message is in the buffer.
+ *
+ * The message is available in recvBuffer until the next call of this function.
+ *
+ * \param readSocket when false only messages already in the receive buffer are returned
+ *
+ * \return -1 in case of an error, 0 when no complete message can be read, > 0 when a complete message is in buffer
+ */
+static int
+receiveMessage(MasterConnection self, bool readSocket)
+{
+    int msgSize = getBufferedMessageSize(self);
+
+    if ((msgSize == 0) && readSocket)
+    {
+        /* move incomplete message to beginning of buffer */
+        if (self->rxBufferStart > 0)
+        {
+            int available = self->rxBufferEnd - self->rxBufferStart;
+
+            if (available > 0)
+                memmove(self->rxBuffer, self->rxBuffer + self->rxBufferStart, available);
+
+            self->rxBufferStart = 0;
+            self->rxBufferEnd = available;
+        }
+
+        int readCnt = readFromSocket(self, self->rxBuffer + self->rxBufferEnd,
+                                     CONFIG_CS104_RX_BUFFER_SIZE - self->rxBufferEnd);
+
+        if (readCnt < 0)
+            msgSize = -1;
+        else
+        {
+            self->rxBufferEnd += readCnt;
+
+            msgSize = getBufferedMessageSize(self);
+        }
+    }
+
+    if (msgSize > 0)
+    {
+        self->recvBuffer = self->rxBuffer + self->rxBufferStart;
+        self->rxBufferStart += msgSize;
+    }
+    else if (msgSize < 0)
+    {
+        self->rxBufferStart = 0;
+        self->rxBufferEnd = 0;
+    }
+
+    return msgSize;
+}
+
+static int
+writeToSocketDirect(MasterConnection self, uint8_t* buf, int size)
+{
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket)
+        return TLSSocket_write(self->tlsSocket, buf, size);
+    else
+        return Socket_write(self->socket, buf, size);
+#else
+    return Socket_write(self->socket, buf, size);
+#endif
+}
+
+/**
+ * Write the content of the output buffer to the socket (requires txBufferLock)
+ *
+ * Data that cannot be written (e.g. socket send buffer full) remains in the output buffer.
+ *
+ * \return -1 in case of a socket error, otherwise the number of bytes written
+ */
+static int
+flushTxBuffer(MasterConnection self)
+{
+    if (self->txBufferPos == 0)
+        return 0;
+
+    int written = writeToSocketDirect(self, self->txBuffer, self->txBufferPos);
+
+    if (written > 0)
+    {
+        if (written < self->txBufferPos)
+            memmove(self->txBuffer, self->txBuffer + written, self->txBufferPos - written);
+
+        self->txBufferPos -= written;
+    }
+
+    return written;
+}
+
+static int
+writeToSocket(MasterConnection self, uint8_t* buf, int size)
+{
+    if (self->slave->rawMessageHandler)
+        self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter, &(self->iMasterConnection), buf, size,
+                                       true);
+
+    MasterConnection_countFrame(self, buf, size, true);
+
+    if (self->txBuffer == NULL)
+        return writeToSocketDirect(self, buf, size);
+
+    int retVal = size;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->txBufferLock);
+#endif
+
+    if (self->txBufferPos + size > self->txBufferSize)
+    {
+        if (flushTxBuffer(self) < 0)
+            retVal = -1;
+    }
+
+    if (retVal != -1)
+    {
+        if (self->txBufferPos + size <= self->txBufferSize)
+        {
+            memcpy(self->txBuffer + self->txBufferPos, buf, size);
+            self->txBufferPos += size;
+
+            if (self->txBatchActive == false)
+            {
+                if (flushTxBuffer(self) < 0)
+                    retVal = -1;
+            }
+        }
+        else if (self->txBufferPos == 0)
+        {
+            /* output buffer is smaller than the APDU */
+            retVal = writeToSocketDirect(self, buf, size);
+        }
+        else
+        {
+            /* the socket is congested and the reserve for S and U frames is used up (client doesn't read) */
+            DEBUG_PRINT("CS104 SLAVE: output buffer overflow\n");
+            retVal = -1;
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->txBufferLock);
+#endif
+
+    return retVal;
+}
+
+/**
+ * Start to collect APDUs in the output buffer (caller has to hold the sentASDUsLock)
+ */
+static void
+MasterConnection_beginTxBatch(MasterConnection self)
+{
+    if (self->txBuffer)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->txBufferLock);
+#endif
+
+        self->txBatchActive = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->txBufferLock);
+#endif
+    }
+}
+
+/**
+ * Check if the output buffer cannot store another APDU of maximum size (and the reserve for S and U frames)
+ */
+static bool
+MasterConnection_isTxBatchFull(MasterConnection self)
+{
+    bool isFull = true;
+
+    if (self->txBuffer)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->txBufferLock);
+#endif
+
+        isFull = (self->txBufferSize - self->txBufferPos <
+                  IEC60870_5_104_MAX_ASDU_LENGTH + IEC60870_5_104_APCI_LENGTH + TX_BUFFER_CONTROL_RESERVE);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->txBufferLock);
+#endif
+    }
+
+    return isFull;
+}
+
+/**
+ * Stop collecting APDUs and send the content of the output buffer
+ *
+ * \return true when data is still waiting in the output buffer (socket is congested), false otherwise
+ */
+static bool
+MasterConnection_flushTxBuffer(MasterConnection self)
+{
+    bool isWaiting = false;
+    bool socketError = false;
+
+    if (self->txBuffer)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->txBufferLock);
+#endif
+
+        self->txBatchActive = false;
+
+        if (flushTxBuffer(self) < 0)
+            socketError = true;
+
+        isWaiting = (self->txBufferPos > 0);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->txBufferLock);
+#endif
+    }
+
+    if (socketError)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->stateLock);
+#endif
+
+        self->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->stateLock);
+#endif
+    }
+
+    return isWaiting;
+}
+
+/**
+ * Check if data of the output buffer is waiting until the socket can accept more data
+ */
+static bool
+MasterConnection_isTxCongested(MasterConnection self)
+{
+    bool isCongested = false;
+
+    if (self->txBuffer)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->txBufferLock);
+#endif
+
+        isCongested = (self->txBufferPos > 0);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->txBufferLock);
+#endif
+    }
+
+    return isCongested;
+}
+
+/**
+ * Monitor the socket for writability while the output buffer is congested
+ *
+ * \return true when the event loop is woken up by the socket, false when the output buffer has to be
+ *         sent by a timer (not congested or not supported by the HAL)
+ */
+static bool
+MasterConnection_updateWriteInterest(MasterConnection self, HandleSet handleSet)
+{
+    bool isCongested = MasterConnection_isTxCongested(self);
+
+    if (isCongested != self->txWriteInterest)
+    {
+        if (Handleset_setWriteInterest(handleSet, self->socket, isCongested))
+            self->txWriteInterest = isCongested;
+    }
+
+    return self->txWriteInterest;
+}
+
+static int
+sendIMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    buffer[0] = (uint8_t)0x68;
+    buffer[1] = (uint8_t)(msgSize - 2);
+
+    buffer[2] = (uint8_t)((self->sendCount % 128) * 2);
+    buffer[3] = (uint8_t)(self->sendCount / 128);
+
+    buffer[4] = (uint8_t)((self->receiveCount % 128) * 2);
+    buffer[5] = (uint8_t)(self->receiveCount / 128);
+
+    if (writeToSocket(self, buffer, msgSize) > 0)
+    {
+        DEBUG_PRINT("CS104 SLAVE: SEND I (size = %i) N(S) = %i N(R) = %i\n", msgSize, self->sendCount,
+                    self->receiveCount);
+        self->sendCount = (self->sendCount + 1) % 32768;
+        self->unconfirmedReceivedIMessages = 0;
+        self->timeoutT2Triggered = false;
+    }
+    else
+        self->isRunning = false;
+
+    self->unconfirmedReceivedIMessages = 0;
+
+    int sendCount = self->sendCount;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+    return sendCount;
+}
+
+static bool
+isSentBufferFull(MasterConnection self)
+{
+    /* locking of k-buffer has to be done by caller! */
+    if (self->oldestSentASDU == -1)
+        return false;
+
+    int newIndex = (self->newestSentASDU + 1) % (self->maxSentASDUs);
+
+    if (newIndex == self->oldestSentASDU)
+        return true;
+    else
+        return false;
+}
+
+static bool
+sendASDU(MasterConnection self, uint8_t* buffer, int msgSize, uint64_t entryId, uint8_t* queueEntry)
+{
+#ifdef SEC_AUTH_60870_5_7
+
+    SecureEndpoint secureEndpoint = NULL;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+
+    if (self->redundancyGroup)
+    {
+        if (self->redundancyGroup->secureEndpoint)
+            secureEndpoint = self->redundancyGroup->secureEndpoint;
+    }
+
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+    if ((secureEndpoint == NULL) && (self->slave->secureEndpoint != NULL))
+        secureEndpoint = self->slave->secureEndpoint;
+
+    if (secureEndpoint)
+    {
+        struct sCS101_ASDU _asdu;
+
+        CS101_ASDU asdu = CS101_ASDU_createFromBufferEx(&_asdu, &(self->slave->alParameters), buffer + 6, msgSize - 6);
+        
+        if (asdu)
+        {
+            if (SecureEndpoint_sendAsdu(secureEndpoint, &(self->iMasterConnection), asdu) == true)
+            {
+                return true;
+            }
+        }
+    }
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+    /* call plugins */
+    if (self->slave->plugins)
+    {
+        struct sCS101_ASDU _asdu;
+
+        CS101_ASDU asdu = CS101_ASDU_createFromBufferEx(&_asdu, &(self->slave->alParameters), buffer + 6, msgSize - 6);
+        
+        if (asdu)
+        {
+            LinkedList pluginElem = LinkedList_getNext(self->slave->plugins);
+
+            while (pluginElem)
+            {
+                CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+
+                if (plugin->sendAsdu)
+                {
+                    if (plugin->sendAsdu(plugin->parameter, &(self->iMasterConnection), asdu) == CS101_PLUGIN_RESULT_HANDLED)
+                    {
+                        return false;
+                    }
+                }
+
+                pluginElem = LinkedList_getNext(pluginElem);
+            }
+        }
+    }
+    
+    int currentIndex = 0;
+
+    if (self->oldestSentASDU == -1)
+    {
+        self->oldestSentASDU = 0;
+        self->newestSentASDU = 0;
+    }
+    else
+    {
+        currentIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
+    }
+
+    self->sentASDUs[currentIndex].entryId = entryId;
+    self->sentASDUs[currentIndex].queueEntry = queueEntry;
+    self->sentASDUs[currentIndex].seqNo = sendIMessage(self, buffer, msgSize);
+    self->sentASDUs[currentIndex].sentTime = Hal_getMonotonicTimeInMs();
+
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+    self->sentASDUs[currentIndex].hasEnqueueTime = false;
+#endif
+
+    self->newestSentASDU = currentIndex;
+
+    printSendBuffer(self);
+
+    return true;
+}
+
+static bool
+sendASDUInternal(MasterConnection self, CS101_ASDU asdu, bool dontQueueIfBufferFull)
+{
+    bool asduSent = false;
+
+    if (MasterConnection_isActive(self))
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->sentASDUsLock);
+#endif
+
+        if (isSentBufferFull(self) == false)
+        {
+            FrameBuffer frameBuffer;
+
+            struct sBufferFrame bufferFrame;
+
+            Frame frame = BufferFrame_initialize(&bufferFrame, frameBuffer.msg, IEC60870_5_104_APCI_LENGTH, 256);
+            CS101_ASDU_encode(asdu, frame);
+
+            frameBuffer.msgSize = Frame_getMsgSize(frame);
+
+            sendASDU(self, frameBuffer.msg, frameBuffer.msgSize, 0, NULL);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->sentASDUsLock);
+#endif
+
+            asduSent = true;
+        }
+        else if (dontQueueIfBufferFull == false)
+        {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->sentASDUsLock);
+#endif
+            asduSent = HighPriorityASDUQueue_enqueue(self->highPrioQueue, asdu);
+
+            if (asduSent == false)
+                MasterConnection_incrementCounter(self, &(self->metrics.highPrioQueueFull));
+        }
+        else
+        {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->sentASDUsLock);
+#endif
+        }
+    }
+
+    if (asduSent == false)
+        DEBUG_PRINT("CS104 SLAVE: unable to send ASDU (state=%i)\n", self->state);
+
+    return asduSent;
+}
+
+static void
+responseNegative(CS101_ASDU asdu, MasterConnection self, CS101_CauseOfTransmission cot)
+{
+    CS101_ASDU_setCOT(asdu, cot);
+    CS101_ASDU_setNegative(asdu, true);
+    sendASDUInternal(self, asdu, false);
+}
+
+static void
+responseCOTUnknown(CS101_ASDU asdu, MasterConnection self)
+{
+    DEBUG_PRINT("CS104 SLAVE:   with unknown COT\n");
+    responseNegative(asdu, self, CS101_COT_UNKNOWN_COT);
+}
+
+static bool
+isBroadcastCA(CS104_Slave self, int ca)
+{
+    if (self->alParameters.sizeOfCA == 2)
+    {
+        if (ca == 65535)
+            return true;
+    }
+    else if (self->alParameters.sizeOfCA == 1)
+    {
+        if (ca == 255)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Answer an interrogation command from the station database. The response is sent by
+ * sendWaitingASDUs when the k-window allows it.
+ *
+ * \return true when the command was handled, false when the database doesn't contain the station
+ */
+static bool
+MasterConnection_handleDatabaseInterrogation(MasterConnection self, CS101_ASDU asdu)
+{
+    CS101_StationDatabase db = self->slave->stationDatabase;
+
+    if (db == NULL)
+        return false;
+
+    union uInformationObject _io;
+
+    InterrogationCommand irc = (InterrogationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+    if ((irc == NULL) || (InformationObject_getObjectAddress((InformationObject)irc) != 0))
+        return false;
+
+    uint8_t qoi = InterrogationCommand_getQOI(irc);
+
+    if ((qoi < IEC60870_QOI_STATION) || (qoi > IEC60870_QOI_GROUP_16))
+        return false;
+
+    int ca = CS101_ASDU_getCA(asdu);
+
+    bool handled = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    if (CS101_ASDU_getCOT(asdu) == CS101_COT_DEACTIVATION)
+    {
+        /* stop the running interrogation */
+        if ((self->interrogationResponse == INTERROGATION_RESPONSE_DATABASE) && (self->interrogationCursor.ca == ca))
+        {
+            self->interrogationResponse = INTERROGATION_RESPONSE_NONE;
+            handled = true;
+        }
+    }
+    else
+    {
+        /* a new request replaces a running interrogation */
+        handled = CS101_StationDatabase_startInterrogation(db, &(self->interrogationCursor), ca,
+                                                           CS101_ASDU_getOA(asdu), qoi);
+
+        if (handled)
+            self->interrogationResponse = INTERROGATION_RESPONSE_DATABASE;
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    if (handled && (CS101_ASDU_getCOT(asdu) == CS101_COT_DEACTIVATION))
+    {
+        CS101_ASDU_setCOT(asdu, CS101_COT_DEACTIVATION_CON);
+        sendASDUInternal(self, asdu, false);
+    }
+
+    return handled;
+}
+
+/**
+ * Answer a read command from the station database
+ *
+ * \return true when the command was handled, false when the database doesn't contain the station
+ */
+static bool
+MasterConnection_handleDatabaseRead(MasterConnection self, CS101_ASDU asdu, int ioa)
+{
+    CS104_Slave slave = self->slave;
+
+    if (slave->stationDatabase == NULL)
+        return false;
+
+    sCS101_StaticASDU _response;
+
+    CS101_ASDU response = CS101_StationDatabase_read(slave->stationDatabase, CS101_ASDU_getCA(asdu), ioa,
+                                                     CS101_ASDU_getOA(asdu), &_response);
+
+    if (response)
+    {
+        sendASDUInternal(self, response, false);
+        return true;
+    }
+
+    /* unknown point of a known station -> only the application can know it */
+    if ((slave->readHandler == NULL) && CS101_StationDatabase_hasStation(slave->stationDatabase, CS101_ASDU_getCA(asdu)))
+    {
+        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+        return true;
+    }
+
+    return false;
+}
+
+/********************************************
+ * Asynchronous command execution
+ *******************************************/
+
+struct sCS104_CommandHandle
+{
+    CS104_Slave slave;
+    MasterConnection connection; /* NULL when the connection has been closed */
+    bool isDispatched;           /* true when the command has been passed to the handler */
+    CS101_ASDU asdu;
+    sCS101_StaticASDU asduBuffer;
+};
+
+#if (CONFIG_USE_THREADS == 1)
+struct sCS104_CommandWorker
+{
+    CS104_Slave slave;
+    Thread thread;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore signal; /* posted when a command is waiting or the workers are stopped */
+#endif
+    bool isIdle; /* protected by commandsLock */
+};
+#endif
+
+static bool
+isProcessCommand(IEC60870_5_TypeID typeId)
+{
+    return (((typeId >= C_SC_NA_1) && (typeId <= C_BO_NA_1)) || ((typeId >= C_SC_TA_1) && (typeId <= C_BO_TA_1)));
+}
+
+/* remove the command from the list of open commands (caller has to hold the commandsLock) */
+static void
+CS104_CommandHandle_release(CS104_CommandHandle self)
+{
+    CS104_Slave slave = self->slave;
+
+    LinkedList_remove(slave->commands, self);
+    slave->numberOfCommands--;
+
+    GLOBAL_FREEMEM(self);
+}
+
+bool
+IMasterConnection_completeCommand(CS104_CommandHandle self, CS104_CommandResponse response)
+{
+    bool responseSent = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->slave->commandsLock);
+#endif
+
+    /* the connection is not deinitialized while the commandsLock is held */
+    if ((self->connection != NULL) && (response != CS104_COMMAND_RELEASE))
+    {
+        if (response == CS104_COMMAND_ACT_TERM)
+        {
+            CS101_ASDU_setCOT(self->asdu, CS101_COT_ACTIVATION_TERMINATION);
+            CS101_ASDU_setNegative(self->asdu, false);
+        }
+        else
+        {
+            CS101_ASDU_setCOT(self->asdu, CS101_COT_ACTIVATION_CON);
+            CS101_ASDU_setNegative(self->asdu, (response == CS104_COMMAND_ACT_CON_NEGATIVE));
+        }
+
+        responseSent = HighPriorityASDUQueue_enqueue(self->connection->highPrioQueue, self->asdu);
+
+        if (responseSent)
+            MasterConnection_wakeup(self->connection);
+        else
+            DEBUG_PRINT("CS104 SLAVE: Cannot send command response - high-priority queue full\n");
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore commandsLock = self->slave->commandsLock;
+#endif
+
+    if (response != CS104_COMMAND_ACT_CON)
+        CS104_CommandHandle_release(self);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(commandsLock);
+#endif
+
+    return responseSent;
+}
+
+/* called when the connection is closed -> open commands cannot send responses anymore */
+static void
+MasterConnection_releaseCommands(MasterConnection self)
+{
+    CS104_Slave slave = self->slave;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(slave->commandsLock);
+#endif
+
+    LinkedList element = LinkedList_getNext(slave->commands);
+
+    while (element)
+    {
+        CS104_CommandHandle command = (CS104_CommandHandle)LinkedList_getData(element);
+
+        element = LinkedList_getNext(element);
+
+        if (command->connection == self)
+        {
+            /* a running handler keeps the connection object pinned until it returns (see getFreeConnection) */
+            command->connection = NULL;
+
+            /* commands that are not yet passed to the handler are dropped */
+            if (command->isDispatched == false)
+                CS104_CommandHandle_release(command);
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(slave->commandsLock);
+#endif
+}
+
+#if (CONFIG_USE_THREADS == 1)
+
+/* get the oldest command that is not yet passed to the handler (caller has to hold the commandsLock) */
+static CS104_CommandHandle
+CS104_Slave_getNextWaitingCommand(CS104_Slave self)
+{
+    LinkedList element = LinkedList_getNext(self->commands);
+
+    while (element)
+    {
+        CS104_CommandHandle command = (CS104_CommandHandle)LinkedList_getData(element);
+
+        if (command->isDispatched == false)
+        {
+            command->isDispatched = true;
+            return command;
+        }
+
+        element = LinkedList_getNext(element);
+    }
+
+    return NULL;
+}
+
+static void*
+CS104_CommandWorker_thread(void* parameter)
+{
+    CS104_CommandWorker self = (CS104_CommandWorker)parameter;
+    CS104_Slave slave = self->slave;
+
+    while (true)
+    {
+        CS104_CommandHandle command = NULL;
+        MasterConnection connection = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(slave->commandsLock);
+#endif
+
+        bool isRunning = slave->commandWorkersRunning;
+
+        if (isRunning)
+        {
+            command = CS104_Slave_getNextWaitingCommand(slave);
+
+            /* pin the connection object -> it is not reused for another client while the handler is running */
+            if (command)
+            {
+                connection = command->connection;
+                connection->runningCommandHandlers++;
+            }
+
+            self->isIdle = (command == NULL);
+        }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(slave->commandsLock);
+#endif
+
+        if (isRunning == false)
+            break;
+
+        if (command)
+        {
+            slave->asyncCommandHandler(slave->asyncCommandHandlerParameter, &(connection->iMasterConnection), command,
+                                       command->asdu);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(slave->commandsLock);
+#endif
+
+            connection->runningCommandHandlers--;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(slave->commandsLock);
+#endif
+        }
+        else
+        {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->signal);
+#else
+            Thread_sleep(10);
+#endif
+        }
+    }
+
+    return NULL;
+}
+
+static void
+CS104_Slave_startCommandWorkers(CS104_Slave self)
+{
+    if ((self->asyncCommandHandler == NULL) || (self->numberOfCommandWorkers < 1) || self->commandWorkers)
+        return;
+
+    CS104_CommandWorker workers =
+        (CS104_CommandWorker)GLOBAL_CALLOC(self->numberOfCommandWorkers, sizeof(struct sCS104_CommandWorker));
+
+    if (workers)
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfCommandWorkers; i++)
+        {
+            CS104_CommandWorker worker = &(workers[i]);
+
+            worker->slave = self;
+#if (CONFIG_USE_SEMAPHORES == 1)
+            worker->signal = Semaphore_create(0);
+#endif
+            worker->isIdle = true;
+        }
+
+        self->commandWorkers = workers;
+        self->commandWorkersRunning = true;
+
+        for (i = 0; i < self->numberOfCommandWorkers; i++)
+        {
+            CS104_CommandWorker worker = &(workers[i]);
+
+            worker->thread = Thread_create(CS104_CommandWorker_thread, (void*)worker, false);
+
+            Thread_start(worker->thread);
+        }
+    }
+    else
+    {
+        DEBUG_PRINT("CS104 SLAVE: Failed to allocate command workers\n");
+    }
+}
+
+static void
+CS104_Slave_stopCommandWorkers(CS104_Slave self)
+{
+    if (self->commandWorkers)
+    {
+        int i;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->commandsLock);
+#endif
+
+        self->commandWorkersRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->commandsLock);
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        for (i = 0; i < self->numberOfCommandWorkers; i++)
+            Semaphore_post(self->commandWorkers[i].signal);
+#endif
+
+        for (i = 0; i < self->numberOfCommandWorkers; i++)
+        {
+            Thread_destroy(self->commandWorkers[i].thread);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_destroy(self->commandWorkers[i].signal);
+#endif
+        }
+
+        GLOBAL_FREEMEM(self->commandWorkers);
+        self->commandWorkers = NULL;
+    }
+}
+
+#endif /* (CONFIG_USE_THREADS == 1) */
+
+/* pass a received command to the async command handler */
+static void
+MasterConnection_dispatchCommand(MasterConnection self, CS101_ASDU asdu)
+{
+    CS104_Slave slave = self->slave;
+
+    CS104_CommandHandle command = NULL;
+
+    bool executeCommand = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(slave->commandsLock);
+#endif
+
+    if (slave->numberOfCommands < CONFIG_CS104_MAX_PENDING_COMMANDS)
+        command = (CS104_CommandHandle)GLOBAL_MALLOC(sizeof(struct sCS104_CommandHandle));
+
+    if (command)
+    {
+        command->slave = slave;
+        command->connection = self;
+        command->isDispatched = false;
+        command->asdu = CS101_ASDU_clone(asdu, &(command->asduBuffer));
+
+        LinkedList_add(slave->commands, command);
+        slave->numberOfCommands++;
+
+#if (CONFIG_USE_THREADS == 1)
+        if (slave->commandWorkersRunning)
+        {
+            int i;
+
+            /* busy workers check for waiting commands before they wait again */
+            for (i = 0; i < slave->numberOfCommandWorkers; i++)
+            {
+                if (slave->commandWorkers[i].isIdle)
+                {
+                    slave->commandWorkers[i].isIdle = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                    Semaphore_post(slave->commandWorkers[i].signal);
+#endif
+                    break;
+                }
+            }
+        }
+        else
+#endif
+        {
+            /* no worker threads -> execute the command by the connection handling */
+            command->isDispatched = true;
+            executeCommand = true;
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(slave->commandsLock);
+#endif
+
+    if (command == NULL)
+    {
+        DEBUG_PRINT("CS104 SLAVE: Too many open commands -> reject command\n");
+
+        CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+        CS101_ASDU_setNegative(asdu, true);
+        sendASDUInternal(self, asdu, false);
+    }
+    else if (executeCommand)
+    {
+        slave->asyncCommandHandler(slave->asyncCommandHandlerParameter, &(self->iMasterConnection), command,
+                                   command->asdu);
+    }
+}
+
+/*
+ * Handle received ASDUs
+ *
+ * Call the appropriate callbacks according to ASDU type and CoT
+ *
+ * \return true when ASDU is valid, false otherwise (e.g. corrupted message data)
+ */
+static bool
+handleASDU(MasterConnection self, CS101_ASDU asdu, CS101_SlavePlugin callingPlugin)
+{
+    bool messageHandled = false;
+
+    CS104_Slave slave = self->slave;
+
+    int ca = CS101_ASDU_getCA(asdu);
+
+    /* check with user callback if CA address is known/used by application */
+    if (slave->isCAAllowedHandler && (isBroadcastCA(slave, ca) == false))
+    {
+        if (slave->isCAAllowedHandler(slave->isCAAllowedHandlerParameter, ca) == false)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Rcvd ASDU with unknown CA\n");
+
+            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+
+            return true;
+        }
+    }
+
+    /* handle test commands with invalid COT before the 62351-5 module gets them */
+    if (CS101_ASDU_getTypeID(asdu) == C_TS_TA_1)
+    {
+        if (CS101_ASDU_getCOT(asdu) != CS101_COT_ACTIVATION)
+        {
+            responseNegative(asdu, self, CS101_COT_UNKNOWN_COT);
+
+            return true;
+        }
+    }
+
+#ifdef SEC_AUTH_60870_5_7
+    SecureEndpoint secureEndpoint = NULL;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+
+    if (self->redundancyGroup)
+    {
+        if (self->redundancyGroup->secureEndpoint)
+            secureEndpoint = self->redundancyGroup->secureEndpoint;
+    }
+
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+    if (secureEndpoint == NULL && slave->secureEndpoint != NULL)
+        secureEndpoint = slave->secureEndpoint;
+
+    if (secureEndpoint)
+    {
+        if (callingPlugin != SecureEndpoint_getSlavePlugin(secureEndpoint))
+        {
+            if (SecureEndpoint_asduReceived(secureEndpoint, &(self->iMasterConnection), asdu, NULL, 0) == true)
+                return true;
+        }
+    }
+#endif /* SEC_AUTH_60870_5_7 */
+
+    /* call plugins */
+    if (slave->plugins)
+    {
+        LinkedList pluginElem = LinkedList_getNext(slave->plugins);
+
+        while (pluginElem)
+        {
+            CS101_SlavePlugin plugin = (CS101_SlavePlugin)LinkedList_getData(pluginElem);
+
+            if (plugin != callingPlugin)
+            {
+                if (plugin->handleAsdu)
+                {
+                    CS101_SlavePlugin_Result result = plugin->handleAsdu(plugin->parameter, &(self->iMasterConnection), asdu);
+
+                    if (result == CS101_PLUGIN_RESULT_HANDLED)
+                        return true;
+
+                    if (result == CS101_PLUGIN_RESULT_INVALID_ASDU)
+                        return false;
+                }
+            }
+
+            pluginElem = LinkedList_getNext(pluginElem);
+        }
+    }
+
+    uint8_t cot = CS101_ASDU_getCOT(asdu);
+
+    switch (CS101_ASDU_getTypeID(asdu))
+    {
+
+    case C_IC_NA_1: /* 100 - interrogation command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd interrogation command C_IC_NA_1\n");
+
+        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION))
+        {
+            if (MasterConnection_handleDatabaseInterrogation(self, asdu))
+            {
+                messageHandled = true;
+            }
+            else if (slave->interrogationHandler != NULL)
+            {
+                union uInformationObject _io;
+
+                InterrogationCommand irc =
+                    (InterrogationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+                if (irc)
+                {
+                    /* Verify IOA = 0 */
+                    if (InformationObject_getObjectAddress((InformationObject)irc) != 0)
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: interrogation command has invalid IOA - should be 0\n");
+                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+                        messageHandled = true;
+                    }
+                    else
+                    {
+                        if (slave->interrogationHandler(slave->interrogationHandlerParameter,
+                                                        &(self->iMasterConnection), asdu,
+                                                        InterrogationCommand_getQOI(irc)))
+                        {
+                            messageHandled = true;
+
+                            /* start (or stop) pulling the response from the application */
+                            if (slave->getNextInterrogationASDUHandler)
+                            {
+#if (CONFIG_USE_SEMAPHORES == 1)
+                                Semaphore_wait(self->sentASDUsLock);
+#endif
+
+                                if (cot == CS101_COT_ACTIVATION)
+                                    self->interrogationResponse = INTERROGATION_RESPONSE_HANDLER;
+                                else
+                                    self->interrogationResponse = INTERROGATION_RESPONSE_NONE;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                                Semaphore_post(self->sentASDUsLock);
+#endif
+                            }
+                        }
+                    }
+                }
+                else
+                    return false;
+            }
+        }
+        else
+        {
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+
+        break;
+
+    case C_CI_NA_1: /* 101 - counter interrogation command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd counter interrogation command C_CI_NA_1\n");
+
+        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION))
+        {
+            if (slave->counterInterrogationHandler != NULL)
+            {
+                union uInformationObject _io;
+
+                CounterInterrogationCommand cic =
+                    (CounterInterrogationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+                if (cic)
+                {
+                    /* Verify IOA = 0 */
+                    if (InformationObject_getObjectAddress((InformationObject)cic) != 0)
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: counter interrogation command has invalid IOA - should be 0\n");
+                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+                        messageHandled = true;
+                    }
+                    else
+                    {
+                        if (slave->counterInterrogationHandler(slave->counterInterrogationHandlerParameter,
+                                                               &(self->iMasterConnection), asdu,
+                                                               CounterInterrogationCommand_getQCC(cic)))
+                            messageHandled = true;
+                    }
+                }
+                else
+                    return false;
+            }
+        }
+        else
+        {
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+
+        break;
+
+    case C_RD_NA_1: /* 102 - read command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd read command C_RD_NA_1\n");
+
+        if (isBroadcastCA(slave, ca) == true)
+        {
+            DEBUG_PRINT("CS104_SLAVE: command with broadcast CA not allowed\n");
+
+            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+
+            return true;
+        }
+
+        if (cot == CS101_COT_REQUEST)
+        {
+            union uInformationObject _io;
+
+            ReadCommand rc = (ReadCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+            if (rc == NULL)
+                return false;
+
+            int ioa = InformationObject_getObjectAddress((InformationObject)rc);
+
+            if (MasterConnection_handleDatabaseRead(self, asdu, ioa))
+            {
+                messageHandled = true;
+            }
+            else if (slave->readHandler != NULL)
+            {
+                if (slave->readHandler(slave->readHandlerParameter, &(self->iMasterConnection), asdu, ioa))
+                    messageHandled = true;
+            }
+        }
+        else
+        {
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+
+        break;
+
+    case C_CS_NA_1: /* 103 - Clock synchronization command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd clock sync command C_CS_NA_1\n");
+
+        if (cot == CS101_COT_ACTIVATION)
+        {
+            if (slave->clockSyncHandler)
+            {
+                union uInformationObject _io;
+
+                ClockSynchronizationCommand csc =
+                    (ClockSynchronizationCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+                if (csc)
+                {
+                    /* Verify IOA = 0 */
+                    if (InformationObject_getObjectAddress((InformationObject)csc) != 0)
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: time sync command has invalid IOA - should be 0\n");
+                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+                    }
+                    else
+                    {
+                        CP56Time2a newTime = ClockSynchronizationCommand_getTime(csc);
+
+                        if (slave->clockSyncHandler(slave->clockSyncHandlerParameter, &(self->iMasterConnection), asdu,
+                                                    newTime))
+                        {
+                            CS101_ASDU_removeAllElements(asdu);
+
+                            ClockSynchronizationCommand_create(csc, 0, newTime);
+
+                            CS101_ASDU_addInformationObject(asdu, (InformationObject)csc);
+
+                            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+
+                            sendASDUInternal(self, asdu, false);
+                        }
+                        else
+                        {
+                            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+                            CS101_ASDU_setNegative(asdu, true);
+
+                            sendASDUInternal(self, asdu, false);
+                        }
+                    }
+
+                    messageHandled = true;
+                }
+                else
+                    return false;
+            }
+        }
+        else
+        {
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+
+        break;
+
+    case C_TS_NA_1: /* 104 - test command */
+
+#if (CONFIG_ALLOW_C_TS_NA_1_FOR_CS104 == 1)
+        DEBUG_PRINT("CS104 SLAVE: Rcvd test command C_TS_NA_1\n");
+
+        if (isBroadcastCA(slave, ca) == true)
+        {
+            DEBUG_PRINT("CS104_SLAVE: test command with broadcast CA not allowed\n");
+
+            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+
+            return true;
+        }
+
+        if (cot == CS101_COT_ACTIVATION)
+        {
+            union uInformationObject _io;
+
+            TestCommand tc = (TestCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+            if (tc)
+            {
+                /* Verify IOA = 0 */
+                if (InformationObject_getObjectAddress((InformationObject)tc) != 0)
+                {
+                    DEBUG_PRINT("CS104 SLAVE: test command has invalid IOA - should be 0\n");
+                    responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+                }
+                else
+                {
+                    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+                    sendASDUInternal(self, asdu);
+                }
+            }
+            else
+            {
+                DEBUG_PRINT("CS104 SLAVE: invalid test command\n");
+                return false;
+            }
+
+            messageHandled = true;
+        }
+        else
+        {
+            DEBUG_PRINT("CS104 SLAVE: test command has invalid COT - should be ACTIVATION(6)\n");
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+#else
+        /* this command is not supported/allowed for IEC 104 */
+        DEBUG_PRINT("CS104 SLAVE: Rcvd test command C_TS_NA_1 -> not allowed\n");
+        messageHandled = false;
+#endif /* (CONFIG_ALLOW_C_TS_NA_1_FOR_CS104 == 1) */
+
+        break;
+
+    case C_RP_NA_1: /* 105 - Reset process command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd reset process command C_RP_NA_1\n");
+
+        if (cot == CS101_COT_ACTIVATION)
+        {
+            if (slave->resetProcessHandler)
+            {
+                union uInformationObject _io;
+
+                ResetProcessCommand rpc =
+                    (ResetProcessCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+                if (rpc)
+                {
+                    /* Verify IOA = 0 */
+                    if (InformationObject_getObjectAddress((InformationObject)rpc) != 0)
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: reset process command has invalid IOA - should be 0\n");
+                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+
+                        messageHandled = true;
+                    }
+                    else
+                    {
+                        if (slave->resetProcessHandler(slave->resetProcessHandlerParameter, &(self->iMasterConnection),
+                                                       asdu, ResetProcessCommand_getQRP(rpc)))
+                            messageHandled = true;
+                    }
+                }
+                else
+                    return false;
+            }
+        }
+        else
+        {
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+
+        break;
+
+    case C_CD_NA_1: /* 106 - Delay acquisition command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd delay acquisition command C_CD_NA_1\n");
+
+        if (isBroadcastCA(slave, ca) == true)
+        {
+            DEBUG_PRINT("CS104_SLAVE: command with broadcast CA not allowed\n");
+
+            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+
+            return true;
+        }
+
+        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_SPONTANEOUS))
+        {
+            if (slave->delayAcquisitionHandler)
+            {
+                union uInformationObject _io;
+
+                DelayAcquisitionCommand dac =
+                    (DelayAcquisitionCommand)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+                if (dac)
+                {
+                    /* Verify IOA = 0 */
+                    if (InformationObject_getObjectAddress((InformationObject)dac) != 0)
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: delay aquisition command has invalid IOA - should be 0\n");
+                        responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+
+                        messageHandled = true;
+                    }
+                    else
+                    {
+                        if (slave->delayAcquisitionHandler(slave->delayAcquisitionHandlerParameter,
+                                                           &(self->iMasterConnection), asdu,
+                                                           DelayAcquisitionCommand_getDelay(dac)))
+                            messageHandled = true;
+                    }
+                }
+                else
+                    return false;
+            }
+        }
+        else
+        {
+            responseCOTUnknown(asdu, self);
+            messageHandled = true;
+        }
+
+        break;
+
+    case C_TS_TA_1: /* 107 - test command with timestamp */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd test command with CP56Time2a C_TS_TA_1\n");
+
+        if (isBroadcastCA(slave, ca) == true)
+        {
+            DEBUG_PRINT("CS104_SLAVE: test command with broadcast CA not allowed\n");
+
+            responseNegative(asdu, self, CS101_COT_UNKNOWN_CA);
+
+            return true;
+        }
+        else
+        {
+            union uInformationObject _io;
+
+            TestCommandWithCP56Time2a tc =
+                (TestCommandWithCP56Time2a)CS101_ASDU_getElementEx(asdu, (InformationObject)&_io, 0);
+
+            if (tc)
+            {
+                /* Verify IOA = 0 */
+                if (InformationObject_getObjectAddress((InformationObject)tc) != 0)
+                {
+                    DEBUG_PRINT("CS104 SLAVE: test command has invalid IOA - should be 0\n");
+                    responseNegative(asdu, self, CS101_COT_UNKNOWN_IOA);
+                    return true;
+                }
+
+                /* Only COT = ACTIVATION is allowed */
+                if (cot != CS101_COT_ACTIVATION)
+                {
+                    DEBUG_PRINT("CS104 SLAVE: test command has invalid COT - should be ACTIVATION(6)\n");
+                    responseNegative(asdu, self, CS101_COT_UNKNOWN_COT);
+                    return true;
+                }
+
+                CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+                sendASDUInternal(self, asdu, false);
+
+                return true;
+            }
+            else
+            {
+                DEBUG_PRINT("CS104 SLAVE: invalid test command\n");
+                return false;
+            }
+        }
+
+        break;
+
+    default: /* no special handler available -> use default handler */
+        break;
+    }
+
+    if ((messageHandled == false) && (slave->asyncCommandHandler != NULL) &&
+        isProcessCommand(CS101_ASDU_getTypeID(asdu)))
+    {
+        MasterConnection_dispatchCommand(self, asdu);
+        messageHandled = true;
+    }
+
+    if ((messageHandled == false) && (slave->asduHandler != NULL))
+        if (slave->asduHandler(slave->asduHandlerParameter, &(self->iMasterConnection), asdu))
+            messageHandled = true;
+
+    if (messageHandled == false)
+    {
+        /* send error response */
+        CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_TYPE_ID);
+        CS101_ASDU_setNegative(asdu, true);
+        sendASDUInternal(self, asdu, false);
+    }
+
+    return true;
+}
+
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+
+static int
+LatencyHistogram_getBucketIndex(uint32_t value)
+{
+    int shift = 0;
+
+    if (value < 16)
+        return (int)value;
+
+    /* keep the 4 most significant bits */
+    while (value >= 16)
+    {
+        value >>= 1;
+        shift++;
+    }
+
+    return 16 + ((shift - 1) * 8) + (int)(value - 8);
+}
+
+static void
+LatencyHistogram_record(CS104_LatencyHistogram self, uint32_t value)
+{
+    if ((self->count == 0) || (value < self->min))
+        self->min = value;
+
+    if (value > self->max)
+        self->max = value;
+
+    self->count++;
+    self->sum += value;
+    self->buckets[LatencyHistogram_getBucketIndex(value)]++;
+}
+
+/* record the queue wait time of the ASDU that has just been sent (caller has to hold the sentASDUsLock) */
+static void
+MasterConnection_recordQueueWait(MasterConnection self, uint64_t entryId, uint8_t* queueEntry, uint64_t enqueueTime)
+{
+    if (self->newestSentASDU == -1)
+        return;
+
+    SentASDUSlave* sentAsdu = &(self->sentASDUs[self->newestSentASDU]);
+
+    /* the ASDU is not added to the sent ASDUs when it is handled by the secure endpoint */
+    if ((sentAsdu->queueEntry != queueEntry) || (sentAsdu->entryId != entryId))
+        return;
+
+    uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+    /* never record a negative wait time */
+    if (enqueueTime > currentTime)
+        enqueueTime = currentTime;
+
+    sentAsdu->hasEnqueueTime = true;
+    sentAsdu->enqueueTime = enqueueTime;
+
+    LatencyHistogram_record(&(self->latency[CS104_LATENCY_QUEUE_WAIT]), (uint32_t)(currentTime - enqueueTime));
+}
+
+/* record the latencies of a confirmed ASDU (caller has to hold the sentASDUsLock) */
+static void
+MasterConnection_recordConfirmation(MasterConnection self, SentASDUSlave* sentAsdu, uint64_t confirmTime)
+{
+    if (confirmTime >= sentAsdu->sentTime)
+        LatencyHistogram_record(&(self->latency[CS104_LATENCY_ACK_RTT]), (uint32_t)(confirmTime - sentAsdu->sentTime));
+
+    if (sentAsdu->hasEnqueueTime)
+    {
+        if (confirmTime >= sentAsdu->enqueueTime)
+            LatencyHistogram_record(&(self->latency[CS104_LATENCY_END_TO_END]),
+                                    (uint32_t)(confirmTime - sentAsdu->enqueueTime));
+
+        sentAsdu->hasEnqueueTime = false;
+    }
+}
+
+#endif /* (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1) */
+
+static bool
+checkSequenceNumber(MasterConnection self, int seqNo)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    /* check if received sequence number is valid */
+
+    bool seqNoIsValid = false;
+    bool counterOverflowDetected = false;
+    int oldestValidSeqNo = -1;
+
+    if (self->oldestSentASDU == -1) /* if k-Buffer is empty */
+    {
+        if (seqNo == self->sendCount)
+            seqNoIsValid = true;
+    }
+    else
+    {
+        /* two cases are required to reflect sequence number overflow */
+        int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
+        int newestAsduSeqNo = self->sentASDUs[self->newestSentASDU].seqNo;
+
+        if (oldestAsduSeqNo <= newestAsduSeqNo)
+        {
+            if ((seqNo >= oldestAsduSeqNo) && (seqNo <= newestAsduSeqNo))
+                seqNoIsValid = true;
+        }
+        else
+        {
+            if ((seqNo >= oldestAsduSeqNo) || (seqNo <= newestAsduSeqNo))
+                seqNoIsValid = true;
+
+            counterOverflowDetected = true;
+        }
+
+        /* check if confirmed message was already removed from list */
+        if (oldestAsduSeqNo == 0)
+            oldestValidSeqNo = 32767;
+        else
+            oldestValidSeqNo = (oldestAsduSeqNo - 1) % 32768;
+
+        if (oldestValidSeqNo == seqNo)
+            seqNoIsValid = true;
+    }
+
+    if (seqNoIsValid)
+    {
+        if (self->oldestSentASDU != -1)
+        {
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+            uint64_t confirmTime = Hal_getMonotonicTimeInMs();
+#endif
+
+            do
+            {
+                int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
+
+                if (counterOverflowDetected == false)
+                {
+                    if (seqNo < oldestAsduSeqNo)
+                        break;
+                }
+
+                if (seqNo == oldestValidSeqNo)
+                    break;
+
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+                MasterConnection_recordConfirmation(self, &(self->sentASDUs[self->oldestSentASDU]), confirmTime);
+#endif
+
+                /* remove from server (low-priority) queue if required */
+                if (self->sentASDUs[self->oldestSentASDU].queueEntry != NULL)
+                {
+                    MessageQueue_lock(self->lowPrioQueue);
+
+                    MessageQueue_markAsduAsConfirmed(self->lowPrioQueue,
+                                                     self->sentASDUs[self->oldestSentASDU].queueEntry,
+                                                     self->sentASDUs[self->oldestSentASDU].entryId);
+
+                    self->sentASDUs[self->oldestSentASDU].queueEntry = NULL;
+
+                    self->sentASDUs[self->oldestSentASDU].seqNo = -1;
+
+                    MessageQueue_unlock(self->lowPrioQueue);
+                }
+
+                /* clear sent buffer entry */
+                self->sentASDUs[self->oldestSentASDU].queueEntry = NULL;
+                self->sentASDUs[self->oldestSentASDU].entryId = 0;
+                self->sentASDUs[self->oldestSentASDU].sentTime = 0;
+                self->sentASDUs[self->oldestSentASDU].seqNo = -1;
+
+                if (oldestAsduSeqNo == seqNo)
+                {
+                    /* we arrived at the seq# that has been confirmed */
+
+                    if (self->oldestSentASDU == self->newestSentASDU)
+                        self->oldestSentASDU = -1;
+                    else
+                        self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+
+                    break;
+                }
+
+                self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+
+                int checkIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
+
+                if (self->oldestSentASDU == checkIndex)
+                {
+                    self->oldestSentASDU = -1;
+                    break;
+                }
+
+            } while (true);
+        }
+    }
+    else
+        DEBUG_PRINT("CS104 SLAVE: Received sequence number out of range");
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    return seqNoIsValid;
+}
+
+static bool
+MasterConnection_isRunning(MasterConnection self)
+{
+    bool retVal;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    retVal = self->isRunning;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+    return retVal;
+}
+
+static bool
+MasterConnection_isActive(MasterConnection self)
+{
+    bool isActive = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    if (self->state == M_CON_STATE_STARTED)
+        isActive = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+    return isActive;
+}
+
+static void
+_resetT3Timeout(MasterConnection self, uint64_t currentTime)
+{
+    self->nextT3Timeout = currentTime + (uint64_t)(self->slave->conParameters.t3 * 1000);
+}
+
+static void
+resetT3Timeout(MasterConnection self, uint64_t currentTime)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    _resetT3Timeout(self, currentTime);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+}
+
+static bool
+checkT3Timeout(MasterConnection self, uint64_t currentTime)
+{
+    bool retVal = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    if (self->waitingForTestFRcon)
+        goto exit_function;
+
+    if (self->nextT3Timeout > (currentTime + (uint64_t)(self->slave->conParameters.t3 * 1000)))
+    {
+        /* timeout value not plausible (maybe system time changed) */
+        _resetT3Timeout(self, currentTime);
+    }
+
+    if (currentTime > self->nextT3Timeout)
+        retVal = true;
+
+exit_function:
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+    return retVal;
+}
+
+static void
+resetTestFRConTimeout(MasterConnection self, uint64_t currentTime)
+{
+    self->nextTestFRConTimeout = currentTime + (uint64_t)(self->slave->conParameters.t1 * 1000);
+}
+
+static bool
+checkTestFRConTimeout(MasterConnection self, uint64_t currentTime)
+{
+    if (self->nextTestFRConTimeout > (currentTime + (uint64_t)(self->slave->conParameters.t1 * 1000)))
+    {
+        /* timeout value not plausible (maybe system time changed) */
+        resetTestFRConTimeout(self, currentTime);
+    }
+
+    if (currentTime > self->nextTestFRConTimeout)
+        return true;
+    else
+        return false;
+}
+
+/* unprotected version of sendSMessage */
+static void
+_sendSMessage(MasterConnection self)
+{
+    uint8_t msg[6];
+
+    msg[0] = 0x68;
+    msg[1] = 0x04;
+    msg[2] = 0x01;
+    msg[3] = 0;
+    msg[4] = (uint8_t)((self->receiveCount % 128) * 2);
+    msg[5] = (uint8_t)(self->receiveCount / 128);
+
+    if (writeToSocket(self, msg, 6) < 0)
+        self->isRunning = false;
+}
+
+static void
+sendSMessage(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    _sendSMessage(self);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+}
+
+static bool
+handleMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+{
+    uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+    if (msgSize >= 3)
+    {
+        if (buffer[0] != 0x68)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Invalid START character!");
+            return false;
+        }
+
+        uint8_t lengthOfApdu = buffer[1];
+
+        if (lengthOfApdu != msgSize - 2)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Invalid length of APDU");
+            return false;
+        }
+
+        MasterConnection_countFrame(self, buffer, msgSize, false);
+
+        if ((buffer[2] & 1) == 0) /* I message */
+        {
+            if (msgSize < 7)
+            {
+                DEBUG_PRINT("CS104 SLAVE: Received I msg too small!");
+                return false;
+            }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+
+            if (self->state != M_CON_STATE_STARTED)
+            {
+                DEBUG_PRINT("CS104 SLAVE: Received I message while connection not active -> close connection");
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_post(self->stateLock);
+#endif
+
+                return false;
+            }
+
+            if (self->timeoutT2Triggered == false)
+            {
+                self->timeoutT2Triggered = true;
+                self->lastConfirmationTime = currentTime; /* start timeout T2 */
+            }
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+
+            int frameSendSequenceNumber = ((buffer[3] * 0x100) + (buffer[2] & 0xfe)) / 2;
+            int frameRecvSequenceNumber = ((buffer[5] * 0x100) + (buffer[4] & 0xfe)) / 2;
+
+            DEBUG_PRINT("CS104 SLAVE: Received I frame: N(S) = %i N(R) = %i\n", frameSendSequenceNumber,
+                        frameRecvSequenceNumber);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+            if (frameSendSequenceNumber != self->receiveCount)
+            {
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_post(self->stateLock);
+#endif
+
+                DEBUG_PRINT("CS104 SLAVE: Sequence error - close connection");
+                return false;
+            }
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+
+            if (checkSequenceNumber(self, frameRecvSequenceNumber) == false)
+            {
+                DEBUG_PRINT("CS104 SLAVE: Sequence number check failed - close connection");
+                return false;
+            }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+            self->receiveCount = (self->receiveCount + 1) % 32768;
+            self->unconfirmedReceivedIMessages++;
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+
+            if (MasterConnection_isActive(self))
+            {
+                struct sCS101_ASDU _asdu;
+
+                CS101_ASDU asdu =
+                    CS101_ASDU_createFromBufferEx(&_asdu, &(self->slave->alParameters), buffer + 6, msgSize - 6);
+
+                if (asdu)
+                {
+                    bool validAsdu = handleASDU(self, asdu, NULL);
+
+                    if (validAsdu == false)
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: ASDU corrupted");
+                        return false;
+                    }
+                }
+                else
+                {
+                    DEBUG_PRINT("CS104 SLAVE: Invalid ASDU");
+                    return false;
+                }
+            }
+            else
+            {
+                DEBUG_PRINT("CS104 SLAVE: Received I message while connection not activate -> close connection");
+                return false;
+            }
+        }
+
+        /* Check for TESTFR_ACT message */
+        else if ((buffer[2] & 0x43) == 0x43)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Send TESTFR_CON\n");
+
+            if (writeToSocket(self, TESTFR_CON_MSG, TESTFR_CON_MSG_SIZE) < 0)
+                return false;
+        }
+
+        /* Check for STARTDT_ACT message */
+        else if ((buffer[2] & 0x07) == 0x07)
+        {
+            CS104_Slave_activate(self->slave, self);
+
+            HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
+
+            DEBUG_PRINT("CS104 SLAVE: Send STARTDT_CON\n");
+
+            if (writeToSocket(self, STARTDT_CON_MSG, STARTDT_CON_MSG_SIZE) < 0)
+                return false;
+        }
+
+        /* Check for STOPDT_ACT message */
+        else if ((buffer[2] & 0x13) == 0x13)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Received STOPDT_ACT\n");
+
+            MasterConnection_deactivate(self);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+
+            if (self->unconfirmedReceivedIMessages > 0)
+            {
+                /* Send S-Message to confirm all outstanding messages */
+
+                self->lastConfirmationTime = Hal_getMonotonicTimeInMs();
+
+                self->unconfirmedReceivedIMessages = 0;
+
+                self->timeoutT2Triggered = false;
+
+                _sendSMessage(self);
+            }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+
+            if (MasterConnection_hasUnconfirmedMessages(self))
+            {
+                DEBUG_PRINT(
+                    "CS104 SLAVE: Unconfirmed messages after STOPDT_ACT -> pending unconfirmed stopped state\n");
+            }
+            else
+            {
+                DEBUG_PRINT("CS104 SLAVE: Send STOPDT_CON\n");
+
+                self->state = M_CON_STATE_STOPPED;
+
+                if (writeToSocket(self, STOPDT_CON_MSG, STOPDT_CON_MSG_SIZE) < 0)
+                {
+#if (CONFIG_USE_SEMAPHORES == 1)
+                    Semaphore_post(self->stateLock);
+#endif
+
+                    return false;
+                }
+            }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+        }
+
+        /* Check for TESTFR_CON message */
+        else if ((buffer[2] & 0x83) == 0x83)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Recv TESTFR_CON\n");
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+            self->waitingForTestFRcon = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+        }
+
+        else if (buffer[2] == 0x01) /* S-message */
+        {
+            int seqNo = (buffer[4] + buffer[5] * 0x100) / 2;
+
+            DEBUG_PRINT("CS104 SLAVE: Rcvd S(%i) (own sendcounter = %i)\n", seqNo, self->sendCount);
+
+            if (checkSequenceNumber(self, seqNo) == false)
+            {
+                DEBUG_PRINT("CS104 SLAVE: S message - sequence number mismatch");
+                return false;
+            }
+
+            printSendBuffer(self);
+
+            if (self->state == M_CON_STATE_UNCONFIRMED_STOPPED)
+            {
+                if (MasterConnection_hasUnconfirmedMessages(self) == false)
+                {
+                    self->state = M_CON_STATE_STOPPED;
+
+                    DEBUG_PRINT("CS104 SLAVE: Send STOPDT_CON\n");
+
+                    if (writeToSocket(self, STOPDT_CON_MSG, STOPDT_CON_MSG_SIZE) < 0)
+                        return false;
+                }
+            }
+            else if (self->state == M_CON_STATE_STOPPED)
+            {
+                DEBUG_PRINT("CS104 SLAVE: S message in stopped state -> active close\n");
+                /* actively close connection */
+                return false;
+            }
+        }
+        else
+        {
+            DEBUG_PRINT("CS104 SLAVE: unknown message - IGNORE\n");
+            return true;
+        }
+
+        resetT3Timeout(self, currentTime);
+
+        return true;
+    }
+    else
+    {
+        DEBUG_PRINT("CS104 SLAVE: Invalid message (too small)");
+        return false;
+    }
+}
+
+static void
+addCounters(CS104_ConnectionMetrics sum, CS104_ConnectionMetrics metrics)
+{
+    sum->iFramesReceived += metrics->iFramesReceived;
+    sum->iFramesSent += metrics->iFramesSent;
+    sum->sFramesReceived += metrics->sFramesReceived;
+    sum->sFramesSent += metrics->sFramesSent;
+    sum->uFramesReceived += metrics->uFramesReceived;
+    sum->uFramesSent += metrics->uFramesSent;
+    sum->bytesReceived += metrics->bytesReceived;
+    sum->bytesSent += metrics->bytesSent;
+    sum->kWindowStalls += metrics->kWindowStalls;
+    sum->t1Timeouts += metrics->t1Timeouts;
+    sum->t2Timeouts += metrics->t2Timeouts;
+    sum->t3Timeouts += metrics->t3Timeouts;
+    sum->highPrioQueueFull += metrics->highPrioQueueFull;
+}
+
+/* read a counter of the connection metrics and optionally reset it (requires metricsLock without 64 bit atomics) */
+static uint64_t
+MasterConnection_readCounter(uint64_t* counter, bool reset)
+{
+#if (CS104_SLAVE_HAS_ATOMICS64 == 1)
+    if (reset)
+        return atomicExchange64((volatile uint64_t*)counter, 0);
+    else
+        return atomicLoad64((volatile uint64_t*)counter);
+#else
+    uint64_t value = *counter;
+
+    if (reset)
+        *counter = 0;
+
+    return value;
+#endif
+}
+
+/**
+ * Copy the counters of the connection metrics. Each counter is read atomically (or with the
+ * metricsLock when 64 bit atomics are not available).
+ *
+ * \param reset true to reset the counters (connection is closed)
+ */
+static void
+MasterConnection_copyCounters(MasterConnection self, CS104_ConnectionMetrics counters, bool reset)
+{
+    CS104_ConnectionMetrics metrics = &(self->metrics);
+
+#if (CS104_SLAVE_HAS_ATOMICS64 == 0) && (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->metricsLock);
+#endif
+
+    counters->iFramesReceived = MasterConnection_readCounter(&(metrics->iFramesReceived), reset);
+    counters->iFramesSent = MasterConnection_readCounter(&(metrics->iFramesSent), reset);
+    counters->sFramesReceived = MasterConnection_readCounter(&(metrics->sFramesReceived), reset);
+    counters->sFramesSent = MasterConnection_readCounter(&(metrics->sFramesSent), reset);
+    counters->uFramesReceived = MasterConnection_readCounter(&(metrics->uFramesReceived), reset);
+    counters->uFramesSent = MasterConnection_readCounter(&(metrics->uFramesSent), reset);
+    counters->bytesReceived = MasterConnection_readCounter(&(metrics->bytesReceived), reset);
+    counters->bytesSent = MasterConnection_readCounter(&(metrics->bytesSent), reset);
+    counters->kWindowStalls = MasterConnection_readCounter(&(metrics->kWindowStalls), reset);
+    counters->t1Timeouts = MasterConnection_readCounter(&(metrics->t1Timeouts), reset);
+    counters->t2Timeouts = MasterConnection_readCounter(&(metrics->t2Timeouts), reset);
+    counters->t3Timeouts = MasterConnection_readCounter(&(metrics->t3Timeouts), reset);
+    counters->highPrioQueueFull = MasterConnection_readCounter(&(metrics->highPrioQueueFull), reset);
+
+#if (CS104_SLAVE_HAS_ATOMICS64 == 0) && (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->metricsLock);
+#endif
+}
+
+/* move the counters of a closed connection to the totals of the slave and the redundancy group */
+static void
+MasterConnection_releaseMetrics(MasterConnection self)
+{
+    CS104_Slave slave = self->slave;
+
+    struct sCS104_ConnectionMetrics counters;
+
+    memset(&counters, 0, sizeof(counters));
+
+    MasterConnection_copyCounters(self, &counters, true);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(slave->metricsLock);
+#endif
+
+    addCounters(&(slave->closedConnectionMetrics), &counters);
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->redundancyGroup)
+        addCounters(&(self->redundancyGroup->closedConnectionMetrics), &counters);
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(slave->metricsLock);
+#endif
+}
+
+static void
+MasterConnection_deinit(MasterConnection self)
+{
+    if (self)
+    {
+        MasterConnection_releaseMetrics(self);
+        MasterConnection_releaseCommands(self);
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        if (self->tlsSocket != NULL)
+            TLSSocket_close(self->tlsSocket);
+#endif
+
+        if (self->socket)
+        {
+            Socket_destroy(self->socket);
+            self->socket = NULL;
+        }
+
+        self->state = M_CON_STATE_STOPPED;
+    }
+}
+
+static void
+MasterConnection_destroy(MasterConnection self)
+{
+    if (self)
+    {
+        GLOBAL_FREEMEM(self->sentASDUs);
+
+        if (self->txBuffer)
+            GLOBAL_FREEMEM(self->txBuffer);
+
+        if (self->rxBuffer)
+            GLOBAL_FREEMEM(self->rxBuffer);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_destroy(self->sentASDUsLock);
+        Semaphore_destroy(self->stateLock);
+        Semaphore_destroy(self->txBufferLock);
+        Semaphore_destroy(self->metricsLock);
+#endif
+
+        Handleset_destroy(self->handleSet);
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+        if (self->slave->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+        {
+            MessageQueue_destroy(self->lowPrioQueue);
+            HighPriorityASDUQueue_destroy(self->highPrioQueue);
+        }
+#endif
+
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+/* unprotected version of sendNextLowPriorityASDU (caller has to hold the sentASDUsLock) */
+static bool
+_sendNextLowPriorityASDU(MasterConnection self)
+{
+    bool retVal = false;
+    uint8_t* asduBuffer;
+
+    if (isSentBufferFull(self))
+        return false;
+
+    MessageQueue_lock(self->lowPrioQueue);
+
+    uint64_t entryId;
+    uint8_t* queueEntry;
+    int msgSize;
+
+    asduBuffer = MessageQueue_getNextWaitingASDU(self->lowPrioQueue, &entryId, &queueEntry, &msgSize);
+
+    if (asduBuffer)
+    {
+        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, asduBuffer, msgSize);
+
+        msgSize += IEC60870_5_104_APCI_LENGTH;
+
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+        /* time when the entry was added (monotonic time) */
+        uint64_t enqueueTime = MessageLog_getEntryTime(self->lowPrioQueue->log, entryId);
+#endif
+
+        MessageQueue_unlock(self->lowPrioQueue);
+
+        retVal = sendASDU(self, self->sendBuffer, msgSize, entryId, queueEntry);
+
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+        if (retVal)
+            MasterConnection_recordQueueWait(self, entryId, queueEntry, enqueueTime);
+#endif
+    }
+    else
+    {
+        MessageQueue_unlock(self->lowPrioQueue);
+    }
+
+    return retVal;
+}
+
+#ifdef SEC_AUTH_60870_5_7
+static void
+sendNextLowPriorityASDU(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    _sendNextLowPriorityASDU(self);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+}
+#endif /* SEC_AUTH_60870_5_7 */
+
+/* unprotected version of sendNextHighPriorityASDU (caller has to hold the sentASDUsLock) */
+static bool
+_sendNextHighPriorityASDU(MasterConnection self)
+{
+    bool retVal = false;
+    uint8_t* buffer = NULL;
+    int msgSize = 0;
+
+    if (isSentBufferFull(self))
+        return false;
+
+    HighPriorityASDUQueue_lock(self->highPrioQueue);
+
+    buffer = HighPriorityASDUQueue_getNextASDU(self->highPrioQueue, &msgSize);
+
+    if (buffer)
+    {
+        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, buffer, msgSize);
+
+        HighPriorityASDUQueue_unlock(self->highPrioQueue);
+
+        msgSize += IEC60870_5_104_APCI_LENGTH;
+
+        retVal = sendASDU(self, self->sendBuffer, msgSize, 0, NULL);
+    }
+    else
+    {
+        HighPriorityASDUQueue_unlock(self->highPrioQueue);
+    }
+
+    return retVal;
+}
+
+/* send the next ASDU of the interrogation response (caller has to hold the sentASDUsLock) */
+static bool
+_sendNextInterrogationASDU(MasterConnection self)
+{
+    if (isSentBufferFull(self))
+        return false;
+
+    CS104_Slave slave = self->slave;
+
+    sCS101_StaticASDU _asdu;
+
+    CS101_ASDU asdu = NULL;
+
+    if (self->interrogationResponse == INTERROGATION_RESPONSE_DATABASE)
+    {
+        asdu = CS101_StationDatabase_getNextInterrogationASDU(slave->stationDatabase, &(self->interrogationCursor),
+                                                              &_asdu);
+    }
+    else if (slave->getNextInterrogationASDUHandler)
+    {
+        asdu = slave->getNextInterrogationASDUHandler(slave->getNextInterrogationASDUHandlerParameter,
+                                                      &(self->iMasterConnection));
+    }
+
+    if (asdu == NULL)
+    {
+        /* response is complete */
+        self->interrogationResponse = INTERROGATION_RESPONSE_NONE;
+        return true;
+    }
+
+    struct sBufferFrame bufferFrame;
+
+    Frame frame = BufferFrame_initialize(&bufferFrame, self->sendBuffer, IEC60870_5_104_APCI_LENGTH,
+                                         sizeof(self->sendBuffer));
+    CS101_ASDU_encode(asdu, frame);
+
+    return sendASDU(self, self->sendBuffer, Frame_getMsgSize(frame), 0, NULL);
+}
+
+/**
+ * Send all high-priority ASDUs and then the waiting ASDUs from the low-priority queue. The APDUs
+ * are collected in the output buffer and sent with a single socket write when the buffer is full
+ * or no more ASDUs can be sent.
+ * Returns true if ASDUs can be sent immediately. This can happen when the output buffer was full
+ * or the socket was congested. ASDUs that are blocked by the k-window are not reported because
+ * the connection is woken up by the confirmation of the client.
+ */
+static bool
+sendWaitingASDUs(MasterConnection self)
+{
+    /* the socket is congested -> no more APDUs are added to the output buffer until it is writable again */
+    if (MasterConnection_flushTxBuffer(self))
+        return false;
+
+#ifdef SEC_AUTH_60870_5_7
+
+    SecureEndpoint secureEndpoint = NULL;
+
+    secureEndpoint = self->slave->secureEndpoint;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+
+    if (self->redundancyGroup)
+    {
+        if (self->redundancyGroup->secureEndpoint)
+            secureEndpoint = self->redundancyGroup->secureEndpoint;
+    }
+
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+    if (secureEndpoint)
+    {
+        if (SecureEndpoint_hasWaitingAsdu(secureEndpoint))
+        {
+            uint8_t buffer[256];
+            struct sBufferFrame _bufferFrame;
+            Frame bufferFrame = BufferFrame_initialize(&_bufferFrame, buffer, 0, 256);
+
+            bool trySend = true;
+            bool sentBufferFull = false;
+
+            while (trySend)
+            {
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_wait(self->sentASDUsLock);
+#endif
+
+                if (isSentBufferFull(self) == false)
+                {
+                    bufferFrame = BufferFrame_initialize(&_bufferFrame, buffer, 0, 256);
+
+                    Frame asdu = SecureEndpoint_getNextWaitingAsdu(secureEndpoint, bufferFrame);
+
+                    if (asdu)
+                    {
+                        int msgSize = Frame_getMsgSize(asdu);
+
+                        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, Frame_getBuffer(asdu), msgSize);
+
+                        msgSize += IEC60870_5_104_APCI_LENGTH;
+
+                        sendASDU(self, self->sendBuffer, msgSize, 0, NULL); 
+                    }
+                    else
+                    {
+                        trySend = false;
+                    }
+                }
+                else
+                {
+                    trySend = false;
+                    sentBufferFull = true;
+                }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_post(self->sentASDUsLock);
+#endif
+
+                if (sentBufferFull)
+                    return true;     
+            }
+        }
+
+        /* check if M_EI_NA_1 is waiting and send when waiting */
+        TypeID typeId = (TypeID)0;
+        if (MessageQueue_isAsduAvailable(self->lowPrioQueue, &typeId) && (typeId == M_EI_NA_1))
+        {
+            sendNextLowPriorityASDU(self);
+        }
+
+        if (SecureEndpoint_sessionReady(secureEndpoint) == false)
+        {
+            return false;
+        }
+
+        if (SecureEndpoint_isChallengeInitialized(secureEndpoint) == false)
+        {
+            return false;
+        }
+    }
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+    bool isAsduWaiting = false;
+    bool isStalled = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    MasterConnection_beginTxBatch(self);
+
+    while (MasterConnection_isRunning(self))
+    {
+        /* send all available high priority ASDUs first */
+        if (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue))
+        {
+            if (_sendNextHighPriorityASDU(self) == false)
+            {
+                isStalled = isSentBufferFull(self);
+                break;
+            }
+        }
+        /* send the interrogation response before the events */
+        else if (self->interrogationResponse != INTERROGATION_RESPONSE_NONE)
+        {
+            if (_sendNextInterrogationASDU(self) == false)
+            {
+                isStalled = isSentBufferFull(self);
+                break;
+            }
+        }
+        /* send messages from low-priority queue */
+        else if (MessageQueue_isAsduAvailable(self->lowPrioQueue, NULL))
+        {
+            if (_sendNextLowPriorityASDU(self) == false)
+            {
+                isStalled = isSentBufferFull(self);
+                break;
+            }
+        }
+        else
+            break;
+
+        if (MasterConnection_isTxBatchFull(self))
+        {
+            /* output buffer is full -> continue after the next socket check */
+            isAsduWaiting = true;
+            break;
+        }
+    }
+
+    /* socket is congested -> the event loop waits until the socket is writable (not counted as waiting ASDUs) */
+    if (MasterConnection_flushTxBuffer(self))
+        isAsduWaiting = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    /* ASDUs are waiting but the k-window is full */
+    if (isStalled)
+        MasterConnection_incrementCounter(self, &(self->metrics.kWindowStalls));
+
+    return isAsduWaiting;
+}
+
+static bool
+handleTimeouts(MasterConnection self)
+{
+    uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+    bool timeoutsOk = true;
+
+    /* send remaining data of the output buffer (when the socket was congested before) */
+    MasterConnection_flushTxBuffer(self);
+
+    /* check T3 timeout */
+    if (checkT3Timeout(self, currentTime))
+    {
+        MasterConnection_incrementCounter(self, &(self->metrics.t3Timeouts));
+
+        int writeToSocketResult = writeToSocket(self, TESTFR_ACT_MSG, TESTFR_ACT_MSG_SIZE);
+
+        if (writeToSocketResult < 0)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Failed to write TESTFR ACT message\n");
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+            self->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+        }
+        else if (writeToSocketResult > 0)
+        {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+            self->waitingForTestFRcon = true;
+            resetTestFRConTimeout(self, currentTime);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    /* Check for TEST FR con timeout */
+    if (self->waitingForTestFRcon && checkTestFRConTimeout(self, currentTime))
+    {
+        DEBUG_PRINT("CS104 SLAVE: Timeout for TESTFR CON message\n");
+
+        MasterConnection_incrementCounter(self, &(self->metrics.t1Timeouts));
+
+        /* close connection */
+        timeoutsOk = false;
+    }
+
+    /* check timeout for others station I messages */
+    if (self->unconfirmedReceivedIMessages > 0)
+    {
+        /* Check validity of last confirmation time */
+        if (self->lastConfirmationTime != UINT64_MAX && self->lastConfirmationTime > currentTime)
+        {
+            /* last confirmation time is in the future (maybe caused by system time change) */
+            self->lastConfirmationTime = currentTime;
+        }
+
+        if (currentTime > self->lastConfirmationTime)
+        {
+            if ((currentTime - self->lastConfirmationTime) >= (uint64_t)(self->slave->conParameters.t2 * 1000))
+            {
+                MasterConnection_incrementCounter(self, &(self->metrics.t2Timeouts));
+
+                self->lastConfirmationTime = currentTime;
+                self->unconfirmedReceivedIMessages = 0;
+                self->timeoutT2Triggered = false;
+                _sendSMessage(self);
+            }
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    /* check if counterpart confirmed I message */
+    if (self->oldestSentASDU != -1)
+    {
+        /* check validity of sent time */
+
+        if (self->sentASDUs[self->oldestSentASDU].sentTime > currentTime)
+        {
+            /* sent time is in the future (maybe caused by system time change) */
+            self->sentASDUs[self->oldestSentASDU].sentTime = currentTime;
+        }
+
+        if (currentTime > self->sentASDUs[self->oldestSentASDU].sentTime)
+        {
+
+            if ((currentTime - self->sentASDUs[self->oldestSentASDU].sentTime) >=
+                (uint64_t)(self->slave->conParameters.t1 * 1000))
+            {
+                timeoutsOk = false;
+
+                MasterConnection_incrementCounter(self, &(self->metrics.t1Timeouts));
+
+                printSendBuffer(self);
+
+                DEBUG_PRINT("CS104 SLAVE: I message timeout for %i seqNo: %i\n", self->oldestSentASDU,
+                            self->sentASDUs[self->oldestSentASDU].seqNo);
+            }
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    return timeoutsOk;
+}
+
+/**
+ * Get the time until the next protocol timer (T1, T2, T3) has to be checked
+ *
+ * \return the time to wait in ms (at least 1 ms and at most maxWaitTime)
+ */
+static unsigned int
+MasterConnection_getWaitTime(MasterConnection self, uint64_t currentTime, unsigned int maxWaitTime)
+{
+    uint64_t nextDeadline = currentTime + maxWaitTime;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    if (self->waitingForTestFRcon)
+    {
+        if (self->nextTestFRConTimeout < nextDeadline)
+            nextDeadline = self->nextTestFRConTimeout;
+    }
+    else
+    {
+        if (self->nextT3Timeout < nextDeadline)
+            nextDeadline = self->nextT3Timeout;
+    }
+
+    if ((self->unconfirmedReceivedIMessages > 0) && (self->lastConfirmationTime != UINT64_MAX))
+    {
+        uint64_t t2Deadline = self->lastConfirmationTime + (uint64_t)(self->slave->conParameters.t2 * 1000);
+
+        if (t2Deadline < nextDeadline)
+            nextDeadline = t2Deadline;
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    if (self->oldestSentASDU != -1)
+    {
+        uint64_t t1Deadline = self->sentASDUs[self->oldestSentASDU].sentTime + (uint64_t)(self->slave->conParameters.t1 * 1000);
+
+        if (t1Deadline < nextDeadline)
+            nextDeadline = t1Deadline;
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    /* timeouts are detected when the current time is after the deadline */
+    if (nextDeadline < currentTime)
+        return 1;
+
+    uint64_t waitTime = nextDeadline - currentTime + 1;
+
+    if (waitTime > maxWaitTime)
+        waitTime = maxWaitTime;
+
+    return (unsigned int)waitTime;
+}
+
+/**
+ * Check if the periodic tasks of all connections have to be executed in a fixed interval
+ *
+ * \param wakeupEnabled true when the handle set is woken up by enqueued ASDUs
+ */
+static bool
+CS104_Slave_requiresPolling(CS104_Slave self, bool wakeupEnabled)
+{
+    /* poll when enqueued ASDUs cannot wake up the connections or plugins have to be called periodically */
+    if (wakeupEnabled == false)
+        return true;
+
+    if (self->plugins && LinkedList_getNext(self->plugins))
+        return true;
+
+#ifdef SEC_AUTH_60870_5_7
+    /* the secure endpoints have to be called periodically */
+    return true;
+#else
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsConfig)
+        return true;
+#endif
+
+    return false;
+#endif /* SEC_AUTH_60870_5_7 */
+}
+
+/**
+ * Get the maximum time the connection handling can wait for new events
+ *
+ * \param wakeupEnabled true when the handle set is woken up by enqueued ASDUs
+ */
+static unsigned int
+CS104_Slave_getMaxWaitTime(CS104_Slave self, bool wakeupEnabled)
+{
+    if (CS104_Slave_requiresPolling(self, wakeupEnabled))
+        return 100;
+
+    return CONFIG_CS104_SLAVE_MAX_WAIT_TIME;
+}
+
+/**
+ * Arm the timer of the connection for the next protocol timer (T1, T2, T3, TESTFR CON)
+ *
+ * Used by the event loops of the workers and the threadless mode. The connection is only
+ * handled again when the timer expires, data is received, or the event loop is woken up.
+ */
+static void
+MasterConnection_armTimer(MasterConnection self, TimerWheel timers, uint64_t currentTime)
+{
+    /* the T3 timeout (or TESTFR CON timeout) is always running */
+    unsigned int maxWaitTime = 0x7fffffff;
+
+    if (self->txBuffer)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->txBufferLock);
+#endif
+
+        /* retry to send the output buffer when the socket is congested and not monitored for writability */
+        if ((self->txBufferPos > 0) && (self->txWriteInterest == false))
+            maxWaitTime = TX_BUFFER_RETRY_INTERVAL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->txBufferLock);
+#endif
+    }
+
+    TimerWheel_add(timers, &(self->timer), currentTime + MasterConnection_getWaitTime(self, currentTime, maxWaitTime));
+}
+
+static void
+CS104_Slave_closeAllConnections(CS104_Slave self)
+{
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
+
+    while (self->numberOfActiveConnections > 0)
+    {
+        MasterConnection con = self->activeConnections[self->numberOfActiveConnections - 1];
+
+        releaseConnection(self, con);
+        MasterConnection_deinit(con);
+    }
+
+    self->openConnections = 0;
+
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_post(self->openConnectionsLock);
+#endif
+}
+
+static void
+MasterConnection_raiseOpenedEvent(MasterConnection self)
+{
+    if (self->slave->connectionEventHandler)
+    {
+        self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection),
+                                            CS104_CON_EVENT_CONNECTION_OPENED);
+    }
+
+#ifdef SEC_AUTH_60870_5_7
+
+    if (self->slave->secureEndpoint)
+    {
+        SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+    }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+    {
+        SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+    }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+}
+
+/**
+ * Read and handle a received message (when available)
+ *
+ * \return false in case of a socket error, true otherwise
+ */
+static bool
+MasterConnection_handleReceivedMessage(MasterConnection self)
+{
+    int bytesRec = receiveMessage(self, true);
+
+    if (bytesRec == -1)
+    {
+        DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
+        return false;
+    }
+
+    /* handle all complete messages that were received with a single socket read */
+    while ((bytesRec > 0) && MasterConnection_isRunning(self))
+    {
+        DEBUG_PRINT("CS104 SLAVE: Connection(%p): rcvd msg(%i bytes)\n", self, bytesRec);
+
+        if (self->slave->rawMessageHandler)
+            self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter, &(self->iMasterConnection),
+                                           self->recvBuffer, bytesRec, false);
+
+        if (handleMessage(self, self->recvBuffer, bytesRec) == false)
+        {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+            self->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+        }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+        if (self->unconfirmedReceivedIMessages >= self->slave->conParameters.w)
+        {
+            self->lastConfirmationTime = Hal_getMonotonicTimeInMs();
+
+            self->unconfirmedReceivedIMessages = 0;
+
+            self->timeoutT2Triggered = false;
+
+            _sendSMessage(self);
+        }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+        bytesRec = receiveMessage(self, false);
+
+        if (bytesRec == -1)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Invalid message in receive buffer\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Handle timeouts, send waiting ASDUs, and run the periodic tasks of TLS, secure endpoints and plugins
+ *
+ * \return true when ASDUs are still waiting to be sent, false otherwise
+ */
+static bool
+MasterConnection_runPeriodicTasks(MasterConnection self)
+{
+    bool isAsduWaiting = false;
+
+    if (handleTimeouts(self) == false)
+    {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+        self->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+    }
+
+    if (MasterConnection_isRunning(self))
+    {
+        if (MasterConnection_isActive(self))
+        {
+            isAsduWaiting = sendWaitingASDUs(self);
+        }
+    }
+
+#ifdef SEC_AUTH_60870_5_7
+    if (self->slave->secureEndpoint)
+    {
+        if (SecureEndpoint_runTask(self->slave->secureEndpoint, &(self->iMasterConnection)) == false)
+        {
+            MasterConnection_close(self);
+        }
+    }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+    {
+        if (SecureEndpoint_runTask(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection)) == false)
+        {
+            MasterConnection_close(self);
+        }
+    }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket != NULL)
+    {
+        if (TLSSocket_tick(self->tlsSocket) == false)
+        {
+            MasterConnection_close(self);
+        }
+    }
+#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+
+    /* call plugins */
+    if (self->slave->plugins)
+    {
+        LinkedList pluginElem = LinkedList_getNext(self->slave->plugins);
+
+        while (pluginElem)
+        {
+            CS101_SlavePlugin plugin = (CS101_SlavePlugin)LinkedList_getData(pluginElem);
+
+            if (plugin->runTask)
+            {
+                plugin->runTask(plugin->parameter, &(self->iMasterConnection));
+            }
+
+            pluginElem = LinkedList_getNext(pluginElem);
+        }
+    }
+
+    return isAsduWaiting;
+}
+
+/**
+ * Inform the application about the closed connection and release the unconfirmed ASDUs
+ */
+static void
+MasterConnection_finalize(MasterConnection self)
+{
+    if (self->slave->connectionEventHandler)
+    {
+        self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection),
+                                            CS104_CON_EVENT_CONNECTION_CLOSED);
+    }
+
+#ifdef SEC_AUTH_60870_5_7
+
+    if (self->slave->secureEndpoint)
+    {
+        SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+    }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+    {
+        SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+    }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+    self->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+    if (!self->requeuedOnActivate)
+        MessageQueue_setWaitingForTransmissionWhenNotConfirmed(self->lowPrioQueue);
+}
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+/**
+ * Create the TLS context and perform the TLS handshake (blocking)
+ *
+ * \return true when TLS is not used or the handshake succeeded, false otherwise
+ */
+static bool
+MasterConnection_startTLS(MasterConnection self)
+{
+    if (self->slave->tlsConfig)
+    {
+        /* a client that doesn't complete the handshake within t0 must not block the caller (e.g. a handshake thread) */
+        self->tlsSocket =
+            TLSSocket_createEx(self->socket, self->slave->tlsConfig, false, self->slave->conParameters.t0 * 1000);
+
+        if (self->tlsSocket == NULL)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Failed to create TLS context. Close connection\n");
+
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+
+static void*
+connectionHandlingThread(void* parameter)
+{
+    MasterConnection self = (MasterConnection)parameter;
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket == NULL)
+    {
+        if (MasterConnection_startTLS(self) == false)
+        {
+            /* connection is released by the server thread */
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+
+            self->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->stateLock);
+#endif
+
+            return NULL;
+        }
+
+#if (CONFIG_USE_THREADS == 1)
+        /* hand over the connection to a worker after the handshake */
+        if (self->slave->threadingModel == CS104_THREADING_MODEL_EVENT_LOOP)
+        {
+            if (CS104_Slave_assignConnectionToWorker(self->slave, self, NULL))
+                return NULL;
+        }
+#endif
+    }
+#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+
+    resetT3Timeout(self, Hal_getMonotonicTimeInMs());
+
+    bool isAsduWaiting = false;
+
+    unsigned int maxWaitTime = CS104_Slave_getMaxWaitTime(self->slave, Handleset_enableWakeup(self->handleSet));
+
+    MasterConnection_raiseOpenedEvent(self);
+
+    while (MasterConnection_isRunning(self))
+    {
+        Handleset_reset(self->handleSet);
+        Handleset_addSocket(self->handleSet, self->socket);
+
+        /* the write interest is removed by Handleset_reset */
+        self->txWriteInterest = false;
+
+        unsigned int socketTimeout;
+
+        /*
+         * When an ASDU can be sent only have a short look to see if a client request
+         * was received. Otherwise wait until data is received, a new ASDU is enqueued,
+         * a protocol timer expires, or the congested socket is writable again.
+         */
+        if (isAsduWaiting)
+            socketTimeout = 0;
+        else
+        {
+            socketTimeout = MasterConnection_getWaitTime(self, Hal_getMonotonicTimeInMs(), maxWaitTime);
+
+            if (MasterConnection_isTxCongested(self) && (MasterConnection_updateWriteInterest(self, self->handleSet) == false))
+            {
+                if (socketTimeout > TX_BUFFER_RETRY_INTERVAL)
+                    socketTimeout = TX_BUFFER_RETRY_INTERVAL;
+            }
+        }
+
+        int readySockets = Handleset_waitReady(self->handleSet, socketTimeout);
+
+        /* the next wakeup request signals the wakeup handle again */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->stateLock);
+#endif
+
+        self->wakeupRequested = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->stateLock);
+#endif
+
+        if ((readySockets > 0) && Handleset_isReady(self->handleSet, self->socket))
+        {
+            if (MasterConnection_handleReceivedMessage(self) == false)
+                break;
+        }
+
+        isAsduWaiting = MasterConnection_runPeriodicTasks(self);
+    }
+
+    MasterConnection_finalize(self);
+
+    return NULL;
+}
+
+#if (CONFIG_USE_THREADS == 1)
+
+/***************************************************
+ * Worker (threading model CS104_THREADING_MODEL_EVENT_LOOP)
+ ***************************************************/
+
+struct sCS104_SlaveWorker
+{
+    CS104_Slave slave;
+
+    Thread thread;
+    bool isRunning;
+
+    HandleSet handleSet;
+    bool handleSetChanged; /* handle set has to be rebuilt before next wait */
+
+    ServerSocket serverSocket; /* own listening socket (accept sharding) or NULL */
+    bool wakeupEnabled;    /* handle set is woken up by new connections and enqueued ASDUs */
+    bool wakeupRequested;  /* all connections have to be handled, e.g. ASDUs were enqueued (protected by lock) */
+
+    struct sTimerWheel timers; /* protocol timers of the connections (only accessed by worker thread) */
+
+    LinkedList connections;    /* connections handled by the worker (only accessed by worker thread) */
+    LinkedList newConnections; /* connections assigned to the worker but not yet started (protected by lock) */
+
+    int numberOfConnections; /* number of assigned connections (protected by lock) */
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore lock;
+    Semaphore idleSignal; /* posted for new connections and stop (wakes up an idle worker without wakeup handle) */
+#endif
+};
+
+static bool
+CS104_SlaveWorker_isRunning(CS104_SlaveWorker self)
+{
+    bool isRunning;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    isRunning = self->isRunning;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    return isRunning;
+}
+
+/*
+ * wake up the worker thread to handle all connections (e.g. when new ASDUs are waiting)
+ *
+ * Only the first request after the worker took the last one signals the wakeup handle.
+ */
+static void
+CS104_SlaveWorker_wakeup(CS104_SlaveWorker self)
+{
+    bool wasRequested;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    wasRequested = self->wakeupRequested;
+    self->wakeupRequested = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    if (wasRequested == false)
+        Handleset_wakeup(self->handleSet);
+}
+
+static bool
+CS104_SlaveWorker_takeWakeupRequest(CS104_SlaveWorker self)
+{
+    bool wakeupRequested;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    wakeupRequested = self->wakeupRequested;
+    self->wakeupRequested = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    return wakeupRequested;
+}
+
+static void
+CS104_SlaveWorker_releaseConnection(CS104_SlaveWorker self, MasterConnection connection)
+{
+    LinkedList_remove(self->connections, connection);
+
+    TimerWheel_remove(&(self->timers), &(connection->timer));
+
+    self->handleSetChanged = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    self->numberOfConnections--;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    /* the server thread can now release the connection */
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(connection->stateLock);
+#endif
+
+    connection->worker = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(connection->stateLock);
+#endif
+}
+
+/* take over the connections assigned by the server thread */
+static void
+CS104_SlaveWorker_startNewConnections(CS104_SlaveWorker self)
+{
+    LinkedList newConnections = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    if (LinkedList_getNext(self->newConnections))
+    {
+        newConnections = self->newConnections;
+        self->newConnections = LinkedList_create();
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    if (newConnections)
+    {
+        LinkedList element = LinkedList_getNext(newConnections);
+
+        while (element)
+        {
+            MasterConnection con = (MasterConnection)LinkedList_getData(element);
+
+            resetT3Timeout(con, Hal_getMonotonicTimeInMs());
+
+            MasterConnection_raiseOpenedEvent(con);
+
+            LinkedList_add(self->connections, con);
+
+            element = LinkedList_getNext(element);
+        }
+
+        LinkedList_destroyStatic(newConnections);
+
+        self->handleSetChanged = true;
+    }
+}
+
+/* maximum number of connections accepted by a worker before the other connections are handled */
+#define CS104_SLAVE_WORKER_MAX_ACCEPTS 16
+
+/* accept new connections with the listening socket of the worker (accept sharding) */
+static void
+CS104_SlaveWorker_acceptConnections(CS104_SlaveWorker self)
+{
+    int i;
+
+    for (i = 0; i < CS104_SLAVE_WORKER_MAX_ACCEPTS; i++)
+    {
+        Socket newSocket = ServerSocket_accept(self->serverSocket);
+
+        if (newSocket == NULL)
+            break;
+
+        MasterConnection connection = CS104_Slave_openConnection(self->slave, newSocket);
+
+        if (connection)
+        {
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+            /* the TLS handshake is performed by a connection thread (connection is assigned to a worker later) */
+            if (self->slave->tlsConfig)
+            {
+                MasterConnection_start(connection);
+                continue;
+            }
+#endif
+
+            CS104_Slave_assignConnectionToWorker(self->slave, connection, self);
+        }
+    }
+}
+
+static void*
+CS104_SlaveWorker_thread(void* parameter)
+{
+    CS104_SlaveWorker self = (CS104_SlaveWorker)parameter;
+
+    bool isAsduWaiting = false;
+
+    unsigned int maxWaitTime = CS104_Slave_getMaxWaitTime(self->slave, self->wakeupEnabled);
+
+    bool requiresPolling = CS104_Slave_requiresPolling(self->slave, self->wakeupEnabled);
+
+    TimerWheel_init(&(self->timers), Hal_getMonotonicTimeInMs());
+
+    while (CS104_SlaveWorker_isRunning(self))
+    {
+        CS104_SlaveWorker_startNewConnections(self);
+
+        /* without wakeup the worker cannot wait for new connections on the handle set */
+        if ((self->wakeupEnabled == false) && (self->serverSocket == NULL) &&
+            (LinkedList_getNext(self->connections) == NULL))
+        {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->idleSignal);
+#else
+            Thread_sleep(10);
+#endif
+            continue;
+        }
+
+        if (self->handleSetChanged)
+        {
+            Handleset_reset(self->handleSet);
+
+            if (self->serverSocket)
+                Handleset_addSocket(self->handleSet, (Socket)self->serverSocket);
+
+            LinkedList element = LinkedList_getNext(self->connections);
+
+            while (element)
+            {
+                MasterConnection con = (MasterConnection)LinkedList_getData(element);
+
+                Handleset_addSocket(self->handleSet, con->socket);
+
+                /* the write interest is removed by Handleset_reset */
+                con->txWriteInterest = false;
+                MasterConnection_updateWriteInterest(con, self->handleSet);
+
+                element = LinkedList_getNext(element);
+            }
+
+            self->handleSetChanged = false;
+        }
+
+        /*
+         * When an ASDU can be sent only have a short look to see if a client request
+         * was received. Otherwise wait until data is received, a new ASDU is enqueued,
+         * or the next protocol timer of a connection expires.
+         */
+        unsigned int waitTime = 0;
+
+        if (isAsduWaiting == false)
+            waitTime = TimerWheel_getWaitTime(&(self->timers), Hal_getMonotonicTimeInMs(), maxWaitTime);
+
+        int readySockets = Handleset_waitReady(self->handleSet, waitTime);
+
+        if (self->serverSocket && (readySockets > 0) && Handleset_isReady(self->handleSet, (Socket)self->serverSocket))
+            CS104_SlaveWorker_acceptConnections(self);
+
+        /* all connections are handled when ASDUs are waiting or were enqueued */
+        bool handleAll = isAsduWaiting || requiresPolling;
+
+        if (CS104_SlaveWorker_takeWakeupRequest(self))
+            handleAll = true;
+
+        isAsduWaiting = false;
+
+        uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+        /* the timers of connections with an expired protocol timer are not armed anymore */
+        TimerWheel_advance(&(self->timers), currentTime);
+
+        LinkedList element = LinkedList_getNext(self->connections);
+
+        while (element)
+        {
+            MasterConnection con = (MasterConnection)LinkedList_getData(element);
+
+            /* get next element here because the current element can be removed from the list */
+            element = LinkedList_getNext(element);
+
+            if (MasterConnection_isRunning(con))
+            {
+                bool handleConnection = handleAll || (TimerWheelEntry_isArmed(&(con->timer)) == false);
+
+                if ((readySockets > 0) && Handleset_isReady(self->handleSet, con->socket))
+                {
+                    if (MasterConnection_handleReceivedMessage(con) == false)
+                    {
+                        MasterConnection_close(con);
+                    }
+
+                    handleConnection = true;
+                }
+
+                /* congested socket can accept more data */
+                if ((readySockets > 0) && con->txWriteInterest && Handleset_isWritable(self->handleSet, con->socket))
+                    handleConnection = true;
+
+                /* idle connections are only handled when their next protocol timer expires */
+                if (handleConnection && MasterConnection_isRunning(con))
+                {
+                    if (MasterConnection_runPeriodicTasks(con))
+                        isAsduWaiting = true;
+
+                    MasterConnection_updateWriteInterest(con, self->handleSet);
+
+                    MasterConnection_armTimer(con, &(self->timers), currentTime);
+                }
+            }
+
+            if (MasterConnection_isRunning(con) == false)
+            {
+                MasterConnection_finalize(con);
+
+                CS104_SlaveWorker_releaseConnection(self, con);
+            }
+        }
+    }
+
+    /* worker is stopped -> close all connections */
+    CS104_SlaveWorker_startNewConnections(self);
+
+    LinkedList element = LinkedList_getNext(self->connections);
+
+    while (element)
+    {
+        MasterConnection con = (MasterConnection)LinkedList_getData(element);
+
+        element = LinkedList_getNext(element);
+
+        MasterConnection_close(con);
+
+        MasterConnection_finalize(con);
+
+        CS104_SlaveWorker_releaseConnection(self, con);
+    }
+
+    return NULL;
+}
+
+static void
+CS104_Slave_startWorkers(CS104_Slave self)
+{
+    CS104_SlaveWorker workers = (CS104_SlaveWorker)GLOBAL_CALLOC(self->numberOfWorkers, sizeof(struct sCS104_SlaveWorker));
+
+    if (workers)
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+        {
+            CS104_SlaveWorker worker = &(workers[i]);
+
+            worker->slave = self;
+            worker->isRunning = true;
+            worker->handleSet = Handleset_new();
+            worker->handleSetChanged = true;
+            worker->wakeupEnabled = Handleset_enableWakeup(worker->handleSet);
+            worker->wakeupRequested = false;
+            worker->connections = LinkedList_create();
+            worker->newConnections = LinkedList_create();
+            worker->numberOfConnections = 0;
+            worker->serverSocket = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            worker->lock = Semaphore_create(1);
+            worker->idleSignal = Semaphore_create(0);
+#endif
+        }
+
+        self->isAcceptShardingActive = false;
+
+        if (self->acceptSharding)
+        {
+            const char* localAddress = self->localAddress ? self->localAddress : "0.0.0.0";
+
+            bool success = true;
+
+            /*
+             * Another process of the same user with a shared listening socket would silently get a part of the
+             * connections -> check that the port is not in use (a socket without SO_REUSEPORT cannot be bound then)
+             */
+            ServerSocket testSocket = TcpServerSocket_create(localAddress, self->tcpPort);
+
+            if (testSocket)
+            {
+                ServerSocket_destroy(testSocket);
+            }
+            else
+            {
+                DEBUG_PRINT("CS104 SLAVE: port %i already in use -> accept sharding not used\n", self->tcpPort);
+                success = false;
+            }
+
+            for (i = 0; success && (i < self->numberOfWorkers); i++)
+            {
+                ServerSocket serverSocket = TcpServerSocket_createReusePort(localAddress, self->tcpPort);
+
+                if (serverSocket == NULL)
+                {
+                    success = false;
+                    break;
+                }
+
+                ServerSocket_setBacklog(serverSocket, CONFIG_CS104_SLAVE_LISTEN_BACKLOG);
+                ServerSocket_listen(serverSocket);
+
+                workers[i].serverSocket = serverSocket;
+            }
+
+            if (success)
+            {
+                self->isAcceptShardingActive = true;
+            }
+            else
+            {
+                DEBUG_PRINT("CS104 SLAVE: cannot use accept sharding -> use single listening socket\n");
+
+                for (i = 0; i < self->numberOfWorkers; i++)
+                {
+                    if (workers[i].serverSocket)
+                    {
+                        ServerSocket_destroy(workers[i].serverSocket);
+                        workers[i].serverSocket = NULL;
+                    }
+                }
+            }
+        }
+
+        /* CS104_Slave_wakeupConnections accesses the workers with the openConnectionsLock */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
+
+        self->workers = workers;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+        {
+            CS104_SlaveWorker worker = &(workers[i]);
+
+            worker->thread = Thread_create(CS104_SlaveWorker_thread, (void*)worker, false);
+
+            Thread_start(worker->thread);
+        }
+    }
+    else
+    {
+        DEBUG_PRINT("CS104 SLAVE: Failed to allocate workers\n");
+    }
+}
+
+static void
+CS104_Slave_stopWorkers(CS104_Slave self)
+{
+    if (self->workers)
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+        {
+            CS104_SlaveWorker worker = &(self->workers[i]);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(worker->lock);
+#endif
+
+            worker->isRunning = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(worker->lock);
+
+            Semaphore_post(worker->idleSignal);
+#endif
+
+            Handleset_wakeup(worker->handleSet);
+        }
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+            Thread_destroy(self->workers[i].thread);
+
+        CS104_SlaveWorker workers = self->workers;
+
+        /* CS104_Slave_wakeupConnections accesses the workers with the openConnectionsLock */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
+
+        self->workers = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+        {
+            CS104_SlaveWorker worker = &(workers[i]);
+
+            if (worker->serverSocket)
+                ServerSocket_destroy(worker->serverSocket);
+
+            Handleset_destroy(worker->handleSet);
+            LinkedList_destroyStatic(worker->connections);
+            LinkedList_destroyStatic(worker->newConnections);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_destroy(worker->lock);
+            Semaphore_destroy(worker->idleSignal);
+#endif
+        }
+
+        GLOBAL_FREEMEM(workers);
+
+        self->isAcceptShardingActive = false;
+    }
+}
+
+/* assign a new connection to the given worker or (worker = NULL) to the worker with the lowest number of connections */
+static bool
+CS104_Slave_assignConnectionToWorker(CS104_Slave self, MasterConnection connection, CS104_SlaveWorker worker)
+{
+    CS104_SlaveWorker selectedWorker = worker;
+
+    if (self->workers == NULL)
+        return false;
+
+    if (selectedWorker == NULL)
+    {
+        int minConnections = 0;
+
+        int i;
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+        {
+            CS104_SlaveWorker candidate = &(self->workers[i]);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(candidate->lock);
+#endif
+
+            int numberOfConnections = candidate->numberOfConnections;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(candidate->lock);
+#endif
+
+            if ((selectedWorker == NULL) || (numberOfConnections < minConnections))
+            {
+                selectedWorker = candidate;
+                minConnections = numberOfConnections;
+            }
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(connection->stateLock);
+#endif
+
+    connection->isRunning = true;
+    connection->state = M_CON_STATE_STOPPED;
+    connection->worker = selectedWorker;
+
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+    connection->handshakePending = false;
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(connection->stateLock);
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(selectedWorker->lock);
+#endif
+
+    LinkedList_add(selectedWorker->newConnections, connection);
+    selectedWorker->numberOfConnections++;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(selectedWorker->lock);
+
+    if (selectedWorker->wakeupEnabled == false)
+        Semaphore_post(selectedWorker->idleSignal);
+#endif
+
+    Handleset_wakeup(selectedWorker->handleSet);
+
+    return true;
+}
+
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+
+/* hand over the connection to a worker after the handshake, otherwise it is released by the server thread */
+static void
+CS104_Slave_finishHandshake(CS104_Slave self, MasterConnection connection, bool handshakeDone)
+{
+    if (handshakeDone && MasterConnection_isRunning(connection))
+    {
+        if (CS104_Slave_assignConnectionToWorker(self, connection, NULL))
+            return;
+    }
+
+    Semaphore_wait(connection->stateLock);
+
+    connection->isRunning = false;
+    connection->handshakePending = false;
+
+    Semaphore_post(connection->stateLock);
+}
+
+static void*
+CS104_Slave_handshakeThread(void* parameter)
+{
+    CS104_Slave self = (CS104_Slave)parameter;
+
+    while (true)
+    {
+        Semaphore_wait(self->handshakeSignal);
+
+        MasterConnection connection = NULL;
+
+        Semaphore_wait(self->handshakeLock);
+
+        bool isRunning = self->handshakeThreadsRunning;
+
+        LinkedList element = LinkedList_getNext(self->handshakeQueue);
+
+        if (element)
+        {
+            connection = (MasterConnection)LinkedList_getData(element);
+            LinkedList_remove(self->handshakeQueue, connection);
+        }
+
+        Semaphore_post(self->handshakeLock);
+
+        if (connection)
+        {
+            /* the waiting connections are closed when the server is stopped */
+            bool handshakeDone = false;
+
+            if (isRunning && MasterConnection_isRunning(connection))
+                handshakeDone = MasterConnection_startTLS(connection);
+
+            CS104_Slave_finishHandshake(self, connection, handshakeDone);
+        }
+        else if (isRunning == false)
+            break;
+    }
+
+    return NULL;
+}
+
+/* queue a new connection for the TLS handshake */
+static bool
+CS104_Slave_startHandshake(CS104_Slave self, MasterConnection connection)
+{
+    bool queued = false;
+
+    Semaphore_wait(connection->stateLock);
+
+    connection->isRunning = true;
+    connection->state = M_CON_STATE_STOPPED;
+    connection->handshakePending = true;
+
+    Semaphore_post(connection->stateLock);
+
+    Semaphore_wait(self->handshakeLock);
+
+    if (self->handshakeThreadsRunning)
+    {
+        LinkedList_add(self->handshakeQueue, connection);
+        queued = true;
+    }
+
+    Semaphore_post(self->handshakeLock);
+
+    if (queued)
+        Semaphore_post(self->handshakeSignal);
+    else
+    {
+        Semaphore_wait(connection->stateLock);
+
+        connection->handshakePending = false;
+
+        Semaphore_post(connection->stateLock);
+    }
+
+    return queued;
+}
+
+static void
+CS104_Slave_startHandshakeThreads(CS104_Slave self)
+{
+    if ((self->tlsConfig == NULL) || (self->handshakeThreads != NULL))
+        return;
+
+    self->handshakeThreads = (Thread*)GLOBAL_CALLOC(CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS, sizeof(Thread));
+
+    if (self->handshakeThreads)
+    {
+        self->handshakeQueue = LinkedList_create();
+        self->handshakeLock = Semaphore_create(1);
+        self->handshakeSignal = Semaphore_create(0);
+        self->handshakeThreadsRunning = true;
+
+        int i;
+
+        for (i = 0; i < CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS; i++)
+        {
+            self->handshakeThreads[i] = Thread_create(CS104_Slave_handshakeThread, (void*)self, false);
+
+            Thread_start(self->handshakeThreads[i]);
+        }
+    }
+    else
+    {
+        DEBUG_PRINT("CS104 SLAVE: Failed to allocate TLS handshake threads\n");
+    }
+}
+
+/* stop the TLS handshake threads (waiting connections are closed) */
+static void
+CS104_Slave_stopHandshakeThreads(CS104_Slave self)
+{
+    if (self->handshakeThreads)
+    {
+        int i;
+
+        Semaphore_wait(self->handshakeLock);
+
+        self->handshakeThreadsRunning = false;
+
+        Semaphore_post(self->handshakeLock);
+
+        for (i = 0; i < CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS; i++)
+            Semaphore_post(self->handshakeSignal);
+
+        for (i = 0; i < CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS; i++)
+            Thread_destroy(self->handshakeThreads[i]);
+
+        GLOBAL_FREEMEM(self->handshakeThreads);
+        self->handshakeThreads = NULL;
+
+        LinkedList_destroyStatic(self->handshakeQueue);
+        self->handshakeQueue = NULL;
+
+        Semaphore_destroy(self->handshakeLock);
+        Semaphore_destroy(self->handshakeSignal);
+    }
+}
+
+#endif /* (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1) */
+
+#endif /* (CONFIG_USE_THREADS == 1) */
+
+/* the connections are handled by the next call of CS104_Slave_tick (threadless mode) */
+static void
+CS104_Slave_requestThreadlessWakeup(CS104_Slave self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    self->threadlessWakeupRequested = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+}
+
+static bool
+CS104_Slave_takeThreadlessWakeupRequest(CS104_Slave self)
+{
+    bool wakeupRequested;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    wakeupRequested = self->threadlessWakeupRequested;
+    self->threadlessWakeupRequested = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+    return wakeupRequested;
+}
+
+#if (CONFIG_USE_THREADS == 1)
+/*
+ * wake up the connection thread (threading model CS104_THREADING_MODEL_THREAD_PER_CONNECTION)
+ *
+ * Only the first request after the thread took the last one signals the wakeup handle.
+ */
+static void
+MasterConnection_wakeupThread(MasterConnection self)
+{
+    bool wasRequested;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+
+    wasRequested = self->wakeupRequested;
+    self->wakeupRequested = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+
+    if (wasRequested == false)
+        Handleset_wakeup(self->handleSet);
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
+/* wake up the thread handling the connection (e.g. when a new ASDU is waiting) */
+static void
+MasterConnection_wakeup(MasterConnection self)
+{
+#if (CONFIG_USE_THREADS == 1)
+    if (self->slave->isThreadlessMode)
+    {
+        CS104_Slave_requestThreadlessWakeup(self->slave);
+    }
+    else
+    {
+        CS104_SlaveWorker worker = self->worker;
+
+        if (worker)
+            CS104_SlaveWorker_wakeup(worker);
+        else
+            MasterConnection_wakeupThread(self);
+    }
+#else
+    CS104_Slave_requestThreadlessWakeup(self->slave);
+#endif
+}
+
+/* wake up the threads of all open connections */
+static void
+CS104_Slave_wakeupConnections(CS104_Slave self)
+{
+#if (CONFIG_USE_THREADS == 1)
+    if (self->isThreadlessMode)
+    {
+        CS104_Slave_requestThreadlessWakeup(self);
+        return;
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
+
+    if (self->workers)
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+            CS104_SlaveWorker_wakeup(&(self->workers[i]));
+    }
+    else
+    {
+        int i;
+
+        for (i = 0; i < self->numberOfActiveConnections; i++)
+        {
+            MasterConnection con = self->activeConnections[i];
+
+            if (con && con->isUsed)
+                MasterConnection_wakeupThread(con);
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->openConnectionsLock);
+#endif
+#else
+    CS104_Slave_requestThreadlessWakeup(self);
+#endif /* (CONFIG_USE_THREADS == 1) */
+}
+
+/********************************************
+ * IMasterConnection
+ *******************************************/
+
+static bool
+_IMasterConnection_isReady(IMasterConnection self)
+{
+    MasterConnection con = (MasterConnection)self->object;
+
+    if (MasterConnection_isActive(con))
+    {
+        if (isSentBufferFull(con) == false)
+            return true;
+
+        if (HighPriorityASDUQueue_isFull(con->highPrioQueue))
+            return false;
+
+        return true;
+    }
+    else
+        return false;
+}
+
+static bool
+_IMasterConnection_sendASDU(IMasterConnection self, CS101_ASDU asdu)
+{
+    MasterConnection con = (MasterConnection)self->object;
+
+    bool enqueued = HighPriorityASDUQueue_enqueue(con->highPrioQueue, asdu);
+
+    if (enqueued)
+        MasterConnection_wakeup(con);
+
+    return enqueued;
+}
+
+
+static bool
+_IMasterConnection_sendASDUEx(IMasterConnection self, CS101_ASDU asdu, bool bypassQueue)
+{
+    if (bypassQueue)
+    {
+        MasterConnection con = (MasterConnection)self->object;
+
+        if (MessageQueue_isAsduAvailable(con->lowPrioQueue, NULL) || HighPriorityASDUQueue_isAsduAvailable(con->highPrioQueue))
+            return false;
+
+        bool sent = sendASDUInternal(con, asdu, true);
+
+        /* the event loop has to update the T1 timer of the connection */
+        if (sent)
+            MasterConnection_wakeup(con);
+
+        return sent;
+    }
+    else
+        return _IMasterConnection_sendASDU(self, asdu);
+}
+
+static bool
+_IMasterConnection_sendACT_CON(IMasterConnection self, CS101_ASDU asdu, bool negative)
+{
+    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+    CS101_ASDU_setNegative(asdu, negative);
+
+    return _IMasterConnection_sendASDU(self, asdu);
+}
+
+static bool
+_IMasterConnection_sendACT_TERM(IMasterConnection self, CS101_ASDU asdu)
+{
+    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_TERMINATION);
+    CS101_ASDU_setNegative(asdu, false);
+
+    return _IMasterConnection_sendASDU(self, asdu);
+}
+
+static void
+_IMasterConnection_close(IMasterConnection self)
+{
+    MasterConnection con = (MasterConnection)self->object;
+
+    MasterConnection_close(con);
+}
+
+static int
+_IMasterConnection_getPeerAddress(IMasterConnection self, char* addrBuf, int addrBufSize)
+{
+    MasterConnection con = (MasterConnection)self->object;
+
+    char buf[54];
+
+    if (con->socket == NULL)
+    {
+        return 0;
+    }
+
+    const char* addrStr = Socket_getPeerAddressStatic(con->socket, buf);
+
+    if (addrStr == NULL)
+        return 0;
+
+    int len = (int)strnlen(buf, sizeof(buf));
+
+    if (len < addrBufSize)
+    {
+        memcpy(addrBuf, buf, len);
+        addrBuf[len] = 0;
+        return len;
+    }
+    else
+        return 0;
+}
+
+static CS101_AppLayerParameters
+_IMasterConnection_getApplicationLayerParameters(IMasterConnection self)
+{
+    MasterConnection con = (MasterConnection)self->object;
+
+    return &(con->slave->alParameters);
+}
+
+/********************************************
+ * END IMasterConnection
+ *******************************************/
+
+static MasterConnection
+MasterConnection_create(CS104_Slave slave)
+{
+    MasterConnection self = (MasterConnection)GLOBAL_CALLOC(1, sizeof(struct sMasterConnection));
+
+    if (self)
+    {
+        self->state = M_CON_STATE_STOPPED;
+        self->activeIndex = -1;
+        self->nextFreeConnection = NULL;
+        TimerWheelEntry_init(&(self->timer), self);
+        self->isUsed = false;
+        self->slave = slave;
+        self->maxSentASDUs = 0;
+        self->sentASDUs = NULL;
+        self->iMasterConnection.object = self;
+        self->iMasterConnection.getApplicationLayerParameters = _IMasterConnection_getApplicationLayerParameters;
+        self->iMasterConnection.isReady = _IMasterConnection_isReady;
+        self->iMasterConnection.sendASDU = _IMasterConnection_sendASDU;
+        self->iMasterConnection.sendASDUEx = _IMasterConnection_sendASDUEx;
+        self->iMasterConnection.sendACT_CON = _IMasterConnection_sendACT_CON;
+        self->iMasterConnection.sendACT_TERM = _IMasterConnection_sendACT_TERM;
+        self->iMasterConnection.close = _IMasterConnection_close;
+        self->iMasterConnection.getPeerAddress = _IMasterConnection_getPeerAddress;
+
+#if (CONFIG_USE_THREADS == 1)
+        self->connectionThread = NULL;
+        self->worker = NULL;
+#endif
+
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+        self->handshakePending = false;
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->sentASDUsLock = Semaphore_create(1);
+        self->stateLock = Semaphore_create(1);
+        self->txBufferLock = Semaphore_create(1);
+        self->metricsLock = Semaphore_create(1);
+#endif
+        self->handleSet = Handleset_new();
+
+        self->rxBuffer = NULL;
+        self->recvBuffer = NULL;
+
+        self->txBuffer = NULL;
+        self->txBufferSize = 0;
+        self->txBufferPos = 0;
+        self->txBatchActive = false;
+        self->txWriteInterest = false;
+
+        /* initialize pointers with NULL to avoid segmentation fault on destroy call */
+        self->socket = NULL;
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        self->tlsSocket = NULL;
+#endif
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+        self->redundancyGroup = NULL;
+#endif
+        self->lowPrioQueue = NULL;
+        self->highPrioQueue = NULL;
+    }
+
+    return self;
+}
+
+static bool
+MasterConnection_init(MasterConnection self, Socket skt, MessageQueue lowPrioQueue, HighPriorityASDUQueue highPrioQueue)
+{
+    if (self)
+    {
+        self->socket = skt;
+        self->isRunning = false;
+        self->requeuedOnActivate = 0;
+        TimerWheelEntry_init(&(self->timer), self);
+        self->receiveCount = 0;
+        self->sendCount = 0;
+        self->rxBufferStart = 0;
+        self->rxBufferEnd = 0;
+
+        if (self->rxBuffer == NULL)
+        {
+            self->rxBuffer = (uint8_t*)GLOBAL_MALLOC(CONFIG_CS104_RX_BUFFER_SIZE);
+
+            if (self->rxBuffer == NULL)
+            {
+                DEBUG_PRINT("CS104 SLAVE: Failed to allocate memory for receive buffer\n");
+                return false;
+            }
+        }
+
+        if (self->maxSentASDUs != self->slave->conParameters.k)
+        {
+            if (self->sentASDUs)
+            {
+                GLOBAL_FREEMEM(self->sentASDUs);
+                self->sentASDUs = NULL;
+            }
+        }
+
+        if (self->sentASDUs == NULL)
+        {
+            self->maxSentASDUs = self->slave->conParameters.k;
+            self->sentASDUs = (SentASDUSlave*)GLOBAL_CALLOC(self->maxSentASDUs, sizeof(SentASDUSlave));
+
+            if (self->sentASDUs == NULL)
+            {
+                DEBUG_PRINT("CS104 SLAVE: Failed to allocate memory for sent ASDU buffer\n");
+                return false;
+            }
+        }
+
+        if (self->txBufferSize != self->slave->maxTxBatchSize)
+        {
+            if (self->txBuffer)
+            {
+                GLOBAL_FREEMEM(self->txBuffer);
+                self->txBuffer = NULL;
+            }
+
+            self->txBufferSize = 0;
+
+            if (self->slave->maxTxBatchSize > 0)
+            {
+                self->txBuffer = (uint8_t*)GLOBAL_MALLOC(self->slave->maxTxBatchSize);
+
+                if (self->txBuffer)
+                    self->txBufferSize = self->slave->maxTxBatchSize;
+                else
+                    DEBUG_PRINT("CS104 SLAVE: Failed to allocate memory for output buffer\n");
+            }
+        }
+
+        self->txBufferPos = 0;
+        self->txBatchActive = false;
+        self->txWriteInterest = false;
+
+        self->wakeupRequested = false;
+
+        self->unconfirmedReceivedIMessages = 0;
+        self->lastConfirmationTime = UINT64_MAX;
+
+        self->timeoutT2Triggered = false;
+
+        self->oldestSentASDU = -1;
+        self->newestSentASDU = -1;
+
+        self->interrogationResponse = INTERROGATION_RESPONSE_NONE;
+
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+        memset(self->latency, 0, sizeof(self->latency));
+#endif
+
+        resetT3Timeout(self, Hal_getMonotonicTimeInMs());
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        self->tlsSocket = NULL;
+
+#if (CONFIG_USE_THREADS == 1)
+        /* in threaded mode the TLS handshake is performed by the connection thread (so the server can accept other clients) */
+        if (self->slave->isThreadlessMode)
+#endif
+        {
+            if (MasterConnection_startTLS(self) == false)
+            {
+                self->isUsed = false;
+                return false;
+            }
+        }
+#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+
+        /* for the mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP we use the connection specific queues */
+        if (lowPrioQueue)
+            self->lowPrioQueue = lowPrioQueue;
+        else
+        {
+            MessageQueue_releaseAllQueuedASDUs(self->lowPrioQueue);
+        }
+
+        if (highPrioQueue)
+            self->highPrioQueue = highPrioQueue;
+
+        HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
+
+        self->waitingForTestFRcon = false;
+
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+static bool
+MasterConnection_initEx(MasterConnection self, Socket skt, CS104_RedundancyGroup redGroup)
+{
+    bool retVal = false;
+
+    if (self)
+    {
+        retVal = MasterConnection_init(self, skt, redGroup->asduQueue, redGroup->connectionAsduQueue);
+
+        if (retVal)
+            self->redundancyGroup = redGroup;
+    }
+
+    return retVal;
+}
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+
+#if (CONFIG_USE_THREADS == 1)
+static void
+MasterConnection_start(MasterConnection self)
+{
+    if (self->slave->threadingModel == CS104_THREADING_MODEL_EVENT_LOOP)
+    {
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+        /* the TLS handshake is performed by a handshake thread that hands over the connection to a worker */
+        if (self->slave->tlsConfig)
+        {
+            if (CS104_Slave_startHandshake(self->slave, self))
+                return;
+        }
+        else
+#elif (CONFIG_CS104_SUPPORT_TLS == 1)
+        /* the TLS handshake is performed by a connection thread that hands over the connection to a worker */
+        if (self->slave->tlsConfig == NULL)
+#endif
+        {
+            if (CS104_Slave_assignConnectionToWorker(self->slave, self, NULL))
+                return;
+        }
+    }
+
+    if (self->connectionThread)
+    {
+        Thread_destroy(self->connectionThread);
+        self->connectionThread = NULL;
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->slave->openConnectionsLock);
+#endif
+
+    /* allow CS104_Slave_enqueueASDU to wake up the connection thread */
+    Handleset_enableWakeup(self->handleSet);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->slave->openConnectionsLock);
+#endif
+
+    self->isRunning = true;
+    self->state = M_CON_STATE_STOPPED;
+
+    self->connectionThread = Thread_create((ThreadExecutionFunction)connectionHandlingThread, (void*)self, false);
+
+    Thread_start(self->connectionThread);
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
+static void
+MasterConnection_close(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+    self->isRunning = false;
+    self->state = M_CON_STATE_STOPPED;
+
+#ifdef SEC_AUTH_60870_5_7
+
+    if (self->slave->secureEndpoint)
+    {
+        SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+    }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+
+    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+    {
+        SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+    }
+
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+    MasterConnection_wakeup(self);
+}
+
+static bool
+MasterConnection_hasUnconfirmedMessages(MasterConnection self)
+{
+    bool retVal = false;
+
+    if (self->lowPrioQueue)
+    {
+        if (MessageQueue_hasUnconfirmedIMessages(self->lowPrioQueue))
+            return true;
+    }
+
+    if (self->oldestSentASDU != -1)
+        retVal = true;
+
+    return retVal;
+}
+
+static void
+MasterConnection_deactivate(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+    if (self->isUsed)
+    {
+        if (self->state == M_CON_STATE_STARTED)
+        {
+            if (self->slave->connectionEventHandler)
+            {
+                self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter,
+                                                    &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
+            }
+
+#ifdef SEC_AUTH_60870_5_7
+
+            if (self->slave->secureEndpoint)
+            {
+                SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
+            }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+            if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+            {
+                SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
+            }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+            self->state = M_CON_STATE_UNCONFIRMED_STOPPED;
+
+            /* a new interrogation is required after the next activation */
+            self->interrogationResponse = INTERROGATION_RESPONSE_NONE;
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+}
+
+static void
+MasterConnection_activate(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+
+    if (self->state != M_CON_STATE_STARTED)
+    {
+        if (self->slave->connectionEventHandler)
+        {
+            self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter,
+                                                &(self->iMasterConnection), CS104_CON_EVENT_ACTIVATED);
+        }
+
+#ifdef SEC_AUTH_60870_5_7
+
+        if (self->slave->secureEndpoint)
+        {
+            SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_ACTIVATED);
+        }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+        if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+        {
+            SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
+        }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+    }
+
+    self->state = M_CON_STATE_STARTED;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+}
+
+static void
+MasterConnection_handleTcpConnection(MasterConnection self)
+{
+    int bytesRec = receiveMessage(self, true);
+
+    /* handle all complete messages that were received with a single socket read */
+    while (bytesRec != 0)
+    {
+        if (bytesRec < 0)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
+            self->isRunning = false;
+            break;
+        }
+
+        if (self->isRunning == false)
+            break;
+
+        if (self->slave->rawMessageHandler)
+            self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter, &(self->iMasterConnection),
+                                           self->recvBuffer, bytesRec, false);
+
+        if (handleMessage(self, self->recvBuffer, bytesRec) == false)
+            self->isRunning = false;
+
+        if (self->unconfirmedReceivedIMessages >= self->slave->conParameters.w)
+        {
+            self->lastConfirmationTime = Hal_getMonotonicTimeInMs();
+
+            self->unconfirmedReceivedIMessages = 0;
+
+            self->timeoutT2Triggered = false;
+
+            sendSMessage(self);
+        }
+
+        bytesRec = receiveMessage(self, false);
+    }
+}
+
+/**
+ * \brief Send waiting ASDUs and check the protocol timers (threadless mode)
+ *
+ * \return true when more ASDUs can be sent immediately
+ */
+static bool
+MasterConnection_executePeriodicTasks(MasterConnection self)
+{
+    bool isAsduWaiting = false;
+
+    if (self->state == M_CON_STATE_STARTED)
+    {
+        isAsduWaiting = sendWaitingASDUs(self);
+    }
+
+    if (handleTimeouts(self) == false)
+    {
+        self->isRunning = false;
+    }
+
+    return isAsduWaiting;
+}
+
+/**
+ * \brief Handle the client connections in threadless mode
+ *
+ * Only connections with a ready socket (see \ref CS104_Slave_pollThreadless) receive messages. The
+ * periodic tasks are executed for connections that received data or have an expired protocol timer.
+ * All connections are handled when ASDUs were enqueued or are waiting to be sent.
+ *
+ * \return the time in ms until the next protocol timer expires or 0 when ASDUs are waiting to be sent
+ */
+static unsigned int
+handleClientConnections(CS104_Slave self, int readySockets, unsigned int maxWaitTime)
+{
+    unsigned int waitTime = maxWaitTime;
+
+    bool handleAll = self->threadlessAsduWaiting || CS104_Slave_requiresPolling(self, true);
+
+    if (CS104_Slave_takeThreadlessWakeupRequest(self))
+        handleAll = true;
+
+    self->threadlessAsduWaiting = false;
+
+    CS104_Slave_drainIngressQueue(self);
+
+    if (self->openConnections > 0)
+    {
+        int i;
+
+        bool isAsduWaiting = false;
+
+        /* backwards because closed connections are removed from the active connections */
+        for (i = self->numberOfActiveConnections - 1; i >= 0; i--)
+        {
+            MasterConnection con = self->activeConnections[i];
+
+            if (con && con->isUsed)
+            {
+                if (con->isRunning == false)
+                {
+                    if (self->connectionEventHandler)
+                    {
+                        self->connectionEventHandler(self->connectionEventHandlerParameter, &(con->iMasterConnection),
+                                                     CS104_CON_EVENT_CONNECTION_CLOSED);
+                    }
+
+                    DEBUG_PRINT("CS104 SLAVE: Connection closed\n");
+
+#ifdef SEC_AUTH_60870_5_7
+
+                    if (self->secureEndpoint)
+                    {
+                        SecureEndpoint_peerConnectionEvent(self->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+                    }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+                    if (con->redundancyGroup && con->redundancyGroup->secureEndpoint)
+                    {
+                        SecureEndpoint_peerConnectionEvent(con->redundancyGroup->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+                    }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+                    /* call plugins */
+                    if (self->plugins)
+                    {
+                        LinkedList pluginElem = LinkedList_getNext(self->plugins);
+
+                        while (pluginElem)
+                        {
+                            CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+
+                            if (plugin->eventHandler)
+                                plugin->eventHandler(plugin->parameter, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+
+                            pluginElem = LinkedList_getNext(pluginElem);
+                        }
+                    }
+
+                    MessageQueue_setWaitingForTransmissionWhenNotConfirmed(con->lowPrioQueue);
+
+                    TimerWheel_remove(&(self->threadlessTimers), &(con->timer));
+
+                    MasterConnection_deinit(con);
+
+#if (CONFIG_USE_SEMAPHORES)
+                    Semaphore_wait(self->openConnectionsLock);
+#endif
+
+                    self->openConnections--;
+
+                    releaseConnection(self, con);
+
+#if (CONFIG_USE_SEMAPHORES)
+                    Semaphore_post(self->openConnectionsLock);
+#endif
+
+                    self->threadlessHandleSetChanged = true;
+                }
+            }
+        }
+
+        uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+        /* the timers of connections with an expired protocol timer are not armed anymore */
+        TimerWheel_advance(&(self->threadlessTimers), currentTime);
+
+        for (i = 0; i < self->numberOfActiveConnections; i++)
+        {
+            MasterConnection con = self->activeConnections[i];
+
+            if ((con == NULL) || (con->isUsed == false) || (con->isRunning == false))
+                continue;
+
+            bool handleConnection = handleAll || (TimerWheelEntry_isArmed(&(con->timer)) == false);
+
+            /* handle incoming messages of the connections with a ready socket */
+            if ((readySockets > 0) && Handleset_isReady(self->threadlessHandleSet, con->socket))
+            {
+                MasterConnection_handleTcpConnection(con);
+
+                handleConnection = true;
+            }
+
+            /* idle connections are only handled when their next protocol timer expires */
+            if (handleConnection && con->isRunning)
+            {
+                if (MasterConnection_executePeriodicTasks(con))
+                    isAsduWaiting = true;
+
+#ifdef SEC_AUTH_60870_5_7
+                if (self->secureEndpoint)
+                {
+                    if (SecureEndpoint_runTask(self->secureEndpoint, &(con->iMasterConnection)) == false)
+                    {
+                        con->isRunning = false;
+                    }
+                }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+                if (con->redundancyGroup && con->redundancyGroup->secureEndpoint)
+                {
+                    if (SecureEndpoint_runTask(con->redundancyGroup->secureEndpoint, &(con->iMasterConnection)) == false)
+                    {
+                        con->isRunning = false;
+                    }
+                }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+
+                /* call plugins */
+                if (self->plugins)
+                {
+                    LinkedList pluginElem = LinkedList_getNext(self->plugins);
+
+                    while (pluginElem)
+                    {
+                        CS101_SlavePlugin plugin = (CS101_SlavePlugin)LinkedList_getData(pluginElem);
+
+
+                        if (plugin->runTask)
+                            plugin->runTask(plugin->parameter, &(con->iMasterConnection));
+
+                        pluginElem = LinkedList_getNext(pluginElem);
+                    }
+                }
+
+                if (con->isRunning)
+                    MasterConnection_armTimer(con, &(self->threadlessTimers), currentTime);
+            }
+
+            /* the connection is released with the next tick */
+            if (con->isRunning == false)
+                isAsduWaiting = true;
+        }
+
+        waitTime = TimerWheel_getWaitTime(&(self->threadlessTimers), currentTime, maxWaitTime);
+
+        if (isAsduWaiting)
+        {
+            self->threadlessAsduWaiting = true;
+            waitTime = 0;
+        }
+    }
+
+    return waitTime;
+}
+
+static char*
+getPeerAddress(Socket socket, char* ipAddress)
+{
+    char* ipAddrStr = NULL;
+
+    if (Socket_getPeerAddressStatic(socket, ipAddress))
+    {
+        /* remove TCP port part */
+        if (ipAddress[0] == '[')
+        {
+            /* IPV6 address */
+            ipAddrStr = ipAddress + 1;
+
+            char* separator = strchr(ipAddrStr, ']');
+
+            if (separator != NULL)
+                *separator = 0;
+        }
+        else
+        {
+            /* IPV4 address */
+            ipAddrStr = ipAddress;
+
+            char* separator = strchr(ipAddrStr, ':');
+
+            if (separator != NULL)
+                *separator = 0;
+        }
+    }
+
+    return ipAddrStr;
+}
+
+static bool
+callConnectionRequestHandler(CS104_Slave self, Socket newSocket)
+{
+    char ipAddress[60];
+
+    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
+
+    if (ipAddrStr == NULL)
+        return false;
+
+    if (self->connectionRequestHandler)
+        return self->connectionRequestHandler(self->connectionRequestHandlerParameter, ipAddrStr);
+    else
+        return true;
+}
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+/**
+ * \brief Get the IP address of the peer in binary form
+ *
+ * Socket_getPeerIpAddress is optional -> when it is not supported the address string of the peer is parsed.
+ *
+ * \return the size of the address (4 for IPv4, 16 for IPv6) or 0 when the address cannot be determined
+ */
+static int
+getPeerIpAddress(Socket socket, uint8_t* ipAddress)
+{
+    int addressSize = Socket_getPeerIpAddress(socket, ipAddress);
+
+    if (addressSize > 0)
+        return addressSize;
+
+    char peerAddress[60];
+
+    if (Socket_getPeerAddressStatic(socket, peerAddress) == NULL)
+        return 0;
+
+    if (peerAddress[0] == '[')
+    {
+        /* "[<IPv6 address>]:<port>" */
+        static const uint8_t ipv4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+        const char* end = strchr(peerAddress, ']');
+
+        if ((end == NULL) || (parseIPv6Address(peerAddress + 1, end, ipAddress) == false))
+            return 0;
+
+        /* IPv4-mapped IPv6 addresses are reported as IPv4 addresses */
+        if (memcmp(ipAddress, ipv4MappedPrefix, 12) == 0)
+        {
+            memmove(ipAddress, ipAddress + 12, 4);
+            return 4;
+        }
+
+        return 16;
+    }
+    else
+    {
+        /* "<IPv4 address>:<port>" */
+        const char* end = strchr(peerAddress, ':');
+
+        if (end == NULL)
+            end = peerAddress + strlen(peerAddress);
+
+        if (parseIPv4Address(peerAddress, end, ipAddress) == false)
+            return 0;
+
+        return 4;
+    }
+}
+
+static CS104_RedundancyGroup
+getMatchingRedundancyGroup(CS104_Slave self, const uint8_t* address, int addressSize)
+{
+    eCS104_IPAddressType type = (addressSize == 4) ? IP_ADDRESS_TYPE_IPV4 : IP_ADDRESS_TYPE_IPV6;
+
+    if (self->clientAddressIndex)
+        return ClientAddressIndex_lookup(self->clientAddressIndex, address, type);
+
+    /* fallback when the index is not available -> check all groups */
+    CS104_RedundancyGroup catchAllGroup = NULL;
+    CS104_RedundancyGroup matchingGroup = NULL;
+    int bestPrefixLength = -1;
+
+    LinkedList element = LinkedList_getNext(self->redundancyGroups);
+
+    while (element)
+    {
+        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup)LinkedList_getData(element);
+
+        int prefixLength = CS104_RedundancyGroup_matches(redGroup, address, type);
+
+        if (prefixLength > bestPrefixLength)
+        {
+            matchingGroup = redGroup;
+            bestPrefixLength = prefixLength;
+        }
+
+        if (CS104_RedundancyGroup_isCatchAll(redGroup))
+            catchAllGroup = redGroup;
+
+        element = LinkedList_getNext(element);
+    }
+
+    if (matchingGroup == NULL)
+        matchingGroup = catchAllGroup;
+
+    return matchingGroup;
+}
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+
+/**
+ * \brief Check which sockets are ready to read (threadless mode)
+ *
+ * The handle set is only rebuilt when connections were opened or closed.
+ *
+ * \return the number of ready sockets
+ */
+static int
+CS104_Slave_pollThreadless(CS104_Slave self)
+{
+    if (self->threadlessHandleSet == NULL)
+        return 0;
+
+    if (self->threadlessHandleSetChanged)
+    {
+        Handleset_reset(self->threadlessHandleSet);
+
+        if (self->serverSocket)
+            Handleset_addSocket(self->threadlessHandleSet, (Socket)self->serverSocket);
+
+        int i;
+
+        for (i = 0; i < self->numberOfActiveConnections; i++)
+        {
+            MasterConnection con = self->activeConnections[i];
+
+            if (con && con->isUsed && con->isRunning)
+                Handleset_addSocket(self->threadlessHandleSet, con->socket);
+        }
+
+        self->threadlessHandleSetChanged = false;
+    }
+
+    /* the application waits for the sockets (see CS104_Slave_getFileDescriptors) -> only check the state */
+    return Handleset_waitReady(self->threadlessHandleSet, 0);
+}
+
+/**
+ * \brief Handle TCP connections in non-threaded mode
+ *
+ * \return the time in ms until the next protocol timer expires or 0 when the tick function should be called again immediately
+ */
+static unsigned int
+handleConnectionsThreadless(CS104_Slave self)
+{
+    /* command responses are handled by the next tick (see IMasterConnection_completeCommand) */
+    unsigned int maxWaitTime = CS104_Slave_getMaxWaitTime(self, true);
+
+    bool connectionAccepted = false;
+
+    int readySockets = CS104_Slave_pollThreadless(self);
+
+    if ((readySockets > 0) && Handleset_isReady(self->threadlessHandleSet, (Socket)self->serverSocket) &&
+        ((self->maxOpenConnections < 1) || (self->openConnections < self->maxOpenConnections)))
+    {
+        Socket newSocket = ServerSocket_accept(self->serverSocket);
+
+        if (newSocket)
+        {
+            bool acceptConnection = true;
+
+            if (acceptConnection)
+                acceptConnection = callConnectionRequestHandler(self, newSocket);
+
+            if (acceptConnection)
+            {
+                MessageQueue lowPrioQueue = NULL;
+                HighPriorityASDUQueue highPrioQueue = NULL;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+                {
+                    lowPrioQueue = self->asduQueue;
+                    highPrioQueue = self->connectionAsduQueue;
+                }
+#endif
+
+                MasterConnection con = NULL;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+                {
+                    uint8_t peerAddress[16];
+
+                    int peerAddressSize = getPeerIpAddress(newSocket, peerAddress);
+
+                    if (peerAddressSize > 0)
+                    {
+                        CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, peerAddress, peerAddressSize);
+
+                        if (matchingGroup)
+                        {
+#if (CONFIG_USE_SEMAPHORES)
+                            Semaphore_wait(self->openConnectionsLock);
+#endif
+
+                            con = getFreeConnection(self);
+
+                            if (con)
+                            {
+                                if (MasterConnection_initEx(con, newSocket, matchingGroup))
+                                {
+                                    self->openConnections++;
+
+                                    if (matchingGroup->name)
+                                    {
+                                        DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
+                                    }
+                                }
+                                else
+                                {
+                                    releaseConnection(self, con);
+                                    con = NULL;
+                                }
+                            }
+
+#if (CONFIG_USE_SEMAPHORES)
+                            Semaphore_post(self->openConnectionsLock);
+#endif
+                        }
+                        else
+                        {
+                            DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
+                        }
+                    }
+                    else
+                    {
+                        DEBUG_PRINT("CS104 SLAVE: cannot determine peer IP address -> close connection\n");
+                    }
+                }
+                else
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+                {
+#if (CONFIG_USE_SEMAPHORES)
+                    Semaphore_wait(self->openConnectionsLock);
+#endif
+                    con = getFreeConnection(self);
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+                    if (con && (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP))
+                    {
+                        lowPrioQueue = con->lowPrioQueue;
+                        MessageQueue_initialize(lowPrioQueue);
+
+                        highPrioQueue = con->highPrioQueue;
+                        HighPriorityASDUQueue_initialize(highPrioQueue);
+                    }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+                    if (con)
+                    {
+                        if (MasterConnection_init(con, newSocket, lowPrioQueue, highPrioQueue))
+                        {
+                            self->openConnections++;
+                        }
+                        else
+                        {
+                            releaseConnection(self, con);
+                            con = NULL;
+                        }
+                    }
+
+#if (CONFIG_USE_SEMAPHORES)
+                    Semaphore_post(self->openConnectionsLock);
+#endif
+                }
+
+                if (con)
+                {
+                    con->isRunning = true;
+
+                    self->threadlessHandleSetChanged = true;
+                    connectionAccepted = true;
+
+                    if (self->connectionEventHandler)
+                    {
+                        self->connectionEventHandler(self->connectionEventHandlerParameter,
+                                                     &(con->iMasterConnection),
+                                                     CS104_CON_EVENT_CONNECTION_OPENED);
+                    }
+
+#ifdef SEC_AUTH_60870_5_7
+
+                    if (self->secureEndpoint)
+                    {
+                        SecureEndpoint_peerConnectionEvent(self->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+                    }
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+                    if (con->redundancyGroup && con->redundancyGroup->secureEndpoint)
+                    {
+                        SecureEndpoint_peerConnectionEvent(con->redundancyGroup->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+                    }
+#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+
+#endif /* SEC_AUTH_60870_5_7 */
+                }
+                else
+                {
+                    Socket_destroy(newSocket);
+                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!\n");
+                }
+            }
+            else
+            {
+                Socket_destroy(newSocket);
+            }
+        }
+    }
+
+    unsigned int waitTime = handleClientConnections(self, readySockets, maxWaitTime);
+
+    /* more connection requests can be waiting */
+    if (connectionAccepted)
+        waitTime = 0;
+
+    return waitTime;
+}
+
+#if (CONFIG_USE_THREADS == 1)
+
+/**
+ * \brief Check if a new client is accepted and initialize the connection object
+ *
+ * Can be called by the server thread and by the workers (accept sharding) at the same time.
+ *
+ * \return the initialized connection or NULL when the client is rejected (the socket is released)
+ */
+static MasterConnection
+CS104_Slave_openConnection(CS104_Slave self, Socket newSocket)
+{
+    MasterConnection connection = NULL;
+
+    bool acceptConnection = true;
+
+    /* check if maximum number of open connections is reached */
+    if (self->maxOpenConnections > 0)
+    {
+        if (CS104_Slave_getOpenConnections(self) >= self->maxOpenConnections)
+            acceptConnection = false;
+    }
+
+    if (acceptConnection)
+        acceptConnection = callConnectionRequestHandler(self, newSocket);
+
+    MessageQueue lowPrioQueue = NULL;
+    HighPriorityASDUQueue highPrioQueue = NULL;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+    {
+        lowPrioQueue = self->asduQueue;
+        highPrioQueue = self->connectionAsduQueue;
     }
+#endif
 
-    return self;
-}
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    CS104_RedundancyGroup matchingGroup = NULL;
 
-static bool
-MasterConnection_init(MasterConnection self, Socket skt, MessageQueue lowPrioQueue, HighPriorityASDUQueue highPrioQueue)
-{
-    if (self)
+    if (acceptConnection && (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS))
     {
-        self->socket = skt;
-        self->isRunning = false;
-        self->requeuedOnActivate = 0;
-        self->receiveCount = 0;
-        self->sendCount = 0;
-        self->recvBufPos = 0;
+        uint8_t peerAddress[16];
 
-        if (self->maxSentASDUs != self->slave->conParameters.k)
-        {
-            if (self->sentASDUs)
-            {
-                GLOBAL_FREEMEM(self->sentASDUs);
-                self->sentASDUs = NULL;
-            }
-        }
+        int peerAddressSize = getPeerIpAddress(newSocket, peerAddress);
 
-        if (self->sentASDUs == NULL)
+        if (peerAddressSize > 0)
         {
-            self->maxSentASDUs = self->slave->conParameters.k;
-            self->sentASDUs = (SentASDUSlave*)GLOBAL_CALLOC(self->maxSentASDUs, sizeof(SentASDUSlave));
+            matchingGroup = getMatchingRedundancyGroup(self, peerAddress, peerAddressSize);
 
-            if (self->sentASDUs == NULL)
+            if (matchingGroup == NULL)
             {
-                DEBUG_PRINT("CS104 SLAVE: Failed to allocate memory for sent ASDU buffer\n");
-                return false;
+                DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
+                acceptConnection = false;
             }
         }
+        else
+        {
+            DEBUG_PRINT("CS104 SLAVE: cannot determine peer IP address -> close connection\n");
+            acceptConnection = false;
+        }
+    }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-        self->unconfirmedReceivedIMessages = 0;
-        self->lastConfirmationTime = UINT64_MAX;
-
-        self->timeoutT2Triggered = false;
-
-        self->oldestSentASDU = -1;
-        self->newestSentASDU = -1;
+    if (acceptConnection)
+    {
+#if (CONFIG_USE_SEMAPHORES)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
 
-        resetT3Timeout(self, Hal_getMonotonicTimeInMs());
+        /* check again with the lock because several workers can accept connections at the same time */
+        if ((self->maxOpenConnections < 1) || (self->openConnections < self->maxOpenConnections))
+            connection = getFreeConnection(self);
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        if (self->slave->tlsConfig)
+        if (connection)
         {
-            self->tlsSocket = TLSSocket_create(skt, self->slave->tlsConfig, false);
+            bool initialized;
 
-            if (self->tlsSocket == NULL)
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+            if (matchingGroup)
             {
-                DEBUG_PRINT("CS104 SLAVE: Failed to create TLS context. Close connection\n");
+                initialized = MasterConnection_initEx(connection, newSocket, matchingGroup);
 
-                self->isUsed = false;
-                return false;
+                if (initialized && matchingGroup->name)
+                {
+                    DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
+                }
             }
-        }
-        else
-            self->tlsSocket = NULL;
+            else
 #endif
+                initialized = MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue);
 
-        /* for the mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP we use the connection specific queues */
-        if (lowPrioQueue)
-            self->lowPrioQueue = lowPrioQueue;
-        else
-        {
-            MessageQueue_releaseAllQueuedASDUs(self->lowPrioQueue);
+            if (initialized)
+            {
+                self->openConnections++;
+            }
+            else
+            {
+                releaseConnection(self, connection);
+                connection = NULL;
+            }
         }
 
-        if (highPrioQueue)
-            self->highPrioQueue = highPrioQueue;
-
-        HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
-
-        self->waitingForTestFRcon = false;
+#if (CONFIG_USE_SEMAPHORES)
+        Semaphore_post(self->openConnectionsLock);
+#endif
 
-        return true;
-    }
-    else
-    {
-        return false;
+        if (connection == NULL)
+            DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!\n");
     }
-}
-
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-static bool
-MasterConnection_initEx(MasterConnection self, Socket skt, CS104_RedundancyGroup redGroup)
-{
-    bool retVal = false;
 
-    if (self)
-    {
-        retVal = MasterConnection_init(self, skt, redGroup->asduQueue, redGroup->connectionAsduQueue);
-
-        if (retVal)
-            self->redundancyGroup = redGroup;
-    }
+    if (connection == NULL)
+        Socket_destroy(newSocket);
 
-    return retVal;
+    return connection;
 }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-#if (CONFIG_USE_THREADS == 1)
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+/* move the ASDUs added since the last drain to the event log and wake up the connections (server thread) */
 static void
-MasterConnection_start(MasterConnection self)
+CS104_Slave_handleIngressQueue(CS104_Slave self)
 {
-    if (self->connectionThread)
+    if (self->ingressQueue && IngressQueue_isWakeupPending(self->ingressQueue))
     {
-        Thread_destroy(self->connectionThread);
-        self->connectionThread = NULL;
+        if (CS104_Slave_drainIngressQueue(self) > 0)
+            CS104_Slave_wakeupConnections(self);
     }
-
-    self->isRunning = true;
-    self->state = M_CON_STATE_STOPPED;
-
-    self->connectionThread = Thread_create((ThreadExecutionFunction)connectionHandlingThread, (void*)self, false);
-
-    Thread_start(self->connectionThread);
 }
-#endif /* (CONFIG_USE_THREADS == 1) */
+#endif /* (CS104_SLAVE_HAS_ATOMICS == 1) */
 
-static void
-MasterConnection_close(MasterConnection self)
+static void*
+serverThread(void* parameter)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-
-    self->isRunning = false;
-    self->state = M_CON_STATE_STOPPED;
+    CS104_Slave self = (CS104_Slave)parameter;
 
-#ifdef SEC_AUTH_60870_5_7
+    HandleSet handleSet = NULL;
+    bool wakeupEnabled = false;
 
-    if (self->slave->secureEndpoint)
+    /* with accept sharding the connections are accepted by the workers -> only close connections here */
+    if (self->isAcceptShardingActive)
     {
-        SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+        self->serverSocket = NULL;
     }
-
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-
-    if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
+    else
     {
-        SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
-    }
+        if (self->localAddress)
+            self->serverSocket = TcpServerSocket_create(self->localAddress, self->tcpPort);
+        else
+            self->serverSocket = TcpServerSocket_create("0.0.0.0", self->tcpPort);
 
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+        if (self->serverSocket == NULL)
+        {
+            DEBUG_PRINT("CS104 SLAVE: Cannot create server socket\n");
 
-#endif /* SEC_AUTH_60870_5_7 */
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_wait(self->stateLock);
+#endif
+            self->isStarting = false;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-}
+            Semaphore_post(self->stateLock);
+#endif
 
-static bool
-MasterConnection_hasUnconfirmedMessages(MasterConnection self)
-{
-    bool retVal = false;
+            goto exit_function;
+        }
 
-    if (self->lowPrioQueue)
-    {
-        if (MessageQueue_hasUnconfirmedIMessages(self->lowPrioQueue))
-            return true;
+        ServerSocket_setBacklog(self->serverSocket, CONFIG_CS104_SLAVE_LISTEN_BACKLOG);
+
+        ServerSocket_listen(self->serverSocket);
     }
 
-    if (self->oldestSentASDU != -1)
-        retVal = true;
+    /* the server thread is woken up by new connections and by ASDUs added to the ingress queue */
+    handleSet = Handleset_new();
 
-    return retVal;
-}
+    if (handleSet && self->serverSocket)
+        Handleset_addSocket(handleSet, (Socket)self->serverSocket);
+
+    if (handleSet)
+        wakeupEnabled = Handleset_enableWakeup(handleSet);
 
-static void
-MasterConnection_deactivate(MasterConnection self)
-{
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_wait(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+#endif
 
-    if (self->isUsed)
-    {
-        if (self->state == M_CON_STATE_STARTED)
-        {
-            if (self->slave->connectionEventHandler)
-            {
-                self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter,
-                                                    &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
-            }
+    self->isRunning = true;
+    self->isStarting = false;
+    self->serverHandleSet = handleSet;
+    self->isIngressDrainerRunning = wakeupEnabled;
 
-#ifdef SEC_AUTH_60870_5_7
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
 
-            if (self->slave->secureEndpoint)
-            {
-                SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
-            }
+    while (isStopRunningSet(self) == false)
+    {
+        Socket newSocket = NULL;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-            if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
-            {
-                SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
-            }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+        if (self->serverSocket)
+            newSocket = ServerSocket_accept(self->serverSocket);
 
-#endif /* SEC_AUTH_60870_5_7 */
+        if (newSocket)
+        {
+            MasterConnection connection = CS104_Slave_openConnection(self, newSocket);
 
-            self->state = M_CON_STATE_UNCONFIRMED_STOPPED;
+            /* now start the connection handling (thread) */
+            if (connection)
+                MasterConnection_start(connection);
         }
-    }
+        else if (wakeupEnabled || (handleSet && self->serverSocket))
+        {
+            /* wait for new connections, new ASDUs in the ingress queue, or the next check of the closed connections */
+            Handleset_waitReady(handleSet, 10);
+        }
+        else
+            Thread_sleep(10);
+
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+        /* the server thread is the only regular consumer of the ingress queue */
+        CS104_Slave_handleIngressQueue(self);
+#endif
 
+        /* check if there are connections to close */
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-}
+        Semaphore_wait(self->openConnectionsLock);
+#endif
+
+        int i;
+
+        /* backwards because closed connections are removed from the active connections */
+        for (i = self->numberOfActiveConnections - 1; i >= 0; i--)
+        {
+            if (i < self->numberOfActiveConnections)
+            {
+                MasterConnection connection = self->activeConnections[i];
 
-static void
-MasterConnection_activate(MasterConnection self)
-{
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+                Semaphore_wait(connection->stateLock);
 #endif /* (CONFIG_USE_SEMAPHORES == 1) */
 
-    if (self->state != M_CON_STATE_STARTED)
-    {
-        if (self->slave->connectionEventHandler)
-        {
-            self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter,
-                                                &(self->iMasterConnection), CS104_CON_EVENT_ACTIVATED);
-        }
+                bool isConnectionUsed = connection->isUsed;
 
-#ifdef SEC_AUTH_60870_5_7
+                /* connection is still owned by a worker (threading model CS104_THREADING_MODEL_EVENT_LOOP) */
+                if (connection->worker)
+                    isConnectionUsed = false;
 
-        if (self->slave->secureEndpoint)
-        {
-            SecureEndpoint_peerConnectionEvent(self->slave->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_ACTIVATED);
-        }
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+                /* connection is still owned by the TLS handshake threads */
+                if (connection->handshakePending)
+                    isConnectionUsed = false;
+#endif
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        if (self->redundancyGroup && self->redundancyGroup->secureEndpoint)
-        {
-            SecureEndpoint_peerConnectionEvent(self->redundancyGroup->secureEndpoint, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
-        }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_post(connection->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
 
-#endif /* SEC_AUTH_60870_5_7 */
-    }
+                if (isConnectionUsed)
+                {
+                    if (MasterConnection_isRunning(connection) == false)
+                    {
+                        Thread threadToJoin = NULL;
 
-    self->state = M_CON_STATE_STARTED;
+                        if (connection->connectionThread)
+                        {
+                            threadToJoin = connection->connectionThread;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+                            Semaphore_wait(connection->stateLock);
 #endif /* (CONFIG_USE_SEMAPHORES == 1) */
-}
 
-static void
-MasterConnection_handleTcpConnection(MasterConnection self)
-{
-    int bytesRec = receiveMessage(self);
+                            connection->connectionThread = NULL;
 
-    if (bytesRec < 0)
-    {
-        DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
-        self->isRunning = false;
-    }
+#if (CONFIG_USE_SEMAPHORES == 1)
+                            Semaphore_post(connection->stateLock);
+#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+                        }
 
-    if ((bytesRec > 0) && (self->isRunning))
-    {
-        if (self->slave->rawMessageHandler)
-            self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter, &(self->iMasterConnection),
-                                           self->recvBuffer, bytesRec, false);
+                        /* Release openConnectionsLock before joining the connection thread.
+                         * The connection thread may be waiting to acquire openConnectionsLock
+                         * (e.g. inside CS104_Slave_activate), so joining while holding the
+                         * lock would cause a deadlock. */
+#if (CONFIG_USE_SEMAPHORES == 1)
+                        Semaphore_post(self->openConnectionsLock);
+#endif
 
-        if (handleMessage(self, self->recvBuffer, bytesRec) == false)
-            self->isRunning = false;
+                        if (threadToJoin)
+                            Thread_destroy(threadToJoin);
 
-        if (self->unconfirmedReceivedIMessages >= self->slave->conParameters.w)
-        {
-            self->lastConfirmationTime = Hal_getMonotonicTimeInMs();
+                        MasterConnection_deinit(connection);
 
-            self->unconfirmedReceivedIMessages = 0;
+#if (CONFIG_USE_SEMAPHORES == 1)
+                        Semaphore_wait(self->openConnectionsLock);
+#endif
 
-            self->timeoutT2Triggered = false;
+                        self->openConnections--;
 
-            sendSMessage(self);
+                        releaseConnection(self, connection);
+                    }
+                }
+            }
         }
-    }
-}
 
-static void
-MasterConnection_executePeriodicTasks(MasterConnection self)
-{
-    if (self->state == M_CON_STATE_STARTED)
-    {
-        sendWaitingASDUs(self);
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
     }
 
-    if (handleTimeouts(self) == false)
+    if (self->serverSocket)
     {
-        self->isRunning = false;
+        Socket_destroy((Socket)self->serverSocket);
+        self->serverSocket = NULL;
     }
-}
-
-static void
-handleClientConnections(CS104_Slave self)
-{
-    HandleSet handleset = NULL;
-
-    if (self->openConnections > 0)
-    {
-        int i;
 
-        bool first = true;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
 
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-        {
-            MasterConnection con = self->masterConnections[i];
+    self->isRunning = false;
+    self->stopRunning = false;
+    self->serverHandleSet = NULL;
+    self->isIngressDrainerRunning = false;
 
-            if (con && con->isUsed)
-            {
-                if (con->isRunning)
-                {
-                    if (first)
-                    {
-                        handleset = con->handleSet;
-                        Handleset_reset(handleset);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
 
-                        first = false;
-                    }
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+    /* ASDUs added before the producers noticed that the server thread is stopped */
+    CS104_Slave_handleIngressQueue(self);
+#endif
 
-                    Handleset_addSocket(handleset, con->socket);
-                }
-                else
-                {
-                    if (self->connectionEventHandler)
-                    {
-                        self->connectionEventHandler(self->connectionEventHandlerParameter, &(con->iMasterConnection),
-                                                     CS104_CON_EVENT_CONNECTION_CLOSED);
-                    }
+    if (handleSet)
+        Handleset_destroy(handleSet);
 
-                    DEBUG_PRINT("CS104 SLAVE: Connection closed\n");
+exit_function:
+    return NULL;
+}
 
-#ifdef SEC_AUTH_60870_5_7
+#endif /* (CONFIG_USE_THREADS == 1) */
 
-                    if (self->secureEndpoint)
-                    {
-                        SecureEndpoint_peerConnectionEvent(self->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
-                    }
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+/**
+ * Wake up the server thread to move the ASDUs of the ingress queue to the event log
+ *
+ * \return true when the ASDUs are moved by another thread, false when the caller has to move them
+ */
+static bool
+CS104_Slave_wakeupIngressDrainer(CS104_Slave self)
+{
+#if (CONFIG_USE_THREADS == 1)
+    bool isDrainerRunning;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                    if (con->redundancyGroup && con->redundancyGroup->secureEndpoint)
-                    {
-                        SecureEndpoint_peerConnectionEvent(con->redundancyGroup->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
-                    }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+    /* the ingress queue is drained by CS104_Slave_tick */
+    if (self->isThreadlessMode)
+    {
+        CS104_Slave_requestThreadlessWakeup(self);
+        return true;
+    }
 
-#endif /* SEC_AUTH_60870_5_7 */
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
 
-                    /* call plugins */
-                    if (self->plugins)
-                    {
-                        LinkedList pluginElem = LinkedList_getNext(self->plugins);
+    isDrainerRunning = self->isIngressDrainerRunning;
 
-                        while (pluginElem)
-                        {
-                            CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+    if (isDrainerRunning)
+        Handleset_wakeup(self->serverHandleSet);
 
-                            if (plugin->eventHandler)
-                                plugin->eventHandler(plugin->parameter, &(self->masterConnections[i]->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
 
-                            pluginElem = LinkedList_getNext(pluginElem);
-                        }
-                    }
+    return isDrainerRunning;
+#else
+    CS104_Slave_requestThreadlessWakeup(self);
+    return true;
+#endif /* (CONFIG_USE_THREADS == 1) */
+}
 
-                    self->masterConnections[i]->isUsed = false;
+/**
+ * Add the ASDU to the lock-free ingress queue
+ *
+ * \return true when the ASDU was added, false when the ingress queue cannot be used or the ASDU is too large
+ */
+static bool
+CS104_Slave_enqueueToIngressQueue(CS104_Slave self, CS101_ASDU asdu)
+{
+    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
 
-                    MessageQueue_setWaitingForTransmissionWhenNotConfirmed(self->masterConnections[i]->lowPrioQueue);
+    /* rejected by the event log */
+    if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH)
+        return false;
 
-                    self->openConnections--;
+    if (CS104_Slave_getEventLog(self) == NULL)
+        return false;
 
-                    MasterConnection_deinit(con);
-                }
-            }
+    while (IngressQueue_enqueueASDU(self->ingressQueue, asdu, asduSize) == false)
+    {
+        /* ingress queue is full -> move the waiting ASDUs to the event log */
+        if (CS104_Slave_drainIngressQueue(self) == 0)
+        {
+            /* oldest entry is not yet published by another producer */
+            Thread_sleep(1);
         }
+    }
 
-        /* handle incoming messages when available */
-        if (handleset && Handleset_waitReady(handleset, 0))
+    /* only the first ASDU after the last drain has to wake up the server thread */
+    if (IngressQueue_requestWakeup(self->ingressQueue))
+    {
+        if (CS104_Slave_wakeupIngressDrainer(self) == false)
         {
-            for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-            {
-                MasterConnection con = self->masterConnections[i];
-
-                if (con && con->isUsed)
-                    MasterConnection_handleTcpConnection(con);
-            }
+            /* server thread is not running */
+            if (CS104_Slave_drainIngressQueue(self) > 0)
+                CS104_Slave_wakeupConnections(self);
         }
+    }
 
-        /* handle periodic tasks for running connections */
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-        {
-            MasterConnection con = self->masterConnections[i];
+    return true;
+}
+#endif /* (CS104_SLAVE_HAS_ATOMICS == 1) */
 
-            if (con && con->isUsed && con->isRunning)
-            {
-                MasterConnection_executePeriodicTasks(con);
+bool
+CS104_Slave_enqueueASDU(CS104_Slave self, CS101_ASDU asdu)
+{
+    bool enqueued = false;
 
-#ifdef SEC_AUTH_60870_5_7
-                if (self->secureEndpoint)
-                {
-                    if (SecureEndpoint_runTask(self->secureEndpoint, &(con->iMasterConnection)) == false)
-                    {
-                        con->isRunning = false;
-                    }
-                }
+    /* waiting for free space only makes sense when the connections are handled by other threads */
+    int blockTimeout = self->overflowBlockTimeout;
+
+#if (CONFIG_USE_THREADS == 1)
+    if (self->isThreadlessMode)
+        blockTimeout = 0;
+#else
+    blockTimeout = 0;
+#endif
+
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+    if (self->ingressQueue && (self->overflowPolicy != CS104_QUEUE_OVERFLOW_BLOCK))
+    {
+        if (CS104_Slave_enqueueToIngressQueue(self, asdu))
+            return true;
+    }
+#endif /* (CS104_SLAVE_HAS_ATOMICS == 1) */
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+    {
+        if (self->asduQueue)
+            enqueued = MessageQueue_enqueueASDU(self->asduQueue, asdu, blockTimeout);
+    }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                if (con->redundancyGroup && con->redundancyGroup->secureEndpoint)
-                {
-                    if (SecureEndpoint_runTask(con->redundancyGroup->secureEndpoint, &(con->iMasterConnection)) == false)
-                    {
-                        con->isRunning = false;
-                    }
-                }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
 
-#endif /* SEC_AUTH_60870_5_7 */
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+    {
+        /************************************************
+         * Dispatch event to all redundancy groups
+         * (the queues of all groups share the same event log)
+         ************************************************/
 
-                /* call plugins */
-                if (self->plugins)
-                {
-                    LinkedList pluginElem = LinkedList_getNext(self->plugins);
+        if (self->sharedEventLog)
+            enqueued = MessageLog_enqueueASDU(self->sharedEventLog, asdu, blockTimeout);
+    }
 
-                    while (pluginElem)
-                    {
-                        CS101_SlavePlugin plugin = (CS101_SlavePlugin)LinkedList_getData(pluginElem);
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+    {
+        /************************************************
+         * Dispatch event to all open client connections
+         * (the queues of all connections share the same event log)
+         ************************************************/
 
-                        if (plugin->runTask)
-                            plugin->runTask(plugin->parameter, &(con->iMasterConnection));
+        if (self->sharedEventLog)
+            enqueued = MessageLog_enqueueASDU(self->sharedEventLog, asdu, 0);
+    }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-                        pluginElem = LinkedList_getNext(pluginElem);
-                    }
-                }
-            }
-        }
+    if (enqueued)
+        CS104_Slave_wakeupConnections(self);
+
+    return enqueued;
+}
+
+/* Information object types without time tag that can be transmitted in SQ=1 ASDUs */
+static bool
+isSequenceAllowedForType(IEC60870_5_TypeID typeId)
+{
+    switch (typeId)
+    {
+    case M_SP_NA_1:
+    case M_DP_NA_1:
+    case M_ST_NA_1:
+    case M_BO_NA_1:
+    case M_ME_NA_1:
+    case M_ME_NB_1:
+    case M_ME_NC_1:
+    case M_IT_NA_1:
+    case M_PS_NA_1:
+    case M_ME_ND_1:
+        return true;
+
+    default:
+        return false;
     }
 }
 
-static char*
-getPeerAddress(Socket socket, char* ipAddress)
+static bool
+isNextObjectContiguous(InformationObject* points, int index, int numberOfPoints)
+{
+    if (index + 1 >= numberOfPoints)
+        return false;
+
+    if (InformationObject_getType(points[index + 1]) != InformationObject_getType(points[index]))
+        return false;
+
+    return (InformationObject_getObjectAddress(points[index + 1]) ==
+            InformationObject_getObjectAddress(points[index]) + 1);
+}
+
+int
+CS104_Slave_enqueuePointUpdates(CS104_Slave self, CS101_CauseOfTransmission cot, int oa, int ca,
+                                InformationObject* points, int numberOfPoints)
 {
-    char* ipAddrStr = NULL;
+    int enqueuedASDUs = 0;
 
-    if (Socket_getPeerAddressStatic(socket, ipAddress))
+    int i = 0;
+
+    while (i < numberOfPoints)
     {
-        /* remove TCP port part */
-        if (ipAddress[0] == '[')
+        IEC60870_5_TypeID typeId = InformationObject_getType(points[i]);
+
+        /* use SQ=1 when the run starting with this object has contiguous IOAs */
+        bool isSequence = isSequenceAllowedForType(typeId) && isNextObjectContiguous(points, i, numberOfPoints);
+
+        sCS101_StaticASDU _asdu;
+
+        CS101_ASDU asdu = CS101_ASDU_initializeStatic(&_asdu, &(self->alParameters), isSequence, cot, oa, ca, false, false);
+
+        while (i < numberOfPoints)
         {
-            /* IPV6 address */
-            ipAddrStr = ipAddress + 1;
+            if (InformationObject_getType(points[i]) != typeId)
+                break;
 
-            char* separator = strchr(ipAddrStr, ']');
+            if (CS101_ASDU_addInformationObject(asdu, points[i]) == false)
+                break;
 
-            if (separator != NULL)
-                *separator = 0;
+            i++;
+
+            /* don't add objects to a sequence that would break the IOA sequence */
+            if (isSequence && (i < numberOfPoints) && (isNextObjectContiguous(points, i - 1, numberOfPoints) == false))
+                break;
+        }
+
+        if (CS101_ASDU_getNumberOfElements(asdu) > 0)
+        {
+            if (CS104_Slave_enqueueASDU(self, asdu))
+                enqueuedASDUs++;
         }
         else
         {
-            /* IPV4 address */
-            ipAddrStr = ipAddress;
-
-            char* separator = strchr(ipAddrStr, ':');
-
-            if (separator != NULL)
-                *separator = 0;
+            DEBUG_PRINT("CS104 SLAVE: cannot encode information object (IOA=%i) - skip\n",
+                        InformationObject_getObjectAddress(points[i]));
+            i++;
         }
     }
 
-    return ipAddrStr;
+    return enqueuedASDUs;
 }
 
-static bool
-callConnectionRequestHandler(CS104_Slave self, Socket newSocket)
+void
+CS104_Slave_addRedundancyGroup(CS104_Slave self, CS104_RedundancyGroup redundancyGroup)
 {
-    char ipAddress[60];
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+    {
+        if (self->redundancyGroups == NULL)
+            self->redundancyGroups = LinkedList_create();
 
-    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
+#ifdef SEC_AUTH_60870_5_7
+        if (redundancyGroup->secureEndpoint)
+        {
+            redundancyGroup->slave = self;
+            SecureEndpoint_addForwardASDUFunctionForSlave(redundancyGroup->secureEndpoint, (CS101_PluginForwardAsduFunc)CS104_Slave_forwardASDU, self);
+        }
+#endif /* SEC_AUTH_60870_5_7 */
 
-    if (ipAddrStr == NULL)
-        return false;
+        LinkedList_add(self->redundancyGroups, redundancyGroup);
+    }
 
-    if (self->connectionRequestHandler)
-        return self->connectionRequestHandler(self->connectionRequestHandlerParameter, ipAddrStr);
-    else
-        return true;
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 }
 
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-static CS104_RedundancyGroup
-getMatchingRedundancyGroup(CS104_Slave self, char* ipAddrStr)
+static void
+initializeRedundancyGroups(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
 {
-    struct sCS104_IPAddress ipAddress;
-    memset(&ipAddress, 0, sizeof(struct sCS104_IPAddress));
-
-    CS104_IPAddress_setFromString(&ipAddress, ipAddrStr);
+    if (self->redundancyGroups == NULL)
+    {
+        CS104_RedundancyGroup redGroup = CS104_RedundancyGroup_create(NULL);
+        CS104_Slave_addRedundancyGroup(self, redGroup);
+    }
 
-    CS104_RedundancyGroup catchAllGroup = NULL;
-    CS104_RedundancyGroup matchingGroup = NULL;
+    initializeSharedEventLog(self, lowPrioMaxQueueSize);
 
     LinkedList element = LinkedList_getNext(self->redundancyGroups);
 
+    int groupIndex = 0;
+
     while (element)
     {
         CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup)LinkedList_getData(element);
 
-        if (CS104_RedundancyGroup_matches(redGroup, &ipAddress))
+        if (redGroup->asduQueue == NULL)
         {
-            matchingGroup = redGroup;
-            break;
+            /* the queue of a group is identified by the group name (or the position of an unnamed group) */
+            char queueKey[MESSAGE_QUEUE_KEY_SIZE];
+
+            if (redGroup->name)
+                snprintf(queueKey, sizeof(queueKey), "group:%s", redGroup->name);
+            else
+                snprintf(queueKey, sizeof(queueKey), "group#%i", groupIndex);
+
+            CS104_RedundancyGroup_initializeMessageQueues(redGroup, self->sharedEventLog, queueKey,
+                                                          highPrioMaxQueueSize);
         }
 
-        if (CS104_RedundancyGroup_isCatchAll(redGroup))
-            catchAllGroup = redGroup;
+        groupIndex++;
 
         element = LinkedList_getNext(element);
     }
 
-    if (matchingGroup == NULL)
-        matchingGroup = catchAllGroup;
+    /* groups can be added while the slave is stopped -> rebuild the index */
+    ClientAddressIndex_destroy(self->clientAddressIndex);
 
-    return matchingGroup;
+    self->clientAddressIndex = ClientAddressIndex_create(self->redundancyGroups);
+
+    if (self->clientAddressIndex == NULL)
+        DEBUG_PRINT("CS104 SLAVE: failed to create client address index\n");
 }
 #endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-/* handle TCP connections in non-threaded mode */
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+
+/* move the pending ASDUs to the log before the replication collects the changes */
 static void
-handleConnectionsThreadless(CS104_Slave self)
+CS104_Slave_drainForReplication(void* parameter)
 {
-    if ((self->maxOpenConnections < 1) || (self->openConnections < self->maxOpenConnections))
-    {
-        Socket newSocket = ServerSocket_accept(self->serverSocket);
+    CS104_Slave_drainIngressQueue((CS104_Slave)parameter);
+}
 
-        if (newSocket)
-        {
-            bool acceptConnection = true;
+/* log of the event queue that can be replicated (NULL -> not supported in the server mode) */
+static MessageLog
+CS104_Slave_getReplicatedLog(CS104_Slave self)
+{
+    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+    {
+        DEBUG_PRINT("CS104 SLAVE: event queue replication not supported in mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP\n");
+        return NULL;
+    }
 
-            if (acceptConnection)
-                acceptConnection = callConnectionRequestHandler(self, newSocket);
+    return CS104_Slave_getEventLog(self);
+}
 
-            if (acceptConnection)
-            {
-                MessageQueue lowPrioQueue = NULL;
-                HighPriorityASDUQueue highPrioQueue = NULL;
+static void
+CS104_Slave_startReplication(CS104_Slave self)
+{
+    if ((self->replicationPort > 0) && (self->replication == NULL))
+    {
+        MessageLog log = CS104_Slave_getReplicatedLog(self);
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-                {
-                    lowPrioQueue = self->asduQueue;
-                    highPrioQueue = self->connectionAsduQueue;
-                }
-#endif
+        if (log)
+        {
+            self->replication = CS104_Replication_create(log, self->localAddress, NULL, self->replicationPort,
+                                                        CS104_Slave_drainForReplication, self);
 
-                MasterConnection con = NULL;
+            if (self->replication == NULL)
+                DEBUG_PRINT("CS104 SLAVE: failed to start event queue replication\n");
+        }
+    }
+}
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
-                {
-                    char ipAddress[60];
+static void
+CS104_Slave_stopReplication(CS104_Slave self)
+{
+    if (self->replication)
+    {
+        CS104_Replication_destroy(self->replication);
+        self->replication = NULL;
+    }
+}
 
-                    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
+#endif /* (CS104_SLAVE_HAS_REPLICATION == 1) */
 
-                    if (ipAddrStr)
-                    {
-                        CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, ipAddrStr);
+bool
+CS104_Slave_startStandby(CS104_Slave self, const char* activeAddress, int port)
+{
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    if (isRunning(self) || self->standby || (activeAddress == NULL))
+        return false;
 
-                        if (matchingGroup)
-                        {
-#if (CONFIG_USE_SEMAPHORES)
-                            Semaphore_wait(self->openConnectionsLock);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+        initializeMessageQueues(self, self->maxLowPrioQueueSize, self->maxHighPrioQueueSize);
 #endif
 
-                            con = getFreeConnection(self);
-
-                            if (con)
-                            {
-                                if (MasterConnection_initEx(con, newSocket, matchingGroup))
-                                {
-                                    self->openConnections++;
-
-                                    if (matchingGroup->name)
-                                    {
-                                        DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
-                                    }
-                                }
-                                else
-                                {
-                                    con->isUsed = false;
-                                    con = NULL;
-                                }
-                            }
-
-#if (CONFIG_USE_SEMAPHORES)
-                            Semaphore_post(self->openConnectionsLock);
-#endif
-                        }
-                        else
-                        {
-                            DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
-                        }
-                    }
-                    else
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: cannot determine peer IP address -> close connection\n");
-                    }
-                }
-                else
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
-                {
-#if (CONFIG_USE_SEMAPHORES)
-                    Semaphore_wait(self->openConnectionsLock);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+        initializeRedundancyGroups(self, self->maxLowPrioQueueSize, self->maxHighPrioQueueSize);
 #endif
-                    con = getFreeConnection(self);
-
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-                    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
-                    {
-                        lowPrioQueue = con->lowPrioQueue;
-                        MessageQueue_initialize(lowPrioQueue);
-
-                        highPrioQueue = con->highPrioQueue;
-                        HighPriorityASDUQueue_initialize(highPrioQueue);
-                    }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
-
-                    if (con)
-                    {
-                        if (MasterConnection_init(con, newSocket, lowPrioQueue, highPrioQueue))
-                        {
-                            self->openConnections++;
-                        }
-                        else
-                        {
-                            con->isUsed = false;
-                            con = NULL;
-                        }
-                    }
 
-#if (CONFIG_USE_SEMAPHORES)
-                    Semaphore_post(self->openConnectionsLock);
-#endif
-                }
+    MessageLog log = CS104_Slave_getReplicatedLog(self);
 
-                if (con)
-                {
-                    con->isRunning = true;
+    if (log == NULL)
+        return false;
 
-                    if (self->connectionEventHandler)
-                    {
-                        self->connectionEventHandler(self->connectionEventHandlerParameter,
-                                                     &(con->iMasterConnection),
-                                                     CS104_CON_EVENT_CONNECTION_OPENED);
-                    }
+    self->standby = CS104_Replication_create(log, NULL, activeAddress, port, NULL, NULL);
 
-#ifdef SEC_AUTH_60870_5_7
+    return (self->standby != NULL);
+#else
+    (void)self;
+    (void)activeAddress;
+    (void)port;
 
-                    if (self->secureEndpoint)
-                    {
-                        SecureEndpoint_peerConnectionEvent(self->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
-                    }
+    DEBUG_PRINT("CS104 SLAVE: event queue replication not supported\n");
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                    if (con->redundancyGroup && con->redundancyGroup->secureEndpoint)
-                    {
-                        SecureEndpoint_peerConnectionEvent(con->redundancyGroup->secureEndpoint, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
-                    }
-#endif /* CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS */
+    return false;
+#endif
+}
 
-#endif /* SEC_AUTH_60870_5_7 */
-                }
-                else
-                {
-                    Socket_destroy(newSocket);
-                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!\n");
-                }
-            }
-            else
-            {
-                Socket_destroy(newSocket);
-            }
-        }
+void
+CS104_Slave_stopStandby(CS104_Slave self)
+{
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    if (self->standby)
+    {
+        CS104_Replication_destroy(self->standby);
+        self->standby = NULL;
     }
-
-    handleClientConnections(self);
+#else
+    (void)self;
+#endif
 }
 
-#if (CONFIG_USE_THREADS == 1)
-
-static void*
-serverThread(void* parameter)
+bool
+CS104_Slave_isReplicationConnected(CS104_Slave self)
 {
-    CS104_Slave self = (CS104_Slave)parameter;
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    if (self->standby)
+        return CS104_Replication_isConnected(self->standby);
 
-    if (self->localAddress)
-        self->serverSocket = TcpServerSocket_create(self->localAddress, self->tcpPort);
-    else
-        self->serverSocket = TcpServerSocket_create("0.0.0.0", self->tcpPort);
+    if (self->replication)
+        return CS104_Replication_isConnected(self->replication);
+#else
+    (void)self;
+#endif
 
-    if (self->serverSocket == NULL)
+    return false;
+}
+
+void
+CS104_Slave_start(CS104_Slave self)
+{
+#if ((CONFIG_USE_THREADS == 1) && (CONFIG_USE_SEMAPHORES == 1))
+    if (isRunning(self) == false)
     {
-        DEBUG_PRINT("CS104 SLAVE: Cannot create server socket\n");
+        /* take over from the active server with the replicated event queue */
+        CS104_Slave_stopStandby(self);
 
 #if (CONFIG_USE_SEMAPHORES == 1)
         Semaphore_wait(self->stateLock);
 #endif
-        self->isStarting = false;
+
+        self->isStarting = true;
+        self->stopRunning = false;
 
 #if (CONFIG_USE_SEMAPHORES == 1)
         Semaphore_post(self->stateLock);
 #endif
 
-        goto exit_function;
-    }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+        if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+            initializeMessageQueues(self, self->maxLowPrioQueueSize, self->maxHighPrioQueueSize);
+#endif
 
-    ServerSocket_listen(self->serverSocket);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+        if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+            initializeRedundancyGroups(self, self->maxLowPrioQueueSize, self->maxHighPrioQueueSize);
+#endif
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+        if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
+            initializeConnectionSpecificQueues(self);
 #endif
 
-    self->isRunning = true;
-    self->isStarting = false;
+        initializeIngressQueue(self);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+        CS104_Slave_startReplication(self);
 #endif
 
-    while (isStopRunningSet(self) == false)
-    {
-        Socket newSocket = ServerSocket_accept(self->serverSocket);
+        CS104_Slave_startCommandWorkers(self);
 
-        if (newSocket)
+        if (self->threadingModel == CS104_THREADING_MODEL_EVENT_LOOP)
         {
-            bool acceptConnection = true;
+            CS104_Slave_startWorkers(self);
 
-            /* check if maximum number of open connections is reached */
-            if (self->maxOpenConnections > 0)
-            {
-                if (CS104_Slave_getOpenConnections(self) >= self->maxOpenConnections)
-                    acceptConnection = false;
-            }
-
-            if (acceptConnection)
-                acceptConnection = callConnectionRequestHandler(self, newSocket);
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+            CS104_Slave_startHandshakeThreads(self);
+#endif
+        }
 
-            if (acceptConnection)
-            {
-                MessageQueue lowPrioQueue = NULL;
-                HighPriorityASDUQueue highPrioQueue = NULL;
+        self->listeningThread = Thread_create(serverThread, (void*)self, false);
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-                {
-                    lowPrioQueue = self->asduQueue;
-                    highPrioQueue = self->connectionAsduQueue;
-                }
-#endif
+        Thread_start(self->listeningThread);
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
-                {
-                    lowPrioQueue = NULL;
-                    highPrioQueue = NULL;
-                }
+        while (isStarting(self))
+            Thread_sleep(1);
+    }
+#else
+    DEBUG_PRINT("CS104 SLAVE: ERROR: CS104_Slave_start not supported when CONFIG_USE_TREADS = 0 or "
+                "CONFIG_USE_SEMAPHORES = 0!\n");
 #endif
+}
 
-                MasterConnection connection = NULL;
+int
+CS104_Slave_getNumberOfQueueEntries(CS104_Slave self, CS104_RedundancyGroup redGroup)
+{
+    CS104_Slave_drainIngressQueue(self);
 
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+    {
+        return MessageQueue_getEntryCount(self->asduQueue);
+    }
+#endif
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
-                {
-                    char ipAddress[60];
-
-                    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
-
-                    if (ipAddrStr)
-                    {
-                        CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, ipAddrStr);
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+    {
+        if (redGroup)
+        {
+            return MessageQueue_getEntryCount(redGroup->asduQueue);
+        }
 
-                        if (matchingGroup)
-                        {
-#if (CONFIG_USE_SEMAPHORES)
-                            Semaphore_wait(self->openConnectionsLock);
+        DEBUG_PRINT("CS104_SLAVE: redundancy group not found\n");
+    }
 #endif
 
-                            connection = getFreeConnection(self);
-
-                            if (connection)
-                            {
-                                if (MasterConnection_initEx(connection, newSocket, matchingGroup))
-                                {
-                                    self->openConnections++;
-
-                                    if (matchingGroup->name)
-                                    {
-                                        DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
-                                    }
-                                }
-                                else
-                                {
-                                    connection->isUsed = false;
-                                    connection = NULL;
-                                }
-                            }
+    /* mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP not supported! */
 
-#if (CONFIG_USE_SEMAPHORES)
-                            Semaphore_post(self->openConnectionsLock);
-#endif
-                        }
-                        else
-                        {
-                            DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
-                        }
-                    }
-                    else
-                    {
-                        DEBUG_PRINT("CS104 SLAVE: cannot determine peer IP address -> close connection\n");
-                    }
-                }
-                else
-                {
-#if (CONFIG_USE_SEMAPHORES)
-                    Semaphore_wait(self->openConnectionsLock);
-#endif
+    return 0;
+}
 
-                    connection = getFreeConnection(self);
+bool
+CS104_Slave_getQueueMemoryUsage(CS104_Slave self, CS104_QueueMemoryUsage usage)
+{
+    CS104_Slave_drainIngressQueue(self);
 
-                    if (connection)
-                    {
-                        if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue))
-                        {
-                            self->openConnections++;
-                        }
-                        else
-                        {
-                            connection->isUsed = false;
-                            connection = NULL;
-                        }
-                    }
+    MessageLog log = CS104_Slave_getEventLog(self);
 
-#if (CONFIG_USE_SEMAPHORES)
-                    Semaphore_post(self->openConnectionsLock);
-#endif
-                }
-#else
+    if (log == NULL)
+        return false;
 
-#if (CONFIG_USE_SEMAPHORES)
-                Semaphore_wait(self->openConnectionsLock);
-#endif
-                connection = getFreeConnection(self);
+    MessageLog_lock(log);
 
-                if (connection)
-                {
-                    if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue))
-                    {
-                        self->openConnections++;
-                    }
-                    else
-                    {
-                        connection->isUsed = false;
-                        connection = NULL;
-                    }
-                }
+    usage->bufferSize = log->size;
+    usage->usedBytes = MessageLog_getUsedBytes(log);
+    usage->numberOfEntries = log->entryCounter;
 
-#if (CONFIG_USE_SEMAPHORES)
-                Semaphore_post(self->openConnectionsLock);
-#endif
+    MessageLog_unlock(log);
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+    return true;
+}
 
-                if (connection)
-                {
-                    /* now start the connection handling (thread) */
-                    MasterConnection_start(connection);
-                }
-                else
-                {
-                    Socket_destroy(newSocket);
+bool
+CS104_Slave_getQueueStatistics(CS104_Slave self, CS104_RedundancyGroup redGroup, CS104_QueueStatistics stats)
+{
+    CS104_Slave_drainIngressQueue(self);
 
-                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!\n");
-                }
-            }
-            else
-            {
-                Socket_destroy(newSocket);
-            }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+    {
+        if (self->asduQueue)
+        {
+            MessageQueue_getStatistics(self->asduQueue, stats);
+            return true;
         }
-        else
-            Thread_sleep(10);
-
-        /* check if there are connections to close */
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
+    }
 #endif
-
-        int i;
-
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+    {
+        if (redGroup && redGroup->asduQueue)
         {
-            if (self->masterConnections[i])
-            {
-                MasterConnection connection = self->masterConnections[i];
+            MessageQueue_getStatistics(redGroup->asduQueue, stats);
+            return true;
+        }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_wait(connection->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+        DEBUG_PRINT("CS104_SLAVE: redundancy group not found\n");
+    }
+#endif
 
-                bool isConnectionUsed = connection->isUsed;
+    /* mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP not supported! */
+    (void)redGroup;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                Semaphore_post(connection->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+    return false;
+}
 
-                if (isConnectionUsed)
-                {
-                    if (MasterConnection_isRunning(connection) == false)
-                    {
-                        Thread threadToJoin = NULL;
+/*
+ * Get a snapshot of the metrics of the connection without locking the connection. Each counter is
+ * read atomically, so it is never torn by a concurrent update (the counters are not read at the same
+ * instant). The gauges are calculated from the current state.
+ */
+static void
+MasterConnection_getMetrics(MasterConnection self, CS104_ConnectionMetrics metrics, uint64_t currentTime)
+{
+    MasterConnection_copyCounters(self, metrics, false);
 
-                        if (connection->connectionThread)
-                        {
-                            threadToJoin = connection->connectionThread;
+    metrics->highPrioQueueDepth = (self->highPrioQueue) ? self->highPrioQueue->entryCounter : 0;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                            Semaphore_wait(connection->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+    metrics->unconfirmedIFrames = 0;
+    metrics->oldestUnconfirmedAge = 0;
 
-                            connection->connectionThread = NULL;
+    int oldest = self->oldestSentASDU;
+    int newest = self->newestSentASDU;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                            Semaphore_post(connection->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-                        }
+    if ((oldest >= 0) && (newest >= 0) && (oldest < self->maxSentASDUs) && (newest < self->maxSentASDUs))
+    {
+        if (newest >= oldest)
+            metrics->unconfirmedIFrames = newest - oldest + 1;
+        else
+            metrics->unconfirmedIFrames = self->maxSentASDUs - oldest + newest + 1;
 
-                        /* Release openConnectionsLock before joining the connection thread.
-                         * The connection thread may be waiting to acquire openConnectionsLock
-                         * (e.g. inside CS104_Slave_activate), so joining while holding the
-                         * lock would cause a deadlock. */
-#if (CONFIG_USE_SEMAPHORES == 1)
-                        Semaphore_post(self->openConnectionsLock);
-#endif
+        uint64_t sentTime = self->sentASDUs[oldest].sentTime;
 
-                        if (threadToJoin)
-                            Thread_destroy(threadToJoin);
+        if (currentTime > sentTime)
+            metrics->oldestUnconfirmedAge = (uint32_t)(currentTime - sentTime);
+    }
+}
 
-                        MasterConnection_deinit(connection);
+bool
+CS104_Slave_getConnectionMetrics(CS104_Slave self, IMasterConnection connection, CS104_ConnectionMetrics metrics)
+{
+    bool found = false;
+
+    uint64_t currentTime = Hal_getMonotonicTimeInMs();
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-                        Semaphore_wait(self->openConnectionsLock);
+    Semaphore_wait(self->openConnectionsLock);
 #endif
 
-                        self->openConnections--;
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-                        Semaphore_wait(connection->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
+    int i;
 
-                        connection->isUsed = false;
+    for (i = 0; i < self->numberOfActiveConnections; i++)
+    {
+        MasterConnection con = self->activeConnections[i];
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-                        Semaphore_post(connection->stateLock);
-#endif /* (CONFIG_USE_SEMAPHORES == 1) */
-                    }
-                }
-            }
+        /* the connection is only accessed when it is still open */
+        if (con && con->isUsed && (&(con->iMasterConnection) == connection))
+        {
+            MasterConnection_getMetrics(con, metrics, currentTime);
+            found = true;
+            break;
         }
+    }
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
+    Semaphore_post(self->openConnectionsLock);
 #endif
-    }
 
-    if (self->serverSocket)
-        Socket_destroy((Socket)self->serverSocket);
+    return found;
+}
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->stateLock);
+bool
+CS104_Slave_getRedundancyGroupMetrics(CS104_Slave self, CS104_RedundancyGroup redGroup, CS104_ConnectionMetrics metrics)
+{
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if ((redGroup != NULL) && (self->serverMode != CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS))
+    {
+        DEBUG_PRINT("CS104_SLAVE: redundancy group metrics require mode CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS\n");
+        return false;
+    }
+#else
+    if (redGroup != NULL)
+        return false;
 #endif
 
-    self->isRunning = false;
-    self->stopRunning = false;
+    uint64_t currentTime = Hal_getMonotonicTimeInMs();
+
+    memset(metrics, 0, sizeof(struct sCS104_ConnectionMetrics));
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->stateLock);
+    Semaphore_wait(self->openConnectionsLock);
+    Semaphore_wait(self->metricsLock);
 #endif
 
-exit_function:
-    return NULL;
-}
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (redGroup)
+        addCounters(metrics, &(redGroup->closedConnectionMetrics));
+    else
+#endif
+        addCounters(metrics, &(self->closedConnectionMetrics));
 
-#endif /* (CONFIG_USE_THREADS == 1) */
+    int i;
 
-void
-CS104_Slave_enqueueASDU(CS104_Slave self, CS101_ASDU asdu)
-{
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-        MessageQueue_enqueueASDU(self->asduQueue, asdu);
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
+    for (i = 0; i < self->numberOfActiveConnections; i++)
+    {
+        MasterConnection con = self->activeConnections[i];
 
+        if (con && con->isUsed)
+        {
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+            if ((redGroup != NULL) && (con->redundancyGroup != redGroup))
+                continue;
+#endif
 
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
-    {
-        /************************************************
-         * Dispatch event to all redundancy groups
-         ************************************************/
+            struct sCS104_ConnectionMetrics conMetrics;
 
-        LinkedList element = LinkedList_getNext(self->redundancyGroups);
+            MasterConnection_getMetrics(con, &conMetrics, currentTime);
 
-        while (element)
-        {
-            CS104_RedundancyGroup group = (CS104_RedundancyGroup)LinkedList_getData(element);
+            addCounters(metrics, &conMetrics);
 
-            MessageQueue_enqueueASDU(group->asduQueue, asdu);
+            metrics->highPrioQueueDepth += conMetrics.highPrioQueueDepth;
+            metrics->unconfirmedIFrames += conMetrics.unconfirmedIFrames;
 
-            element = LinkedList_getNext(element);
+            if (conMetrics.oldestUnconfirmedAge > metrics->oldestUnconfirmedAge)
+                metrics->oldestUnconfirmedAge = conMetrics.oldestUnconfirmedAge;
         }
     }
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
-
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
-    {
 #if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
+    Semaphore_post(self->metricsLock);
+    Semaphore_post(self->openConnectionsLock);
 #endif
 
-        /************************************************
-         * Dispatch event to all open client connections
-         ************************************************/
+    return true;
+}
 
-        int i;
+uint32_t
+CS104_LatencyHistogram_getBucketLimit(int index)
+{
+    if (index < 16)
+        return (index < 0) ? 0 : (uint32_t)index;
 
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-        {
-            MasterConnection con = self->masterConnections[i];
+    if (index >= CS104_LATENCY_HISTOGRAM_BUCKETS)
+        return UINT32_MAX;
 
-            if (con)
-                MessageQueue_enqueueASDU(con->lowPrioQueue, asdu);
-        }
+    int shift = 1 + ((index - 16) / 8);
+    uint64_t mantissa = 8 + ((index - 16) % 8);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
-#endif
-    }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
+    return (uint32_t)(((mantissa + 1) << shift) - 1);
 }
 
-void
-CS104_Slave_addRedundancyGroup(CS104_Slave self, CS104_RedundancyGroup redundancyGroup)
+uint32_t
+CS104_LatencyHistogram_getPercentile(CS104_LatencyHistogram self, double percentile)
 {
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+    if (self->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)(self->count));
+
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t counted = 0;
+
+    int i;
+
+    for (i = 0; i < CS104_LATENCY_HISTOGRAM_BUCKETS; i++)
     {
-        if (self->redundancyGroups == NULL)
-            self->redundancyGroups = LinkedList_create();
+        counted += self->buckets[i];
 
-#ifdef SEC_AUTH_60870_5_7
-        if (redundancyGroup->secureEndpoint)
+        if (counted >= rank)
         {
-            redundancyGroup->slave = self;
-            SecureEndpoint_addForwardASDUFunctionForSlave(redundancyGroup->secureEndpoint, (CS101_PluginForwardAsduFunc)CS104_Slave_forwardASDU, self);
-        }
-#endif /* SEC_AUTH_60870_5_7 */
+            uint32_t limit = CS104_LatencyHistogram_getBucketLimit(i);
 
-        LinkedList_add(self->redundancyGroups, redundancyGroup);
+            return (limit < self->max) ? limit : self->max;
+        }
     }
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+    return self->max;
 }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-static void
-initializeRedundancyGroups(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
+bool
+CS104_Slave_getConnectionLatency(CS104_Slave self, IMasterConnection connection, CS104_LatencyType type,
+                                 CS104_LatencyHistogram histogram)
 {
-    if (self->redundancyGroups == NULL)
-    {
-        CS104_RedundancyGroup redGroup = CS104_RedundancyGroup_create(NULL);
-        CS104_Slave_addRedundancyGroup(self, redGroup);
-    }
-
-    LinkedList element = LinkedList_getNext(self->redundancyGroups);
+    bool found = false;
 
-    while (element)
-    {
-        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup)LinkedList_getData(element);
+#if (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1)
+    if ((type < CS104_LATENCY_QUEUE_WAIT) || (type > CS104_LATENCY_END_TO_END))
+        return false;
 
-        if (redGroup->asduQueue == NULL)
-            CS104_RedundancyGroup_initializeMessageQueues(redGroup, lowPrioMaxQueueSize, highPrioMaxQueueSize);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
 
-        element = LinkedList_getNext(element);
-    }
-}
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+    int i;
 
-void
-CS104_Slave_start(CS104_Slave self)
-{
-#if ((CONFIG_USE_THREADS == 1) && (CONFIG_USE_SEMAPHORES == 1))
-    if (isRunning(self) == false)
+    for (i = 0; i < self->numberOfActiveConnections; i++)
     {
+        MasterConnection con = self->activeConnections[i];
+
+        if (con && con->isUsed && (&(con->iMasterConnection) == connection))
+        {
 #if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->stateLock);
+            Semaphore_wait(con->sentASDUsLock);
 #endif
 
-        self->isStarting = true;
-        self->stopRunning = false;
+            memcpy(histogram, &(con->latency[type]), sizeof(struct sCS104_LatencyHistogram));
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->stateLock);
+            Semaphore_post(con->sentASDUsLock);
 #endif
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-        if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-            initializeMessageQueues(self, self->maxLowPrioQueueSize, self->maxHighPrioQueueSize);
-#endif
+            found = true;
+            break;
+        }
+    }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
-            initializeRedundancyGroups(self, self->maxLowPrioQueueSize, self->maxHighPrioQueueSize);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->openConnectionsLock);
 #endif
+#else
+    (void)self;
+    (void)connection;
+    (void)type;
+    (void)histogram;
+#endif /* (CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS == 1) */
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-        if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
-            initializeConnectionSpecificQueues(self);
+    return found;
+}
+
+int
+CS104_Slave_getFileDescriptors(CS104_Slave self, int* fds, int maxFds)
+{
+    int count = 0;
+
+    if (self->serverSocket)
+    {
+        if ((fds != NULL) && (count < maxFds))
+            fds[count] = Socket_getFd((Socket)self->serverSocket);
+
+        count++;
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->openConnectionsLock);
 #endif
 
-        self->listeningThread = Thread_create(serverThread, (void*)self, false);
+    int i;
 
-        Thread_start(self->listeningThread);
+    for (i = 0; i < self->numberOfActiveConnections; i++)
+    {
+        MasterConnection con = self->activeConnections[i];
 
-        while (isStarting(self))
-            Thread_sleep(1);
+        if (con && con->isUsed && con->isRunning)
+        {
+            if ((fds != NULL) && (count < maxFds))
+                fds[count] = Socket_getFd(con->socket);
+
+            count++;
+        }
     }
-#else
-    DEBUG_PRINT("CS104 SLAVE: ERROR: CS104_Slave_start not supported when CONFIG_USE_TREADS = 0 or "
-                "CONFIG_USE_SEMAPHORES = 0!\n");
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->openConnectionsLock);
 #endif
+
+    return count;
 }
 
 int
-CS104_Slave_getNumberOfQueueEntries(CS104_Slave self, CS104_RedundancyGroup redGroup)
+CS104_Slave_getConnectionFileDescriptor(CS104_Slave self, IMasterConnection connection)
 {
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-    {
-        return MessageQueue_getEntryCount(self->asduQueue);
-    }
+    int fd = -1;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->openConnectionsLock);
 #endif
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)
+
+    int i;
+
+    for (i = 0; i < self->numberOfActiveConnections; i++)
     {
-        if (redGroup)
+        MasterConnection con = self->activeConnections[i];
+
+        if (con && con->isUsed && (&(con->iMasterConnection) == connection))
         {
-            return MessageQueue_getEntryCount(redGroup->asduQueue);
+            fd = Socket_getFd(con->socket);
+            break;
         }
-
-        DEBUG_PRINT("CS104_SLAVE: redundancy group not found\n");
     }
-#endif
 
-    /* mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP not supported! */
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->openConnectionsLock);
+#endif
 
-    return 0;
+    return fd;
 }
 
 void
@@ -5154,6 +10815,9 @@ CS104_Slave_startThreadless(CS104_Slave self)
 {
     if (isRunning(self) == false)
     {
+        /* take over from the active server with the replicated event queue */
+        CS104_Slave_stopStandby(self);
+
 #if (CONFIG_USE_THREADS == 1)
         self->isThreadlessMode = true;
 #endif
@@ -5173,6 +10837,16 @@ CS104_Slave_startThreadless(CS104_Slave self)
             initializeConnectionSpecificQueues(self);
 #endif
 
+        initializeIngressQueue(self);
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+        CS104_Slave_startReplication(self);
+#endif
+
+#if (CONFIG_USE_THREADS == 1)
+        CS104_Slave_startCommandWorkers(self);
+#endif
+
         if (self->localAddress)
             self->serverSocket = TcpServerSocket_create(self->localAddress, self->tcpPort);
         else
@@ -5195,8 +10869,16 @@ CS104_Slave_startThreadless(CS104_Slave self)
             goto exit_function;
         }
 
+        ServerSocket_setBacklog(self->serverSocket, CONFIG_CS104_SLAVE_LISTEN_BACKLOG);
+
         ServerSocket_listen(self->serverSocket);
 
+        self->threadlessHandleSet = Handleset_new();
+        self->threadlessHandleSetChanged = true;
+
+        TimerWheel_init(&(self->threadlessTimers), Hal_getMonotonicTimeInMs());
+        self->threadlessAsduWaiting = false;
+
 #if (CONFIG_USE_SEMAPHORES == 1)
         Semaphore_wait(self->stateLock);
 #endif
@@ -5223,6 +10905,12 @@ CS104_Slave_stopThreadless(CS104_Slave self)
         self->serverSocket = NULL;
     }
 
+    if (self->threadlessHandleSet)
+    {
+        Handleset_destroy(self->threadlessHandleSet);
+        self->threadlessHandleSet = NULL;
+    }
+
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
     if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP)
     {
@@ -5231,12 +10919,23 @@ CS104_Slave_stopThreadless(CS104_Slave self)
 #endif
 
     CS104_Slave_closeAllConnections(self);
+
+#if (CONFIG_USE_THREADS == 1)
+    CS104_Slave_stopCommandWorkers(self);
+#endif
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    CS104_Slave_stopReplication(self);
+#endif
 }
 
-void
+unsigned int
 CS104_Slave_tick(CS104_Slave self)
 {
-    handleConnectionsThreadless(self);
+    if (self->serverSocket == NULL)
+        return CS104_Slave_getMaxWaitTime(self, true);
+
+    return handleConnectionsThreadless(self);
 }
 
 bool
@@ -5277,19 +10976,28 @@ CS104_Slave_stop(CS104_Slave self)
             Thread_destroy(self->listeningThread);
         }
 
+#if (CS104_SLAVE_HAS_HANDSHAKE_THREADS == 1)
+        /* connections waiting for the TLS handshake are closed */
+        CS104_Slave_stopHandshakeThreads(self);
+#endif
+
+        /* workers close all their connections when stopped */
+        CS104_Slave_stopWorkers(self);
+
         /*
          * Stop all connections
          * */
         {
             int i;
 
-            for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
+            /* backwards because the closed connections are removed from the active connections */
+            for (i = self->numberOfActiveConnections - 1; i >= 0; i--)
             {
 #if (CONFIG_USE_SEMAPHORES == 1)
                 Semaphore_wait(self->openConnectionsLock);
 #endif
 
-                MasterConnection connection = self->masterConnections[i];
+                MasterConnection connection = (i < self->numberOfActiveConnections) ? self->activeConnections[i] : NULL;
 
                 if (connection)
                 {
@@ -5324,9 +11032,15 @@ CS104_Slave_stop(CS104_Slave self)
 
                             connection->connectionThread = NULL;
                         }
+                        else if (self->threadingModel == CS104_THREADING_MODEL_EVENT_LOOP)
+                        {
+                            MasterConnection_deinit(connection);
+                        }
 #endif /* (CONFIG_USE_THREADS == 1) */
 
                         self->openConnections--;
+
+                        releaseConnection(self, connection);
                     }
                 }
 
@@ -5337,6 +11051,12 @@ CS104_Slave_stop(CS104_Slave self)
         }
 
         self->listeningThread = NULL;
+
+        CS104_Slave_stopCommandWorkers(self);
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+        CS104_Slave_stopReplication(self);
+#endif
     }
 #endif
 }
@@ -5348,6 +11068,8 @@ CS104_Slave_destroy(CS104_Slave self)
     {
         CS104_Slave_stop(self);
 
+        CS104_Slave_stopStandby(self);
+
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
         if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
         {
@@ -5359,9 +11081,16 @@ CS104_Slave_destroy(CS104_Slave self)
         if (self->localAddress != NULL)
             GLOBAL_FREEMEM(self->localAddress);
 
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+        if (self->eventQueueFile != NULL)
+            GLOBAL_FREEMEM(self->eventQueueFile);
+#endif
+
 #if (CONFIG_USE_SEMAPHORES == 1)
         Semaphore_destroy(self->openConnectionsLock);
         Semaphore_destroy(self->stateLock);
+        Semaphore_destroy(self->metricsLock);
+        Semaphore_destroy(self->commandsLock);
 #endif
 
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
@@ -5381,26 +11110,39 @@ CS104_Slave_destroy(CS104_Slave self)
                                        (LinkedListValueDeleteFunction)CS104_RedundancyGroup_destroy);
         }
 
+        ClientAddressIndex_destroy(self->clientAddressIndex);
+
 #endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
         {
             int i;
 
-            for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++)
-            {
-                if (self->masterConnections[i])
-                {
-                    MasterConnection_destroy(self->masterConnections[i]);
-                    self->masterConnections[i] = NULL;
-                }
-            }
+            for (i = 0; i < self->numberOfConnectionObjects; i++)
+                MasterConnection_destroy(self->masterConnections[i]);
+
+            if (self->masterConnections)
+                GLOBAL_FREEMEM(self->masterConnections);
+
+            if (self->activeConnections)
+                GLOBAL_FREEMEM(self->activeConnections);
         }
 
+#if ((CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) || (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1))
+        MessageLog_release(self->sharedEventLog);
+#endif
+
+#if (CS104_SLAVE_HAS_ATOMICS == 1)
+        IngressQueue_destroy(self->ingressQueue);
+#endif
+
         if (self->plugins)
         {
             LinkedList_destroyStatic(self->plugins);
         }
 
+        /* commands that are still open are released (the handles must not be used anymore) */
+        LinkedList_destroy(self->commands);
+
         GLOBAL_FREEMEM(self);
     }
 }
@@ -0,0 +1,276 @@
+/*
+ *  cs104_timer_wheel.c
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "cs104_timer_wheel.h"
+
+void
+TimerWheelEntry_init(TimerWheelEntry self, void* data)
+{
+    self->next = NULL;
+    self->prev = NULL;
+    self->slot = NULL;
+    self->expiry = 0;
+    self->data = data;
+}
+
+bool
+TimerWheelEntry_isArmed(TimerWheelEntry self)
+{
+    return (self->slot != NULL);
+}
+
+void
+TimerWheel_init(TimerWheel self, uint64_t currentTime)
+{
+    memset(self->slots, 0, sizeof(self->slots));
+
+    self->currentTime = currentTime;
+    self->numberOfEntries = 0;
+}
+
+/**
+ * \param minimumDelta 0 when the slot of the current time is not yet handled (moving entries down), 1 otherwise
+ */
+static void
+TimerWheel_insert(TimerWheel self, TimerWheelEntry entry, uint64_t minimumDelta)
+{
+    /* entries that are already expired are handled with the next time step */
+    uint64_t placement = entry->expiry;
+
+    if (placement < self->currentTime + minimumDelta)
+        placement = self->currentTime + minimumDelta;
+
+    if ((placement - self->currentTime) > TIMER_WHEEL_MAX_RANGE)
+        placement = self->currentTime + TIMER_WHEEL_MAX_RANGE;
+
+    uint64_t delta = placement - self->currentTime;
+
+    int level = 0;
+
+    while ((level < TIMER_WHEEL_LEVELS - 1) && (delta >= ((uint64_t)1 << ((level + 1) * TIMER_WHEEL_SLOT_BITS))))
+        level++;
+
+    TimerWheelEntry* slot =
+        &(self->slots[level][(placement >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK]);
+
+    entry->prev = NULL;
+    entry->next = *slot;
+
+    if (entry->next)
+        entry->next->prev = entry;
+
+    *slot = entry;
+    entry->slot = slot;
+}
+
+static void
+TimerWheel_unlink(TimerWheelEntry entry)
+{
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        *(entry->slot) = entry->next;
+
+    if (entry->next)
+        entry->next->prev = entry->prev;
+
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->slot = NULL;
+}
+
+/**
+ * \brief Remove the entry from the wheel (no effect when the entry is not armed)
+ */
+void
+TimerWheel_remove(TimerWheel self, TimerWheelEntry entry)
+{
+    if (TimerWheelEntry_isArmed(entry))
+    {
+        TimerWheel_unlink(entry);
+        self->numberOfEntries--;
+    }
+}
+
+/**
+ * \brief Arm the entry (an armed entry is moved to the new expiry time)
+ *
+ * \param expiry monotonic time in ms
+ */
+void
+TimerWheel_add(TimerWheel self, TimerWheelEntry entry, uint64_t expiry)
+{
+    TimerWheel_remove(self, entry);
+
+    entry->expiry = expiry;
+
+    TimerWheel_insert(self, entry, 1);
+    self->numberOfEntries++;
+}
+
+/**
+ * \brief Get the next time the wheel has to be advanced
+ *
+ * For the higher levels this is the time the entries of the next slot are moved to a lower
+ * level (the entries don't expire before this time).
+ *
+ * \return the time in ms or UINT64_MAX when the wheel is empty
+ */
+uint64_t
+TimerWheel_getNextEventTime(TimerWheel self)
+{
+    uint64_t nextTime = UINT64_MAX;
+
+    if (self->numberOfEntries > 0)
+    {
+        int level;
+
+        for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            int shift = level * TIMER_WHEEL_SLOT_BITS;
+
+            uint64_t position = self->currentTime >> shift;
+
+            uint64_t k;
+
+            for (k = 1; k <= TIMER_WHEEL_SLOTS; k++)
+            {
+                if (self->slots[level][(position + k) & TIMER_WHEEL_SLOT_MASK])
+                {
+                    uint64_t slotTime = (position + k) << shift;
+
+                    if (slotTime < nextTime)
+                        nextTime = slotTime;
+
+                    break;
+                }
+            }
+        }
+    }
+
+    return nextTime;
+}
+
+/**
+ * \brief Get the time until the next entry can expire
+ *
+ * \return the time to wait in ms (at most maxWaitTime)
+ */
+unsigned int
+TimerWheel_getWaitTime(TimerWheel self, uint64_t currentTime, unsigned int maxWaitTime)
+{
+    uint64_t nextTime = TimerWheel_getNextEventTime(self);
+
+    if (nextTime <= currentTime)
+        return 0;
+
+    if ((nextTime - currentTime) > maxWaitTime)
+        return maxWaitTime;
+
+    return (unsigned int)(nextTime - currentTime);
+}
+
+/**
+ * \brief Advance the wheel to the current time and remove the expired entries
+ *
+ * The time jumps to the next slot containing entries, so empty slots cost nothing.
+ *
+ * \return the number of expired entries (the expired entries are not armed anymore)
+ */
+int
+TimerWheel_advance(TimerWheel self, uint64_t currentTime)
+{
+    int expiredEntries = 0;
+
+    while (self->currentTime < currentTime)
+    {
+        uint64_t nextTime = TimerWheel_getNextEventTime(self);
+
+        if (nextTime > currentTime)
+        {
+            /* nothing happens until the current time */
+            self->currentTime = currentTime;
+            break;
+        }
+
+        self->currentTime = nextTime;
+
+        /* move entries of the higher levels down (highest level first) */
+        int level;
+
+        for (level = TIMER_WHEEL_LEVELS - 1; level > 0; level--)
+        {
+            int shift = level * TIMER_WHEEL_SLOT_BITS;
+
+            if ((self->currentTime & (((uint64_t)1 << shift) - 1)) == 0)
+            {
+                TimerWheelEntry* slot = &(self->slots[level][(self->currentTime >> shift) & TIMER_WHEEL_SLOT_MASK]);
+
+                TimerWheelEntry entry = *slot;
+
+                *slot = NULL;
+
+                while (entry)
+                {
+                    TimerWheelEntry next = entry->next;
+
+                    TimerWheel_insert(self, entry, 0);
+
+                    entry = next;
+                }
+            }
+        }
+
+        TimerWheelEntry* slot = &(self->slots[0][self->currentTime & TIMER_WHEEL_SLOT_MASK]);
+
+        TimerWheelEntry entry = *slot;
+
+        *slot = NULL;
+
+        while (entry)
+        {
+            TimerWheelEntry next = entry->next;
+
+            if (entry->expiry > self->currentTime)
+            {
+                /* entry was placed at the end of the range (expiry beyond TIMER_WHEEL_MAX_RANGE) */
+                TimerWheel_insert(self, entry, 1);
+            }
+            else
+            {
+                entry->slot = NULL;
+                entry->prev = NULL;
+                entry->next = NULL;
+
+                self->numberOfEntries--;
+                expiredEntries++;
+            }
+
+            entry = next;
+        }
+    }
+
+    return expiredEntries;
+}
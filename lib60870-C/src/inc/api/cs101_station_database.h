@@ -0,0 +1,224 @@
+/*
+ *  cs101_station_database.h
+ *
+ *  Copyright 2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS101_STATION_DATABASE_H_
+#define SRC_INC_API_CS101_STATION_DATABASE_H_
+
+/**
+ * \file cs101_station_database.h
+ * \brief Process image of a slave that can answer interrogation and read commands.
+ */
+
+#include "iec60870_common.h"
+#include "cs101_information_objects.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup SLAVE
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS101_STATION_DATABASE Station database (process image)
+ *
+ * The station database keeps the current values of the data points of one or more
+ * stations (common addresses). The points are stored in blocks of points with the same
+ * type and contiguous information object addresses. A slave can use the database to
+ * answer station and group interrogation (C_IC_NA_1) and read commands (C_RD_NA_1)
+ * without calling the application. Interrogation responses are packed into ASDUs with
+ * sequence of information objects (SQ=1).
+ *
+ * Supported types: M_SP_NA_1, M_DP_NA_1, M_ST_NA_1, M_BO_NA_1, M_ME_NA_1, M_ME_NB_1,
+ * M_ME_NC_1, M_PS_NA_1, M_ME_ND_1. All points are invalid (quality IV set) until the
+ * first update.
+ *
+ * Measured values can be filtered by a deadband (see \ref CS101_StationDatabase_setDeadband), so
+ * only significant changes are reported as spontaneous events. The process image always contains
+ * the latest value.
+ *
+ * @{
+ */
+
+typedef struct sCS101_StationDatabase* CS101_StationDatabase;
+
+/**
+ * \brief Deadband types for measured values
+ */
+typedef enum
+{
+    /** every change of the value is reported */
+    CS101_DEADBAND_NONE = 0,
+
+    /** change is reported when |value - last reported value| > threshold */
+    CS101_DEADBAND_ABSOLUTE = 1,
+
+    /** change is reported when |value - last reported value| > threshold (in percent) * |last reported value| */
+    CS101_DEADBAND_PERCENT = 2,
+
+    /** change is reported when the integral of |value - last reported value| over time (in seconds) > threshold */
+    CS101_DEADBAND_INTEGRATED = 3
+} CS101_DeadbandType;
+
+/**
+ * \brief Handler that is called when the value or quality of a point with spontaneous transmission changed
+ *
+ * \param parameter user provided parameter
+ * \param asdu the spontaneous ASDU (only valid during the call)
+ *
+ * \return true when the event was accepted, false otherwise
+ */
+typedef bool (*CS101_StationDatabase_EventHandler)(void* parameter, CS101_ASDU asdu);
+
+/**
+ * \brief Create a new station database
+ *
+ * \param alParams the application layer parameters of the slave (used to create the ASDUs)
+ *
+ * \return the new instance or NULL when the memory allocation failed
+ */
+CS101_StationDatabase
+CS101_StationDatabase_create(CS101_AppLayerParameters alParams);
+
+/**
+ * \brief Release all resources of the station database
+ *
+ * NOTE: The database has to be removed from the slave before (or the slave has to be destroyed before).
+ */
+void
+CS101_StationDatabase_destroy(CS101_StationDatabase self);
+
+/**
+ * \brief Add a block of points with the same type and contiguous information object addresses
+ *
+ * NOTE: Should be called before the database is used by the slave.
+ *
+ * \param ca the common address of the station
+ * \param typeId the type of the points (type without time tag, see supported types)
+ * \param startIoa information object address of the first point
+ * \param count number of points
+ * \param group interrogation group (1-16) or 0 when the points are only part of the station interrogation
+ * \param spontaneous true when a change of value or quality is reported as spontaneous event
+ *
+ * \return true on success, false when the type is not supported, the addresses overlap with
+ *         another block or the memory allocation failed
+ */
+bool
+CS101_StationDatabase_addPoints(CS101_StationDatabase self, int ca, IEC60870_5_TypeID typeId, int startIoa,
+                                int count, int group, bool spontaneous);
+
+/**
+ * \brief Set the handler for spontaneous events
+ *
+ * NOTE: This function is used by the slave when the database is assigned to the slave (see
+ * \ref CS104_Slave_setStationDatabase).
+ *
+ * \param handler the handler or NULL to disable events
+ * \param parameter user provided parameter for the handler
+ */
+void
+CS101_StationDatabase_setEventHandler(CS101_StationDatabase self, CS101_StationDatabase_EventHandler handler,
+                                      void* parameter);
+
+/**
+ * \brief Update the value of a point
+ *
+ * The information object can also be of the corresponding type with time tag (e.g. M_ME_TF_1
+ * for a point of type M_ME_NC_1). When the value or quality changed and the block of the point
+ * has spontaneous transmission enabled, the information object is reported as spontaneous event
+ * (including the time tag).
+ *
+ * \param ca the common address of the station
+ * \param io the information object with the new value (the object is not released by this function)
+ *
+ * \return true when the point was updated, false when the point doesn't exist or the type doesn't match
+ */
+bool
+CS101_StationDatabase_update(CS101_StationDatabase self, int ca, InformationObject io);
+
+/**
+ * \brief Set the deadband filter for measured values
+ *
+ * The filter decides which updates of the points are reported as spontaneous events. A change of
+ * the quality is always reported. When a maximum report interval is set, the value is also reported
+ * with the next update when the last report is older than the interval.
+ *
+ * NOTE: The points have to be part of a single block of measured values (M_ME_NA_1, M_ME_NB_1,
+ * M_ME_NC_1 or M_ME_ND_1). The deadband is applied to the value as represented in the ASDU (e.g.
+ * the scaled value for M_ME_NB_1).
+ *
+ * \param ca the common address of the station
+ * \param startIoa information object address of the first point
+ * \param count number of points
+ * \param type the deadband type
+ * \param threshold the deadband (unit depends on the deadband type)
+ * \param maxReportInterval maximum time between two reports in ms (0 -> not used)
+ *
+ * \return true on success, false when the points don't exist, are not measured values or the memory allocation failed
+ */
+bool
+CS101_StationDatabase_setDeadband(CS101_StationDatabase self, int ca, int startIoa, int count, CS101_DeadbandType type,
+                                  float threshold, int maxReportInterval);
+
+/**
+ * \brief Update the values of a range of measured values
+ *
+ * This function is intended for the cyclic update of many measured values. The deadbands of all points
+ * are evaluated in one pass and the reported points are packed into spontaneous ASDUs (SQ=0).
+ *
+ * NOTE: The points have to be part of a single block of measured values (M_ME_NA_1, M_ME_NB_1,
+ * M_ME_NC_1 or M_ME_ND_1).
+ *
+ * \param ca the common address of the station
+ * \param startIoa information object address of the first point
+ * \param count number of points
+ * \param values the new values (normalized value, scaled value or short floating point value depending on the type)
+ * \param qualities the new qualities or NULL when all points have good quality
+ * \param timestamp time tag of the events (events are sent as types with CP56Time2a time tag) or NULL
+ *                  to send events without time tag
+ *
+ * \return the number of reported points, or -1 when the points don't exist or are not measured values
+ */
+int
+CS101_StationDatabase_updateMeasuredValues(CS101_StationDatabase self, int ca, int startIoa, int count,
+                                           const float* values, const QualityDescriptor* qualities,
+                                           CP56Time2a timestamp);
+
+/**
+ * \brief Check if the database contains the station with the given common address
+ */
+bool
+CS101_StationDatabase_hasStation(CS101_StationDatabase self, int ca);
+
+/** @} */
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS101_STATION_DATABASE_H_ */
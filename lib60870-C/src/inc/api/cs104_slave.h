@@ -25,6 +25,7 @@
 #define SRC_INC_API_CS104_SLAVE_H_
 
 #include "iec60870_slave.h"
+#include "cs101_station_database.h"
 
 #ifdef SEC_AUTH_60870_5_7
 #include "sec_auth_60870_5_7.h"
@@ -59,6 +60,16 @@ typedef enum {
     CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS
 } CS104_ServerMode;
 
+/**
+ * \brief Threading model used by the server to handle the client connections
+ */
+typedef enum {
+    /** each client connection is handled by a dedicated thread (default) */
+    CS104_THREADING_MODEL_THREAD_PER_CONNECTION,
+    /** client connections are distributed over a fixed number of worker threads */
+    CS104_THREADING_MODEL_EVENT_LOOP
+} CS104_ThreadingModel;
+
 typedef enum
 {
     IP_ADDRESS_TYPE_IPV4,
@@ -122,6 +133,11 @@ CS104_Slave_create(int maxLowPrioQueueSize, int maxHighPrioQueueSize);
 /**
  * \brief Create a new instance of a CS104 slave (server) with TLS enabled
  *
+ * When the server runs with threads the TLS handshake is performed by the thread handling the
+ * connection. The server can accept other clients while handshakes are in progress. In threadless
+ * mode the handshake is performed by \ref CS104_Slave_tick when the connection is accepted.
+ * A client that doesn't complete the handshake within the timeout t0 is closed.
+ *
  * \param maxLowPrioQueueSize the maximum size of the event queue
  * \param maxHighPrioQueueSize the maximum size of the high-priority queue
  * \param tlsConfig the TLS configuration object (containing configuration parameters, keys, and certificates)
@@ -169,10 +185,12 @@ CS104_Slave_getOpenConnections(CS104_Slave self);
 /**
  * \brief set the maximum number of open client connections allowed
  *
- * NOTE: the number cannot be larger than the static maximum defined in
+ * The connection objects are created when required, so the memory of a connection is only
+ * allocated when the number of open connections reaches a new maximum. The default is
+ * CONFIG_CS104_MAX_CLIENT_CONNECTIONS.
  *
  * \param self the slave instance
- * \param maxOpenConnections the maximum number of open client connections allowed
+ * \param maxOpenConnections the maximum number of open client connections allowed (0 -> no limit)
  */
 void
 CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections);
@@ -186,6 +204,264 @@ CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections);
 void
 CS104_Slave_setServerMode(CS104_Slave self, CS104_ServerMode serverMode);
 
+/**
+ * \brief Set the threading model that is used to handle the client connections
+ *
+ * With the default threading model \ref CS104_THREADING_MODEL_THREAD_PER_CONNECTION the server
+ * starts a new thread for each client connection. With \ref CS104_THREADING_MODEL_EVENT_LOOP
+ * the client connections are distributed over a fixed number of worker threads. Each worker
+ * handles the message reception, the k/w window, the timeouts, and the sending of queued ASDUs
+ * for all of its connections. The number of threads is then independent of the number of clients.
+ * The TLS handshakes of new connections are performed by a small number of handshake threads
+ * (see CONFIG_CS104_EVENT_LOOP_TLS_HANDSHAKE_THREADS).
+ *
+ * NOTE: Has to be called before the server is started! Only used by \ref CS104_Slave_start.
+ *
+ * \param self the slave instance
+ * \param threadingModel the threading model to use
+ * \param numberOfWorkers number of worker threads for the event loop model (when < 1 the
+ *        default CONFIG_CS104_EVENT_LOOP_DEFAULT_WORKERS is used)
+ */
+void
+CS104_Slave_setThreadingModel(CS104_Slave self, CS104_ThreadingModel threadingModel, int numberOfWorkers);
+
+/**
+ * \brief Let each worker accept new connections with its own listening socket
+ *
+ * With the threading model \ref CS104_THREADING_MODEL_EVENT_LOOP all workers open a listening socket
+ * on the same port (SO_REUSEPORT). The operating system distributes the incoming connections over the
+ * sockets. Each worker checks the new connection (connection request handler, redundancy group) and
+ * handles it afterwards. So many connections that arrive at the same time are accepted in parallel.
+ * When the platform doesn't support shared ports a single listening socket is used.
+ *
+ * NOTE: With SO_REUSEPORT every process of the same user can open another listening socket on the
+ * port, and the operating system then silently passes a part of the connections to that process.
+ * The slave doesn't start when the port is already in use, but a process started later is not
+ * detected. Use a dedicated user for the server or a port that other applications cannot bind to.
+ *
+ * NOTE: The connection request handler can be called by several threads at the same time. TLS
+ * connections are assigned to the worker with the lowest number of connections after the handshake.
+ * Has to be called before the server is started! Only used by \ref CS104_Slave_start.
+ *
+ * \param self the slave instance
+ * \param enable true to use a listening socket per worker, false to use a single listening socket (default)
+ */
+void
+CS104_Slave_setAcceptSharding(CS104_Slave self, bool enable);
+
+/**
+ * \brief Set the maximum size of a transmit batch
+ *
+ * When multiple ASDUs are waiting in the queues the server collects the APDUs in an output
+ * buffer of a connection and sends them with a single socket write (or a single TLS record).
+ * The buffer is sent as soon as it is full, or no more ASDUs can be sent (queues empty or
+ * k-window full). The server never waits for more ASDUs to fill a batch.
+ *
+ * When the socket cannot accept the whole buffer (slow client) the remaining data stays in the
+ * buffer and no more ASDUs are sent to this client until the socket is writable again.
+ *
+ * NOTE: Has to be called before the server is started!
+ *
+ * \param self the slave instance
+ * \param maxBatchSize maximum size of a batch in bytes (default: CONFIG_CS104_DEFAULT_TX_BATCH_SIZE).
+ *        When smaller than the maximum APDU size (255 bytes) each APDU is sent separately.
+ */
+void
+CS104_Slave_setMaxTxBatchSize(CS104_Slave self, int maxBatchSize);
+
+/**
+ * \brief Set the size of the low-priority event buffer in bytes
+ *
+ * By default the buffer size is calculated from the maxLowPrioQueueSize parameter of \ref CS104_Slave_create
+ * so that it can hold this number of ASDUs of maximum size. The ASDUs are stored with their actual size
+ * (plus a header of 4 bytes), so a buffer can hold many more small ASDUs. Setting a byte budget makes the
+ * memory usage independent of the number of entries.
+ *
+ * NOTE: Has to be called before the server is started!
+ *
+ * \param self the slave instance
+ * \param size size of the buffer in bytes (0 -> depends on maxLowPrioQueueSize (default))
+ */
+void
+CS104_Slave_setEventQueueMemorySize(CS104_Slave self, int size);
+
+/**
+ * \brief Store the low-priority event queue in a memory mapped file
+ *
+ * The events are stored in a journal file of fixed size (depending on the maxLowPrioQueueSize parameter
+ * of \ref CS104_Slave_create). The file also keeps track of the events that have been confirmed by the
+ * clients. When the server is started again with the same file, all events that have not been confirmed are
+ * sent again. When the file does not exist a new (empty) journal is created. When the file was created for a
+ * queue of different size (or by an incompatible library version) the stored events are discarded and a
+ * debug message is printed. Like the in-memory queue the oldest events are overwritten when the queue is full.
+ *
+ * The changes of the file survive a crash of the process. To make them also survive a crash of the
+ * operating system or a power failure, syncOnWrite has to be set. This reduces the throughput of
+ * \ref CS104_Slave_enqueueASDU considerably because each call waits until the event is written
+ * to the storage device.
+ *
+ * NOTE: Has to be called before the server is started! Only supported for the server modes
+ * CS104_MODE_SINGLE_REDUNDANCY_GROUP and CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS. In mode
+ * CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS the confirmation state is stored by the name of the redundancy
+ * group (up to 16 groups), so the groups should have unique names. Unnamed groups are identified by the
+ * position in which they have been added.
+ *
+ * \param self the slave instance
+ * \param filename name of the file or NULL to use an event queue in memory (default)
+ * \param syncOnWrite when true each event is written to the storage device before \ref CS104_Slave_enqueueASDU returns
+ */
+void
+CS104_Slave_setEventQueueFile(CS104_Slave self, const char* filename, bool syncOnWrite);
+
+/**
+ * \brief Replicate the low-priority event queue to a warm-standby server
+ *
+ * When the server is started it listens on the given port for a standby server (see
+ * \ref CS104_Slave_startStandby). The new events and the confirmations of the clients are sent
+ * to the standby server in batches (see CONFIG_CS104_EVENT_QUEUE_REPLICATION_INTERVAL). When the
+ * standby server takes over it sends the events that have not been confirmed by the clients. A
+ * connection of a new standby server replaces the old connection.
+ *
+ * NOTE: Has to be called before the server is started! Only supported for the server modes
+ * CS104_MODE_SINGLE_REDUNDANCY_GROUP and CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS. The port is not
+ * protected and should only be reachable by the standby server.
+ *
+ * \param self the slave instance
+ * \param port TCP port for the standby server (0 -> the event queue is not replicated (default))
+ */
+void
+CS104_Slave_setReplicationPort(CS104_Slave self, int port);
+
+/**
+ * \brief Run the server as warm-standby server of an active server
+ *
+ * The server connects to the replication port of the active server (see \ref CS104_Slave_setReplicationPort)
+ * and keeps a copy of the event queue. Events enqueued by the application are not sent to the standby server.
+ * When the connection is lost the server connects again every second and receives the complete event queue.
+ * The old events are kept until the complete event queue has been received (this requires a temporary
+ * buffer of the size of the event queue). To take over, the server is started with \ref CS104_Slave_start
+ * or \ref CS104_Slave_startThreadless. This stops the standby mode.
+ *
+ * NOTE: Both servers have to use the same server mode. In mode CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS
+ * the confirmation state of the redundancy groups is assigned by the name of the group (groups without
+ * name in the order they have been added).
+ *
+ * \param self the slave instance
+ * \param activeAddress IP address of the active server
+ * \param port replication port of the active server
+ *
+ * \return true when the standby mode was started, false otherwise (e.g. server is running or not supported)
+ */
+bool
+CS104_Slave_startStandby(CS104_Slave self, const char* activeAddress, int port);
+
+/**
+ * \brief Stop the standby mode (see \ref CS104_Slave_startStandby)
+ *
+ * The replicated events stay in the event queue.
+ *
+ * \param self the slave instance
+ */
+void
+CS104_Slave_stopStandby(CS104_Slave self);
+
+/**
+ * \brief Check if the event queue replication is connected
+ *
+ * \param self the slave instance
+ *
+ * \return true when a standby server is connected (active server) or the connection to the
+ *         active server is established (standby server), false otherwise
+ */
+bool
+CS104_Slave_isReplicationConnected(CS104_Slave self);
+
+/**
+ * \brief Behavior of the low-priority event queue when a new ASDU doesn't fit into the queue
+ *
+ * The queue is full when adding a new ASDU would remove ASDUs that are not yet confirmed
+ * by all clients (redundancy groups) using the queue.
+ */
+typedef enum {
+    /** overwrite the oldest ASDUs (default) */
+    CS104_QUEUE_OVERFLOW_DROP_OLDEST = 0,
+    /** reject the new ASDU */
+    CS104_QUEUE_OVERFLOW_DROP_NEWEST = 1,
+    /** wait until the clients confirmed enough ASDUs (up to a timeout) and then reject the new ASDU */
+    CS104_QUEUE_OVERFLOW_BLOCK = 2,
+    /** replace a waiting ASDU of the same type and address (CA and IOA) or overwrite the oldest ASDUs
+     *  when there is no such ASDU. Only ASDUs with a single information object are replaced. */
+    CS104_QUEUE_OVERFLOW_COALESCE = 3
+} CS104_QueueOverflowPolicy;
+
+/**
+ * \brief Set the behavior of the low-priority event queue when it is full
+ *
+ * NOTE: Has to be called before the server is started! In server mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP
+ * the queue always overwrites the oldest ASDUs. With policy CS104_QUEUE_OVERFLOW_BLOCK the ingress queue
+ * is not used. In threadless mode the queue cannot change while \ref CS104_Slave_enqueueASDU is waiting,
+ * so CS104_QUEUE_OVERFLOW_BLOCK behaves like CS104_QUEUE_OVERFLOW_DROP_NEWEST.
+ *
+ * \param self the slave instance
+ * \param policy the overflow policy (default: CS104_QUEUE_OVERFLOW_DROP_OLDEST)
+ * \param blockTimeoutInMs maximum time \ref CS104_Slave_enqueueASDU waits with policy CS104_QUEUE_OVERFLOW_BLOCK
+ */
+void
+CS104_Slave_setQueueOverflowPolicy(CS104_Slave self, CS104_QueueOverflowPolicy policy, int blockTimeoutInMs);
+
+/**
+ * \brief Only keep the latest waiting value of a data point in the low-priority queue for the given type
+ *
+ * When a new ASDU of this type refers to a data point (same COT, CA and IOA) with an ASDU that is still
+ * waiting for transmission to all clients, the waiting ASDU is replaced by the new one. The replaced ASDU
+ * keeps its position in the queue. This way the queue size during an event storm depends on the number
+ * of data points instead of the update rate. Use this for measured values only, not for types where
+ * each change has to be reported (e.g. single or double point information).
+ *
+ * NOTE: Has to be called before the server is started! Only ASDUs with a single information object
+ * are replaced.
+ *
+ * \param self the slave instance
+ * \param typeId the type ID (e.g. M_ME_NC_1)
+ * \param enable true to keep only the latest value, false to queue all values (default)
+ */
+void
+CS104_Slave_setLatestValueCoalescing(CS104_Slave self, IEC60870_5_TypeID typeId, bool enable);
+
+/**
+ * \brief Set the number of data points for which waiting ASDUs can be replaced
+ *
+ * The waiting ASDUs that can be replaced (\ref CS104_Slave_setLatestValueCoalescing and policy
+ * CS104_QUEUE_OVERFLOW_COALESCE) are found with an index of 32 bytes per data point. When more data points
+ * have waiting ASDUs some updates are queued instead of replacing the waiting ASDU.
+ *
+ * NOTE: Has to be called before the server is started!
+ *
+ * \param self the slave instance
+ * \param numberOfDataPoints expected number of data points (0 -> maxLowPrioQueueSize of \ref CS104_Slave_create (default))
+ */
+void
+CS104_Slave_setCoalescingCapacity(CS104_Slave self, int numberOfDataPoints);
+
+/**
+ * \brief Set the size of the lock-free ingress queue used by \ref CS104_Slave_enqueueASDU
+ *
+ * When enabled, \ref CS104_Slave_enqueueASDU encodes the ASDU into a lock-free multi-producer queue
+ * instead of the event queue. Multiple application threads can then enqueue ASDUs without blocking
+ * each other. The connection handling moves the ASDUs from the ingress queue to the event queue.
+ * When the ingress queue is full the calling thread moves the ASDUs itself (and has to take the
+ * event queue lock).
+ *
+ * NOTE: Has to be called before the server is started! Not available when the compiler
+ * doesn't support atomic operations.
+ *
+ * \param self the slave instance
+ * \param size number of ASDUs that can be stored in the ingress queue (rounded up to the next power of two).
+ *        0 disables the ingress queue (default: CONFIG_CS104_DEFAULT_INGRESS_QUEUE_SIZE)
+ */
+void
+CS104_Slave_setIngressQueueSize(CS104_Slave self, int size);
+
 /**
  * \brief Set a callback handler for the library to check if a specific CA is known by the application
  *
@@ -250,6 +526,47 @@ CS104_Slave_setCounterInterrogationHandler(CS104_Slave self, CS101_CounterInterr
 void
 CS104_Slave_setReadHandler(CS104_Slave self, CS101_ReadHandler handler, void* parameter);
 
+/**
+ * \brief Set the handler to get the next ASDU for an interrogation response (flow-controlled response)
+ *
+ * When the interrogation handler accepted an interrogation command (returned true), the response
+ * is pulled from this handler for the connection that received the command. The handler is only
+ * called when the k-window of the connection has room for another ASDU and no high-priority ASDUs
+ * are waiting, so large interrogation responses are sent as fast as the client confirms them and
+ * are not limited by the size of the high-priority queue. The ACT_CON of the interrogation handler
+ * is sent before the first ASDU of the handler. The response is finished when the handler returns
+ * NULL, so the handler should return the ACT_TERM as last ASDU. The response is stopped when the
+ * interrogation handler accepted a deactivation command or the connection is deactivated.
+ *
+ * NOTE: The returned ASDU is encoded immediately and is not released by the library (e.g. use a
+ * \ref CS101_StaticASDU per connection). The handler is called by the connection handling with the
+ * send lock of the connection held and must not send ASDUs to the connection by itself.
+ *
+ * \param handler the callback handler function or NULL to send the interrogation responses with
+ *                \ref IMasterConnection_sendASDU
+ * \param parameter user provided parameter to be passed to the callback handler
+ */
+void
+CS104_Slave_setGetNextInterrogationASDUHandler(CS104_Slave self, CS101_GetNextInterrogationASDUHandler handler,
+                                               void* parameter);
+
+/**
+ * \brief Use a station database to answer interrogation and read commands and to report changes
+ *
+ * Station and group interrogation commands (C_IC_NA_1) and read commands (C_RD_NA_1) for stations
+ * (common addresses) of the database are answered from the database. The interrogation responses
+ * are packed into ASDUs with sequence of information objects and are sent when the k-window allows
+ * it, so the high-priority queue is not used. Commands for other common addresses are passed to the
+ * interrogation and read handlers. Changes of points with spontaneous transmission are added to the
+ * low-priority queue (see \ref CS104_Slave_enqueueASDU).
+ *
+ * NOTE: The database has to be created with the application layer parameters of the slave.
+ *
+ * \param db the station database or NULL to remove the database
+ */
+void
+CS104_Slave_setStationDatabase(CS104_Slave self, CS101_StationDatabase db);
+
 /**
  * \brief Set the handler for a received ASDU
  *
@@ -262,6 +579,85 @@ CS104_Slave_setReadHandler(CS104_Slave self, CS101_ReadHandler handler, void* pa
 void
 CS104_Slave_setASDUHandler(CS104_Slave self, CS101_ASDUHandler handler, void* parameter);
 
+/**
+ * \brief Handle of a command that is executed asynchronously (see \ref CS104_Slave_setAsyncCommandHandler)
+ */
+typedef struct sCS104_CommandHandle* CS104_CommandHandle;
+
+/**
+ * \brief Response to an asynchronously executed command (see \ref IMasterConnection_completeCommand)
+ */
+typedef enum
+{
+    /** send a positive ACT_CON. The command stays open for the ACT_TERM. */
+    CS104_COMMAND_ACT_CON = 0,
+
+    /** send a negative ACT_CON and release the command */
+    CS104_COMMAND_ACT_CON_NEGATIVE = 1,
+
+    /** send the ACT_TERM and release the command */
+    CS104_COMMAND_ACT_TERM = 2,
+
+    /** release the command without sending a response (e.g. when no ACT_TERM is used) */
+    CS104_COMMAND_RELEASE = 3
+} CS104_CommandResponse;
+
+/**
+ * \brief Handler for commands that are executed asynchronously
+ *
+ * The handler is called by a thread of the command worker pool. The responses are sent with
+ * \ref IMasterConnection_completeCommand, either by the handler or later by any other thread.
+ *
+ * \param parameter user provided parameter
+ * \param connection the connection that received the command (only use it to identify the client)
+ * \param command the handle of the command (valid until the command is released)
+ * \param asdu copy of the received ASDU (valid until the command is released)
+ */
+typedef void (*CS104_AsyncCommandHandler) (void* parameter, IMasterConnection connection, CS104_CommandHandle command,
+                                           CS101_ASDU asdu);
+
+/**
+ * \brief Execute process commands asynchronously by a pool of worker threads
+ *
+ * Received process commands (C_SC_NA_1 - C_BO_NA_1 and C_SC_TA_1 - C_BO_TA_1) that are not handled
+ * by a plugin are copied and passed to the handler by one of the worker threads. The connection
+ * continues to receive and send messages and to handle the protocol timers while a command
+ * is executed (e.g. while a select-before-operate command is forwarded to a PLC).
+ * The commands can be executed in parallel and in a different order than received.
+ *
+ * When more than CONFIG_CS104_MAX_PENDING_COMMANDS commands are open the command is rejected with a
+ * negative ACT_CON. Commands of a closed connection are released when they are completed.
+ *
+ * NOTE: Has to be called before the slave is started. Without thread support (or with 0 threads)
+ * the handler is called by the connection handling.
+ *
+ * \param handler the callback handler function or NULL to handle commands with the ASDU handler
+ * \param parameter user provided parameter to be passed to the callback handler
+ * \param numberOfThreads number of worker threads
+ */
+void
+CS104_Slave_setAsyncCommandHandler(CS104_Slave self, CS104_AsyncCommandHandler handler, void* parameter,
+                                   int numberOfThreads);
+
+/**
+ * \brief Send the response to an asynchronously executed command
+ *
+ * This function can be called by any thread. After CS104_COMMAND_ACT_CON_NEGATIVE, CS104_COMMAND_ACT_TERM,
+ * or CS104_COMMAND_RELEASE the handle and the ASDU of the command are released and must not be used anymore.
+ *
+ * NOTE: All commands have to be completed before the slave is destroyed. In non-threaded mode
+ * \ref CS104_Slave_tick has to be called after a command is completed (like after new ASDUs are
+ * enqueued) to send the response.
+ *
+ * \param command the handle of the command
+ * \param response the response to send
+ *
+ * \return true when the response has been sent, false when the connection is closed or the
+ *         response could not be added to the high-priority queue (the command is released anyway)
+ */
+bool
+IMasterConnection_completeCommand(CS104_CommandHandle command, CS104_CommandResponse response);
+
 /**
  * \brief Set the handler for the clock synchronization message
  *
@@ -367,11 +763,50 @@ CS104_Slave_stopThreadless(CS104_Slave self);
  * Handle incoming connection requests and messages, send buffered events, and
  * handle periodic tasks.
  *
- * NOTE: This function has to be called periodically by the application.
+ * Only connections with a readable socket receive messages. The returned time can be used
+ * by the application as timeout when it waits for the sockets of the slave (see
+ * \ref CS104_Slave_getFileDescriptors) instead of calling this function in a fixed interval.
+ *
+ * NOTE: This function has to be called periodically by the application. It also has to be
+ * called after new ASDUs are enqueued (e.g. with \ref CS104_Slave_enqueueASDU) and when one of the
+ * sockets is ready to read.
+ *
+ * \return the time in ms until the next protocol timer (T1, T2, T3) expires, 0 when the function
+ *         has to be called again immediately (e.g. more events are waiting to be sent)
  */
-void
+unsigned int
 CS104_Slave_tick(CS104_Slave self);
 
+/**
+ * \brief Get the socket handles (file descriptors) of the slave in non-threaded mode
+ *
+ * The first handle is the listening socket followed by the sockets of the open connections.
+ * The handles can be used to wait for the sockets in an external event loop (e.g. epoll or poll).
+ * When one of the sockets is ready to read \ref CS104_Slave_tick has to be called. The handles
+ * must not be used to read or write data.
+ *
+ * NOTE: The handles change when connections are opened or closed. The connection event handler
+ * (see \ref CS104_Slave_setConnectionEventHandler) together with \ref CS104_Slave_getConnectionFileDescriptor
+ * can be used to track the changes.
+ *
+ * \param fds array to store the handles (can be NULL)
+ * \param maxFds size of the array
+ *
+ * \return the number of handles (can be larger than maxFds, in this case only maxFds handles are stored)
+ */
+int
+CS104_Slave_getFileDescriptors(CS104_Slave self, int* fds, int maxFds);
+
+/**
+ * \brief Get the socket handle (file descriptor) of a connection
+ *
+ * \param connection the connection (e.g. from the connection event handler)
+ *
+ * \return the socket handle or -1 when the connection is not open
+ */
+int
+CS104_Slave_getConnectionFileDescriptor(CS104_Slave self, IMasterConnection connection);
+
 /*
  * \brief Gets the number of ASDU in the low-priority queue
  *
@@ -384,14 +819,228 @@ CS104_Slave_tick(CS104_Slave self);
 int
 CS104_Slave_getNumberOfQueueEntries(CS104_Slave self, CS104_RedundancyGroup redGroup);
 
+typedef struct sCS104_QueueMemoryUsage* CS104_QueueMemoryUsage;
+
+/**
+ * \brief Memory usage of the low-priority event buffer
+ */
+struct sCS104_QueueMemoryUsage
+{
+    int bufferSize;      /**< size of the event buffer in bytes */
+    int usedBytes;       /**< bytes used by the stored ASDUs (including entry headers) */
+    int numberOfEntries; /**< number of stored ASDUs (including ASDUs that are already confirmed but not yet overwritten) */
+};
+
+/**
+ * \brief Get the memory usage of the low-priority event buffer
+ *
+ * In the modes CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS and CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP
+ * the buffer is shared by all redundancy groups or connections.
+ *
+ * \param self the slave instance
+ * \param usage returns the memory usage
+ *
+ * \return true on success, false when the queues are not yet initialized (server not started)
+ */
+bool
+CS104_Slave_getQueueMemoryUsage(CS104_Slave self, CS104_QueueMemoryUsage usage);
+
+typedef struct sCS104_QueueStatistics* CS104_QueueStatistics;
+
+/**
+ * \brief Statistics of the low-priority queue of a redundancy group
+ */
+struct sCS104_QueueStatistics
+{
+    uint64_t enqueuedASDUs;   /**< ASDUs accepted by the event buffer (including coalesced ASDUs) */
+    uint64_t coalescedASDUs;  /**< ASDUs that replaced a waiting ASDU (CS104_QUEUE_OVERFLOW_COALESCE) */
+    uint64_t droppedASDUs;    /**< ASDUs lost for the redundancy group because of queue overflow (overwritten or rejected) */
+    int pendingASDUs;         /**< ASDUs that are not yet confirmed (sent or waiting for transmission) */
+    int pendingBytes;         /**< bytes used by the pending ASDUs (including entry headers) */
+    int maxPendingASDUs;      /**< high-water mark of pendingASDUs */
+    uint32_t oldestPendingAge; /**< time in ms since the oldest pending ASDU was added (0 when no ASDU is pending).
+                                    Measured with the monotonic clock. The resolution is 10 ms and decreases to about
+                                    1/32 of the age of the oldest pending ASDU for long-lasting queues. */
+};
+
+/**
+ * \brief Get the statistics of the low-priority queue of a redundancy group
+ *
+ * In mode CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS the event buffer is shared by all redundancy
+ * groups, so enqueuedASDUs and coalescedASDUs are the same for all groups.
+ *
+ * NOTE: Mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP is not supported by this function.
+ *
+ * \param self the slave instance
+ * \param redGroup the redundancy group to use or NULL for single redundancy mode
+ * \param stats returns the statistics
+ *
+ * \return true on success, false when the queue is not available (server not started, unknown group)
+ */
+bool
+CS104_Slave_getQueueStatistics(CS104_Slave self, CS104_RedundancyGroup redGroup, CS104_QueueStatistics stats);
+
+typedef struct sCS104_ConnectionMetrics* CS104_ConnectionMetrics;
+
+/**
+ * \brief Performance counters and gauges of a client connection (or the sum of a group of connections)
+ */
+struct sCS104_ConnectionMetrics
+{
+    uint64_t iFramesReceived;   /**< received I frames */
+    uint64_t iFramesSent;       /**< sent I frames */
+    uint64_t sFramesReceived;   /**< received S frames */
+    uint64_t sFramesSent;       /**< sent S frames */
+    uint64_t uFramesReceived;   /**< received U frames (STARTDT, STOPDT, TESTFR) */
+    uint64_t uFramesSent;       /**< sent U frames */
+    uint64_t bytesReceived;     /**< received bytes (APDUs) */
+    uint64_t bytesSent;         /**< sent bytes (APDUs) */
+    uint64_t kWindowStalls;     /**< number of times ASDUs were waiting but k I frames were not confirmed */
+    uint64_t t1Timeouts;        /**< expired T1 timeouts (I frame or TESTFR not confirmed -> connection closed) */
+    uint64_t t2Timeouts;        /**< expired T2 timeouts (S frame sent to confirm received I frames) */
+    uint64_t t3Timeouts;        /**< expired T3 timeouts (TESTFR ACT sent because of idle connection) */
+    uint64_t highPrioQueueFull; /**< ASDUs that could not be sent because the high-priority queue was full */
+    int highPrioQueueDepth;     /**< ASDUs waiting in the high-priority queue */
+    int unconfirmedIFrames;     /**< sent I frames that are not yet confirmed */
+    uint32_t oldestUnconfirmedAge; /**< time in ms since the oldest unconfirmed I frame was sent (0 when all are confirmed) */
+};
+
+/**
+ * \brief Get the metrics of a client connection
+ *
+ * The metrics are read without locking the connection, so the function can be called frequently
+ * (e.g. by a monitoring system) without delaying the communication.
+ *
+ * \param self the slave instance
+ * \param connection the connection (e.g. as provided by the connection event handler)
+ * \param metrics returns the metrics
+ *
+ * \return true on success, false when the connection is not open
+ */
+bool
+CS104_Slave_getConnectionMetrics(CS104_Slave self, IMasterConnection connection, CS104_ConnectionMetrics metrics);
+
+/**
+ * \brief Get the sum of the metrics of all connections of a redundancy group or of the slave
+ *
+ * The counters include the closed connections. The gauges are the sum of the open connections,
+ * except oldestUnconfirmedAge that is the maximum of the open connections.
+ *
+ * \param self the slave instance
+ * \param redGroup the redundancy group (only mode CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) or NULL for all
+ *                 connections of the slave
+ * \param metrics returns the metrics
+ *
+ * \return true on success, false otherwise
+ */
+bool
+CS104_Slave_getRedundancyGroupMetrics(CS104_Slave self, CS104_RedundancyGroup redGroup, CS104_ConnectionMetrics metrics);
+
+/** number of buckets of a latency histogram */
+#define CS104_LATENCY_HISTOGRAM_BUCKETS 240
+
+/**
+ * \brief Latency measured by a connection
+ */
+typedef enum
+{
+    /** time from adding the ASDU to the low-priority queue until the ASDU is sent */
+    CS104_LATENCY_QUEUE_WAIT = 0,
+
+    /** time from sending an I frame until it is confirmed by the client */
+    CS104_LATENCY_ACK_RTT = 1,
+
+    /** time from adding the ASDU to the low-priority queue until it is confirmed by the client */
+    CS104_LATENCY_END_TO_END = 2
+} CS104_LatencyType;
+
+typedef struct sCS104_LatencyHistogram* CS104_LatencyHistogram;
+
+/**
+ * \brief Histogram of latencies in ms
+ *
+ * Values below 16 ms have their own bucket. Larger values are stored in 8 buckets for each power of
+ * two, so the relative error of a bucket is below 12.5 % (see \ref CS104_LatencyHistogram_getBucketLimit).
+ */
+struct sCS104_LatencyHistogram
+{
+    uint64_t count; /**< number of recorded values */
+    uint64_t sum;   /**< sum of the recorded values (in ms) */
+    uint32_t min;   /**< smallest recorded value (in ms) */
+    uint32_t max;   /**< largest recorded value (in ms) */
+    uint32_t buckets[CS104_LATENCY_HISTOGRAM_BUCKETS]; /**< number of values per bucket */
+};
+
+/**
+ * \brief Get the largest value (in ms) that is counted in a bucket of a latency histogram
+ *
+ * \param index the bucket index (0 to CS104_LATENCY_HISTOGRAM_BUCKETS - 1)
+ */
+uint32_t
+CS104_LatencyHistogram_getBucketLimit(int index);
+
+/**
+ * \brief Get a percentile of the recorded values
+ *
+ * \param percentile the percentile (0.0 - 100.0, e.g. 99.9)
+ *
+ * \return the upper limit of the bucket that contains the percentile (in ms, not larger than max)
+ *         or 0 when the histogram is empty
+ */
+uint32_t
+CS104_LatencyHistogram_getPercentile(CS104_LatencyHistogram self, double percentile);
+
+/**
+ * \brief Get a latency histogram of a client connection
+ *
+ * Only ASDUs of the low-priority queue (see \ref CS104_Slave_enqueueASDU) have a queue wait time. The
+ * histograms are reset when the connection is closed.
+ *
+ * NOTE: Requires CONFIG_CS104_SLAVE_LATENCY_HISTOGRAMS.
+ *
+ * \param self the slave instance
+ * \param connection the connection (e.g. as provided by the connection event handler)
+ * \param type the latency to get
+ * \param histogram returns the histogram
+ *
+ * \return true on success, false when the connection is not open or the histograms are not supported
+ */
+bool
+CS104_Slave_getConnectionLatency(CS104_Slave self, IMasterConnection connection, CS104_LatencyType type,
+                                 CS104_LatencyHistogram histogram);
+
 /**
  * \brief Add an ASDU to the low-priority queue of the slave (use for periodic and spontaneous messages)
  *
  * \param asdu the ASDU to add
+ *
+ * \return true when the ASDU was added, false when it was rejected (queue full, see \ref CS104_Slave_setQueueOverflowPolicy)
+ *         When the ingress queue is used, ASDUs rejected later while moved to the event queue are only counted
+ *         in the queue statistics (see \ref CS104_Slave_getQueueStatistics).
  */
-void
+bool
 CS104_Slave_enqueueASDU(CS104_Slave self, CS101_ASDU asdu);
 
+/**
+ * \brief Add a list of point updates to the low-priority queue, packed into as few ASDUs as possible
+ *
+ * Consecutive information objects of the same type are combined into ASDUs of the maximum size
+ * given by the application layer parameters. Runs of objects with contiguous information object
+ * addresses are encoded as a sequence (SQ=1) when the type has no time tag. The order of the
+ * point updates is preserved.
+ *
+ * \param cot the cause of transmission for all created ASDUs
+ * \param oa the originator address for all created ASDUs
+ * \param ca the common address for all created ASDUs
+ * \param points array of information objects (the objects are not released by this function)
+ * \param numberOfPoints number of elements in the points array
+ *
+ * \return the number of ASDUs that have been added to the queue
+ */
+int
+CS104_Slave_enqueuePointUpdates(CS104_Slave self, CS101_CauseOfTransmission cot, int oa, int ca,
+                                InformationObject* points, int numberOfPoints);
+
 /**
  * \brief Add a new redundancy group to the server.
  *
@@ -423,7 +1072,15 @@ CS104_RedundancyGroup_create(const char* name);
 /**
  * \brief Add an allowed client to the redundancy group
  *
- * \param ipAddress the IP address of the client as C string (can be IPv4 or IPv6 address).
+ * A subnet can be given in CIDR notation (e.g. "10.0.0.0/8" or "2001:db8::/32"). When the
+ * address of a client matches entries of several groups the group with the longest prefix
+ * is used (a single address has prefix length 32 or 128). Clients without a matching entry
+ * are assigned to the group without allowed clients.
+ *
+ * NOTE: The allowed clients are evaluated when the slave is started. Changes while the slave
+ * is running are ignored until the next start.
+ *
+ * \param ipAddress the IP address or subnet of the client as C string (can be IPv4 or IPv6 address).
  */
 void
 CS104_RedundancyGroup_addAllowedClient(CS104_RedundancyGroup self, const char* ipAddress);
@@ -437,6 +1094,17 @@ CS104_RedundancyGroup_addAllowedClient(CS104_RedundancyGroup self, const char* i
 void
 CS104_RedundancyGroup_addAllowedClientEx(CS104_RedundancyGroup self, const uint8_t* ipAddress, eCS104_IPAddressType addressType);
 
+/**
+ * \brief Add an allowed subnet to the redundancy group
+ *
+ * \param ipAddress the network address as byte buffer (4 byte for IPv4, 16 byte for IPv6)
+ * \param addressType type of the IP address (either IP_ADDRESS_TYPE_IPV4 or IP_ADDRESS_TYPE_IPV6)
+ * \param prefixLength number of significant bits of the address (0-32 for IPv4, 0-128 for IPv6)
+ */
+void
+CS104_RedundancyGroup_addAllowedSubnet(CS104_RedundancyGroup self, const uint8_t* ipAddress,
+                                       eCS104_IPAddressType addressType, int prefixLength);
+
 #ifdef SEC_AUTH_60870_5_7
 /**
  * \brief Set the secure endpoint for the redundancy group
@@ -0,0 +1,83 @@
+/*
+ *  cs101_station_database_internal.h
+ *
+ *  Copyright 2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS101_STATION_DATABASE_INTERNAL_H_
+#define SRC_INC_INTERNAL_CS101_STATION_DATABASE_INTERNAL_H_
+
+#include "cs101_station_database.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Position of an interrogation response. The responses are created one ASDU at a time,
+ * so the sender can stop whenever no more ASDUs can be sent.
+ */
+typedef struct
+{
+    int ca;       /* requested common address (can be the broadcast address) */
+    int oa;       /* originator address of the request */
+    uint8_t qoi;  /* qualifier of interrogation (20 = station, 21-36 = group 1-16) */
+
+    int state;        /* next ASDU to create (ACT_CON, data, ACT_TERM) */
+    int stationIndex;
+    int blockIndex;
+    int pointIndex;
+} sCS101_StationDatabaseCursor;
+
+/**
+ * Prepare the interrogation response for the given common address
+ *
+ * \return false when the database doesn't contain the station (or no station for a broadcast request)
+ */
+bool
+CS101_StationDatabase_startInterrogation(CS101_StationDatabase self, sCS101_StationDatabaseCursor* cursor, int ca,
+                                         int oa, uint8_t qoi);
+
+/**
+ * Create the next ASDU of the interrogation response (ACT_CON, packed data ASDUs, ACT_TERM)
+ *
+ * \param asdu buffer for the ASDU
+ *
+ * \return the ASDU or NULL when the response is complete
+ */
+CS101_ASDU
+CS101_StationDatabase_getNextInterrogationASDU(CS101_StationDatabase self, sCS101_StationDatabaseCursor* cursor,
+                                               CS101_StaticASDU asdu);
+
+/**
+ * Create the response to a read command (COT = REQUEST)
+ *
+ * \param asdu buffer for the ASDU
+ *
+ * \return the ASDU or NULL when the database doesn't contain the point
+ */
+CS101_ASDU
+CS101_StationDatabase_read(CS101_StationDatabase self, int ca, int ioa, int oa, CS101_StaticASDU asdu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS101_STATION_DATABASE_INTERNAL_H_ */
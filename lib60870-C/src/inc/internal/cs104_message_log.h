@@ -0,0 +1,253 @@
+/*
+ *  cs104_message_log.h
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS104_MESSAGE_LOG_H_
+#define SRC_INC_INTERNAL_CS104_MESSAGE_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "hal_mapped_file.h"
+#include "hal_thread.h"
+#include "lib60870_config.h"
+#include "linked_list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the event queue can be replicated to a standby server (requires the replication thread) */
+#if ((CONFIG_CS104_SUPPORT_EVENT_QUEUE_REPLICATION == 1) && (CONFIG_USE_THREADS == 1) && (CONFIG_USE_SEMAPHORES == 1))
+#define CS104_SLAVE_HAS_REPLICATION 1
+#else
+#define CS104_SLAVE_HAS_REPLICATION 0
+#endif
+
+/*
+ * Ring buffer of encoded low priority ASDUs. Each ASDU is encoded only once
+ * into the log. The log can be shared by multiple message queues (one per
+ * redundancy group or client connection). The message queues only keep
+ * their transmission and confirmation state as cursors into the log.
+ *
+ * The entries are stored back to back with a compact header. The entries have
+ * consecutive IDs, so the ID of an entry is given by its position in the log
+ * (ID of the first entry + index) and is not stored in the entry.
+ *
+ * A persistent log uses a memory mapped journal file as buffer. The file
+ * header contains the position of the oldest entry and the confirmation
+ * state of the message queues.
+ *
+ * The time when an entry was added is not stored in the entry. Instead the
+ * log keeps a small table of time marks (ID and time of an entry) with a
+ * resolution of at least MESSAGE_LOG_TIME_MARK_INTERVAL.
+ */
+
+struct sMessageQueueEntryInfo
+{
+    unsigned int size : 8;
+    unsigned int checksum : 24; /* checksum of entry ID and ASDU (only used by persistent logs) */
+};
+
+/* number of time marks of a log */
+#define MESSAGE_LOG_TIME_MARKS 64
+
+/* minimum time between two time marks in ms (doubled while the table is full) */
+#define MESSAGE_LOG_TIME_MARK_INTERVAL 10
+
+/* monotonic time when the entry with the given ID (and the following entries until the next mark) was added */
+struct sMessageLogTimeMark
+{
+    uint64_t entryId;
+    uint64_t time;
+};
+
+/* maximum length of the key identifying a message queue (redundancy group or connection) */
+#define MESSAGE_QUEUE_KEY_SIZE 32
+
+/* header of the journal file of a persistent log (see cs104_message_log_journal.c) */
+struct sMessageLogJournal;
+
+/* number of consecutive index slots checked for a data point */
+#define MESSAGE_LOG_INDEX_PROBES 8
+
+/* slot of the index of the entries that can be coalesced (data point -> waiting entry) */
+struct sMessageLogIndexSlot
+{
+    uint32_t keyHash; /* hash of the data point address */
+    uint32_t offset;  /* position of the entry in the buffer */
+    uint64_t entryId; /* 0 -> slot is unused */
+};
+
+struct sMessageLog
+{
+    int size;         /* size of buffer in bytes */
+    int entryCounter; /* number of messages (ASDU) in the log */
+
+    uint8_t* firstEntry;        /* first entry in FIFO */
+    uint8_t* lastEntry;         /* last entry in FIFO */
+    uint8_t* lastInBufferEntry; /* entry with highest address in FIFO buffer */
+
+    uint64_t entryId; /* ID of next entry; will be increased by one for each new entry */
+    uint8_t* buffer;
+
+    int refCount; /* number of message queues (and other owners) using the log */
+
+    LinkedList queues; /* message queues using the log (required to detect overflow) */
+
+    CS104_QueueOverflowPolicy overflowPolicy;
+    int coalesceKeySize; /* number of ASDU bytes identifying the data point (type, VSQ, COT, CA, IOA) */
+
+    uint8_t coalescedTypes[32];           /* bit set of the types that only keep the latest waiting value */
+    struct sMessageLogIndexSlot* index;   /* waiting entries by data point (NULL -> no coalescing) */
+    uint32_t indexMask;                   /* number of index slots - 1 */
+
+    uint64_t enqueuedEntries;  /* number of accepted ASDUs (including coalesced ASDUs) */
+    uint64_t coalescedEntries; /* number of ASDUs that replaced a waiting entry */
+
+    struct sMessageLogTimeMark timeMarks[MESSAGE_LOG_TIME_MARKS]; /* ring buffer of time marks */
+    int firstTimeMark;                                            /* index of the oldest time mark */
+    int timeMarkCount;                                            /* number of valid time marks */
+    int timeMarkInterval;                                         /* current minimum time between two marks */
+
+    LinkedList blockedProducers; /* wakeup handles of the producers waiting for free space (CS104_QUEUE_OVERFLOW_BLOCK) */
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+    uint64_t firstModifiedId; /* oldest entry replaced by coalescing since the last replication (UINT64_MAX -> none) */
+#endif
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    MappedFile journalFile;              /* file that contains the log (NULL -> log is not persistent) */
+    struct sMessageLogJournal* journal;  /* header of the journal file */
+    uint32_t usedJournalSlots;           /* bit set of the slots owned by message queues of this log */
+    bool syncOnWrite;                    /* write new entries to the storage device before returning */
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore logLock;
+#endif
+};
+
+typedef struct sMessageLog* MessageLog;
+
+/*
+ * Low priority queue of a redundancy group or client connection. Entries between
+ * firstUnconfirmedId and nextWaitingId are sent but not confirmed. Entries starting
+ * with nextWaitingId are waiting for transmission.
+ *
+ * The queue remembers the last sent and the last confirmed entry. This way the
+ * next waiting entry can be found in constant time.
+ */
+
+struct sMessageQueue
+{
+    MessageLog log;
+
+    uint64_t firstUnconfirmedId; /* ID of the oldest entry that is not confirmed */
+    uint64_t nextWaitingId;      /* ID of the next entry waiting for transmission */
+
+    uint64_t lastSentId;    /* ID of the entry preceding the next waiting entry */
+    uint8_t* lastSentEntry; /* entry with ID lastSentId or NULL when unknown */
+
+    uint64_t lastConfirmedId;    /* ID of the entry preceding the first unconfirmed entry */
+    uint8_t* lastConfirmedEntry; /* entry with ID lastConfirmedId or NULL when unknown */
+
+    uint64_t droppedEntries; /* entries removed or rejected before they were confirmed */
+    int maxPendingEntries;   /* high-water mark of the number of unconfirmed entries */
+
+    char key[MESSAGE_QUEUE_KEY_SIZE]; /* identifies the redundancy group or connection of the queue */
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+    int journalSlot; /* slot of the confirmation state in the journal of a persistent log (-1 -> not stored) */
+#endif
+};
+
+typedef struct sMessageQueue* MessageQueue;
+
+MessageLog
+MessageLog_createInstance(int bufferSize);
+
+void
+MessageLog_destroyInstance(MessageLog self);
+
+MessageLog
+MessageLog_create(int bufferSize);
+
+void
+MessageLog_lock(MessageLog self);
+
+void
+MessageLog_unlock(MessageLog self);
+
+void
+MessageLog_retain(MessageLog self);
+
+void
+MessageLog_release(MessageLog self);
+
+int
+MessageLog_getEntrySize(uint8_t* entryPtr);
+
+uint64_t
+MessageLog_getFirstEntryId(MessageLog self);
+
+void
+MessageLog_addTimeMark(MessageLog self, uint64_t entryId, uint64_t time);
+
+uint64_t
+MessageLog_getEntryTime(MessageLog self, uint64_t entryId);
+
+void
+MessageLog_commitEntry(MessageLog self);
+
+void
+MessageLog_replaceEntry(MessageLog self, uint8_t* entryPtr, uint64_t entryId, const uint8_t* asdu, int asduSize);
+
+void
+MessageLog_sync(MessageLog self);
+
+uint8_t*
+MessageLog_addEntry(MessageLog self, int asduSize, uint64_t entryTime);
+
+uint8_t*
+MessageLog_getEntry(MessageLog self, uint64_t entryId);
+
+uint8_t*
+MessageLog_getFollowingEntry(MessageLog self, uint8_t* entryPtr);
+
+void
+MessageQueue_updateCursors(MessageQueue self);
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+void
+MessageQueue_setConfirmed(MessageQueue self, uint64_t confirmedId);
+
+void
+MessageLog_reset(MessageLog self, uint64_t nextEntryId);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS104_MESSAGE_LOG_H_ */
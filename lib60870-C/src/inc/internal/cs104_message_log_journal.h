@@ -0,0 +1,81 @@
+/*
+ *  cs104_message_log_journal.h
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS104_MESSAGE_LOG_JOURNAL_H_
+#define SRC_INC_INTERNAL_CS104_MESSAGE_LOG_JOURNAL_H_
+
+#include "cs104_message_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1)
+
+/*
+ * Journal of a persistent message log. The ring buffer of the log is stored in a
+ * memory mapped file behind a header with the position of the oldest entry and the
+ * confirmation state of the message queues. After a restart the entries are restored
+ * from the file.
+ *
+ * The functions except MessageLog_createPersistent require the lock of the log and
+ * may only be called for a log with journal (self->journal != NULL).
+ */
+
+MessageLog
+MessageLog_createPersistent(int bufferSize, const char* filename, bool syncOnWrite);
+
+void
+MessageLog_setJournalFirstEntry(MessageLog self, uint64_t entryId, uint32_t offset);
+
+void
+MessageLog_commitJournalEntry(MessageLog self);
+
+void
+MessageLog_beginJournalUpdate(MessageLog self, uint8_t* entryPtr, uint64_t entryId, const uint8_t* asdu, int asduSize);
+
+void
+MessageLog_endJournalUpdate(MessageLog self, uint8_t* entryPtr, uint64_t entryId);
+
+void
+MessageLog_resetJournal(MessageLog self, uint64_t nextEntryId);
+
+int
+MessageLog_allocateJournalSlot(MessageLog self, const char* queueKey);
+
+void
+MessageLog_releaseJournalSlot(MessageLog self, int slot);
+
+uint64_t
+MessageLog_getJournalConfirmedId(MessageLog self, int slot);
+
+void
+MessageLog_setJournalConfirmedId(MessageLog self, int slot, uint64_t entryId);
+
+#endif /* (CONFIG_CS104_SUPPORT_PERSISTENT_EVENT_QUEUE == 1) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS104_MESSAGE_LOG_JOURNAL_H_ */
@@ -0,0 +1,69 @@
+/*
+ *  cs104_replication.h
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS104_REPLICATION_H_
+#define SRC_INC_INTERNAL_CS104_REPLICATION_H_
+
+#include "cs104_message_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (CS104_SLAVE_HAS_REPLICATION == 1)
+
+/*
+ * Keeps the event queue of a standby server up to date. The active server sends
+ * the new entries of the event log and the confirmation state of the message
+ * queues over a TCP connection to the standby server. The changes of an interval
+ * (CONFIG_CS104_EVENT_QUEUE_REPLICATION_INTERVAL) are sent with a single socket
+ * write. The standby server stores the entries with the same IDs in its own log,
+ * so it can take over with the events that are not yet confirmed.
+ *
+ * After a RESET the standby receives a snapshot of the log. It keeps its old entries
+ * until the snapshot is complete, so it can take over with the old state while the
+ * snapshot is transferred.
+ */
+
+typedef struct sCS104_Replication* CS104_Replication;
+
+/* called by the replication thread of the active server before the changes of the log are collected */
+typedef void (*CS104_ReplicationCollectHandler)(void* parameter);
+
+CS104_Replication
+CS104_Replication_create(MessageLog log, const char* localAddress, const char* activeAddress, int port,
+                         CS104_ReplicationCollectHandler collectHandler, void* collectHandlerParameter);
+
+void
+CS104_Replication_destroy(CS104_Replication self);
+
+bool
+CS104_Replication_isConnected(CS104_Replication self);
+
+#endif /* (CS104_SLAVE_HAS_REPLICATION == 1) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS104_REPLICATION_H_ */
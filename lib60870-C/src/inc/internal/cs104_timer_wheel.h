@@ -0,0 +1,100 @@
+/*
+ *  cs104_timer_wheel.h
+ *
+ *  Copyright 2016-2026 Michael Zillgith
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS104_TIMER_WHEEL_H_
+#define SRC_INC_INTERNAL_CS104_TIMER_WHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hierarchical timer wheel that is used to check the protocol timers of many
+ * connections with a single event loop. Level 0 has a resolution of 1 ms, each
+ * slot of level n covers TIMER_WHEEL_SLOTS^n ms. Entries are moved to the next
+ * lower level when the time reaches their slot. Adding and removing an entry is
+ * done in constant time.
+ *
+ * A wheel is only used by a single thread (no locking).
+ */
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/* maximum time (in ms) between the current time and the time an entry is placed to */
+#define TIMER_WHEEL_MAX_RANGE (((uint64_t)1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1)
+
+typedef struct sTimerWheelEntry* TimerWheelEntry;
+
+struct sTimerWheelEntry
+{
+    TimerWheelEntry next;
+    TimerWheelEntry prev;
+    TimerWheelEntry* slot; /* slot containing the entry (NULL -> entry is not armed) */
+    uint64_t expiry;       /* monotonic time in ms */
+    void* data;
+};
+
+typedef struct sTimerWheel* TimerWheel;
+
+struct sTimerWheel
+{
+    uint64_t currentTime; /* all entries expiring at or before this time are removed */
+    int numberOfEntries;
+    TimerWheelEntry slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+void
+TimerWheelEntry_init(TimerWheelEntry self, void* data);
+
+bool
+TimerWheelEntry_isArmed(TimerWheelEntry self);
+
+void
+TimerWheel_init(TimerWheel self, uint64_t currentTime);
+
+void
+TimerWheel_remove(TimerWheel self, TimerWheelEntry entry);
+
+void
+TimerWheel_add(TimerWheel self, TimerWheelEntry entry, uint64_t expiry);
+
+uint64_t
+TimerWheel_getNextEventTime(TimerWheel self);
+
+unsigned int
+TimerWheel_getWaitTime(TimerWheel self, uint64_t currentTime, unsigned int maxWaitTime);
+
+int
+TimerWheel_advance(TimerWheel self, uint64_t currentTime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS104_TIMER_WHEEL_H_ */
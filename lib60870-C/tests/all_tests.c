@@ -1,6 +1,7 @@
 #include "buffer_frame.h"
 #include "cs104_connection.h"
 #include "cs104_slave.h"
+#include "cs104_timer_wheel.h"
 #include "hal_socket.h"
 #include "hal_thread.h"
 #include "hal_time.h"
@@ -1201,13 +1202,3465 @@ test_CS104SlaveEventQueue1_asduReceivedHandler(void* parameter, int address, CS1
     return true;
 }
 
+void
+test_CS104SlaveEventLoopThreadingModel()
+{
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setThreadingModel(slave, CS104_THREADING_MODEL_EVENT_LOOP, 2);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    struct stest_CS104SlaveEventQueue1 info[3];
+    CS104_Connection con[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        info[i].asduHandlerCalled = 0;
+        info[i].spontCount = 0;
+        info[i].lastScaledValue = 0;
+
+        con[i] = CS104_Connection_create("127.0.0.1", 20004);
+
+        CS104_Connection_setASDUReceivedHandler(con[i], test_CS104SlaveEventQueue1_asduReceivedHandler, &(info[i]));
+
+        bool result = CS104_Connection_connect(con[i]);
+        TEST_ASSERT_TRUE(result);
+
+        CS104_Connection_sendStartDT(con[i]);
+    }
+
+    Thread_sleep(200);
+
+    TEST_ASSERT_EQUAL_INT(3, CS104_Slave_getOpenConnections(slave));
+
+    for (int i = 0; i < 20; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+
+    Thread_sleep(500);
+
+    for (int i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(20, info[i].spontCount);
+        TEST_ASSERT_EQUAL_INT(19, info[i].lastScaledValue);
+    }
+
+    CS104_Connection_destroy(con[0]);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(2, CS104_Slave_getOpenConnections(slave));
+
+    CS104_Slave_stop(slave);
+
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getOpenConnections(slave));
+
+    CS104_Connection_destroy(con[1]);
+    CS104_Connection_destroy(con[2]);
+
+    CS104_Slave_destroy(slave);
+}
+
+static void
+test_CS104SlaveSharedEventLog_enqueueEvents(CS104_Slave slave, int firstValue, int count)
+{
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    for (int i = 0; i < count; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io =
+            (InformationObject)MeasuredValueScaled_create(NULL, 110, firstValue + i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+}
+
+void
+test_CS104SlaveSharedEventLogConnectionIsRedundancyGroup()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    struct stest_CS104SlaveEventQueue1 info1 = {0, 0, 0};
+    struct stest_CS104SlaveEventQueue1 info2 = {0, 0, 0};
+
+    CS104_Connection con1 = CS104_Connection_create("127.0.0.1", 20004);
+    CS104_Connection_setASDUReceivedHandler(con1, test_CS104SlaveEventQueue1_asduReceivedHandler, &info1);
+
+    CS104_Connection con2 = CS104_Connection_create("127.0.0.1", 20004);
+    CS104_Connection_setASDUReceivedHandler(con2, test_CS104SlaveEventQueue1_asduReceivedHandler, &info2);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con1));
+    CS104_Connection_sendStartDT(con1);
+
+    Thread_sleep(200);
+
+    test_CS104SlaveSharedEventLog_enqueueEvents(slave, 0, 10);
+
+    Thread_sleep(300);
+
+    TEST_ASSERT_EQUAL_INT(10, info1.spontCount);
+    TEST_ASSERT_EQUAL_INT(9, info1.lastScaledValue);
+
+    /* new connection only receives events enqueued after it is connected */
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con2));
+    CS104_Connection_sendStartDT(con2);
+
+    Thread_sleep(200);
+
+    test_CS104SlaveSharedEventLog_enqueueEvents(slave, 10, 5);
+
+    Thread_sleep(300);
+
+    TEST_ASSERT_EQUAL_INT(15, info1.spontCount);
+    TEST_ASSERT_EQUAL_INT(14, info1.lastScaledValue);
+
+    TEST_ASSERT_EQUAL_INT(5, info2.spontCount);
+    TEST_ASSERT_EQUAL_INT(14, info2.lastScaledValue);
+
+    /* events are queued for a stopped connection and sent when the connection is started again */
+    CS104_Connection_sendStopDT(con2);
+
+    Thread_sleep(200);
+
+    test_CS104SlaveSharedEventLog_enqueueEvents(slave, 15, 5);
+
+    Thread_sleep(300);
+
+    TEST_ASSERT_EQUAL_INT(20, info1.spontCount);
+    TEST_ASSERT_EQUAL_INT(5, info2.spontCount);
+
+    CS104_Connection_sendStartDT(con2);
+
+    Thread_sleep(300);
+
+    TEST_ASSERT_EQUAL_INT(10, info2.spontCount);
+    TEST_ASSERT_EQUAL_INT(19, info2.lastScaledValue);
+
+    CS104_Connection_destroy(con1);
+    CS104_Connection_destroy(con2);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+/* transmit a large event queue with a large k parameter (many sent but unconfirmed entries) */
+void
+test_CS104SlaveEventQueueLargeK()
+{
+    const int numberOfEvents = 10000;
+
+    CS104_Slave slave = CS104_Slave_create(numberOfEvents, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_APCIParameters slaveApciParams = CS104_Slave_getConnectionParameters(slave);
+    slaveApciParams->k = 256;
+    slaveApciParams->w = 200;
+
+    CS104_Slave_start(slave);
+
+    test_CS104SlaveSharedEventLog_enqueueEvents(slave, 0, numberOfEvents);
+
+    TEST_ASSERT_EQUAL_INT(numberOfEvents, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    struct stest_CS104SlaveEventQueue1 info = {0, 0, 0};
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_APCIParameters apciParams = CS104_Connection_getAPCIParameters(con);
+    apciParams->k = 256;
+    apciParams->w = 200;
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveEventQueue1_asduReceivedHandler, &info);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    CS104_Connection_sendStartDT(con);
+
+    while ((info.spontCount < numberOfEvents) && (Hal_getMonotonicTimeInMs() - startTime < 10000))
+        Thread_sleep(1);
+
+    TEST_ASSERT_EQUAL_INT(numberOfEvents, info.spontCount);
+    TEST_ASSERT_EQUAL_INT((int16_t)(numberOfEvents - 1), info.lastScaledValue);
+
+    /* connection is still alive (no sequence number errors) */
+    TEST_ASSERT_TRUE(CS104_Connection_isConnected(con));
+
+    /* all events are confirmed by the client */
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+static void
+test_CS104SlaveTxBatchSize(int maxTxBatchSize)
+{
+    const int numberOfEvents = 500;
+
+    CS104_Slave slave = CS104_Slave_create(numberOfEvents, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setMaxTxBatchSize(slave, maxTxBatchSize);
+
+    CS104_Slave_start(slave);
+
+    test_CS104SlaveSharedEventLog_enqueueEvents(slave, 0, numberOfEvents);
+
+    struct stest_CS104SlaveEventQueue1 info = {0, 0, 0};
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveEventQueue1_asduReceivedHandler, &info);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((info.spontCount < numberOfEvents) && (Hal_getMonotonicTimeInMs() - startTime < 5000))
+        Thread_sleep(1);
+
+    TEST_ASSERT_EQUAL_INT(numberOfEvents, info.spontCount);
+    TEST_ASSERT_EQUAL_INT(numberOfEvents - 1, info.lastScaledValue);
+
+    /* connection is still alive (no sequence number errors) */
+    TEST_ASSERT_TRUE(CS104_Connection_isConnected(con));
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+void
+test_CS104SlaveTxBatching()
+{
+    /* APDUs collected in output buffer */
+    test_CS104SlaveTxBatchSize(4096);
+
+    /* small output buffer -> buffer is flushed during the batch */
+    test_CS104SlaveTxBatchSize(300);
+
+    /* no output buffer -> each APDU is written separately */
+    test_CS104SlaveTxBatchSize(0);
+}
+
+static void
+test_CS104SlaveTxCongestionWithThreadingModel(CS104_ThreadingModel threadingModel)
+{
+    /* more data than the socket buffers can store (252 bytes per APDU) */
+    const int numberOfEvents = 30000;
+
+    CS104_Slave slave = CS104_Slave_create(numberOfEvents, 10);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setThreadingModel(slave, threadingModel, 2);
+
+    CS104_APCIParameters apciParams = CS104_Slave_getConnectionParameters(slave);
+    apciParams->k = numberOfEvents;
+    apciParams->w = numberOfEvents / 2;
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    for (int i = 0; i < numberOfEvents; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        for (int j = 0; j < 40; j++)
+        {
+            InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 100 + j, i, IEC60870_QUALITY_GOOD);
+
+            CS101_ASDU_addInformationObject(newAsdu, io);
+
+            InformationObject_destroy(io);
+        }
+
+        CS104_Slave_enqueueASDU(slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+
+    Socket socket = TcpSocket_create();
+
+    TEST_ASSERT_NOT_NULL(socket);
+    TEST_ASSERT_TRUE(Socket_connect(socket, "127.0.0.1", 20004));
+
+    uint8_t startDtAct[] = {0x68, 0x04, 0x07, 0x00, 0x00, 0x00};
+
+    TEST_ASSERT_EQUAL_INT(6, Socket_write(socket, startDtAct, 6));
+
+    /* client doesn't read -> the socket of the server is congested */
+    Thread_sleep(1000);
+
+    /* congestion doesn't close the connection */
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getOpenConnections(slave));
+
+    /* STARTDT CON and all events are received when the client reads again */
+    int expectedBytes = 6 + numberOfEvents * 252;
+    int receivedBytes = 0;
+
+    uint8_t buffer[4096];
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((receivedBytes < expectedBytes) && (Hal_getMonotonicTimeInMs() - startTime < 10000))
+    {
+        int readBytes = Socket_read(socket, buffer, sizeof(buffer));
+
+        if (readBytes < 0)
+            break;
+
+        if (readBytes == 0)
+            Thread_sleep(1);
+
+        receivedBytes += readBytes;
+    }
+
+    TEST_ASSERT_EQUAL_INT(expectedBytes, receivedBytes);
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getOpenConnections(slave));
+
+    Socket_destroy(socket);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+/* slow client: the output buffer is sent when the socket is writable again (no overflow, no busy loop) */
+void
+test_CS104SlaveTxCongestion()
+{
+    test_CS104SlaveTxCongestionWithThreadingModel(CS104_THREADING_MODEL_THREAD_PER_CONNECTION);
+    test_CS104SlaveTxCongestionWithThreadingModel(CS104_THREADING_MODEL_EVENT_LOOP);
+}
+
+/* multiple APDUs in a single TCP segment and an APDU split over multiple segments */
+void
+test_CS104SlaveReceiveMultipleAPDUsWithSingleRead()
+{
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    Socket socket = TcpSocket_create();
+
+    TEST_ASSERT_NOT_NULL(socket);
+    TEST_ASSERT_TRUE(Socket_connect(socket, "127.0.0.1", 20004));
+
+    Thread_sleep(100);
+
+    uint8_t request[] = {0x68, 0x04, 0x07, 0x00, 0x00, 0x00,  /* STARTDT ACT */
+                         0x68, 0x04, 0x43, 0x00, 0x00, 0x00,  /* TESTFR ACT */
+                         0x68, 0x04, 0x43, 0x00, 0x00, 0x00,  /* TESTFR ACT */
+                         0x68, 0x04, 0x43, 0x00, 0x00, 0x00}; /* TESTFR ACT */
+
+    /* send the last APDU in two parts */
+    TEST_ASSERT_EQUAL_INT(21, Socket_write(socket, request, 21));
+
+    Thread_sleep(100);
+
+    TEST_ASSERT_EQUAL_INT(3, Socket_write(socket, request + 21, 3));
+
+    uint8_t response[100];
+    int responseSize = 0;
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((responseSize < 24) && (Hal_getMonotonicTimeInMs() - startTime < 1000))
+    {
+        int readBytes = Socket_read(socket, response + responseSize, sizeof(response) - responseSize);
+
+        if (readBytes < 0)
+            break;
+
+        responseSize += readBytes;
+
+        Thread_sleep(10);
+    }
+
+    TEST_ASSERT_EQUAL_INT(24, responseSize);
+
+    uint8_t expectedResponse[] = {0x68, 0x04, 0x0b, 0x00, 0x00, 0x00,  /* STARTDT CON */
+                                  0x68, 0x04, 0x83, 0x00, 0x00, 0x00,  /* TESTFR CON */
+                                  0x68, 0x04, 0x83, 0x00, 0x00, 0x00,  /* TESTFR CON */
+                                  0x68, 0x04, 0x83, 0x00, 0x00, 0x00}; /* TESTFR CON */
+
+    TEST_ASSERT_EQUAL_MEMORY(expectedResponse, response, 24);
+
+    /* invalid start byte after a valid APDU closes the connection */
+    uint8_t invalidRequest[] = {0x68, 0x04, 0x43, 0x00, 0x00, 0x00, 0x67, 0x04, 0x43, 0x00, 0x00, 0x00};
+
+    Socket_write(socket, invalidRequest, sizeof(invalidRequest));
+
+    Thread_sleep(200);
+
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getOpenConnections(slave));
+
+    Socket_destroy(socket);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+static void
+test_CS104SlaveEnqueueWakeupWithThreadingModel(CS104_ThreadingModel threadingModel)
+{
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setThreadingModel(slave, threadingModel, 2);
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    Socket socket = TcpSocket_create();
+
+    TEST_ASSERT_NOT_NULL(socket);
+    TEST_ASSERT_TRUE(Socket_connect(socket, "127.0.0.1", 20004));
+
+    uint8_t startDtAct[] = {0x68, 0x04, 0x07, 0x00, 0x00, 0x00};
+
+    TEST_ASSERT_EQUAL_INT(6, Socket_write(socket, startDtAct, 6));
+
+    uint8_t response[256];
+    int responseSize = 0;
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((responseSize < 6) && (Hal_getMonotonicTimeInMs() - startTime < 1000))
+    {
+        int readBytes = Socket_read(socket, response + responseSize, 6 - responseSize);
+
+        if (readBytes < 0)
+            break;
+
+        responseSize += readBytes;
+    }
+
+    TEST_ASSERT_EQUAL_INT(6, responseSize);
+    TEST_ASSERT_EQUAL_UINT8(0x0b, response[2]);
+
+    /* each event has to be sent immediately and not with the next poll cycle */
+    int numberOfEvents = 20;
+    int receivedEvents = 0;
+
+    startTime = Hal_getMonotonicTimeInMs();
+
+    for (int i = 0; i < numberOfEvents; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)SinglePointInformation_create(NULL, 100, (i % 2) == 0, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+
+        uint64_t eventTime = Hal_getMonotonicTimeInMs();
+
+        responseSize = 0;
+
+        /* read APCI header and ASDU of the I frame */
+        while ((Hal_getMonotonicTimeInMs() - eventTime < 1000) && ((responseSize < 2) || (responseSize < response[1] + 2)))
+        {
+            int readBytes = Socket_read(socket, response + responseSize, sizeof(response) - responseSize);
+
+            if (readBytes < 0)
+                break;
+
+            responseSize += readBytes;
+        }
+
+        if ((responseSize >= 6) && ((response[2] & 0x01) == 0))
+        {
+            receivedEvents++;
+
+            /* confirm the I frame (S frame) */
+            int receiveSeqNo = receivedEvents << 1;
+
+            uint8_t sFrame[] = {0x68, 0x04, 0x01, 0x00, (uint8_t)(receiveSeqNo % 256), (uint8_t)(receiveSeqNo / 256)};
+
+            Socket_write(socket, sFrame, 6);
+        }
+    }
+
+    uint64_t duration = Hal_getMonotonicTimeInMs() - startTime;
+
+    Socket_destroy(socket);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(numberOfEvents, receivedEvents);
+
+    /* with the 100 ms poll cycle of the connection handling this took about 1 s */
+    TEST_ASSERT_TRUE(duration < 500);
+}
+
+void
+test_CS104SlaveEnqueueWakeup()
+{
+    test_CS104SlaveEnqueueWakeupWithThreadingModel(CS104_THREADING_MODEL_THREAD_PER_CONNECTION);
+    test_CS104SlaveEnqueueWakeupWithThreadingModel(CS104_THREADING_MODEL_EVENT_LOOP);
+}
+
+#define TEST_INGRESS_PRODUCERS 4
+#define TEST_INGRESS_EVENTS_PER_PRODUCER 300
+
+struct stest_CS104SlaveIngressQueue
+{
+    CS104_Slave slave;
+    int producer;
+
+    /* receiver side */
+    int receivedEvents;
+    int orderErrors;
+    int nextValue[TEST_INGRESS_PRODUCERS];
+};
+
+static void*
+test_CS104SlaveIngressQueue_producerThread(void* parameter)
+{
+    struct stest_CS104SlaveIngressQueue* info = (struct stest_CS104SlaveIngressQueue*)parameter;
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(info->slave);
+
+    for (int i = 0; i < TEST_INGRESS_EVENTS_PER_PRODUCER; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io =
+            (InformationObject)MeasuredValueScaled_create(NULL, 100 + info->producer, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(info->slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+
+    return NULL;
+}
+
+static bool
+test_CS104SlaveIngressQueue_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveIngressQueue* info = (struct stest_CS104SlaveIngressQueue*)parameter;
+
+    if ((CS101_ASDU_getCOT(asdu) == CS101_COT_SPONTANEOUS) && (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1))
+    {
+        uint8_t ioBuf[250];
+
+        MeasuredValueScaled mv = (MeasuredValueScaled)CS101_ASDU_getElementEx(asdu, (InformationObject)ioBuf, 0);
+
+        int producer = InformationObject_getObjectAddress((InformationObject)mv) - 100;
+
+        if ((producer >= 0) && (producer < TEST_INGRESS_PRODUCERS))
+        {
+            /* the events of a producer have to keep their order */
+            if (MeasuredValueScaled_getValue(mv) != info->nextValue[producer])
+                info->orderErrors++;
+
+            info->nextValue[producer] = MeasuredValueScaled_getValue(mv) + 1;
+        }
+
+        info->receivedEvents++;
+    }
+
+    return true;
+}
+
+void
+test_CS104SlaveIngressQueueMultipleProducers()
+{
+    CS104_Slave slave = CS104_Slave_create(TEST_INGRESS_PRODUCERS * TEST_INGRESS_EVENTS_PER_PRODUCER, 10);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    /* small ingress queue -> the producers also have to move the ASDUs to the event queue */
+    CS104_Slave_setIngressQueueSize(slave, 64);
+
+    CS104_Slave_start(slave);
+
+    struct stest_CS104SlaveIngressQueue receiverInfo;
+    memset(&receiverInfo, 0, sizeof(receiverInfo));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveIngressQueue_asduReceivedHandler, &receiverInfo);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    struct stest_CS104SlaveIngressQueue producerInfo[TEST_INGRESS_PRODUCERS];
+    Thread producers[TEST_INGRESS_PRODUCERS];
+
+    for (int i = 0; i < TEST_INGRESS_PRODUCERS; i++)
+    {
+        producerInfo[i].slave = slave;
+        producerInfo[i].producer = i;
+
+        producers[i] = Thread_create(test_CS104SlaveIngressQueue_producerThread, &(producerInfo[i]), false);
+        Thread_start(producers[i]);
+    }
+
+    for (int i = 0; i < TEST_INGRESS_PRODUCERS; i++)
+        Thread_destroy(producers[i]);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((receiverInfo.receivedEvents < TEST_INGRESS_PRODUCERS * TEST_INGRESS_EVENTS_PER_PRODUCER) &&
+           (Hal_getMonotonicTimeInMs() - startTime < 5000))
+    {
+        Thread_sleep(10);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(TEST_INGRESS_PRODUCERS * TEST_INGRESS_EVENTS_PER_PRODUCER, receiverInfo.receivedEvents);
+    TEST_ASSERT_EQUAL_INT(0, receiverInfo.orderErrors);
+}
+
+struct stest_CS104SlaveEnqueuePointUpdates {
+    int receivedASDUs;
+    int sequenceASDUs;
+    int receivedObjects;
+    int valueErrors;
+};
+
+static bool
+test_CS104SlaveEnqueuePointUpdates_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveEnqueuePointUpdates* info = (struct stest_CS104SlaveEnqueuePointUpdates*)parameter;
+
+    info->receivedASDUs++;
+
+    if (CS101_ASDU_isSequence(asdu))
+        info->sequenceASDUs++;
+
+    for (int i = 0; i < CS101_ASDU_getNumberOfElements(asdu); i++)
+    {
+        InformationObject io = CS101_ASDU_getElement(asdu, i);
+
+        if (io)
+        {
+            int ioa = InformationObject_getObjectAddress(io);
+
+            if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1)
+            {
+                if (MeasuredValueScaled_getValue((MeasuredValueScaled)io) != ioa)
+                    info->valueErrors++;
+            }
+            else if (CS101_ASDU_getTypeID(asdu) == M_SP_TB_1)
+            {
+                if (SinglePointInformation_getValue((SinglePointInformation)io) != (ioa % 2 == 0))
+                    info->valueErrors++;
+            }
+
+            info->receivedObjects++;
+
+            InformationObject_destroy(io);
+        }
+    }
+
+    return true;
+}
+
+void
+test_CS104SlaveEnqueuePointUpdates()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    InformationObject points[100];
+
+    /* contiguous IOAs -> sequence ASDUs with 80 elements */
+    for (int i = 0; i < 100; i++)
+        points[i] = (InformationObject)MeasuredValueScaled_create(NULL, 1000 + i, 1000 + i, IEC60870_QUALITY_GOOD);
+
+    int contiguousASDUs = CS104_Slave_enqueuePointUpdates(slave, CS101_COT_SPONTANEOUS, 0, 1, points, 100);
+
+    for (int i = 0; i < 100; i++)
+        InformationObject_destroy(points[i]);
+
+    /* gaps between IOAs -> ASDUs with 40 elements */
+    for (int i = 0; i < 100; i++)
+        points[i] = (InformationObject)MeasuredValueScaled_create(NULL, 2000 + 2 * i, 2000 + 2 * i, IEC60870_QUALITY_GOOD);
+
+    int sparseASDUs = CS104_Slave_enqueuePointUpdates(slave, CS101_COT_SPONTANEOUS, 0, 1, points, 100);
+
+    for (int i = 0; i < 100; i++)
+        InformationObject_destroy(points[i]);
+
+    /* time tagged type -> no sequence, 22 elements per ASDU */
+    struct sCP56Time2a timestamp;
+    CP56Time2a_createFromMsTimestamp(&timestamp, Hal_getTimeInMs());
+
+    for (int i = 0; i < 30; i++)
+        points[i] = (InformationObject)SinglePointWithCP56Time2a_create(NULL, 3000 + i, (i % 2 == 0), IEC60870_QUALITY_GOOD, &timestamp);
+
+    int timeTaggedASDUs = CS104_Slave_enqueuePointUpdates(slave, CS101_COT_SPONTANEOUS, 0, 1, points, 30);
+
+    for (int i = 0; i < 30; i++)
+        InformationObject_destroy(points[i]);
+
+    int queueEntries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+
+    struct stest_CS104SlaveEnqueuePointUpdates receiverInfo;
+    memset(&receiverInfo, 0, sizeof(receiverInfo));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveEnqueuePointUpdates_asduReceivedHandler, &receiverInfo);
+
+    bool connected = CS104_Connection_connect(con);
+
+    CS104_Connection_sendStartDT(con);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((receiverInfo.receivedObjects < 230) && (Hal_getMonotonicTimeInMs() - startTime < 2000))
+        Thread_sleep(10);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(2, contiguousASDUs);
+    TEST_ASSERT_EQUAL_INT(3, sparseASDUs);
+    TEST_ASSERT_EQUAL_INT(2, timeTaggedASDUs);
+    TEST_ASSERT_EQUAL_INT(7, queueEntries);
+    TEST_ASSERT_EQUAL_INT(7, receiverInfo.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(2, receiverInfo.sequenceASDUs);
+    TEST_ASSERT_EQUAL_INT(230, receiverInfo.receivedObjects);
+    TEST_ASSERT_EQUAL_INT(0, receiverInfo.valueErrors);
+}
+
+struct stest_CS104SlavePersistentEventQueue {
+    int receivedASDUs;
+    int firstIOA;
+    int lastIOA;
+};
+
+static bool
+test_CS104SlavePersistentEventQueue_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct stest_CS104SlavePersistentEventQueue* info = (struct stest_CS104SlavePersistentEventQueue*)parameter;
+
+    InformationObject io = CS101_ASDU_getElement(asdu, 0);
+
+    if (io)
+    {
+        if (info->receivedASDUs == 0)
+            info->firstIOA = InformationObject_getObjectAddress(io);
+
+        info->lastIOA = InformationObject_getObjectAddress(io);
+
+        InformationObject_destroy(io);
+    }
+
+    info->receivedASDUs++;
+
+    return true;
+}
+
+static void
+test_CS104SlavePersistentEventQueue_enqueueEvents(CS104_Slave slave, int firstIOA, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, firstIOA + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+}
+
+static void
+test_CS104SlavePersistentEventQueue_receive(struct stest_CS104SlavePersistentEventQueue* info, int expectedASDUs)
+{
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlavePersistentEventQueue_asduReceivedHandler, info);
+
+    if (CS104_Connection_connect(con))
+    {
+        CS104_Connection_sendStartDT(con);
+
+        uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+        while ((info->receivedASDUs < expectedASDUs) && (Hal_getMonotonicTimeInMs() - startTime < 2000))
+            Thread_sleep(10);
+
+        /* wait for the S message that confirms the received ASDUs */
+        Thread_sleep(500);
+    }
+
+    CS104_Connection_destroy(con);
+}
+
+void
+test_CS104SlavePersistentEventQueue()
+{
+    const char* journalFile = "test_event_queue.journal";
+
+    remove(journalFile);
+
+    struct stest_CS104SlavePersistentEventQueue firstRun;
+    memset(&firstRun, 0, sizeof(firstRun));
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    CS104_Slave_start(slave);
+
+    /* 8 ASDUs (= w) are confirmed by the client */
+    test_CS104SlavePersistentEventQueue_enqueueEvents(slave, 100, 8);
+
+    test_CS104SlavePersistentEventQueue_receive(&firstRun, 8);
+
+    /* not sent before the server is stopped */
+    test_CS104SlavePersistentEventQueue_enqueueEvents(slave, 200, 5);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    /* restart -> only the unconfirmed ASDUs are sent */
+    struct stest_CS104SlavePersistentEventQueue secondRun;
+    memset(&secondRun, 0, sizeof(secondRun));
+
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    CS104_Slave_start(slave);
+
+    int restoredEntries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+
+    test_CS104SlavePersistentEventQueue_enqueueEvents(slave, 300, 1);
+
+    test_CS104SlavePersistentEventQueue_receive(&secondRun, 6);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    remove(journalFile);
+
+    TEST_ASSERT_EQUAL_INT(8, firstRun.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(100, firstRun.firstIOA);
+    TEST_ASSERT_EQUAL_INT(107, firstRun.lastIOA);
+
+    TEST_ASSERT_EQUAL_INT(5, restoredEntries);
+    TEST_ASSERT_EQUAL_INT(6, secondRun.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(200, secondRun.firstIOA);
+    TEST_ASSERT_EQUAL_INT(300, secondRun.lastIOA);
+}
+
+void
+test_CS104SlavePersistentEventQueueCorruptedEntry()
+{
+    const char* journalFile = "test_event_queue_corrupted.journal";
+
+    remove(journalFile);
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    CS104_Slave_start(slave);
+
+    test_CS104SlavePersistentEventQueue_enqueueEvents(slave, 100, 5);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    /* the free space of the log is cleared -> last non-zero byte belongs to the last entry */
+    bool corrupted = false;
+
+    FILE* file = fopen(journalFile, "r+b");
+
+    if (file)
+    {
+        fseek(file, 0, SEEK_END);
+
+        long fileSize = ftell(file);
+
+        uint8_t* content = (uint8_t*)malloc(fileSize);
+
+        fseek(file, 0, SEEK_SET);
+
+        if (content && (fread(content, 1, fileSize, file) == (size_t)fileSize))
+        {
+            long pos = fileSize - 1;
+
+            while ((pos > 0) && (content[pos] == 0))
+                pos--;
+
+            content[pos] ^= 0xff;
+
+            fseek(file, pos, SEEK_SET);
+
+            corrupted = (fwrite(content + pos, 1, 1, file) == 1);
+        }
+
+        free(content);
+        fclose(file);
+    }
+
+    /* restart -> the entries before the corrupted entry are restored */
+    struct stest_CS104SlavePersistentEventQueue info;
+    memset(&info, 0, sizeof(info));
+
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    CS104_Slave_start(slave);
+
+    int restoredEntries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+
+    test_CS104SlavePersistentEventQueue_receive(&info, 4);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    remove(journalFile);
+
+    TEST_ASSERT_TRUE(corrupted);
+    TEST_ASSERT_EQUAL_INT(4, restoredEntries);
+    TEST_ASSERT_EQUAL_INT(4, info.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(100, info.firstIOA);
+    TEST_ASSERT_EQUAL_INT(103, info.lastIOA);
+}
+
+static CS104_Slave
+test_CS104SlavePersistentEventQueueGroups_createSlave(const char* journalFile, bool groupAFirst,
+                                                      CS104_RedundancyGroup* groupA, CS104_RedundancyGroup* groupB)
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setServerMode(slave, CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    *groupA = CS104_RedundancyGroup_create("A");
+    CS104_RedundancyGroup_addAllowedClient(*groupA, "127.0.0.1");
+
+    *groupB = CS104_RedundancyGroup_create("B");
+    CS104_RedundancyGroup_addAllowedClient(*groupB, "10.0.0.1");
+
+    if (groupAFirst)
+    {
+        CS104_Slave_addRedundancyGroup(slave, *groupA);
+        CS104_Slave_addRedundancyGroup(slave, *groupB);
+    }
+    else
+    {
+        CS104_Slave_addRedundancyGroup(slave, *groupB);
+        CS104_Slave_addRedundancyGroup(slave, *groupA);
+    }
+
+    return slave;
+}
+
+void
+test_CS104SlavePersistentEventQueueGroups()
+{
+    const char* journalFile = "test_event_queue_groups.journal";
+
+    remove(journalFile);
+
+    CS104_RedundancyGroup groupA;
+    CS104_RedundancyGroup groupB;
+
+    struct stest_CS104SlavePersistentEventQueue info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Slave slave = test_CS104SlavePersistentEventQueueGroups_createSlave(journalFile, true, &groupA, &groupB);
+
+    CS104_Slave_start(slave);
+
+    /* 8 ASDUs (= w) are confirmed by the client of group A */
+    test_CS104SlavePersistentEventQueue_enqueueEvents(slave, 100, 8);
+
+    test_CS104SlavePersistentEventQueue_receive(&info, 8);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    /* restart with the groups added in a different order */
+    slave = test_CS104SlavePersistentEventQueueGroups_createSlave(journalFile, false, &groupA, &groupB);
+
+    CS104_Slave_start(slave);
+
+    int entriesA = CS104_Slave_getNumberOfQueueEntries(slave, groupA);
+    int entriesB = CS104_Slave_getNumberOfQueueEntries(slave, groupB);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    remove(journalFile);
+
+    TEST_ASSERT_EQUAL_INT(8, info.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(0, entriesA);
+    TEST_ASSERT_EQUAL_INT(8, entriesB);
+}
+
+static bool
+test_CS104SlaveIngressQueue_copyFile(const char* source, const char* destination)
+{
+    bool copied = false;
+
+    FILE* src = fopen(source, "rb");
+    FILE* dst = fopen(destination, "wb");
+
+    if (src && dst)
+    {
+        char buffer[4096];
+        size_t bytes;
+
+        copied = true;
+
+        while ((bytes = fread(buffer, 1, sizeof(buffer), src)) > 0)
+        {
+            if (fwrite(buffer, 1, bytes, dst) != bytes)
+                copied = false;
+        }
+    }
+
+    if (src)
+        fclose(src);
+
+    if (dst)
+        fclose(dst);
+
+    return copied;
+}
+
+void
+test_CS104SlaveIngressQueueWithoutConnection()
+{
+    const char* journalFile = "test_ingress_queue.journal";
+    const char* journalCopy = "test_ingress_queue_copy.journal";
+
+    remove(journalFile);
+    remove(journalCopy);
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setIngressQueueSize(slave, 64);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    CS104_Slave_start(slave);
+
+    /* ASDUs that don't fit into an APDU are rejected */
+    CS101_ASDU oversizedAsdu =
+        CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    uint8_t payload[250];
+    memset(payload, 0, sizeof(payload));
+
+    CS101_ASDU_setTypeID(oversizedAsdu, M_ME_NB_1);
+    bool payloadAdded = CS101_ASDU_addPayload(oversizedAsdu, payload, sizeof(payload));
+
+    bool oversizedEnqueued = CS104_Slave_enqueueASDU(slave, oversizedAsdu);
+
+    CS101_ASDU_destroy(oversizedAsdu);
+
+    /* no client is connected -> the server thread has to move the ASDUs to the event queue */
+    test_CS104SlavePersistentEventQueue_enqueueEvents(slave, 100, 5);
+
+    Thread_sleep(200);
+
+    /* snapshot of the journal as it would be found after a crash */
+    bool copied = test_CS104SlaveIngressQueue_copyFile(journalFile, journalCopy);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalCopy, false);
+
+    CS104_Slave_start(slave);
+
+    int restoredEntries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    remove(journalFile);
+    remove(journalCopy);
+
+    TEST_ASSERT_TRUE(payloadAdded);
+    TEST_ASSERT_FALSE(oversizedEnqueued);
+    TEST_ASSERT_TRUE(copied);
+    TEST_ASSERT_EQUAL_INT(5, restoredEntries);
+}
+
+static int
+test_CS104SlaveEventQueueReplication_waitForEntries(CS104_Slave slave, int expectedEntries)
+{
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    int entries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+
+    while ((entries != expectedEntries) && (Hal_getMonotonicTimeInMs() - startTime < 2000))
+    {
+        Thread_sleep(10);
+
+        entries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+    }
+
+    return entries;
+}
+
+void
+test_CS104SlaveEventQueueReplication()
+{
+    struct stest_CS104SlavePersistentEventQueue firstRun;
+    memset(&firstRun, 0, sizeof(firstRun));
+
+    CS104_Slave active = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(active, 20004);
+    CS104_Slave_setReplicationPort(active, 20005);
+
+    CS104_Slave_start(active);
+
+    /* second server on the same machine (takes over the client port later) */
+    CS104_Slave standby = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(standby, 20004);
+
+    bool standbyStarted = CS104_Slave_startStandby(standby, "127.0.0.1", 20005);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((CS104_Slave_isReplicationConnected(standby) == false) && (Hal_getMonotonicTimeInMs() - startTime < 3000))
+        Thread_sleep(10);
+
+    bool standbyConnected = CS104_Slave_isReplicationConnected(standby);
+
+    /* 8 ASDUs (= w) are confirmed by the client */
+    test_CS104SlavePersistentEventQueue_enqueueEvents(active, 100, 8);
+
+    test_CS104SlavePersistentEventQueue_receive(&firstRun, 8);
+
+    /* not sent before the active server fails */
+    test_CS104SlavePersistentEventQueue_enqueueEvents(active, 200, 5);
+
+    int activeEntries = CS104_Slave_getNumberOfQueueEntries(active, NULL);
+
+    /* new entries and confirmations are replicated */
+    int standbyEntries = test_CS104SlaveEventQueueReplication_waitForEntries(standby, 5);
+
+    CS104_Slave_stop(active);
+    CS104_Slave_destroy(active);
+
+    /* take over -> only the unconfirmed ASDUs are sent */
+    struct stest_CS104SlavePersistentEventQueue secondRun;
+    memset(&secondRun, 0, sizeof(secondRun));
+
+    CS104_Slave_start(standby);
+
+    bool isRunning = CS104_Slave_isRunning(standby);
+
+    test_CS104SlavePersistentEventQueue_enqueueEvents(standby, 300, 1);
+
+    test_CS104SlavePersistentEventQueue_receive(&secondRun, 6);
+
+    CS104_Slave_stop(standby);
+    CS104_Slave_destroy(standby);
+
+    TEST_ASSERT_TRUE(standbyStarted);
+    TEST_ASSERT_TRUE(standbyConnected);
+    TEST_ASSERT_TRUE(isRunning);
+
+    TEST_ASSERT_EQUAL_INT(8, firstRun.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(100, firstRun.firstIOA);
+    TEST_ASSERT_EQUAL_INT(107, firstRun.lastIOA);
+
+    TEST_ASSERT_EQUAL_INT(5, activeEntries);
+    TEST_ASSERT_EQUAL_INT(5, standbyEntries);
+    TEST_ASSERT_EQUAL_INT(6, secondRun.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(200, secondRun.firstIOA);
+    TEST_ASSERT_EQUAL_INT(300, secondRun.lastIOA);
+}
+
+static void
+test_CS104SlaveEventQueueReplication_sendFrame(Socket socket, int type, const uint8_t* payload, int payloadSize)
+{
+    uint8_t frame[300];
+
+    frame[0] = (uint8_t)type;
+    frame[1] = (uint8_t)(payloadSize & 0xff);
+    frame[2] = (uint8_t)(payloadSize >> 8);
+
+    memcpy(frame + 3, payload, payloadSize);
+
+    Socket_write(socket, frame, 3 + payloadSize);
+}
+
+static int
+test_CS104SlaveEventQueueReplication_encodeUint(uint8_t* buffer, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+        buffer[i] = (uint8_t)(value >> (8 * i));
+
+    return size;
+}
+
+static void
+test_CS104SlaveEventQueueReplication_sendReset(Socket socket, uint64_t firstEntryId, uint64_t endEntryId)
+{
+    uint8_t payload[16];
+
+    test_CS104SlaveEventQueueReplication_encodeUint(payload, firstEntryId, 8);
+    test_CS104SlaveEventQueueReplication_encodeUint(payload + 8, endEntryId, 8);
+
+    test_CS104SlaveEventQueueReplication_sendFrame(socket, 2, payload, 16);
+}
+
+static void
+test_CS104SlaveEventQueueReplication_sendEntry(Socket socket, uint64_t entryId, int ioa)
+{
+    uint8_t payload[256];
+
+    int pos = test_CS104SlaveEventQueueReplication_encodeUint(payload, entryId, 8);
+    pos += test_CS104SlaveEventQueueReplication_encodeUint(payload + pos, 0, 4);
+
+    struct sBufferFrame bf;
+
+    Frame f = BufferFrame_initialize(&bf, payload + pos, 0, sizeof(payload) - pos);
+
+    CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, ioa, 0, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+
+    InformationObject_destroy(io);
+
+    CS101_ASDU_encode(asdu, f);
+
+    CS101_ASDU_destroy(asdu);
+
+    test_CS104SlaveEventQueueReplication_sendFrame(socket, 3, payload, pos + Frame_getMsgSize(f));
+}
+
+static void
+test_CS104SlaveEventQueueReplication_sendConfirmed(Socket socket, const char* key, uint64_t confirmedId)
+{
+    uint8_t payload[64];
+
+    int keySize = (int)strlen(key);
+
+    payload[0] = (uint8_t)keySize;
+    memcpy(payload + 1, key, keySize);
+
+    test_CS104SlaveEventQueueReplication_encodeUint(payload + 1 + keySize, confirmedId, 8);
+
+    test_CS104SlaveEventQueueReplication_sendFrame(socket, 4, payload, 1 + keySize + 8);
+}
+
+void
+test_CS104SlaveEventQueueReplicationResync()
+{
+    /* the test acts as active server */
+    ServerSocket serverSocket = TcpServerSocket_create(NULL, 20005);
+    TEST_ASSERT_NOT_NULL(serverSocket);
+
+    ServerSocket_listen(serverSocket);
+
+    CS104_Slave standby = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(standby, 20004);
+
+    bool standbyStarted = CS104_Slave_startStandby(standby, "127.0.0.1", 20005);
+
+    Socket socket = NULL;
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((socket == NULL) && (Hal_getMonotonicTimeInMs() - startTime < 3000))
+    {
+        socket = ServerSocket_accept(serverSocket);
+
+        if (socket == NULL)
+            Thread_sleep(10);
+    }
+
+    TEST_ASSERT_NOT_NULL(socket);
+
+    uint8_t hello[8];
+
+    test_CS104SlaveEventQueueReplication_encodeUint(hello, 0x52343031, 4);
+    test_CS104SlaveEventQueueReplication_encodeUint(hello + 4, 3, 4);
+
+    test_CS104SlaveEventQueueReplication_sendFrame(socket, 1, hello, 8);
+
+    /* initial state: entries 1 - 5 */
+    test_CS104SlaveEventQueueReplication_sendReset(socket, 1, 1);
+
+    for (int i = 0; i < 5; i++)
+        test_CS104SlaveEventQueueReplication_sendEntry(socket, 1 + i, 100 + i);
+
+    int initialEntries = test_CS104SlaveEventQueueReplication_waitForEntries(standby, 5);
+
+    /* resync (e.g. after an overflow of the send window) with entries 10 - 12 */
+    test_CS104SlaveEventQueueReplication_sendReset(socket, 10, 13);
+    test_CS104SlaveEventQueueReplication_sendEntry(socket, 10, 210);
+    test_CS104SlaveEventQueueReplication_sendEntry(socket, 11, 211);
+    test_CS104SlaveEventQueueReplication_sendConfirmed(socket, "default", 10);
+
+    Thread_sleep(200);
+
+    /* the old entries are kept until the snapshot is complete */
+    int entriesDuringResync = CS104_Slave_getNumberOfQueueEntries(standby, NULL);
+
+    test_CS104SlaveEventQueueReplication_sendEntry(socket, 12, 212);
+
+    int entriesAfterResync = test_CS104SlaveEventQueueReplication_waitForEntries(standby, 2);
+
+    Socket_destroy(socket);
+    ServerSocket_destroy(serverSocket);
+
+    /* take over -> the unconfirmed entries of the snapshot are sent */
+    struct stest_CS104SlavePersistentEventQueue info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Slave_start(standby);
+
+    test_CS104SlavePersistentEventQueue_receive(&info, 2);
+
+    CS104_Slave_stop(standby);
+    CS104_Slave_destroy(standby);
+
+    TEST_ASSERT_TRUE(standbyStarted);
+    TEST_ASSERT_EQUAL_INT(5, initialEntries);
+    TEST_ASSERT_EQUAL_INT(5, entriesDuringResync);
+    TEST_ASSERT_EQUAL_INT(2, entriesAfterResync);
+
+    TEST_ASSERT_EQUAL_INT(2, info.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(211, info.firstIOA);
+    TEST_ASSERT_EQUAL_INT(212, info.lastIOA);
+}
+
+static void
+test_CS104SlaveEventQueueReplication_enqueueValue(CS104_Slave slave, int ioa, int value)
+{
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, ioa, value, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+
+    InformationObject_destroy(io);
+
+    CS104_Slave_enqueueASDU(slave, asdu);
+
+    CS101_ASDU_destroy(asdu);
+}
+
+void
+test_CS104SlaveEventQueueReplicationCoalescing()
+{
+    CS104_Slave active = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(active, 20004);
+    CS104_Slave_setReplicationPort(active, 20005);
+    CS104_Slave_setLatestValueCoalescing(active, M_ME_NB_1, true);
+
+    CS104_Slave_start(active);
+
+    CS104_Slave standby = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(standby, 20004);
+
+    CS104_Slave_startStandby(standby, "127.0.0.1", 20005);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((CS104_Slave_isReplicationConnected(standby) == false) && (Hal_getMonotonicTimeInMs() - startTime < 3000))
+        Thread_sleep(10);
+
+    bool standbyConnected = CS104_Slave_isReplicationConnected(standby);
+
+    test_CS104SlaveEventQueueReplication_enqueueValue(active, 110, 1);
+
+    int standbyEntries = test_CS104SlaveEventQueueReplication_waitForEntries(standby, 1);
+
+    /* the entry is replaced after it has been sent to the standby -> sent again */
+    test_CS104SlaveEventQueueReplication_enqueueValue(active, 110, 2);
+
+    Thread_sleep(200);
+
+    int activeEntries = CS104_Slave_getNumberOfQueueEntries(active, NULL);
+
+    CS104_Slave_stop(active);
+    CS104_Slave_destroy(active);
+
+    /* take over -> the latest value is sent */
+    struct stest_CS104SlaveEventQueue1 info = {0, 0, 0};
+
+    CS104_Slave_start(standby);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveEventQueue1_asduReceivedHandler, &info);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(500);
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(standby);
+    CS104_Slave_destroy(standby);
+
+    TEST_ASSERT_TRUE(standbyConnected);
+    TEST_ASSERT_EQUAL_INT(1, standbyEntries);
+    TEST_ASSERT_EQUAL_INT(1, activeEntries);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(1, info.spontCount);
+    TEST_ASSERT_EQUAL_INT(2, info.lastScaledValue);
+}
+
+void
+test_CS104SlaveEventQueueReplicationGroups()
+{
+    CS104_RedundancyGroup activeGroupA;
+    CS104_RedundancyGroup activeGroupB;
+
+    CS104_Slave active =
+        test_CS104SlavePersistentEventQueueGroups_createSlave(NULL, true, &activeGroupA, &activeGroupB);
+
+    CS104_Slave_setReplicationPort(active, 20005);
+
+    CS104_Slave_start(active);
+
+    /* the standby adds the groups in a different order */
+    CS104_RedundancyGroup standbyGroupA;
+    CS104_RedundancyGroup standbyGroupB;
+
+    CS104_Slave standby =
+        test_CS104SlavePersistentEventQueueGroups_createSlave(NULL, false, &standbyGroupA, &standbyGroupB);
+
+    CS104_Slave_startStandby(standby, "127.0.0.1", 20005);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((CS104_Slave_isReplicationConnected(standby) == false) && (Hal_getMonotonicTimeInMs() - startTime < 3000))
+        Thread_sleep(10);
+
+    bool standbyConnected = CS104_Slave_isReplicationConnected(standby);
+
+    /* 8 ASDUs (= w) are confirmed by the client of group A */
+    struct stest_CS104SlavePersistentEventQueue firstRun;
+    memset(&firstRun, 0, sizeof(firstRun));
+
+    test_CS104SlavePersistentEventQueue_enqueueEvents(active, 100, 8);
+
+    test_CS104SlavePersistentEventQueue_receive(&firstRun, 8);
+
+    test_CS104SlavePersistentEventQueue_enqueueEvents(active, 200, 5);
+
+    startTime = Hal_getMonotonicTimeInMs();
+
+    while (((CS104_Slave_getNumberOfQueueEntries(standby, standbyGroupA) != 5) ||
+            (CS104_Slave_getNumberOfQueueEntries(standby, standbyGroupB) != 13)) &&
+           (Hal_getMonotonicTimeInMs() - startTime < 2000))
+        Thread_sleep(10);
+
+    int standbyEntriesA = CS104_Slave_getNumberOfQueueEntries(standby, standbyGroupA);
+    int standbyEntriesB = CS104_Slave_getNumberOfQueueEntries(standby, standbyGroupB);
+
+    CS104_Slave_stop(active);
+    CS104_Slave_destroy(active);
+
+    /* take over -> the client of group A only receives the unconfirmed ASDUs */
+    struct stest_CS104SlavePersistentEventQueue secondRun;
+    memset(&secondRun, 0, sizeof(secondRun));
+
+    CS104_Slave_start(standby);
+
+    test_CS104SlavePersistentEventQueue_receive(&secondRun, 5);
+
+    CS104_Slave_stop(standby);
+    CS104_Slave_destroy(standby);
+
+    TEST_ASSERT_TRUE(standbyConnected);
+    TEST_ASSERT_EQUAL_INT(8, firstRun.receivedASDUs);
+
+    TEST_ASSERT_EQUAL_INT(5, standbyEntriesA);
+    TEST_ASSERT_EQUAL_INT(13, standbyEntriesB);
+
+    TEST_ASSERT_EQUAL_INT(5, secondRun.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(200, secondRun.firstIOA);
+    TEST_ASSERT_EQUAL_INT(204, secondRun.lastIOA);
+}
+
 struct sTestMessageQueueEntryInfo
 {
-    uint64_t entryTimestamp;
-    unsigned int entryState : 2;
-    unsigned int size : 8;
+    unsigned int size : 8;
+    unsigned int checksum : 24;
+};
+
+void
+test_CS104SlaveQueueMemoryUsage()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    /* byte budget instead of entry count */
+    CS104_Slave_setEventQueueMemorySize(slave, 4096);
+
+    struct sCS104_QueueMemoryUsage usageBeforeStart;
+    bool resultBeforeStart = CS104_Slave_getQueueMemoryUsage(slave, &usageBeforeStart);
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+
+    struct sCS104_QueueMemoryUsage usage;
+    bool result = CS104_Slave_getQueueMemoryUsage(slave, &usage);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    /* ASDU (12 bytes) + entry header */
+    int entrySize = sizeof(struct sTestMessageQueueEntryInfo) + 12;
+
+    TEST_ASSERT_FALSE(resultBeforeStart);
+    TEST_ASSERT_TRUE(result);
+    TEST_ASSERT_EQUAL_INT(4096, usage.bufferSize);
+    TEST_ASSERT_EQUAL_INT(4096 / entrySize, usage.numberOfEntries);
+    TEST_ASSERT_EQUAL_INT((4096 / entrySize) * entrySize, usage.usedBytes);
+}
+
+static void
+fillEventQueue(CS104_Slave slave, int count, int ioaModulo)
+{
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    for (int i = 0; i < count; i++)
+    {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io =
+            (InformationObject)MeasuredValueScaled_create(NULL, 100 + (i % ioaModulo), i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+}
+
+void
+test_CS104SlaveQueueOverflowPolicy()
+{
+    int entrySize = sizeof(struct sTestMessageQueueEntryInfo) + 12;
+    int capacity = 4096 / entrySize;
+
+    /* no client confirms the events -> queue is full after "capacity" ASDUs */
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueMemorySize(slave, 4096);
+    CS104_Slave_setQueueOverflowPolicy(slave, CS104_QUEUE_OVERFLOW_DROP_NEWEST, 0);
+
+    CS104_Slave_start(slave);
+
+    fillEventQueue(slave, 1000, 1000);
+
+    struct sCS104_QueueStatistics dropNewest;
+    bool result = CS104_Slave_getQueueStatistics(slave, NULL, &dropNewest);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(result);
+    TEST_ASSERT_EQUAL_INT(capacity, (int)dropNewest.enqueuedASDUs);
+    TEST_ASSERT_EQUAL_INT(1000 - capacity, (int)dropNewest.droppedASDUs);
+    TEST_ASSERT_EQUAL_INT(0, (int)dropNewest.coalescedASDUs);
+    TEST_ASSERT_EQUAL_INT(capacity, dropNewest.pendingASDUs);
+    TEST_ASSERT_EQUAL_INT(capacity, dropNewest.maxPendingASDUs);
+    TEST_ASSERT_EQUAL_INT(capacity * entrySize, dropNewest.pendingBytes);
+
+    /* updates of 50 data points -> later updates replace the waiting ASDUs */
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueMemorySize(slave, 4096);
+    CS104_Slave_setQueueOverflowPolicy(slave, CS104_QUEUE_OVERFLOW_COALESCE, 0);
+
+    CS104_Slave_start(slave);
+
+    fillEventQueue(slave, 1000, 50);
+
+    struct sCS104_QueueStatistics coalesce;
+    CS104_Slave_getQueueStatistics(slave, NULL, &coalesce);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(1000, (int)coalesce.enqueuedASDUs);
+    TEST_ASSERT_EQUAL_INT(1000 - capacity, (int)coalesce.coalescedASDUs);
+    TEST_ASSERT_EQUAL_INT(0, (int)coalesce.droppedASDUs);
+    TEST_ASSERT_EQUAL_INT(capacity, coalesce.pendingASDUs);
+
+    /* default policy -> oldest ASDUs are overwritten */
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueMemorySize(slave, 4096);
+
+    CS104_Slave_start(slave);
+
+    fillEventQueue(slave, 1000, 1000);
+
+    struct sCS104_QueueStatistics dropOldest;
+    CS104_Slave_getQueueStatistics(slave, NULL, &dropOldest);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(1000, (int)dropOldest.enqueuedASDUs);
+    TEST_ASSERT_EQUAL_INT(1000 - capacity, (int)dropOldest.droppedASDUs);
+    TEST_ASSERT_EQUAL_INT(capacity, dropOldest.pendingASDUs);
+    TEST_ASSERT_EQUAL_INT(capacity, dropOldest.maxPendingASDUs);
+}
+
+struct stest_CS104SlaveQueueOverflowBlock
+{
+    CS104_Slave slave;
+    bool enqueued;
+    bool finished;
+    uint64_t waitTime;
+};
+
+static void*
+test_CS104SlaveQueueOverflowBlock_producerThread(void* parameter)
+{
+    struct stest_CS104SlaveQueueOverflowBlock* info = (struct stest_CS104SlaveQueueOverflowBlock*)parameter;
+
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(info->slave), false, CS101_COT_SPONTANEOUS,
+                                        0, 1, false, false);
+
+    InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 5000, 0, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+
+    InformationObject_destroy(io);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    info->enqueued = CS104_Slave_enqueueASDU(info->slave, asdu);
+    info->waitTime = Hal_getMonotonicTimeInMs() - startTime;
+    info->finished = true;
+
+    CS101_ASDU_destroy(asdu);
+
+    return NULL;
+}
+
+void
+test_CS104SlaveQueueOverflowBlock()
+{
+    int entrySize = sizeof(struct sTestMessageQueueEntryInfo) + 12;
+    int capacity = 4096 / entrySize;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueMemorySize(slave, 4096);
+    CS104_Slave_setQueueOverflowPolicy(slave, CS104_QUEUE_OVERFLOW_BLOCK, 200);
+
+    CS104_Slave_start(slave);
+
+    fillEventQueue(slave, capacity, capacity);
+
+    /* no client confirms the events -> rejected after the timeout */
+    struct stest_CS104SlaveQueueOverflowBlock timeoutInfo;
+    memset(&timeoutInfo, 0, sizeof(timeoutInfo));
+    timeoutInfo.slave = slave;
+
+    test_CS104SlaveQueueOverflowBlock_producerThread(&timeoutInfo);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_FALSE(timeoutInfo.enqueued);
+    TEST_ASSERT_TRUE(timeoutInfo.waitTime >= 200);
+
+    /* the producer is woken up when a client confirms the events */
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueMemorySize(slave, 4096);
+    CS104_Slave_setQueueOverflowPolicy(slave, CS104_QUEUE_OVERFLOW_BLOCK, 10000);
+
+    CS104_Slave_start(slave);
+
+    fillEventQueue(slave, capacity, capacity);
+
+    struct stest_CS104SlaveQueueOverflowBlock info;
+    memset(&info, 0, sizeof(info));
+    info.slave = slave;
+
+    Thread producer = Thread_create(test_CS104SlaveQueueOverflowBlock_producerThread, &info, false);
+    Thread_start(producer);
+
+    Thread_sleep(300);
+
+    bool blocked = (info.finished == false);
+
+    struct stest_CS104SlavePersistentEventQueue receiverInfo;
+    memset(&receiverInfo, 0, sizeof(receiverInfo));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlavePersistentEventQueue_asduReceivedHandler, &receiverInfo);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+        CS104_Connection_sendStartDT(con);
+
+    Thread_destroy(producer);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(blocked);
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_TRUE(info.enqueued);
+    TEST_ASSERT_TRUE(info.waitTime >= 300);
+    TEST_ASSERT_TRUE(info.waitTime < 5000);
+}
+
+void
+test_CS104SlaveQueueOldestPendingAge()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    struct sCS104_QueueStatistics emptyStats;
+    CS104_Slave_getQueueStatistics(slave, NULL, &emptyStats);
+
+    fillEventQueue(slave, 1, 1);
+
+    Thread_sleep(300);
+
+    /* newer events don't change the age of the oldest event */
+    fillEventQueue(slave, 50, 50);
+
+    struct sCS104_QueueStatistics stats;
+    CS104_Slave_getQueueStatistics(slave, NULL, &stats);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(0, (int)emptyStats.oldestPendingAge);
+    TEST_ASSERT_EQUAL_INT(51, stats.pendingASDUs);
+    TEST_ASSERT_TRUE(stats.oldestPendingAge >= 290);
+    TEST_ASSERT_TRUE(stats.oldestPendingAge < 2000);
+}
+
+void
+test_CS104SlaveLatestValueCoalescing()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setLatestValueCoalescing(slave, M_ME_NB_1, true);
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    /* 100 updates of a measured value and 5 updates of a single point */
+    for (int i = 0; i < 100; i++)
+    {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, i, IEC60870_QUALITY_GOOD);
+
+        if ((i % 20) == 0)
+        {
+            InformationObject_destroy(io);
+            io = (InformationObject)SinglePointInformation_create(NULL, 120, (i % 40) == 0, IEC60870_QUALITY_GOOD);
+        }
+
+        CS101_ASDU_addInformationObject(asdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+
+    struct sCS104_QueueStatistics stats;
+    CS104_Slave_getQueueStatistics(slave, NULL, &stats);
+
+    struct stest_CS104SlaveEventQueue1 info = {0, 0, 0};
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveEventQueue1_asduReceivedHandler, &info);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(500);
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(100, (int)stats.enqueuedASDUs);
+    TEST_ASSERT_EQUAL_INT(94, (int)stats.coalescedASDUs);
+    TEST_ASSERT_EQUAL_INT(6, stats.pendingASDUs);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(6, info.spontCount);
+    TEST_ASSERT_EQUAL_INT(99, info.lastScaledValue);
+}
+
+void
+test_CS104SlaveLatestValueCoalescingPersistent()
+{
+    const char* journalFile = "test_event_queue_coalescing.journal";
+
+    remove(journalFile);
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+    CS104_Slave_setLatestValueCoalescing(slave, M_ME_NB_1, true);
+    CS104_Slave_setCoalescingCapacity(slave, 10);
+
+    CS104_Slave_start(slave);
+
+    /* 20 updates of the same data point -> the waiting entry is replaced in the journal */
+    fillEventQueue(slave, 20, 1);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setEventQueueFile(slave, journalFile, false);
+
+    CS104_Slave_start(slave);
+
+    int restoredEntries = CS104_Slave_getNumberOfQueueEntries(slave, NULL);
+
+    struct stest_CS104SlaveEventQueue1 info = {0, 0, 0};
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveEventQueue1_asduReceivedHandler, &info);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(500);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    remove(journalFile);
+
+    TEST_ASSERT_EQUAL_INT(1, restoredEntries);
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(1, info.spontCount);
+    TEST_ASSERT_EQUAL_INT(19, info.lastScaledValue);
+}
+
+struct stest_CS104SlaveStationDatabase
+{
+    int actConCount;
+    int actTermCount;
+    int dataAsduCount;
+    int dataPointCount;
+    int sequenceCount;
+    int spontCount;
+    int readCount;
+    int lastReadValue;
+};
+
+static bool
+test_CS104SlaveStationDatabase_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveStationDatabase* info = (struct stest_CS104SlaveStationDatabase*)parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == C_IC_NA_1)
+    {
+        if (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION_CON)
+            info->actConCount++;
+        else if (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION_TERMINATION)
+            info->actTermCount++;
+    }
+    else if (CS101_ASDU_getCOT(asdu) == CS101_COT_INTERROGATED_BY_STATION)
+    {
+        info->dataAsduCount++;
+        info->dataPointCount += CS101_ASDU_getNumberOfElements(asdu);
+
+        if (CS101_ASDU_isSequence(asdu))
+            info->sequenceCount++;
+    }
+    else if (CS101_ASDU_getCOT(asdu) == CS101_COT_SPONTANEOUS)
+    {
+        info->spontCount++;
+    }
+    else if (CS101_ASDU_getCOT(asdu) == CS101_COT_REQUEST)
+    {
+        if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1)
+        {
+            MeasuredValueScaled mv = (MeasuredValueScaled)CS101_ASDU_getElement(asdu, 0);
+
+            info->readCount++;
+            info->lastReadValue = MeasuredValueScaled_getValue(mv);
+
+            MeasuredValueScaled_destroy(mv);
+        }
+    }
+
+    return true;
+}
+
+void
+test_CS104SlaveStationDatabase()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS101_StationDatabase db = CS101_StationDatabase_create(CS104_Slave_getAppLayerParameters(slave));
+
+    TEST_ASSERT_TRUE(CS101_StationDatabase_addPoints(db, 1, M_SP_NA_1, 100, 200, 1, true));
+    TEST_ASSERT_TRUE(CS101_StationDatabase_addPoints(db, 1, M_ME_NB_1, 1000, 50, 2, true));
+    TEST_ASSERT_FALSE(CS101_StationDatabase_addPoints(db, 1, M_DP_NA_1, 150, 10, 0, false));
+    TEST_ASSERT_FALSE(CS101_StationDatabase_addPoints(db, 1, C_SC_NA_1, 5000, 10, 0, false));
+
+    CS104_Slave_setStationDatabase(slave, db);
+
+    CS104_Slave_start(slave);
+
+    struct stest_CS104SlaveStationDatabase info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveStationDatabase_asduReceivedHandler, &info);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(100);
+
+        /* changed value -> spontaneous event, same value again -> no event */
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 1010, 42, IEC60870_QUALITY_GOOD);
+        CS101_StationDatabase_update(db, 1, io);
+        CS101_StationDatabase_update(db, 1, io);
+        InformationObject_destroy(io);
+
+        /* unknown point */
+        io = (InformationObject)MeasuredValueScaled_create(NULL, 2000, 42, IEC60870_QUALITY_GOOD);
+        TEST_ASSERT_FALSE(CS101_StationDatabase_update(db, 1, io));
+        InformationObject_destroy(io);
+
+        CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+        Thread_sleep(200);
+
+        CS104_Connection_sendReadCommand(con, 1, 1010);
+
+        Thread_sleep(200);
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    CS101_StationDatabase_destroy(db);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(1, info.actConCount);
+    TEST_ASSERT_EQUAL_INT(1, info.actTermCount);
+    TEST_ASSERT_EQUAL_INT(250, info.dataPointCount);
+    TEST_ASSERT_EQUAL_INT(info.dataAsduCount, info.sequenceCount);
+    TEST_ASSERT_TRUE(info.dataAsduCount < 10);
+    TEST_ASSERT_EQUAL_INT(1, info.spontCount);
+    TEST_ASSERT_EQUAL_INT(1, info.readCount);
+    TEST_ASSERT_EQUAL_INT(42, info.lastReadValue);
+}
+
+struct stest_CS104SlaveInterrogationStreaming
+{
+    CS101_AppLayerParameters alParams;
+    sCS101_StaticASDU asdu;
+    int ca;
+    int nextValue;
+    int count;
+    bool finished;
+    int actConCount;
+    int actTermCount;
+    int receivedCount;
+    int lastValue;
+};
+
+static bool
+test_CS104SlaveInterrogationStreaming_interrogationHandler(void* parameter, IMasterConnection connection,
+                                                          CS101_ASDU asdu, uint8_t qoi)
+{
+    struct stest_CS104SlaveInterrogationStreaming* info = (struct stest_CS104SlaveInterrogationStreaming*)parameter;
+
+    info->ca = CS101_ASDU_getCA(asdu);
+    info->nextValue = 0;
+    info->finished = false;
+
+    IMasterConnection_sendACT_CON(connection, asdu, false);
+
+    return true;
+}
+
+static CS101_ASDU
+test_CS104SlaveInterrogationStreaming_getNextASDU(void* parameter, IMasterConnection connection)
+{
+    struct stest_CS104SlaveInterrogationStreaming* info = (struct stest_CS104SlaveInterrogationStreaming*)parameter;
+
+    if (info->finished)
+        return NULL;
+
+    if (info->nextValue == info->count)
+    {
+        info->finished = true;
+
+        CS101_ASDU asdu = CS101_ASDU_initializeStatic(&(info->asdu), info->alParams, false,
+                                                      CS101_COT_ACTIVATION_TERMINATION, 0, info->ca, false, false);
+
+        InterrogationCommand irc = InterrogationCommand_create(NULL, 0, IEC60870_QOI_STATION);
+        CS101_ASDU_addInformationObject(asdu, (InformationObject)irc);
+        InterrogationCommand_destroy(irc);
+
+        return asdu;
+    }
+
+    CS101_ASDU asdu = CS101_ASDU_initializeStatic(&(info->asdu), info->alParams, false,
+                                                  CS101_COT_INTERROGATED_BY_STATION, 0, info->ca, false, false);
+
+    InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 1000 + info->nextValue,
+                                                                         info->nextValue, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    info->nextValue++;
+
+    return asdu;
+}
+
+static bool
+test_CS104SlaveInterrogationStreaming_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveInterrogationStreaming* info = (struct stest_CS104SlaveInterrogationStreaming*)parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == C_IC_NA_1)
+    {
+        if (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION_CON)
+            info->actConCount++;
+        else if (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION_TERMINATION)
+            info->actTermCount++;
+    }
+    else if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1)
+    {
+        MeasuredValueScaled mv = (MeasuredValueScaled)CS101_ASDU_getElement(asdu, 0);
+
+        /* ACT_TERM is only expected after the last data ASDU */
+        if (info->actTermCount == 0)
+            info->receivedCount++;
+
+        info->lastValue = MeasuredValueScaled_getValue(mv);
+
+        MeasuredValueScaled_destroy(mv);
+    }
+
+    return true;
+}
+
+void
+test_CS104SlaveInterrogationStreaming()
+{
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    struct stest_CS104SlaveInterrogationStreaming info;
+    memset(&info, 0, sizeof(info));
+
+    info.alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    /* much more ASDUs than fit into the high-priority queue */
+    info.count = 5000;
+
+    CS104_Slave_setInterrogationHandler(slave, test_CS104SlaveInterrogationStreaming_interrogationHandler, &info);
+    CS104_Slave_setGetNextInterrogationASDUHandler(slave, test_CS104SlaveInterrogationStreaming_getNextASDU, &info);
+
+    CS104_Slave_start(slave);
+
+    struct stest_CS104SlaveInterrogationStreaming received;
+    memset(&received, 0, sizeof(received));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveInterrogationStreaming_asduReceivedHandler,
+                                            &received);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(100);
+
+        CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+        for (int i = 0; i < 100; i++)
+        {
+            if (received.actTermCount > 0)
+                break;
+
+            Thread_sleep(50);
+        }
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(1, received.actConCount);
+    TEST_ASSERT_EQUAL_INT(1, received.actTermCount);
+    TEST_ASSERT_EQUAL_INT(5000, received.receivedCount);
+    TEST_ASSERT_EQUAL_INT(4999, received.lastValue);
+}
+
+struct stest_StationDatabaseDeadband
+{
+    int asduCount;
+    int eventCount;
+    IEC60870_5_TypeID lastTypeId;
+};
+
+static bool
+test_StationDatabaseDeadband_eventHandler(void* parameter, CS101_ASDU asdu)
+{
+    struct stest_StationDatabaseDeadband* info = (struct stest_StationDatabaseDeadband*)parameter;
+
+    info->asduCount++;
+    info->eventCount += CS101_ASDU_getNumberOfElements(asdu);
+    info->lastTypeId = CS101_ASDU_getTypeID(asdu);
+
+    return true;
+}
+
+void
+test_StationDatabaseDeadband()
+{
+    CS101_StationDatabase db = CS101_StationDatabase_create(&defaultAppLayerParameters);
+
+    struct stest_StationDatabaseDeadband info;
+    memset(&info, 0, sizeof(info));
+
+    CS101_StationDatabase_setEventHandler(db, test_StationDatabaseDeadband_eventHandler, &info);
+
+    TEST_ASSERT_TRUE(CS101_StationDatabase_addPoints(db, 1, M_ME_NC_1, 1, 1000, 0, true));
+    TEST_ASSERT_TRUE(CS101_StationDatabase_addPoints(db, 1, M_ME_NB_1, 2001, 10, 0, true));
+    TEST_ASSERT_TRUE(CS101_StationDatabase_addPoints(db, 1, M_ME_NC_1, 3001, 5, 0, true));
+    TEST_ASSERT_TRUE(CS101_StationDatabase_addPoints(db, 1, M_SP_NA_1, 4001, 5, 0, true));
+
+    TEST_ASSERT_TRUE(CS101_StationDatabase_setDeadband(db, 1, 1, 1000, CS101_DEADBAND_ABSOLUTE, 1.0f, 0));
+    TEST_ASSERT_TRUE(CS101_StationDatabase_setDeadband(db, 1, 2001, 10, CS101_DEADBAND_INTEGRATED, 100.0f, 0));
+    TEST_ASSERT_TRUE(CS101_StationDatabase_setDeadband(db, 1, 3001, 5, CS101_DEADBAND_NONE, 0.0f, 100));
+    TEST_ASSERT_FALSE(CS101_StationDatabase_setDeadband(db, 1, 4001, 5, CS101_DEADBAND_ABSOLUTE, 1.0f, 0));
+    TEST_ASSERT_FALSE(CS101_StationDatabase_setDeadband(db, 1, 995, 10, CS101_DEADBAND_ABSOLUTE, 1.0f, 0));
+
+    float values[1000];
+
+    for (int i = 0; i < 1000; i++)
+        values[i] = (float)i;
+
+    /* first update -> quality changes from invalid to good */
+    TEST_ASSERT_EQUAL_INT(1000, CS101_StationDatabase_updateMeasuredValues(db, 1, 1, 1000, values, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(1000, info.eventCount);
+    TEST_ASSERT_TRUE(info.asduCount < 100);
+    TEST_ASSERT_EQUAL_INT(M_ME_NC_1, info.lastTypeId);
+
+    /* changes within the deadband */
+    for (int i = 0; i < 1000; i++)
+        values[i] += 0.5f;
+
+    TEST_ASSERT_EQUAL_INT(0, CS101_StationDatabase_updateMeasuredValues(db, 1, 1, 1000, values, NULL, NULL));
+
+    /* half of the points leave the deadband */
+    for (int i = 0; i < 1000; i += 2)
+        values[i] += 1.0f;
+
+    struct sCP56Time2a timestamp;
+    CP56Time2a_createFromMsTimestamp(&timestamp, Hal_getTimeInMs());
+
+    info.eventCount = 0;
+    TEST_ASSERT_EQUAL_INT(500, CS101_StationDatabase_updateMeasuredValues(db, 1, 1, 1000, values, NULL, &timestamp));
+    TEST_ASSERT_EQUAL_INT(500, info.eventCount);
+    TEST_ASSERT_EQUAL_INT(M_ME_TF_1, info.lastTypeId);
+
+    /* quality change is always reported */
+    QualityDescriptor qualities[1000];
+    memset(qualities, 0, sizeof(qualities));
+    qualities[10] = IEC60870_QUALITY_NON_TOPICAL;
+
+    TEST_ASSERT_EQUAL_INT(1, CS101_StationDatabase_updateMeasuredValues(db, 1, 1, 1000, values, qualities, NULL));
+
+    /* single updates use the same filter */
+    InformationObject io = (InformationObject)MeasuredValueShort_create(NULL, 20, values[19] + 0.2f, IEC60870_QUALITY_GOOD);
+    info.eventCount = 0;
+    TEST_ASSERT_TRUE(CS101_StationDatabase_update(db, 1, io));
+    TEST_ASSERT_EQUAL_INT(0, info.eventCount);
+    InformationObject_destroy(io);
+
+    /* integrated deadband: small deviation is reported after some time */
+    float scaled[10] = {0};
+
+    TEST_ASSERT_EQUAL_INT(10, CS101_StationDatabase_updateMeasuredValues(db, 1, 2001, 10, scaled, NULL, NULL));
+
+    for (int i = 0; i < 10; i++)
+        scaled[i] = 500.0f;
+
+    TEST_ASSERT_EQUAL_INT(0, CS101_StationDatabase_updateMeasuredValues(db, 1, 2001, 10, scaled, NULL, NULL));
+
+    Thread_sleep(300);
+
+    TEST_ASSERT_EQUAL_INT(10, CS101_StationDatabase_updateMeasuredValues(db, 1, 2001, 10, scaled, NULL, NULL));
+
+    /* maximum report interval */
+    float unchanged[5] = {0};
+
+    TEST_ASSERT_EQUAL_INT(5, CS101_StationDatabase_updateMeasuredValues(db, 1, 3001, 5, unchanged, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, CS101_StationDatabase_updateMeasuredValues(db, 1, 3001, 5, unchanged, NULL, NULL));
+
+    Thread_sleep(150);
+
+    TEST_ASSERT_EQUAL_INT(5, CS101_StationDatabase_updateMeasuredValues(db, 1, 3001, 5, unchanged, NULL, NULL));
+
+    /* not a range of measured values */
+    TEST_ASSERT_EQUAL_INT(-1, CS101_StationDatabase_updateMeasuredValues(db, 1, 4001, 5, unchanged, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, CS101_StationDatabase_updateMeasuredValues(db, 1, 998, 5, unchanged, NULL, NULL));
+
+    CS101_StationDatabase_destroy(db);
+}
+
+static bool
+test_CS104SlaveMetrics_interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu,
+                                            uint8_t qoi)
+{
+    IMasterConnection_sendACT_CON(connection, asdu, false);
+    IMasterConnection_sendACT_TERM(connection, asdu);
+
+    return true;
+}
+
+static void
+test_CS104SlaveMetrics_connectionEventHandler(void* parameter, IMasterConnection connection,
+                                              CS104_PeerConnectionEvent event)
+{
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+        *((IMasterConnection*)parameter) = connection;
+}
+
+void
+test_CS104SlaveMetrics()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    IMasterConnection openedConnection = NULL;
+
+    CS104_Slave_setInterrogationHandler(slave, test_CS104SlaveMetrics_interrogationHandler, NULL);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104SlaveMetrics_connectionEventHandler, &openedConnection);
+
+    CS104_Slave_start(slave);
+
+    struct sCS104_ConnectionMetrics conMetrics;
+    struct sCS104_ConnectionMetrics totalMetrics;
+    struct sCS104_ConnectionMetrics closedMetrics;
+
+    memset(&conMetrics, 0, sizeof(conMetrics));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    bool connected = CS104_Connection_connect(con);
+
+    bool conMetricsFound = false;
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(100);
+
+        CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+        Thread_sleep(200);
+
+        conMetricsFound = CS104_Slave_getConnectionMetrics(slave, openedConnection, &conMetrics);
+
+        CS104_Slave_getRedundancyGroupMetrics(slave, NULL, &totalMetrics);
+
+        CS104_Connection_close(con);
+
+        Thread_sleep(200);
+    }
+
+    CS104_Connection_destroy(con);
+
+    /* counters of closed connections are kept in the totals */
+    CS104_Slave_getRedundancyGroupMetrics(slave, NULL, &closedMetrics);
+
+    bool closedConnectionFound = CS104_Slave_getConnectionMetrics(slave, openedConnection, &conMetrics);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_TRUE(conMetricsFound);
+    TEST_ASSERT_FALSE(closedConnectionFound);
+
+    TEST_ASSERT_EQUAL_INT(1, (int)conMetrics.iFramesReceived);
+    TEST_ASSERT_EQUAL_INT(2, (int)conMetrics.iFramesSent);
+    TEST_ASSERT_EQUAL_INT(1, (int)conMetrics.uFramesReceived);
+    TEST_ASSERT_EQUAL_INT(1, (int)conMetrics.uFramesSent);
+    TEST_ASSERT_EQUAL_INT(6 + 16, (int)conMetrics.bytesReceived);
+    TEST_ASSERT_EQUAL_INT(6 + 2 * 16, (int)conMetrics.bytesSent);
+    TEST_ASSERT_EQUAL_INT(0, (int)conMetrics.t1Timeouts);
+    TEST_ASSERT_EQUAL_INT(0, conMetrics.highPrioQueueDepth);
+
+    TEST_ASSERT_EQUAL_INT((int)conMetrics.iFramesSent, (int)totalMetrics.iFramesSent);
+    TEST_ASSERT_EQUAL_INT((int)conMetrics.iFramesSent, (int)closedMetrics.iFramesSent);
+    TEST_ASSERT_TRUE(closedMetrics.bytesReceived >= conMetrics.bytesReceived);
+    TEST_ASSERT_EQUAL_INT(0, closedMetrics.unconfirmedIFrames);
+}
+
+void
+test_CS104SlaveLatencyHistograms()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    IMasterConnection openedConnection = NULL;
+
+    CS104_Slave_setInterrogationHandler(slave, test_CS104SlaveMetrics_interrogationHandler, NULL);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104SlaveMetrics_connectionEventHandler, &openedConnection);
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+        CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(newAsdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, newAsdu);
+
+        CS101_ASDU_destroy(newAsdu);
+    }
+
+    /* the events are waiting in the queue until a client is connected */
+    Thread_sleep(100);
+
+    struct sCS104_LatencyHistogram queueWait;
+    struct sCS104_LatencyHistogram ackRtt;
+    struct sCS104_LatencyHistogram endToEnd;
+
+    memset(&queueWait, 0, sizeof(queueWait));
+    memset(&ackRtt, 0, sizeof(ackRtt));
+    memset(&endToEnd, 0, sizeof(endToEnd));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    bool connected = CS104_Connection_connect(con);
+
+    bool histogramsFound = false;
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(200);
+
+        /* the I frame confirms all received events */
+        CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+        Thread_sleep(200);
+
+        histogramsFound = CS104_Slave_getConnectionLatency(slave, openedConnection, CS104_LATENCY_QUEUE_WAIT, &queueWait);
+        histogramsFound &= CS104_Slave_getConnectionLatency(slave, openedConnection, CS104_LATENCY_ACK_RTT, &ackRtt);
+        histogramsFound &= CS104_Slave_getConnectionLatency(slave, openedConnection, CS104_LATENCY_END_TO_END, &endToEnd);
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_TRUE(histogramsFound);
+
+    TEST_ASSERT_EQUAL_INT(10, (int)queueWait.count);
+    TEST_ASSERT_TRUE(queueWait.min >= 100);
+    TEST_ASSERT_TRUE(queueWait.max >= queueWait.min);
+
+    /* latencies are measured with the monotonic clock -> no wrapped (negative) values */
+    TEST_ASSERT_TRUE(queueWait.max < 10000);
+    TEST_ASSERT_TRUE(endToEnd.max < 10000);
+
+    /* ACT_CON and ACT_TERM of the interrogation are not yet confirmed */
+    TEST_ASSERT_EQUAL_INT(10, (int)ackRtt.count);
+    TEST_ASSERT_TRUE(ackRtt.max < 10000);
+
+    TEST_ASSERT_EQUAL_INT(10, (int)endToEnd.count);
+    TEST_ASSERT_TRUE(endToEnd.min >= queueWait.min);
+
+    TEST_ASSERT_TRUE(CS104_LatencyHistogram_getPercentile(&queueWait, 0.0) >= 100);
+    TEST_ASSERT_TRUE(CS104_LatencyHistogram_getPercentile(&endToEnd, 99.0) <= endToEnd.max);
+}
+
+void
+test_CS104LatencyHistogramBuckets()
+{
+    struct sCS104_LatencyHistogram histogram;
+
+    memset(&histogram, 0, sizeof(histogram));
+
+    TEST_ASSERT_EQUAL_UINT32(0, CS104_LatencyHistogram_getBucketLimit(0));
+    TEST_ASSERT_EQUAL_UINT32(15, CS104_LatencyHistogram_getBucketLimit(15));
+    TEST_ASSERT_EQUAL_UINT32(17, CS104_LatencyHistogram_getBucketLimit(16));
+    TEST_ASSERT_EQUAL_UINT32(31, CS104_LatencyHistogram_getBucketLimit(23));
+    TEST_ASSERT_EQUAL_UINT32(35, CS104_LatencyHistogram_getBucketLimit(24));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, CS104_LatencyHistogram_getBucketLimit(CS104_LATENCY_HISTOGRAM_BUCKETS - 1));
+
+    int i;
+
+    for (i = 1; i < CS104_LATENCY_HISTOGRAM_BUCKETS; i++)
+        TEST_ASSERT_TRUE(CS104_LatencyHistogram_getBucketLimit(i) > CS104_LatencyHistogram_getBucketLimit(i - 1));
+
+    TEST_ASSERT_EQUAL_UINT32(0, CS104_LatencyHistogram_getPercentile(&histogram, 50.0));
+
+    /* 90 values of 5 ms and 10 values of 1000 ms (bucket 960 - 1023) */
+    histogram.count = 100;
+    histogram.min = 5;
+    histogram.max = 1000;
+    histogram.buckets[5] = 90;
+    histogram.buckets[16 + 5 * 8 + 7] = 10;
+
+    TEST_ASSERT_EQUAL_UINT32(5, CS104_LatencyHistogram_getPercentile(&histogram, 50.0));
+    TEST_ASSERT_EQUAL_UINT32(5, CS104_LatencyHistogram_getPercentile(&histogram, 90.0));
+    TEST_ASSERT_EQUAL_UINT32(1000, CS104_LatencyHistogram_getPercentile(&histogram, 99.0));
+}
+
+void
+test_CS104TimerWheelInsertAndAdvance()
+{
+    struct sTimerWheel wheel;
+    struct sTimerWheelEntry entry1;
+    struct sTimerWheelEntry entry2;
+
+    TimerWheel_init(&wheel, 1000);
+    TimerWheelEntry_init(&entry1, NULL);
+    TimerWheelEntry_init(&entry2, NULL);
+
+    TEST_ASSERT_TRUE(TimerWheel_getNextEventTime(&wheel) == UINT64_MAX);
+    TEST_ASSERT_EQUAL_UINT(100, TimerWheel_getWaitTime(&wheel, 1000, 100));
+
+    TimerWheel_add(&wheel, &entry1, 1005);
+    TimerWheel_add(&wheel, &entry2, 1010);
+
+    TEST_ASSERT_TRUE(TimerWheelEntry_isArmed(&entry1));
+    TEST_ASSERT_EQUAL_INT(2, wheel.numberOfEntries);
+    TEST_ASSERT_TRUE(TimerWheel_getNextEventTime(&wheel) == 1005);
+    TEST_ASSERT_EQUAL_UINT(5, TimerWheel_getWaitTime(&wheel, 1000, 100));
+    TEST_ASSERT_EQUAL_UINT(3, TimerWheel_getWaitTime(&wheel, 1000, 3));
+
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, 1004));
+    TEST_ASSERT_TRUE(TimerWheelEntry_isArmed(&entry1));
+
+    TEST_ASSERT_EQUAL_INT(1, TimerWheel_advance(&wheel, 1005));
+    TEST_ASSERT_FALSE(TimerWheelEntry_isArmed(&entry1));
+    TEST_ASSERT_TRUE(TimerWheelEntry_isArmed(&entry2));
+    TEST_ASSERT_EQUAL_UINT(0, TimerWheel_getWaitTime(&wheel, 1012, 100));
+
+    /* an expired entry is handled with the next time step */
+    TimerWheel_add(&wheel, &entry1, 900);
+    TEST_ASSERT_TRUE(TimerWheel_getNextEventTime(&wheel) == 1006);
+
+    TEST_ASSERT_EQUAL_INT(2, TimerWheel_advance(&wheel, 1020));
+    TEST_ASSERT_EQUAL_INT(0, wheel.numberOfEntries);
+    TEST_ASSERT_TRUE(TimerWheel_getNextEventTime(&wheel) == UINT64_MAX);
+}
+
+void
+test_CS104TimerWheelCascading()
+{
+    struct sTimerWheel wheel;
+    struct sTimerWheelEntry level2Entry;
+    struct sTimerWheelEntry level3Entry;
+    struct sTimerWheelEntry outOfRangeEntry;
+
+    TimerWheel_init(&wheel, 0);
+    TimerWheelEntry_init(&level2Entry, NULL);
+    TimerWheelEntry_init(&level3Entry, NULL);
+    TimerWheelEntry_init(&outOfRangeEntry, NULL);
+
+    TimerWheel_add(&wheel, &level2Entry, 5000);
+    TimerWheel_add(&wheel, &level3Entry, 300000);
+    TimerWheel_add(&wheel, &outOfRangeEntry, TIMER_WHEEL_MAX_RANGE + 100);
+
+    TEST_ASSERT_TRUE((level2Entry.slot >= &(wheel.slots[2][0])) &&
+                     (level2Entry.slot <= &(wheel.slots[2][TIMER_WHEEL_SLOT_MASK])));
+    TEST_ASSERT_TRUE((level3Entry.slot >= &(wheel.slots[3][0])) &&
+                     (level3Entry.slot <= &(wheel.slots[3][TIMER_WHEEL_SLOT_MASK])));
+
+    /* the wheel stops at the slot boundaries to move the entries down */
+    TEST_ASSERT_TRUE(TimerWheel_getNextEventTime(&wheel) == 4096);
+
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, 4999));
+    TEST_ASSERT_TRUE(TimerWheelEntry_isArmed(&level2Entry));
+    TEST_ASSERT_TRUE(level2Entry.slot < &(wheel.slots[2][0]));
+
+    TEST_ASSERT_EQUAL_INT(1, TimerWheel_advance(&wheel, 5000));
+    TEST_ASSERT_FALSE(TimerWheelEntry_isArmed(&level2Entry));
+
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, 299999));
+    TEST_ASSERT_TRUE(TimerWheelEntry_isArmed(&level3Entry));
+
+    TEST_ASSERT_EQUAL_INT(1, TimerWheel_advance(&wheel, 300000));
+    TEST_ASSERT_FALSE(TimerWheelEntry_isArmed(&level3Entry));
+
+    /* entry beyond the range of the wheel is placed again when the end of the range is reached */
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, TIMER_WHEEL_MAX_RANGE + 99));
+    TEST_ASSERT_TRUE(TimerWheelEntry_isArmed(&outOfRangeEntry));
+
+    TEST_ASSERT_EQUAL_INT(1, TimerWheel_advance(&wheel, TIMER_WHEEL_MAX_RANGE + 100));
+    TEST_ASSERT_FALSE(TimerWheelEntry_isArmed(&outOfRangeEntry));
+    TEST_ASSERT_EQUAL_INT(0, wheel.numberOfEntries);
+}
+
+void
+test_CS104TimerWheelRemove()
+{
+    struct sTimerWheel wheel;
+    struct sTimerWheelEntry entries[3];
+
+    TimerWheel_init(&wheel, 0);
+
+    int i;
+
+    /* all entries in the same slot */
+    for (i = 0; i < 3; i++)
+    {
+        TimerWheelEntry_init(&(entries[i]), NULL);
+        TimerWheel_add(&wheel, &(entries[i]), 10);
+    }
+
+    TEST_ASSERT_EQUAL_INT(3, wheel.numberOfEntries);
+
+    /* middle and first entry of the slot list */
+    TimerWheel_remove(&wheel, &(entries[1]));
+    TimerWheel_remove(&wheel, &(entries[2]));
+
+    TEST_ASSERT_FALSE(TimerWheelEntry_isArmed(&(entries[1])));
+    TEST_ASSERT_FALSE(TimerWheelEntry_isArmed(&(entries[2])));
+    TEST_ASSERT_EQUAL_INT(1, wheel.numberOfEntries);
+
+    /* removing an entry that is not armed has no effect */
+    TimerWheel_remove(&wheel, &(entries[1]));
+    TEST_ASSERT_EQUAL_INT(1, wheel.numberOfEntries);
+
+    /* adding an armed entry moves it */
+    TimerWheel_add(&wheel, &(entries[0]), 20000);
+    TEST_ASSERT_EQUAL_INT(1, wheel.numberOfEntries);
+
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, 19999));
+    TEST_ASSERT_EQUAL_INT(1, TimerWheel_advance(&wheel, 20000));
+
+    /* removed after cascading to a lower level */
+    TimerWheel_add(&wheel, &(entries[0]), 30000);
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, 29990));
+    TimerWheel_remove(&wheel, &(entries[0]));
+
+    TEST_ASSERT_EQUAL_INT(0, wheel.numberOfEntries);
+    TEST_ASSERT_EQUAL_INT(0, TimerWheel_advance(&wheel, 40000));
+    TEST_ASSERT_TRUE(TimerWheel_getNextEventTime(&wheel) == UINT64_MAX);
+}
+
+void
+test_CS104TimerWheelRandomExpiry()
+{
+    struct sTimerWheel wheel;
+    struct sTimerWheelEntry entries[500];
+
+    uint32_t random = 12345;
+
+    TimerWheel_init(&wheel, 100);
+
+    int i;
+
+    for (i = 0; i < 500; i++)
+    {
+        random = random * 1103515245 + 12345;
+
+        TimerWheelEntry_init(&(entries[i]), NULL);
+        TimerWheel_add(&wheel, &(entries[i]), 100 + ((random >> 8) % 400000));
+    }
+
+    uint64_t currentTime = 100;
+    int expired = 0;
+
+    while (expired < 500)
+    {
+        random = random * 1103515245 + 12345;
+
+        currentTime += (random >> 8) % 5000;
+
+        expired += TimerWheel_advance(&wheel, currentTime);
+
+        /* entries expire exactly when the time reaches their expiry time */
+        for (i = 0; i < 500; i++)
+            TEST_ASSERT_EQUAL(entries[i].expiry > currentTime, TimerWheelEntry_isArmed(&(entries[i])));
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, wheel.numberOfEntries);
+}
+
+struct stest_CS104SlaveAsyncCommands
+{
+    int handlerCalls;
+    int received[16]; /* type ID * 100 + COT of the received ASDUs */
+    int receivedCount;
+    bool negativeResponse;
+};
+
+static void
+test_CS104SlaveAsyncCommands_commandHandler(void* parameter, IMasterConnection connection, CS104_CommandHandle command,
+                                            CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveAsyncCommands* info = (struct stest_CS104SlaveAsyncCommands*)parameter;
+
+    info->handlerCalls++;
+
+    /* simulate a slow process interface */
+    Thread_sleep(300);
+
+    IMasterConnection_completeCommand(command, CS104_COMMAND_ACT_CON);
+    IMasterConnection_completeCommand(command, CS104_COMMAND_ACT_TERM);
+}
+
+static bool
+test_CS104SlaveAsyncCommands_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveAsyncCommands* info = (struct stest_CS104SlaveAsyncCommands*)parameter;
+
+    if (info->receivedCount < 16)
+        info->received[info->receivedCount++] = CS101_ASDU_getTypeID(asdu) * 100 + CS101_ASDU_getCOT(asdu);
+
+    if (CS101_ASDU_isNegative(asdu))
+        info->negativeResponse = true;
+
+    return true;
+}
+
+void
+test_CS104SlaveAsyncCommands()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    struct stest_CS104SlaveAsyncCommands info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Slave_setInterrogationHandler(slave, test_CS104SlaveMetrics_interrogationHandler, NULL);
+    CS104_Slave_setAsyncCommandHandler(slave, test_CS104SlaveAsyncCommands_commandHandler, &info, 2);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveAsyncCommands_asduReceivedHandler, &info);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(100);
+
+        InformationObject sc = (InformationObject)SingleCommand_create(NULL, 5000, true, false, 0);
+
+        CS104_Connection_sendProcessCommandEx(con, CS101_COT_ACTIVATION, 1, sc);
+
+        InformationObject_destroy(sc);
+
+        Thread_sleep(50);
+
+        /* is answered while the command is executed */
+        CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+        Thread_sleep(600);
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(1, info.handlerCalls);
+    TEST_ASSERT_FALSE(info.negativeResponse);
+    TEST_ASSERT_EQUAL_INT(4, info.receivedCount);
+
+    TEST_ASSERT_EQUAL_INT(C_IC_NA_1 * 100 + CS101_COT_ACTIVATION_CON, info.received[0]);
+    TEST_ASSERT_EQUAL_INT(C_IC_NA_1 * 100 + CS101_COT_ACTIVATION_TERMINATION, info.received[1]);
+    TEST_ASSERT_EQUAL_INT(C_SC_NA_1 * 100 + CS101_COT_ACTIVATION_CON, info.received[2]);
+    TEST_ASSERT_EQUAL_INT(C_SC_NA_1 * 100 + CS101_COT_ACTIVATION_TERMINATION, info.received[3]);
+}
+
+struct stest_CS104SlaveAsyncCommandClosedConnection
+{
+    IMasterConnection handlerConnection;
+    bool responseSent;
+};
+
+static void
+test_CS104SlaveAsyncCommandClosedConnection_commandHandler(void* parameter, IMasterConnection connection,
+                                                           CS104_CommandHandle command, CS101_ASDU asdu)
+{
+    struct stest_CS104SlaveAsyncCommandClosedConnection* info =
+        (struct stest_CS104SlaveAsyncCommandClosedConnection*)parameter;
+
+    info->handlerConnection = connection;
+
+    /* the client closes the connection and a new client connects while the command is executed */
+    Thread_sleep(600);
+
+    info->responseSent = IMasterConnection_completeCommand(command, CS104_COMMAND_ACT_CON_NEGATIVE);
+}
+
+void
+test_CS104SlaveAsyncCommandClosedConnection()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    struct stest_CS104SlaveAsyncCommandClosedConnection info;
+    memset(&info, 0, sizeof(info));
+
+    info.responseSent = true;
+
+    IMasterConnection openedConnection = NULL;
+
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104SlaveMetrics_connectionEventHandler, &openedConnection);
+    CS104_Slave_setAsyncCommandHandler(slave, test_CS104SlaveAsyncCommandClosedConnection_commandHandler, &info, 1);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    bool connected = CS104_Connection_connect(con);
+
+    if (connected)
+    {
+        CS104_Connection_sendStartDT(con);
+
+        Thread_sleep(100);
+
+        InformationObject sc = (InformationObject)SingleCommand_create(NULL, 5000, true, false, 0);
+
+        CS104_Connection_sendProcessCommandEx(con, CS101_COT_ACTIVATION, 1, sc);
+
+        InformationObject_destroy(sc);
+
+        Thread_sleep(100);
+
+        CS104_Connection_close(con);
+    }
+
+    CS104_Connection_destroy(con);
+
+    Thread_sleep(100);
+
+    IMasterConnection closedConnection = openedConnection;
+
+    CS104_Connection con2 = CS104_Connection_create("127.0.0.1", 20004);
+
+    bool connected2 = CS104_Connection_connect(con2);
+
+    Thread_sleep(100);
+
+    /* the connection object of the running handler is not reused for the new client */
+    IMasterConnection newConnection = openedConnection;
+
+    Thread_sleep(600);
+
+    CS104_Connection_destroy(con2);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_TRUE(connected2);
+    TEST_ASSERT_TRUE(info.handlerConnection == closedConnection);
+    TEST_ASSERT_TRUE(newConnection != closedConnection);
+    TEST_ASSERT_FALSE(info.responseSent);
+}
+
+void
+test_CS104SlaveDynamicConnectionTable()
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setThreadingModel(slave, CS104_THREADING_MODEL_EVENT_LOOP, 2);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    /* more connections than the default maximum */
+    CS104_Slave_setMaxOpenConnections(slave, 150);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection cons[130];
+
+    int i;
+
+    int connected = 0;
+
+    for (i = 0; i < 120; i++)
+    {
+        cons[i] = CS104_Connection_create("127.0.0.1", 20004);
+
+        if (CS104_Connection_connect(cons[i]))
+            connected++;
+    }
+
+    Thread_sleep(500);
+
+    int openConnections1 = CS104_Slave_getOpenConnections(slave);
+
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1,
+                                        false, false);
+
+    InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, 1, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+
+    InformationObject_destroy(io);
+
+    CS104_Slave_enqueueASDU(slave, asdu);
+
+    CS101_ASDU_destroy(asdu);
+
+    for (i = 0; i < 60; i++)
+        CS104_Connection_close(cons[i]);
+
+    Thread_sleep(500);
+
+    int openConnections2 = CS104_Slave_getOpenConnections(slave);
+
+    /* the limit can be changed at runtime (closed connection objects are reused) */
+    CS104_Slave_setMaxOpenConnections(slave, 70);
+
+    for (i = 120; i < 130; i++)
+    {
+        cons[i] = CS104_Connection_create("127.0.0.1", 20004);
+
+        CS104_Connection_connect(cons[i]);
+
+        Thread_sleep(20);
+    }
+
+    for (i = 0; i < 60; i++)
+        CS104_Connection_connect(cons[i]);
+
+    Thread_sleep(500);
+
+    int openConnections3 = CS104_Slave_getOpenConnections(slave);
+
+    for (i = 0; i < 130; i++)
+        CS104_Connection_destroy(cons[i]);
+
+    CS104_Slave_stop(slave);
+
+    int openConnections4 = CS104_Slave_getOpenConnections(slave);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(120, connected);
+    TEST_ASSERT_EQUAL_INT(120, openConnections1);
+    TEST_ASSERT_EQUAL_INT(60, openConnections2);
+    TEST_ASSERT_EQUAL_INT(70, openConnections3);
+    TEST_ASSERT_EQUAL_INT(0, openConnections4);
+}
+
+struct stest_CS104SlaveThreadlessReadiness
+{
+    CS104_Slave slave;
+    int connectionFd;
+    int asdusReceived;
+};
+
+static void
+test_CS104SlaveThreadlessReadiness_connectionEventHandler(void* parameter, IMasterConnection con,
+                                                         CS104_PeerConnectionEvent event)
+{
+    struct stest_CS104SlaveThreadlessReadiness* info = (struct stest_CS104SlaveThreadlessReadiness*)parameter;
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+        info->connectionFd = CS104_Slave_getConnectionFileDescriptor(info->slave, con);
+    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED)
+        info->connectionFd = -1;
+}
+
+static bool
+test_CS104SlaveThreadlessReadiness_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    (void)address;
+    (void)asdu;
+
+    struct stest_CS104SlaveThreadlessReadiness* info = (struct stest_CS104SlaveThreadlessReadiness*)parameter;
+
+    info->asdusReceived++;
+
+    return true;
+}
+
+void
+test_CS104SlaveThreadlessReadiness()
+{
+    struct stest_CS104SlaveThreadlessReadiness info;
+    info.connectionFd = -1;
+    info.asdusReceived = 0;
+
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+    info.slave = slave;
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104SlaveThreadlessReadiness_connectionEventHandler, &info);
+
+    CS104_Slave_getConnectionParameters(slave)->t3 = 2;
+
+    CS104_Slave_startThreadless(slave);
+
+    int fds[4];
+
+    int fdsBeforeConnect = CS104_Slave_getFileDescriptors(slave, fds, 4);
+    int serverFd = fds[0];
+
+    /* without connections the application can wait for the maximum time */
+    unsigned int idleWaitTime = CS104_Slave_tick(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104SlaveThreadlessReadiness_asduReceivedHandler, &info);
+
+    bool connected = CS104_Connection_connect(con);
+
+    CS104_Connection_sendStartDT(con);
+
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        unsigned int waitTime = CS104_Slave_tick(slave);
+
+        Thread_sleep((waitTime < 10) ? waitTime : 10);
+    }
+
+    int fdsAfterConnect = CS104_Slave_getFileDescriptors(slave, fds, 4);
+    int connectionFd = info.connectionFd;
+
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1,
+                                        false, false);
+
+    InformationObject io = (InformationObject)MeasuredValueScaled_create(NULL, 110, 1, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+
+    InformationObject_destroy(io);
+
+    CS104_Slave_enqueueASDU(slave, asdu);
+
+    CS101_ASDU_destroy(asdu);
+
+    unsigned int waitTime = 0;
+
+    for (i = 0; i < 100; i++)
+    {
+        waitTime = CS104_Slave_tick(slave);
+
+        if ((info.asdusReceived > 0) && (waitTime > 0))
+            break;
+
+        Thread_sleep(10);
+    }
+
+    /* the next deadline is the T3 timeout of the connection */
+    bool waitTimeLimitedByT3 = (waitTime > 0) && (waitTime <= 2001);
+
+    CS104_Connection_destroy(con);
+
+    for (i = 0; i < 100; i++)
+    {
+        CS104_Slave_tick(slave);
+
+        if (info.connectionFd == -1)
+            break;
+
+        Thread_sleep(10);
+    }
+
+    int fdsAfterClose = CS104_Slave_getFileDescriptors(slave, NULL, 0);
+
+    CS104_Slave_stopThreadless(slave);
+
+    int fdsAfterStop = CS104_Slave_getFileDescriptors(slave, NULL, 0);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(1, fdsBeforeConnect);
+    TEST_ASSERT_TRUE(serverFd >= 0);
+    TEST_ASSERT_TRUE(idleWaitTime > 100);
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_EQUAL_INT(2, fdsAfterConnect);
+    TEST_ASSERT_TRUE(connectionFd >= 0);
+    TEST_ASSERT_EQUAL_INT(connectionFd, fds[1]);
+    TEST_ASSERT_EQUAL_INT(1, info.asdusReceived);
+    TEST_ASSERT_TRUE(waitTimeLimitedByT3);
+    TEST_ASSERT_EQUAL_INT(1, fdsAfterClose);
+    TEST_ASSERT_EQUAL_INT(-1, info.connectionFd);
+    TEST_ASSERT_EQUAL_INT(0, fdsAfterStop);
+}
+
+struct stest_CS104SlaveEventLoopT3Timeouts
+{
+    IMasterConnection connections[3];
+    int testFrActCount[3];
+};
+
+static void
+test_CS104SlaveEventLoopT3Timeouts_rawMessageHandler(void* parameter, IMasterConnection connection, uint8_t* msg,
+                                                     int msgSize, bool sent)
+{
+    struct stest_CS104SlaveEventLoopT3Timeouts* info = (struct stest_CS104SlaveEventLoopT3Timeouts*)parameter;
+
+    if (sent && (msgSize == 6) && (msg[2] == 0x43))
+    {
+        int i;
+
+        for (i = 0; i < 3; i++)
+        {
+            if ((info->connections[i] == NULL) || (info->connections[i] == connection))
+            {
+                info->connections[i] = connection;
+                info->testFrActCount[i]++;
+                break;
+            }
+        }
+    }
+}
+
+void
+test_CS104SlaveEventLoopT3Timeouts()
+{
+    struct stest_CS104SlaveEventLoopT3Timeouts info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setThreadingModel(slave, CS104_THREADING_MODEL_EVENT_LOOP, 1);
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setRawMessageHandler(slave, test_CS104SlaveEventLoopT3Timeouts_rawMessageHandler, &info);
+
+    CS104_Slave_getConnectionParameters(slave)->t3 = 1;
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection cons[3];
+
+    int i;
+
+    int connected = 0;
+
+    for (i = 0; i < 3; i++)
+    {
+        cons[i] = CS104_Connection_create("127.0.0.1", 20004);
+
+        if (CS104_Connection_connect(cons[i]))
+            connected++;
+    }
+
+    /* the connections are idle -> only the T3 timers of the connections wake up the worker */
+    Thread_sleep(2600);
+
+    for (i = 0; i < 3; i++)
+        CS104_Connection_destroy(cons[i]);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(3, connected);
+
+    for (i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_NOT_NULL(info.connections[i]);
+        TEST_ASSERT_TRUE(info.testFrActCount[i] >= 2);
+    }
+}
+
+void
+test_CS104SlaveRedundancyGroupSubnets()
+{
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_RedundancyGroup subnetGroup = CS104_RedundancyGroup_create("subnet");
+    CS104_RedundancyGroup_addAllowedClient(subnetGroup, "127.0.0.0/8");
+    CS104_Slave_addRedundancyGroup(slave, subnetGroup);
+
+    /* the more specific entry is used although the group was added later */
+    CS104_RedundancyGroup hostGroup = CS104_RedundancyGroup_create("host");
+    CS104_RedundancyGroup_addAllowedClient(hostGroup, "192.168.2.0/24");
+    CS104_RedundancyGroup_addAllowedClient(hostGroup, "127.0.0.1");
+    CS104_Slave_addRedundancyGroup(slave, hostGroup);
+
+    CS104_RedundancyGroup otherGroup = CS104_RedundancyGroup_create("other");
+    CS104_RedundancyGroup_addAllowedClient(otherGroup, "2001:db8::/32");
+    CS104_RedundancyGroup_addAllowedClient(otherGroup, "::ffff:127.0.0.1");
+
+    uint8_t network[4] = {127, 1, 0, 0};
+    CS104_RedundancyGroup_addAllowedSubnet(otherGroup, network, IP_ADDRESS_TYPE_IPV4, 16);
+    CS104_Slave_addRedundancyGroup(slave, otherGroup);
+
+    CS104_RedundancyGroup catchAllGroup = CS104_RedundancyGroup_create("catch-all");
+    CS104_Slave_addRedundancyGroup(slave, catchAllGroup);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    bool connected = CS104_Connection_connect(con);
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(500);
+
+    struct sCS104_ConnectionMetrics subnetMetrics;
+    struct sCS104_ConnectionMetrics hostMetrics;
+    struct sCS104_ConnectionMetrics otherMetrics;
+    struct sCS104_ConnectionMetrics catchAllMetrics;
+
+    CS104_Slave_getRedundancyGroupMetrics(slave, subnetGroup, &subnetMetrics);
+    CS104_Slave_getRedundancyGroupMetrics(slave, hostGroup, &hostMetrics);
+    CS104_Slave_getRedundancyGroupMetrics(slave, otherGroup, &otherMetrics);
+    CS104_Slave_getRedundancyGroupMetrics(slave, catchAllGroup, &catchAllMetrics);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(connected);
+
+    TEST_ASSERT_EQUAL_UINT64(0, subnetMetrics.uFramesReceived);
+    TEST_ASSERT_EQUAL_UINT64(1, hostMetrics.uFramesReceived);
+    TEST_ASSERT_EQUAL_UINT64(0, otherMetrics.uFramesReceived);
+    TEST_ASSERT_EQUAL_UINT64(0, catchAllMetrics.uFramesReceived);
+}
+
+struct stest_CS104SlaveAcceptSharding
+{
+    Semaphore lock; /* the handler is called by all workers */
+    int openedEvents;
+    int activatedEvents;
 };
 
+static void
+test_CS104SlaveAcceptSharding_connectionEventHandler(void* parameter, IMasterConnection con,
+                                                     CS104_PeerConnectionEvent event)
+{
+    (void)con;
+
+    struct stest_CS104SlaveAcceptSharding* info = (struct stest_CS104SlaveAcceptSharding*)parameter;
+
+    Semaphore_wait(info->lock);
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+        info->openedEvents++;
+    else if (event == CS104_CON_EVENT_ACTIVATED)
+        info->activatedEvents++;
+
+    Semaphore_post(info->lock);
+}
+
+void
+test_CS104SlaveAcceptSharding()
+{
+    struct stest_CS104SlaveAcceptSharding info;
+    memset(&info, 0, sizeof(info));
+    info.lock = Semaphore_create(1);
+
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setThreadingModel(slave, CS104_THREADING_MODEL_EVENT_LOOP, 3);
+    CS104_Slave_setAcceptSharding(slave, true);
+    CS104_Slave_setMaxOpenConnections(slave, 6);
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104SlaveAcceptSharding_connectionEventHandler, &info);
+
+    CS104_Slave_start(slave);
+
+    bool running = CS104_Slave_isRunning(slave);
+
+    CS104_Connection cons[8];
+
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        cons[i] = CS104_Connection_create("127.0.0.1", 20004);
+
+        if (CS104_Connection_connect(cons[i]))
+            CS104_Connection_sendStartDT(cons[i]);
+    }
+
+    Thread_sleep(500);
+
+    /* the limit is checked by all workers together */
+    int openConnections = CS104_Slave_getOpenConnections(slave);
+
+    for (i = 0; i < 8; i++)
+        CS104_Connection_destroy(cons[i]);
+
+    CS104_Slave_stop(slave);
+
+    CS104_Slave_destroy(slave);
+
+    Semaphore_destroy(info.lock);
+
+    TEST_ASSERT_TRUE(running);
+    TEST_ASSERT_EQUAL_INT(6, openConnections);
+    TEST_ASSERT_EQUAL_INT(6, info.openedEvents);
+    TEST_ASSERT_EQUAL_INT(6, info.activatedEvents);
+}
+
+void
+test_CS104SlaveAcceptShardingPortInUse()
+{
+    CS104_Slave slave1 = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setThreadingModel(slave1, CS104_THREADING_MODEL_EVENT_LOOP, 2);
+    CS104_Slave_setAcceptSharding(slave1, true);
+    CS104_Slave_setLocalPort(slave1, 20004);
+
+    CS104_Slave_start(slave1);
+
+    bool running1 = CS104_Slave_isRunning(slave1);
+
+    /* a second instance must not share the listening port of the first one */
+    CS104_Slave slave2 = CS104_Slave_create(10, 10);
+
+    CS104_Slave_setThreadingModel(slave2, CS104_THREADING_MODEL_EVENT_LOOP, 2);
+    CS104_Slave_setAcceptSharding(slave2, true);
+    CS104_Slave_setLocalPort(slave2, 20004);
+
+    CS104_Slave_start(slave2);
+
+    bool running2 = CS104_Slave_isRunning(slave2);
+
+    CS104_Slave_stop(slave2);
+    CS104_Slave_destroy(slave2);
+
+    CS104_Slave_stop(slave1);
+    CS104_Slave_destroy(slave1);
+
+    TEST_ASSERT_TRUE(running1);
+    TEST_ASSERT_FALSE(running2);
+}
+
 void
 test_CS104SlaveEventQueue1()
 {
@@ -6106,6 +9559,258 @@ test_CS104_MasterSlave_TLSConnectFails(void)
     TEST_ASSERT_EQUAL_INT(TLS_EVENT_CODE_ALM_ALGO_NOT_SUPPORTED, eventInfo.eventCodes[0]);
 }
 
+struct stest_TLSThreadless
+{
+    CS104_Slave slave;
+    bool running;
+    int openedEvents;
+    int closedEvents;
+    IMasterConnection lastOpenedConnection;
+};
+
+static void*
+test_CS104_MasterSlave_TLSThreadless_tickThread(void* parameter)
+{
+    struct stest_TLSThreadless* info = (struct stest_TLSThreadless*)parameter;
+
+    while (info->running)
+    {
+        CS104_Slave_tick(info->slave);
+        Thread_sleep(1);
+    }
+
+    return NULL;
+}
+
+static void
+test_CS104_MasterSlave_TLSThreadless_connectionEventHandler(void* parameter, IMasterConnection connection,
+                                                            CS104_PeerConnectionEvent event)
+{
+    struct stest_TLSThreadless* info = (struct stest_TLSThreadless*)parameter;
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+    {
+        info->lastOpenedConnection = connection;
+        info->openedEvents++;
+    }
+    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED)
+    {
+        info->closedEvents++;
+    }
+}
+
+static bool
+test_CS104_MasterSlave_TLSThreadless_waitForEvents(int* events, int expectedEvents)
+{
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    while ((*events < expectedEvents) && (Hal_getMonotonicTimeInMs() - startTime < 2000))
+        Thread_sleep(10);
+
+    return (*events >= expectedEvents);
+}
+
+void
+test_CS104_MasterSlave_TLSThreadlessFailedHandshake(void)
+{
+    struct stest_TLSThreadless info;
+    memset(&info, 0, sizeof(info));
+
+    bool res = false;
+
+    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig1, true);
+
+    res = TLSConfiguration_setOwnKeyFromFile(tlsConfig1, "server_CA1_1.key", NULL);
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_setOwnCertificateFromFile(tlsConfig1, "server_CA1_1.pem");
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_addCACertificateFromFile(tlsConfig1, "root_CA1.pem");
+    TEST_ASSERT_TRUE(res);
+
+    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig2, true);
+    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+
+    res = TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client_CA1_3.key", NULL);
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client_CA1_3.pem");
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root_CA1.pem");
+    TEST_ASSERT_TRUE(res);
+
+    res = TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server_CA1_1.pem");
+    TEST_ASSERT_TRUE(res);
+
+    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_MasterSlave_TLSThreadless_connectionEventHandler, &info);
+
+    CS104_Slave_startThreadless(slave);
+
+    /* the handshake of the threadless server blocks the tick -> the clients are handled by the test thread */
+    info.slave = slave;
+    info.running = true;
+
+    Thread tickThread = Thread_create(test_CS104_MasterSlave_TLSThreadless_tickThread, &info, false);
+    Thread_start(tickThread);
+
+    /* first client -> the connection object is added to the free connection objects when it is closed */
+    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+
+    bool firstConnected = CS104_Connection_connect(con);
+
+    bool firstOpened = test_CS104_MasterSlave_TLSThreadless_waitForEvents(&info.openedEvents, 1);
+
+    IMasterConnection firstConnection = info.lastOpenedConnection;
+
+    CS104_Connection_destroy(con);
+
+    bool firstClosed = test_CS104_MasterSlave_TLSThreadless_waitForEvents(&info.closedEvents, 1);
+
+    /* client without TLS -> the handshake fails and the connection object has to be released again */
+    Socket socket = TcpSocket_create();
+
+    bool rawConnected = Socket_connect(socket, "127.0.0.1", 20004);
+
+    uint8_t startDtAct[] = {0x68, 0x04, 0x07, 0x00, 0x00, 0x00};
+
+    Socket_write(socket, startDtAct, sizeof(startDtAct));
+
+    Thread_sleep(200);
+
+    Socket_destroy(socket);
+
+    Thread_sleep(200);
+
+    /* second client -> the connection object of the first client is reused */
+    con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+
+    bool secondConnected = CS104_Connection_connect(con);
+
+    bool secondOpened = test_CS104_MasterSlave_TLSThreadless_waitForEvents(&info.openedEvents, 2);
+
+    IMasterConnection secondConnection = info.lastOpenedConnection;
+
+    CS104_Connection_destroy(con);
+
+    info.running = false;
+
+    Thread_destroy(tickThread);
+
+    CS104_Slave_stopThreadless(slave);
+    CS104_Slave_destroy(slave);
+
+    TLSConfiguration_destroy(tlsConfig1);
+    TLSConfiguration_destroy(tlsConfig2);
+
+    TEST_ASSERT_TRUE(firstConnected);
+    TEST_ASSERT_TRUE(firstOpened);
+    TEST_ASSERT_TRUE(firstClosed);
+    TEST_ASSERT_TRUE(rawConnected);
+    TEST_ASSERT_TRUE(secondConnected);
+    TEST_ASSERT_TRUE(secondOpened);
+
+    TEST_ASSERT_EQUAL_INT(2, info.openedEvents);
+    TEST_ASSERT_TRUE(firstConnection == secondConnection);
+}
+
+void
+test_CS104_MasterSlave_TLSEventLoopSilentClient(void)
+{
+    bool res = false;
+
+    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig1, true);
+
+    res = TLSConfiguration_setOwnKeyFromFile(tlsConfig1, "server_CA1_1.key", NULL);
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_setOwnCertificateFromFile(tlsConfig1, "server_CA1_1.pem");
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_addCACertificateFromFile(tlsConfig1, "root_CA1.pem");
+    TEST_ASSERT_TRUE(res);
+
+    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig2, true);
+    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+
+    res = TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client_CA1_3.key", NULL);
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client_CA1_3.pem");
+    TEST_ASSERT_TRUE(res);
+    res = TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root_CA1.pem");
+    TEST_ASSERT_TRUE(res);
+
+    res = TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server_CA1_1.pem");
+    TEST_ASSERT_TRUE(res);
+
+    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setThreadingModel(slave, CS104_THREADING_MODEL_EVENT_LOOP, 2);
+
+    CS104_APCIParameters apciParams = CS104_Slave_getConnectionParameters(slave);
+    apciParams->t0 = 2;
+
+    CS104_Slave_start(slave);
+
+    /* client that connects but doesn't start the handshake */
+    Socket silentClient1 = TcpSocket_create();
+
+    bool silentConnected1 = Socket_connect(silentClient1, "127.0.0.1", 20004);
+
+    Thread_sleep(100);
+
+    /* the handshake of the second client is performed while the first handshake is waiting */
+    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+
+    uint64_t startTime = Hal_getMonotonicTimeInMs();
+
+    bool connected = CS104_Connection_connect(con);
+
+    uint64_t connectTime = Hal_getMonotonicTimeInMs() - startTime;
+
+    CS104_Connection_destroy(con);
+
+    /* all handshake threads are waiting for silent clients when the server is stopped */
+    Socket silentClient2 = TcpSocket_create();
+
+    bool silentConnected2 = Socket_connect(silentClient2, "127.0.0.1", 20004);
+
+    Thread_sleep(100);
+
+    startTime = Hal_getMonotonicTimeInMs();
+
+    CS104_Slave_stop(slave);
+
+    uint64_t stopTime = Hal_getMonotonicTimeInMs() - startTime;
+
+    Socket_destroy(silentClient1);
+    Socket_destroy(silentClient2);
+
+    CS104_Slave_destroy(slave);
+
+    TLSConfiguration_destroy(tlsConfig1);
+    TLSConfiguration_destroy(tlsConfig2);
+
+    TEST_ASSERT_TRUE(silentConnected1);
+    TEST_ASSERT_TRUE(silentConnected2);
+    TEST_ASSERT_TRUE(connected);
+    TEST_ASSERT_TRUE(connectTime < 1000);
+
+    /* the handshakes are aborted after t0 at the latest */
+    TEST_ASSERT_TRUE(stopTime < 3000);
+}
+
 #ifndef WITH_MBEDTLS3
 void
 test_CS104_MasterSlave_TLSVersionMismatch(void)
@@ -10489,6 +14194,47 @@ main(int argc, char** argv)
     RUN_TEST(test_CS104SlaveSingleRedundancyGroupMultipleConnections);
 
     RUN_TEST(test_CS104SlaveEventQueue1);
+    RUN_TEST(test_CS104SlaveEventLoopThreadingModel);
+    RUN_TEST(test_CS104SlaveSharedEventLogConnectionIsRedundancyGroup);
+    RUN_TEST(test_CS104SlaveEventQueueLargeK);
+    RUN_TEST(test_CS104SlaveTxBatching);
+    RUN_TEST(test_CS104SlaveTxCongestion);
+    RUN_TEST(test_CS104SlaveReceiveMultipleAPDUsWithSingleRead);
+    RUN_TEST(test_CS104SlaveEnqueueWakeup);
+    RUN_TEST(test_CS104SlaveIngressQueueMultipleProducers);
+    RUN_TEST(test_CS104SlaveEnqueuePointUpdates);
+    RUN_TEST(test_CS104SlavePersistentEventQueue);
+    RUN_TEST(test_CS104SlavePersistentEventQueueCorruptedEntry);
+    RUN_TEST(test_CS104SlavePersistentEventQueueGroups);
+    RUN_TEST(test_CS104SlaveIngressQueueWithoutConnection);
+    RUN_TEST(test_CS104SlaveQueueMemoryUsage);
+    RUN_TEST(test_CS104SlaveQueueOverflowPolicy);
+    RUN_TEST(test_CS104SlaveQueueOverflowBlock);
+    RUN_TEST(test_CS104SlaveQueueOldestPendingAge);
+    RUN_TEST(test_CS104SlaveLatestValueCoalescing);
+    RUN_TEST(test_CS104SlaveLatestValueCoalescingPersistent);
+    RUN_TEST(test_CS104SlaveStationDatabase);
+    RUN_TEST(test_CS104SlaveInterrogationStreaming);
+    RUN_TEST(test_StationDatabaseDeadband);
+    RUN_TEST(test_CS104SlaveMetrics);
+    RUN_TEST(test_CS104SlaveLatencyHistograms);
+    RUN_TEST(test_CS104LatencyHistogramBuckets);
+    RUN_TEST(test_CS104TimerWheelInsertAndAdvance);
+    RUN_TEST(test_CS104TimerWheelCascading);
+    RUN_TEST(test_CS104TimerWheelRemove);
+    RUN_TEST(test_CS104TimerWheelRandomExpiry);
+    RUN_TEST(test_CS104SlaveAsyncCommands);
+    RUN_TEST(test_CS104SlaveAsyncCommandClosedConnection);
+    RUN_TEST(test_CS104SlaveDynamicConnectionTable);
+    RUN_TEST(test_CS104SlaveThreadlessReadiness);
+    RUN_TEST(test_CS104SlaveEventLoopT3Timeouts);
+    RUN_TEST(test_CS104SlaveRedundancyGroupSubnets);
+    RUN_TEST(test_CS104SlaveAcceptSharding);
+    RUN_TEST(test_CS104SlaveAcceptShardingPortInUse);
+    RUN_TEST(test_CS104SlaveEventQueueReplication);
+    RUN_TEST(test_CS104SlaveEventQueueReplicationResync);
+    RUN_TEST(test_CS104SlaveEventQueueReplicationCoalescing);
+    RUN_TEST(test_CS104SlaveEventQueueReplicationGroups);
     RUN_TEST(test_CS104SlaveEventQueueOverflow);
     RUN_TEST(test_CS104SlaveEventQueueOverflow2);
     RUN_TEST(test_CS104SlaveEventQueueCheckCapacity);
@@ -10514,6 +14260,8 @@ main(int argc, char** argv)
     RUN_TEST(test_CS104_MasterSlave_TLSConnectSuccess);
     RUN_TEST(test_CS104_MasterSlave_TLSConnectSuccessWithoutSeparateCACert);
     RUN_TEST(test_CS104_MasterSlave_TLSConnectFails);
+    RUN_TEST(test_CS104_MasterSlave_TLSThreadlessFailedHandshake);
+    RUN_TEST(test_CS104_MasterSlave_TLSEventLoopSilentClient);
 
 #ifndef WITH_MBEDTLS3
     RUN_TEST(test_CS104_MasterSlave_TLSVersionMismatch);